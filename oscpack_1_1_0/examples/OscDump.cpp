@@ -39,12 +39,17 @@
     OscDump prints incoming OSC packets. Unlike the Berkeley dumposc program
     OscDump uses a different printing format which indicates the type of each
     message argument.
+
+    With -f it prints the packets of a PacketFlightRecorder dump instead,
+    each with the time it was sent and its destination.
 */
 
 
 #include <iostream>
+#include <iomanip>
 #include <cstring>
 #include <cstdlib>
+#include <ctime>
 
 #if defined(__BORLANDC__) // workaround for BCB4 release build intrinsics bug
 namespace std {
@@ -57,6 +62,7 @@ using ::__strcmp__;  // avoid error: E2316 '__strcmp__' is not a member of 'std'
 
 #include "ip/UdpSocket.h"
 #include "ip/PacketListener.h"
+#include "ip/PacketFlightRecorder.h"
 
 
 class OscDumpPacketListener : public PacketListener{
@@ -70,13 +76,58 @@ public:
 	}
 };
 
+// Local time of day with microseconds
+static void PrintTime( int64_t timeNs )
+{
+    std::time_t seconds = (std::time_t)(timeNs / 1000000000LL);
+    char text[32];
+    std::strftime( text, sizeof(text), "%H:%M:%S", std::localtime( &seconds ) );
+    std::cout << text << "." << std::setfill( '0' ) << std::setw( 6 )
+            << (timeNs % 1000000000LL) / 1000 << std::setfill( ' ' );
+}
+
+static int DumpFlightRecording( const char *path )
+{
+    FlightDumpReader reader;
+    if( !reader.Open( path ) ){
+        std::cout << "can't read flight recorder dump " << path << "\n";
+        return 1;
+    }
+
+    std::time_t dumped = (std::time_t)(reader.Header().dumpTimeNs / 1000000000LL);
+    char date[64];
+    std::strftime( date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime( &dumped ) );
+    std::cout << "flight recorder dump written " << date << "\n";
+
+    FlightPacket packet;
+    unsigned long count = 0;
+    while( reader.Next( packet ) ){
+        char destination[IpEndpointName::ADDRESS_AND_PORT_STRING_LENGTH];
+        packet.remoteEndpoint.AddressAndPortAsString( destination );
+        PrintTime( packet.timeNs );
+        std::cout << " -> " << destination << " (" << packet.size << " bytes)\n";
+        try{
+            std::cout << osc::ReceivedPacket( packet.data, (osc::osc_bundle_element_size_t)packet.size );
+        }catch( osc::Exception& e ){
+            std::cout << "not OSC: " << e.what() << "\n";
+        }
+        ++count;
+    }
+    std::cout << count << " packets\n";
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
 	if( argc >= 2 && std::strcmp( argv[1], "-h" ) == 0 ){
         std::cout << "usage: OscDump [port]\n";
+        std::cout << "       OscDump -f <flight recorder dump>\n";
         return 0;
     }
 
+	if( argc >= 3 && std::strcmp( argv[1], "-f" ) == 0 )
+		return DumpFlightRecording( argv[2] );
+
 	int port = 7000;
 
 	if( argc >= 2 )
@@ -0,0 +1,445 @@
+/*
+    PacketFlightRecorder -- keeps the last datagrams sent by any UdpSocket
+    in a ring in memory, to be written out on request or when the process
+    crashes.
+*/
+#include "ip/PacketFlightRecorder.h"
+
+#include <stdio.h>
+#include <signal.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "ip/UdpSocket.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+
+static const char flightDumpMagic_[8] = { 'O', 'S', 'C', 'F', 'L', 'I', 'T', 'E' };
+static const uint32_t flightDumpVersion_ = 1;
+
+static const uint64_t recordAlignment_ = 16;
+static const std::size_t minimumCapacity_ = 65536;
+
+// Never a valid position, the ring starts out filled with it
+static const unsigned char emptyRingByte_ = 0xFF;
+
+static std::atomic<PacketFlightRecorder*> activeRecorder_( (PacketFlightRecorder*)0 );
+static PacketFlightRecorder *crashRecorder_ = 0;
+
+
+static uint64_t RecordLength( std::size_t size )
+{
+    return (sizeof(FlightRecordHeader) + size + recordAlignment_ - 1) & ~(recordAlignment_ - 1);
+}
+
+// Whether two ranges of the ring, each shorter than half of it, overlap
+static bool RingRangesOverlap( uint64_t a, uint64_t aLength, uint64_t b, uint64_t bLength, uint64_t capacity )
+{
+    uint64_t distance = (b - a) & (capacity - 1);
+    return distance < aLength || capacity - distance < bLength;
+}
+
+
+PacketFlightRecorder::PacketFlightRecorder()
+    : ring_( 0 )
+    , capacity_( 0 )
+    , windowNs_( 0 )
+    , startNs_( 0 )
+    , head_( 0 )
+    , skipped_( 0 )
+    , torn_( 0 )
+{
+    crashDumpPath_[0] = '\0';
+    for( int i = 0; i < flightTornRangeCount_; ++i )
+        for( int j = 0; j < 3; ++j )
+            tornRanges_[i][j].store( 0 );
+}
+
+PacketFlightRecorder::~PacketFlightRecorder()
+{
+    Stop();
+}
+
+bool PacketFlightRecorder::Start( std::size_t capacity, double seconds )
+{
+    if( ring_ || activeRecorder_.load() != 0 )
+        return false;
+
+    uint64_t size = minimumCapacity_;
+    while( size < capacity )
+        size <<= 1;
+
+#if defined(_WIN32)
+    HANDLE mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+            (DWORD)(size >> 32), (DWORD)size, NULL );
+    if( mapping == NULL )
+        return false;
+    void *ring = MapViewOfFile( mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size );
+    CloseHandle( mapping ); // the view keeps it alive
+    if( ring == NULL )
+        return false;
+#else
+    void *ring = mmap( NULL, (std::size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if( ring == MAP_FAILED )
+        return false;
+#endif
+
+    // touches every page, so the send path never takes a page fault
+    std::memset( ring, emptyRingByte_, (std::size_t)size );
+
+    ring_ = (char*)ring;
+    capacity_ = size;
+    windowNs_ = (seconds > 0) ? (int64_t)(seconds * 1e9) : 0;
+    startNs_ = Now();
+    head_.store( 0 );
+    skipped_.store( 0 );
+    torn_.store( 0 );
+    for( int i = 0; i < flightTornRangeCount_; ++i )
+        tornRanges_[i][1].store( 0 );
+    activeRecorder_.store( this, std::memory_order_release );
+    return true;
+}
+
+// Sockets must have stopped sending, a Record() in progress would write
+// into the unmapped ring
+void PacketFlightRecorder::Stop()
+{
+    if( !ring_ )
+        return;
+
+    PacketFlightRecorder *self = this;
+    activeRecorder_.compare_exchange_strong( self, (PacketFlightRecorder*)0 );
+    if( crashRecorder_ == this )
+        crashRecorder_ = 0;
+
+#if defined(_WIN32)
+    UnmapViewOfFile( ring_ );
+#else
+    munmap( ring_, (std::size_t)capacity_ );
+#endif
+    ring_ = 0;
+}
+
+PacketFlightRecorder *PacketFlightRecorder::Active()
+{
+    return activeRecorder_.load( std::memory_order_acquire );
+}
+
+int64_t PacketFlightRecorder::Now()
+{
+#if defined(_WIN32)
+    FILETIME time;
+    GetSystemTimePreciseAsFileTime( &time );
+    int64_t ticks = ((int64_t)time.dwHighDateTime << 32) | time.dwLowDateTime;
+    return (ticks - 116444736000000000LL) * 100; // 100 ns since 1601
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_REALTIME, &ts );
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+// Copies to the ring at position, wrapping at its end
+void PacketFlightRecorder::CopyIn( uint64_t position, const void *data, std::size_t size )
+{
+    std::size_t offset = (std::size_t)(position & (capacity_ - 1));
+    std::size_t first = std::min( size, (std::size_t)capacity_ - offset );
+    std::memcpy( ring_ + offset, data, first );
+    if( first < size )
+        std::memcpy( ring_, (const char*)data + first, size - first );
+}
+
+void PacketFlightRecorder::Record( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size, int64_t timeNs )
+{
+    uint64_t length = RecordLength( size );
+    if( length > capacity_ / 2 ){
+        skipped_.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+
+    uint64_t position = head_.fetch_add( length, std::memory_order_relaxed );
+    std::atomic<uint64_t> *slot = (std::atomic<uint64_t>*)(ring_ + (position & (capacity_ - 1)));
+    uint64_t previous = slot->load( std::memory_order_relaxed );
+
+    // Everything but the position, which is at the aligned start of the
+    // record and so never split by the end of the ring
+    FlightRecordHeader header;
+    header.timeNs = timeNs;
+    header.size = (uint32_t)size;
+    header.address = (uint32_t)remoteEndpoint.address;
+    header.port = (uint16_t)remoteEndpoint.port;
+    header.reserved[0] = header.reserved[1] = header.reserved[2] = 0;
+    CopyIn( position + sizeof(uint64_t), &header.timeNs, sizeof(header) - sizeof(uint64_t) );
+    CopyIn( position + sizeof(header), data, size );
+
+    // Commits the record, unless other senders have gone all the way
+    // round the ring meanwhile: then the copies above may have landed in
+    // their newer records, which the dump reader is told about instead
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if( head_.load( std::memory_order_relaxed ) <= position + capacity_
+            && slot->compare_exchange_strong( previous, position, std::memory_order_release ) )
+        return;
+
+    unsigned long torn = torn_.fetch_add( 1, std::memory_order_relaxed );
+    std::atomic<uint64_t> *note = tornRanges_[torn % flightTornRangeCount_];
+    note[1].store( 0, std::memory_order_relaxed );
+    note[0].store( position, std::memory_order_relaxed );
+    note[2].store( head_.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+    note[1].store( length, std::memory_order_release );
+}
+
+void PacketFlightRecorder::Record( const UdpPacket *packets, std::size_t count )
+{
+    int64_t timeNs = Now();
+    for( std::size_t i = 0; i < count; ++i )
+        Record( packets[i].remoteEndpoint, packets[i].data, packets[i].size, timeNs );
+}
+
+double PacketFlightRecorder::SecondsHeld() const
+{
+    double elapsed = (Now() - startNs_) / 1e9;
+    uint64_t bytes = BytesRecorded();
+    if( bytes == 0 || elapsed <= 0 )
+        return 0.;
+    return elapsed * (double)capacity_ / (double)bytes;
+}
+
+
+#if defined(_WIN32)
+
+static bool WriteAll( HANDLE file, const void *data, uint64_t size )
+{
+    const char *p = (const char*)data;
+    while( size > 0 ){
+        DWORD chunk = (DWORD)std::min( size, (uint64_t)(1 << 30) );
+        DWORD written = 0;
+        if( !WriteFile( file, p, chunk, &written, NULL ) || written == 0 )
+            return false;
+        p += written;
+        size -= written;
+    }
+    return true;
+}
+
+#else
+
+static bool WriteAll( int file, const void *data, uint64_t size )
+{
+    const char *p = (const char*)data;
+    while( size > 0 ){
+        ssize_t written = write( file, p, (std::size_t)size );
+        if( written < 0 ){
+            if( errno == EINTR )
+                continue;
+            return false;
+        }
+        p += written;
+        size -= (uint64_t)written;
+    }
+    return true;
+}
+
+#endif
+
+FlightDumpTrailer PacketFlightRecorder::Trailer() const
+{
+    FlightDumpTrailer trailer;
+    trailer.end = head_.load( std::memory_order_acquire );
+    for( int i = 0; i < flightTornRangeCount_; ++i ){
+        trailer.torn[i].length = tornRanges_[i][1].load( std::memory_order_acquire );
+        trailer.torn[i].position = tornRanges_[i][0].load( std::memory_order_relaxed );
+        trailer.torn[i].head = tornRanges_[i][2].load( std::memory_order_relaxed );
+    }
+    return trailer;
+}
+
+bool PacketFlightRecorder::Dump( const char *path ) const
+{
+    if( !ring_ )
+        return false;
+
+    FlightDumpHeader header;
+    std::memcpy( header.magic, flightDumpMagic_, sizeof(header.magic) );
+    header.version = flightDumpVersion_;
+    header.reserved = 0;
+    header.capacity = capacity_;
+    header.end = head_.load( std::memory_order_acquire );
+    header.begin = (header.end > capacity_) ? header.end - capacity_ : 0;
+    header.dumpTimeNs = Now();
+    header.windowNs = windowNs_;
+
+    // The ring from begin to end in two pieces, records that are written
+    // meanwhile are told apart by the write position afterwards
+    std::size_t offset = (std::size_t)(header.begin & (capacity_ - 1));
+    uint64_t length = header.end - header.begin;
+    uint64_t first = std::min( length, capacity_ - offset );
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+    if( file == INVALID_HANDLE_VALUE )
+        return false;
+    bool ok = WriteAll( file, &header, sizeof(header) )
+            && WriteAll( file, ring_ + offset, first )
+            && WriteAll( file, ring_, length - first );
+    FlightDumpTrailer trailer = Trailer();
+    ok = ok && WriteAll( file, &trailer, sizeof(trailer) );
+    CloseHandle( file );
+#else
+    int file = open( path, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( file < 0 )
+        return false;
+    bool ok = WriteAll( file, &header, sizeof(header) )
+            && WriteAll( file, ring_ + offset, first )
+            && WriteAll( file, ring_, length - first );
+    FlightDumpTrailer trailer = Trailer();
+    ok = ok && WriteAll( file, &trailer, sizeof(trailer) );
+    close( file );
+#endif
+    return ok;
+}
+
+
+#if defined(_WIN32)
+
+static LONG WINAPI CrashFilter( EXCEPTION_POINTERS *exception )
+{
+    (void) exception;
+    if( crashRecorder_ )
+        crashRecorder_->Dump( crashRecorder_->CrashDumpPath() );
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+static void AbortHandler( int signal )
+{
+    if( crashRecorder_ )
+        crashRecorder_->Dump( crashRecorder_->CrashDumpPath() );
+    ::signal( signal, SIG_DFL );
+    raise( signal );
+}
+
+#else
+
+// The handler is reset to the default before it runs, so the signal kills
+// the process (with a core dump) once it is raised again
+static void CrashHandler( int signal )
+{
+    if( crashRecorder_ )
+        crashRecorder_->Dump( crashRecorder_->CrashDumpPath() );
+    raise( signal );
+}
+
+#endif
+
+void PacketFlightRecorder::DumpOnCrash( const char *path )
+{
+    std::strncpy( crashDumpPath_, path, sizeof(crashDumpPath_) - 1 );
+    crashDumpPath_[sizeof(crashDumpPath_) - 1] = '\0';
+    crashRecorder_ = this;
+
+#if defined(_WIN32)
+    SetUnhandledExceptionFilter( CrashFilter );
+    signal( SIGABRT, AbortHandler );
+#else
+    struct sigaction action;
+    std::memset( &action, 0, sizeof(action) );
+    action.sa_handler = CrashHandler;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset( &action.sa_mask );
+    const int signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+    for( std::size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i )
+        sigaction( signals[i], &action, NULL );
+#endif
+}
+
+
+FlightDumpReader::FlightDumpReader()
+    : validBegin_( 0 )
+    , next_( 0 )
+{
+    std::memset( &header_, 0, sizeof(header_) );
+    std::memset( &trailer_, 0, sizeof(trailer_) );
+}
+
+bool FlightDumpReader::Open( const char *path )
+{
+    file_.clear();
+    next_ = validBegin_ = 0;
+
+    FILE *file = fopen( path, "rb" );
+    if( !file )
+        return false;
+    char buffer[65536];
+    std::size_t n;
+    while( (n = fread( buffer, 1, sizeof(buffer), file )) > 0 )
+        file_.insert( file_.end(), buffer, buffer + n );
+    fclose( file );
+
+    if( file_.size() < sizeof(header_) + sizeof(trailer_) )
+        return false;
+    std::memcpy( &header_, &file_[0], sizeof(header_) );
+    if( std::memcmp( header_.magic, flightDumpMagic_, sizeof(header_.magic) ) != 0
+            || header_.version != flightDumpVersion_ || header_.end < header_.begin
+            || file_.size() != sizeof(header_) + (header_.end - header_.begin) + sizeof(trailer_) )
+        return false;
+
+    // Records the recorder had started to overwrite while they were dumped
+    std::memcpy( &trailer_, &file_[file_.size() - sizeof(trailer_)], sizeof(trailer_) );
+    uint64_t torn = (trailer_.end > header_.capacity) ? trailer_.end - header_.capacity : 0;
+    validBegin_ = std::max( header_.begin, torn );
+    next_ = (validBegin_ + recordAlignment_ - 1) & ~(recordAlignment_ - 1);
+    return true;
+}
+
+bool FlightDumpReader::Next( FlightPacket& packet )
+{
+    int64_t oldest = (header_.windowNs > 0) ? header_.dumpTimeNs - header_.windowNs : 0;
+
+    while( next_ + sizeof(FlightRecordHeader) <= header_.end ){
+        const char *record = &file_[sizeof(header_) + (std::size_t)(next_ - header_.begin)];
+        FlightRecordHeader header;
+        std::memcpy( &header, record, sizeof(header) );
+
+        // The first records of a dump and any that were still being
+        // written aren't where a record starts, look further
+        uint64_t length = RecordLength( header.size );
+        if( header.position != next_ || next_ + length > header_.end ){
+            next_ += recordAlignment_;
+            continue;
+        }
+        if( Torn( next_, length ) ){
+            next_ += recordAlignment_;
+            continue;
+        }
+        next_ += length;
+        if( header.timeNs < oldest )
+            continue;
+
+        packet.timeNs = header.timeNs;
+        packet.remoteEndpoint = IpEndpointName( (unsigned long)header.address, (int)header.port );
+        packet.data = record + sizeof(header);
+        packet.size = header.size;
+        return true;
+    }
+    return false;
+}
+
+bool FlightDumpReader::Torn( uint64_t position, uint64_t length ) const
+{
+    for( int i = 0; i < flightTornRangeCount_; ++i ){
+        const FlightTornRange& torn = trailer_.torn[i];
+        if( torn.length > 0 && position < torn.head
+                && RingRangesOverlap( position, length, torn.position, torn.length, header_.capacity ) )
+            return true;
+    }
+    return false;
+}
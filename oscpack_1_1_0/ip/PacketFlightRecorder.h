@@ -0,0 +1,175 @@
+/*
+    PacketFlightRecorder -- keeps the last datagrams sent by any UdpSocket
+    in a ring in memory, to be written out on request or when the process
+    crashes.
+*/
+#ifndef INCLUDED_OSCPACK_PACKETFLIGHTRECORDER_H
+#define INCLUDED_OSCPACK_PACKETFLIGHTRECORDER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <cstring> // size_t
+#include <vector>
+
+#include "IpEndpointName.h"
+
+struct UdpPacket;
+
+
+// Each datagram is stored behind this header, records are 16 byte aligned.
+// The position is written last, a record is only valid if it matches the
+// record's offset in the ring.
+struct FlightRecordHeader{
+    uint64_t position;      // offset since the recorder started
+    int64_t timeNs;         // system clock, nanoseconds since 1970
+    uint32_t size;          // datagram bytes following the header
+    uint32_t address;       // destination, as in IpEndpointName
+    uint16_t port;
+    uint16_t reserved[3];
+};
+
+// A sender that stalls in the middle of recording while the whole ring is
+// rewritten may write over newer records that lie where its record was.
+// It doesn't commit its record then and leaves this note instead; records
+// that overlap it and started before head are invalid.
+struct FlightTornRange{
+    uint64_t position;
+    uint64_t length;
+    uint64_t head;          // write position when the sender noticed
+};
+
+static const int flightTornRangeCount_ = 4;
+
+// A dump file is this header, the ring contents from position begin to end
+// in order, and the trailer once they were written.
+struct FlightDumpHeader{
+    char magic[8];          // "OSCFLITE"
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t capacity;
+    uint64_t begin;
+    uint64_t end;
+    int64_t dumpTimeNs;     // system clock when the dump was written
+    int64_t windowNs;       // only the packets this long before it are wanted
+};
+
+struct FlightDumpTrailer{
+    uint64_t end;           // write position, records it had started to overwrite are invalid
+    FlightTornRange torn[flightTornRangeCount_];    // the latest notes, unused ones have length 0
+};
+
+
+//
+// Every datagram passed to UdpSocket::Send(), SendTo() or SendToMultiple()
+// is copied into a ring mapped at Start(), with the time and destination,
+// while a recorder is active. Recording takes an atomic add to claim space,
+// copies the datagram and commits it with a compare and swap, it never
+// locks or allocates, so any number of sockets on any threads can send at
+// the same time. The ring holds the
+// last capacity bytes of traffic, Dump() writes those of the last seconds
+// given to Start() to a file.
+//
+// Dump() only uses async signal safe calls and no locks, so it can run in a
+// signal handler, see DumpOnCrash().
+//
+class PacketFlightRecorder{
+    char *ring_;
+    uint64_t capacity_;     // power of two
+    int64_t windowNs_;
+    int64_t startNs_;
+    std::atomic<uint64_t> head_;
+    std::atomic<unsigned long> skipped_;
+    std::atomic<unsigned long> torn_;
+    std::atomic<uint64_t> tornRanges_[flightTornRangeCount_][3];
+
+    char crashDumpPath_[512];
+
+    void CopyIn( uint64_t position, const void *data, std::size_t size );
+    FlightDumpTrailer Trailer() const;
+
+    PacketFlightRecorder( const PacketFlightRecorder& );
+    PacketFlightRecorder& operator=( const PacketFlightRecorder& );
+
+public:
+    PacketFlightRecorder();
+    ~PacketFlightRecorder();
+
+    // Map a ring of at least capacity bytes, touch all of it so recording
+    // never page faults, and make this the recorder sockets write to.
+    // Dumps cover the last seconds. False if it can't be mapped or another
+    // recorder is active.
+    bool Start( std::size_t capacity, double seconds );
+    void Stop();
+    bool IsActive() const { return ring_ != 0; }
+
+    // The recorder sockets write to, 0 if there is none
+    static PacketFlightRecorder *Active();
+
+    // System clock in nanoseconds since 1970
+    static int64_t Now();
+
+    void Record( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size, int64_t timeNs );
+    void Record( const UdpPacket *packets, std::size_t count );
+
+    // Write the packets of the last seconds to a dump file. False if the
+    // file can't be written.
+    bool Dump( const char *path ) const;
+
+    // Dump to path when the process crashes (SIGSEGV, SIGBUS, SIGILL,
+    // SIGFPE or SIGABRT; an unhandled exception on Win32), then let it crash
+    void DumpOnCrash( const char *path );
+    const char *CrashDumpPath() const { return crashDumpPath_; }
+
+    // Datagrams too large for the ring, not recorded
+    unsigned long Skipped() const { return skipped_.load( std::memory_order_relaxed ); }
+
+    // Datagrams whose sender stalled while the whole ring was rewritten,
+    // see FlightTornRange
+    unsigned long Torn() const { return torn_.load( std::memory_order_relaxed ); }
+    std::size_t Capacity() const { return (std::size_t)capacity_; }
+
+    // Bytes of records written since Start(), the ring holds the last Capacity()
+    uint64_t BytesRecorded() const { return head_.load( std::memory_order_relaxed ); }
+
+    // About how many seconds of traffic the ring holds, at the average rate
+    // since Start()
+    double SecondsHeld() const;
+};
+
+
+// A datagram read back from a dump
+struct FlightPacket{
+    int64_t timeNs;
+    IpEndpointName remoteEndpoint;
+    const char *data;
+    std::size_t size;
+};
+
+//
+// Reads the packets of a dump file in the order they were sent, skipping
+// records that were torn by an overwrite while the dump was written or by
+// a stalled sender.
+//
+class FlightDumpReader{
+    std::vector<char> file_;
+    FlightDumpHeader header_;
+    FlightDumpTrailer trailer_;
+    uint64_t validBegin_;
+    uint64_t next_;
+
+    bool Torn( uint64_t position, uint64_t length ) const;
+
+public:
+    FlightDumpReader();
+
+    // False if the file can't be read or isn't a dump
+    bool Open( const char *path );
+
+    // False after the last packet
+    bool Next( FlightPacket& packet );
+
+    const FlightDumpHeader& Header() const { return header_; }
+};
+
+
+#endif /* INCLUDED_OSCPACK_PACKETFLIGHTRECORDER_H */
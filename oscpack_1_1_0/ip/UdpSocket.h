@@ -76,6 +76,15 @@ public:
 };
 
 
+// A datagram for UdpSocket::SendToMultiple()
+struct UdpPacket{
+    IpEndpointName remoteEndpoint;
+    const char *data;
+    std::size_t size;
+    int error; // set by SendToMultiple(): 0 if sent, otherwise errno (WSAGetLastError() on Win32)
+};
+
+
 class UdpSocket{
     class Implementation;
     Implementation *impl_;
@@ -119,6 +128,12 @@ public:
 	void Send( const char *data, std::size_t size );
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size );
 
+    // Send a batch of datagrams, each to its own endpoint, with as few
+    // system calls as the platform allows (sendmmsg() on Linux). Unlike
+    // Send() and SendTo() errors are reported, in each packet's error
+    // field. Returns the number of packets sent.
+    std::size_t SendToMultiple( UdpPacket *packets, std::size_t count );
+
 
 	// Bind a local endpoint to receive incoming data. Endpoint
 	// can be 'any' for the system to choose an endpoint
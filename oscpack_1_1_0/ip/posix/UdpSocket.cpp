@@ -57,6 +57,7 @@
 #include <stdexcept>
 #include <vector>
 
+#include "ip/PacketFlightRecorder.h"
 #include "ip/PacketListener.h"
 #include "ip/TimerListener.h"
 
@@ -103,6 +104,7 @@ class UdpSocket::Implementation{
 
 	int socket_;
 	struct sockaddr_in connectedAddr_;
+	IpEndpointName connectedEndpoint_; // for the flight recorder
 	struct sockaddr_in sendToAddr_;
 
 public:
@@ -196,6 +198,7 @@ public:
             throw std::runtime_error("unable to connect udp socket\n");
         }
 
+		connectedEndpoint_ = remoteEndpoint;
 		isConnected_ = true;
 	}
 
@@ -203,17 +206,83 @@ public:
 	{
 		assert( isConnected_ );
 
+        if( PacketFlightRecorder *recorder = PacketFlightRecorder::Active() )
+            recorder->Record( connectedEndpoint_, data, size, PacketFlightRecorder::Now() );
+
         send( socket_, data, size, 0 );
 	}
 
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
 	{
+        if( PacketFlightRecorder *recorder = PacketFlightRecorder::Active() )
+            recorder->Record( remoteEndpoint, data, size, PacketFlightRecorder::Now() );
+
 		sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
         sendToAddr_.sin_port = htons( remoteEndpoint.port );
 
         sendto( socket_, data, size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
 	}
 
+    std::size_t SendToMultiple( UdpPacket *packets, std::size_t count )
+	{
+        if( PacketFlightRecorder *recorder = PacketFlightRecorder::Active() )
+            recorder->Record( packets, count );
+
+        std::size_t sent = 0;
+
+#if defined(__linux__)
+        // batches of up to 64 datagrams per sendmmsg(), kept on the stack
+        const std::size_t batchSize = 64;
+        struct mmsghdr messages[batchSize];
+        struct iovec iovecs[batchSize];
+        struct sockaddr_in addresses[batchSize];
+
+        std::size_t i = 0;
+        while( i < count ){
+            std::size_t n = std::min( count - i, batchSize );
+            std::memset( messages, 0, n * sizeof(messages[0]) );
+            for( std::size_t j = 0; j < n; ++j ){
+                const UdpPacket& packet = packets[i + j];
+                SockaddrFromIpEndpointName( addresses[j], packet.remoteEndpoint );
+                iovecs[j].iov_base = const_cast<char*>( packet.data );
+                iovecs[j].iov_len = packet.size;
+                messages[j].msg_hdr.msg_name = &addresses[j];
+                messages[j].msg_hdr.msg_namelen = sizeof(addresses[j]);
+                messages[j].msg_hdr.msg_iov = &iovecs[j];
+                messages[j].msg_hdr.msg_iovlen = 1;
+            }
+
+            int result = sendmmsg( socket_, messages, (unsigned int)n, 0 );
+            if( result <= 0 ){
+                // the first datagram of the batch failed, skip it
+                packets[i].error = (result < 0) ? errno : EIO;
+                ++i;
+                continue;
+            }
+
+            // sendmmsg() stops at the first datagram that fails, the next
+            // round starts with it and reports its error
+            for( int j = 0; j < result; ++j )
+                packets[i + j].error = 0;
+            sent += (std::size_t)result;
+            i += (std::size_t)result;
+        }
+#else
+        struct sockaddr_in address;
+        for( std::size_t i = 0; i < count; ++i ){
+            SockaddrFromIpEndpointName( address, packets[i].remoteEndpoint );
+            if( sendto( socket_, packets[i].data, packets[i].size, 0, (sockaddr*)&address, sizeof(address) ) < 0 ){
+                packets[i].error = errno;
+            }else{
+                packets[i].error = 0;
+                ++sent;
+            }
+        }
+#endif
+
+        return sent;
+	}
+
 	void Bind( const IpEndpointName& localEndpoint )
 	{
 		struct sockaddr_in bindSockAddr;
@@ -289,6 +358,11 @@ void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data,
 	impl_->SendTo( remoteEndpoint, data, size );
 }
 
+std::size_t UdpSocket::SendToMultiple( UdpPacket *packets, std::size_t count )
+{
+	return impl_->SendToMultiple( packets, count );
+}
+
 void UdpSocket::Bind( const IpEndpointName& localEndpoint )
 {
 	impl_->Bind( localEndpoint );
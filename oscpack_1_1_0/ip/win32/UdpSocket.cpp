@@ -54,6 +54,7 @@
                           // std::size_t usage.
 
 #include "ip/NetworkingUtils.h"
+#include "ip/PacketFlightRecorder.h"
 #include "ip/PacketListener.h"
 #include "ip/TimerListener.h"
 
@@ -99,6 +100,7 @@ class UdpSocket::Implementation{
 
 	SOCKET socket_;
 	struct sockaddr_in connectedAddr_;
+	IpEndpointName connectedEndpoint_; // for the flight recorder
 	struct sockaddr_in sendToAddr_;
 
 public:
@@ -189,6 +191,7 @@ public:
             throw std::runtime_error("unable to connect udp socket\n");
         }
 
+		connectedEndpoint_ = remoteEndpoint;
 		isConnected_ = true;
 	}
 
@@ -196,17 +199,43 @@ public:
 	{
 		assert( isConnected_ );
 
+        if( PacketFlightRecorder *recorder = PacketFlightRecorder::Active() )
+            recorder->Record( connectedEndpoint_, data, size, PacketFlightRecorder::Now() );
+
         send( socket_, data, (int)size, 0 );
 	}
 
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
 	{
+        if( PacketFlightRecorder *recorder = PacketFlightRecorder::Active() )
+            recorder->Record( remoteEndpoint, data, size, PacketFlightRecorder::Now() );
+
 		sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
         sendToAddr_.sin_port = htons( (short)remoteEndpoint.port );
 
         sendto( socket_, data, (int)size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
 	}
 
+    std::size_t SendToMultiple( UdpPacket *packets, std::size_t count )
+	{
+        if( PacketFlightRecorder *recorder = PacketFlightRecorder::Active() )
+            recorder->Record( packets, count );
+
+        // no batched send on Win32, one sendto() per datagram
+        std::size_t sent = 0;
+        struct sockaddr_in address;
+        for( std::size_t i = 0; i < count; ++i ){
+            SockaddrFromIpEndpointName( address, packets[i].remoteEndpoint );
+            if( sendto( socket_, packets[i].data, (int)packets[i].size, 0, (sockaddr*)&address, sizeof(address) ) == SOCKET_ERROR ){
+                packets[i].error = WSAGetLastError();
+            }else{
+                packets[i].error = 0;
+                ++sent;
+            }
+        }
+        return sent;
+	}
+
 	void Bind( const IpEndpointName& localEndpoint )
 	{
 		struct sockaddr_in bindSockAddr;
@@ -282,6 +311,11 @@ void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data,
 	impl_->SendTo( remoteEndpoint, data, size );
 }
 
+std::size_t UdpSocket::SendToMultiple( UdpPacket *packets, std::size_t count )
+{
+	return impl_->SendToMultiple( packets, count );
+}
+
 void UdpSocket::Bind( const IpEndpointName& localEndpoint )
 {
 	impl_->Bind( localEndpoint );
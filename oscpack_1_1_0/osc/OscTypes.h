@@ -207,6 +207,40 @@ struct TimeTag{
 };
 
 
+// time tag conversions. a time tag counts seconds since 1900-01-01 (the NTP
+// epoch) in its upper 32 bits and fractions of a second in units of 2^-32 s
+// in its lower 32 bits. these round to the nearest nanosecond / fraction, so
+// nanoseconds -> time tag -> nanoseconds gives back the same value.
+
+// seconds from the NTP epoch to the unix epoch (1970-01-01)
+static const uint64 NTP_UNIX_EPOCH_OFFSET_SECONDS = 2208988800UL;
+
+inline uint64 TimeTagFromNtpNanoseconds( uint64 nanoseconds )
+{
+    uint64 seconds = nanoseconds / 1000000000;
+    uint64 remainder = nanoseconds - seconds * 1000000000;
+    return (seconds << 32) | (((remainder << 32) + 500000000) / 1000000000);
+}
+
+inline uint64 TimeTagToNtpNanoseconds( uint64 timeTag )
+{
+    uint64 fraction = timeTag & 0xFFFFFFFFUL;
+    return (timeTag >> 32) * 1000000000 + ((fraction * 1000000000 + 0x80000000UL) >> 32);
+}
+
+// nanoseconds since the unix epoch, as std::chrono::system_clock counts
+// them on common platforms
+inline uint64 TimeTagFromUnixNanoseconds( int64 nanoseconds )
+{
+    return TimeTagFromNtpNanoseconds( (uint64)(nanoseconds + (int64)NTP_UNIX_EPOCH_OFFSET_SECONDS * 1000000000) );
+}
+
+inline int64 TimeTagToUnixNanoseconds( uint64 timeTag )
+{
+    return (int64)TimeTagToNtpNanoseconds( timeTag ) - (int64)NTP_UNIX_EPOCH_OFFSET_SECONDS * 1000000000;
+}
+
+
 struct Symbol{
     Symbol() {}
     explicit Symbol( const char* value_ ) : value( value_ ) {}
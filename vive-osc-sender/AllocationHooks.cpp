@@ -0,0 +1,198 @@
+//
+// Replacements of the global allocation functions that count every
+// allocation, see AllocationTracker.h. Only linked into instrumentation
+// builds and the allocation tests.
+//
+
+#include "stdafx.h"
+#include "AllocationTracker.h"
+
+#include <new>
+#include <errno.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <malloc.h>		// _aligned_malloc
+#endif
+
+#if defined(__GLIBC__)
+// glibc's own entry points, so the C allocations of libraries are counted
+// as well, operator new goes through them too. The aligned ones all end up
+// in __libc_memalign.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size) noexcept {
+	CountAllocation();
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept {
+	CountAllocation();
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) noexcept {
+	CountAllocation();
+	return __libc_realloc(pointer, size);
+}
+
+void *memalign(size_t alignment, size_t size) noexcept {
+	CountAllocation();
+	return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) noexcept {
+	CountAllocation();
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **pointer, size_t alignment, size_t size) noexcept {
+	if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+		return EINVAL;
+	CountAllocation();
+	void *block = __libc_memalign(alignment, size);
+	if (!block)
+		return ENOMEM;
+	*pointer = block;
+	return 0;
+}
+}
+#define ALLOCATION_HOOKS_COUNT_MALLOC
+#endif
+
+static void *CountedNew(size_t size) {
+#ifndef ALLOCATION_HOOKS_COUNT_MALLOC
+	CountAllocation();
+#endif
+	return malloc(size ? size : 1);
+}
+
+void *operator new(size_t size) {
+	void *pointer = CountedNew(size);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void *operator new[](size_t size) {
+	void *pointer = CountedNew(size);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+	return CountedNew(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+	return CountedNew(size);
+}
+
+void operator delete(void *pointer) noexcept {
+	free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+	free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+	free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept {
+	free(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+	free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+	free(pointer);
+}
+
+#ifdef __cpp_aligned_new
+// The forms new picks for over-aligned types, alignas(64) and the like.
+// Windows has no aligned malloc that free() can release.
+static void *CountedAlignedNew(size_t size, std::align_val_t alignment) {
+	size_t bytes = static_cast<size_t>(alignment);
+	if (bytes < sizeof(void *))
+		bytes = sizeof(void *);
+#ifdef _WIN32
+	CountAllocation();
+	return _aligned_malloc(size ? size : 1, bytes);
+#else
+#ifndef ALLOCATION_HOOKS_COUNT_MALLOC
+	CountAllocation();
+#endif
+	void *pointer = NULL;
+	if (posix_memalign(&pointer, bytes, size ? size : 1) != 0)
+		return NULL;
+	return pointer;
+#endif
+}
+
+static void AlignedFree(void *pointer) {
+#ifdef _WIN32
+	_aligned_free(pointer);
+#else
+	free(pointer);
+#endif
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+	void *pointer = CountedAlignedNew(size, alignment);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+	void *pointer = CountedAlignedNew(size, alignment);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+	return CountedAlignedNew(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+	return CountedAlignedNew(size, alignment);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept {
+	AlignedFree(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+	AlignedFree(pointer);
+}
+
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept {
+	AlignedFree(pointer);
+}
+
+void operator delete[](void *pointer, size_t, std::align_val_t) noexcept {
+	AlignedFree(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t, const std::nothrow_t &) noexcept {
+	AlignedFree(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t, const std::nothrow_t &) noexcept {
+	AlignedFree(pointer);
+}
+#endif
+
+// Before main, so the counts cover the whole run
+static struct AllocationHooks {
+	AllocationHooks() { EnableAllocationTracking(); }
+} s_allocationHooks;
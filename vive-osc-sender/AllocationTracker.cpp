@@ -0,0 +1,34 @@
+//
+// Per thread and total heap allocation counts
+//
+
+#include "stdafx.h"
+#include "AllocationTracker.h"
+
+#include <atomic>
+
+// Plain data only, so reading them from inside malloc never allocates
+static thread_local uint64_t s_threadAllocations = 0;
+static std::atomic<uint64_t> s_totalAllocations(0);
+static bool s_trackingEnabled = false;
+
+void CountAllocation() {
+	s_threadAllocations++;
+	s_totalAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EnableAllocationTracking() {
+	s_trackingEnabled = true;
+}
+
+bool AllocationTrackingEnabled() {
+	return s_trackingEnabled;
+}
+
+uint64_t ThreadAllocationCount() {
+	return s_threadAllocations;
+}
+
+uint64_t TotalAllocationCount() {
+	return s_totalAllocations.load(std::memory_order_relaxed);
+}
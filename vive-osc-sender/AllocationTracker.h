@@ -0,0 +1,37 @@
+// ALLOCATIONTRACKER.h
+#ifndef _ALLOCATIONTRACKER_H_
+#define _ALLOCATIONTRACKER_H_
+
+#include <stdint.h>
+
+//
+// Heap allocation counts, per thread and in total, for proving that the
+// frame path doesn't allocate once it has warmed up.
+//
+// Nothing is counted unless AllocationHooks.cpp is linked into the
+// executable: it replaces every form of the global operator new, aligned
+// ones included (and on glibc malloc, calloc, realloc and the aligned
+// allocators), with versions that call CountAllocation(). The
+// instrumentation build of the sender (VIVE_OSC_TRACK_ALLOCATIONS in CMake)
+// and the allocation tests link it, regular builds don't pay for it.
+//
+// Reading the counts is a thread local load, cheap enough to do around
+// every pipeline stage in any build.
+//
+
+// Called by the hooks for every allocation, must not allocate itself
+void CountAllocation();
+
+// Called once by the hooks, before main
+void EnableAllocationTracking();
+
+// Whether the hooks are linked in, otherwise all counts stay 0
+bool AllocationTrackingEnabled();
+
+// Allocations made by the calling thread so far
+uint64_t ThreadAllocationCount();
+
+// Allocations made by all threads so far
+uint64_t TotalAllocationCount();
+
+#endif // _ALLOCATIONTRACKER_H_
@@ -0,0 +1,182 @@
+//
+// Quantized poses of a whole frame in one OSC blob
+//
+
+#include "stdafx.h"
+#include "CompactPose.h"
+
+#include <math.h>
+#include <stdint.h>
+
+// Largest magnitude of the three smallest components of a unit quaternion
+static const float k_fSmallestThreeRange = 0.70710678f;
+
+static float Clamp(float value, float lowest, float highest) {
+	return value < lowest ? lowest : value > highest ? highest : value;
+}
+
+static void WriteBigEndian(char *p, uint64_t value, std::size_t bytes) {
+	for (std::size_t n = 0; n < bytes; n++)
+		p[n] = static_cast<char>(value >> (8 * (bytes - 1 - n)));
+}
+
+static uint64_t ReadBigEndian(const char *p, std::size_t bytes) {
+	uint64_t value = 0;
+	for (std::size_t n = 0; n < bytes; n++)
+		value = (value << 8) | static_cast<unsigned char>(p[n]);
+	return value;
+}
+
+static std::size_t RotationBytes(int rotationBits) {
+	return (2 + 3 * rotationBits + 7) / 8;
+}
+
+bool CompactPoseFormat::IsValid() const {
+	return resolution > 0 && (positionBits == 16 || positionBits == 24)
+		&& rotationBits >= k_nMinCompactRotationBits && rotationBits <= k_nMaxCompactRotationBits;
+}
+
+std::size_t CompactPoseFormat::RecordSize() const {
+	return 1 + 3 * (positionBits / 8) + RotationBytes(rotationBits);
+}
+
+bool CompactPoseFormat::operator==(const CompactPoseFormat &other) const {
+	return resolution == other.resolution && positionBits == other.positionBits && rotationBits == other.rotationBits;
+}
+
+void CompactPoseWriter::Begin(const CompactPoseFormat &format) {
+	m_format = format;
+	m_count = 0;
+	m_size = k_unCompactPoseHeaderSize;
+
+	union { float f; uint32_t i; } u;
+	u.f = format.resolution;
+	m_data[0] = static_cast<char>(k_nCompactPoseVersion);
+	m_data[1] = static_cast<char>(format.positionBits);
+	m_data[2] = static_cast<char>(format.rotationBits);
+	m_data[3] = 0;
+	WriteBigEndian(m_data + 4, u.i, 4);
+}
+
+void QuantizePose(const CompactPoseFormat &format, const float position[3], const float quaternion[4], QuantizedPose &pose) {
+	// Fixed point, clamped to the signed range
+	float limit = static_cast<float>((1 << (format.positionBits - 1)) - 1);
+	for (int k = 0; k < 3; k++)
+		pose.position[k] = static_cast<int32_t>(Clamp(floorf(position[k] / format.resolution + 0.5f), -limit, limit));
+
+	// Smallest three, with the largest component made positive (q and -q
+	// are the same rotation) so its sign needn't be sent
+	int largest = 0;
+	for (int k = 1; k < 4; k++)
+		if (fabsf(quaternion[k]) > fabsf(quaternion[largest]))
+			largest = k;
+	float sign = quaternion[largest] < 0 ? -1.0f : 1.0f;
+	float scale = static_cast<float>((1 << format.rotationBits) - 1) / (2 * k_fSmallestThreeRange);
+	pose.largest = largest;
+	for (int k = 0, field = 0; k < 4; k++) {
+		if (k == largest)
+			continue;
+		float value = Clamp(sign * quaternion[k], -k_fSmallestThreeRange, k_fSmallestThreeRange);
+		pose.rotation[field++] = static_cast<int32_t>(floorf((value + k_fSmallestThreeRange) * scale + 0.5f));
+	}
+}
+
+void DequantizePose(const CompactPoseFormat &format, const QuantizedPose &pose, float position[3], float quaternion[4]) {
+	for (int k = 0; k < 3; k++)
+		position[k] = static_cast<float>(pose.position[k]) * format.resolution;
+
+	float step = 2 * k_fSmallestThreeRange / static_cast<float>((1 << format.rotationBits) - 1);
+	float sumOfSquares = 0;
+	for (int k = 0, field = 0; k < 4; k++) {
+		if (k == pose.largest)
+			continue;
+		float value = static_cast<float>(pose.rotation[field++]) * step - k_fSmallestThreeRange;
+		quaternion[k] = value;
+		sumOfSquares += value * value;
+	}
+	quaternion[pose.largest] = sqrtf(sumOfSquares < 1 ? 1 - sumOfSquares : 0);
+}
+
+bool CompactPoseWriter::Add(bool isController, int ordinal, const float position[3], const float quaternion[4]) {
+	std::size_t recordSize = m_format.RecordSize();
+	if (m_size + recordSize > sizeof(m_data) || m_count == 255)
+		return false;
+	char *p = m_data + m_size;
+
+	*p++ = static_cast<char>((isController ? 0x80 : 0) | (ordinal & 0x7f));
+
+	QuantizedPose pose;
+	QuantizePose(m_format, position, quaternion, pose);
+	std::size_t positionBytes = m_format.positionBits / 8;
+	for (int k = 0; k < 3; k++) {
+		WriteBigEndian(p, static_cast<uint64_t>(static_cast<int64_t>(pose.position[k])), positionBytes);
+		p += positionBytes;
+	}
+
+	int bits = m_format.rotationBits;
+	uint64_t packed = static_cast<uint64_t>(pose.largest);
+	for (int k = 0; k < 3; k++)
+		packed = (packed << bits) | static_cast<uint64_t>(pose.rotation[k]);
+	std::size_t rotationBytes = RotationBytes(bits);
+	WriteBigEndian(p, packed << (8 * rotationBytes - (2 + 3 * bits)), rotationBytes);
+
+	m_size += recordSize;
+	m_count++;
+	m_data[3] = static_cast<char>(m_count);
+	return true;
+}
+
+bool DecodeCompactPoses(const void *data, std::size_t size, CompactPoseFormat &format,
+	CompactPose *poses, int maxPoses, int &count) {
+	count = 0;
+	const char *p = static_cast<const char *>(data);
+	if (size < k_unCompactPoseHeaderSize || p[0] != k_nCompactPoseVersion)
+		return false;
+
+	union { float f; uint32_t i; } u;
+	u.i = static_cast<uint32_t>(ReadBigEndian(p + 4, 4));
+	format.positionBits = static_cast<unsigned char>(p[1]);
+	format.rotationBits = static_cast<unsigned char>(p[2]);
+	format.resolution = u.f;
+	int devices = static_cast<unsigned char>(p[3]);
+	if (!format.IsValid() || size != k_unCompactPoseHeaderSize + devices * format.RecordSize())
+		return false;
+	p += k_unCompactPoseHeaderSize;
+
+	std::size_t positionBytes = format.positionBits / 8;
+	int bits = format.rotationBits;
+	std::size_t rotationBytes = RotationBytes(bits);
+	uint64_t mask = (static_cast<uint64_t>(1) << bits) - 1;
+	for (int n = 0; n < devices && n < maxPoses; n++) {
+		CompactPose &pose = poses[n];
+		unsigned char id = static_cast<unsigned char>(*p++);
+		pose.isController = (id & 0x80) != 0;
+		pose.ordinal = id & 0x7f;
+
+		QuantizedPose quantized;
+		for (int k = 0; k < 3; k++) {
+			// Sign extend from the field width
+			int shift = 64 - format.positionBits;
+			quantized.position[k] = static_cast<int32_t>(static_cast<int64_t>(ReadBigEndian(p, positionBytes) << shift) >> shift);
+			p += positionBytes;
+		}
+
+		uint64_t packed = ReadBigEndian(p, rotationBytes) >> (8 * rotationBytes - (2 + 3 * bits));
+		p += rotationBytes;
+		quantized.largest = static_cast<int>(packed >> (3 * bits));
+		for (int k = 0; k < 3; k++)
+			quantized.rotation[k] = static_cast<int32_t>((packed >> (bits * (2 - k))) & mask);
+
+		DequantizePose(format, quantized, pose.position, pose.quaternion);
+		count++;
+	}
+	return true;
+}
+
+bool DecodeCompactPoses(const osc::ReceivedMessageArgument &argument, CompactPoseFormat &format,
+	CompactPose *poses, int maxPoses, int &count) {
+	const void *data;
+	osc::osc_bundle_element_size_t size;
+	argument.AsBlob(data, size);
+	return DecodeCompactPoses(data, static_cast<std::size_t>(size), format, poses, maxPoses, count);
+}
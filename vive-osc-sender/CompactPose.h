@@ -0,0 +1,110 @@
+// COMPACTPOSE.h
+#ifndef _COMPACTPOSE_H_
+#define _COMPACTPOSE_H_
+
+#include <cstring> // size_t
+#include <stdint.h>
+
+#include "PoseSource.h"
+#include "osc/OscReceivedElements.h"
+
+// Address of the message that carries a frame's compact poses as one blob
+static const char *const k_pchCompactPoseAddress = "/poses";
+
+static const int k_nCompactPoseVersion = 1;
+
+// Version, position bits, rotation bits, device count, resolution (float)
+static const std::size_t k_unCompactPoseHeaderSize = 8;
+
+// Device id, 3 x 24 bit position, 2 + 3 x 15 bit rotation
+static const std::size_t k_unMaxCompactPoseRecordSize = 1 + 9 + 6;
+static const std::size_t k_unMaxCompactPoseSize = k_unCompactPoseHeaderSize + k_unMaxDeviceCount * k_unMaxCompactPoseRecordSize;
+
+// Bits of each of the three smallest quaternion components
+static const int k_nMinCompactRotationBits = 10;
+static const int k_nMaxCompactRotationBits = 15;
+
+//
+// How positions and rotations are quantized.
+//
+// Positions are signed fixed point, resolution metres per step; 16 bits at
+// the default 0.2 mm cover +-6.5 m, 24 bits cover +-1.6 km at that
+// resolution. Positions outside the range are clamped to it.
+//
+// Rotations are sent "smallest three": the index of the quaternion's
+// largest component in 2 bits, then the other three, which can't be larger
+// than 1/sqrt(2), in rotationBits each. The largest is restored from the
+// unit length. 15 bits are within 0.01 degrees, 10 bits within 0.25.
+//
+struct CompactPoseFormat {
+	float resolution = 0.0002f;	// metres
+	int positionBits = 16;		// 16 or 24
+	int rotationBits = 15;		// k_nMinCompactRotationBits .. k_nMaxCompactRotationBits
+
+	bool IsValid() const;
+	std::size_t RecordSize() const;
+	bool operator==(const CompactPoseFormat &other) const;
+};
+
+// A pose as the integers it is sent as
+struct QuantizedPose {
+	int32_t position[3];	// resolution steps
+	int largest;			// index of the quaternion component left out
+	int32_t rotation[3];	// the other three, 0 .. 2^rotationBits - 1
+};
+
+// Quantize a pose as the format says, and back
+void QuantizePose(const CompactPoseFormat &format, const float position[3], const float quaternion[4], QuantizedPose &pose);
+void DequantizePose(const CompactPoseFormat &format, const QuantizedPose &pose, float position[3], float quaternion[4]);
+
+// A decoded device. The id matches the OSC addresses of the float
+// messages: "/controller/<ordinal>" or "/tracker/<ordinal>".
+struct CompactPose {
+	bool isController;
+	int ordinal;
+	float position[3];
+	float quaternion[4];	// w, x, y, z, unit length
+};
+
+//
+// Builds the blob of one frame: a header, then one record per device, all
+// big endian like the rest of OSC.
+//
+//   header: version, position bits, rotation bits, device count (1 byte
+//           each), resolution in metres (float)
+//   record: device id (1 byte, bit 7 set for controllers, ordinal in the
+//           low 7 bits), x, y, z (positionBits / 8 bytes each), rotation
+//           (2 + 3 x rotationBits bits, zero padded to whole bytes)
+//
+// Fixed size, nothing is allocated per frame.
+//
+class CompactPoseWriter {
+private:
+	char m_data[k_unMaxCompactPoseSize];
+	std::size_t m_size = 0;
+	int m_count = 0;
+	CompactPoseFormat m_format;
+
+public:
+	void Begin(const CompactPoseFormat &format);
+
+	// Returns false when the blob is full
+	bool Add(bool isController, int ordinal, const float position[3], const float quaternion[4]);
+
+	int Count() const { return m_count; }
+	const char *Data() const { return m_data; }
+	std::size_t Size() const { return m_size; }
+};
+
+// Decodes a blob written by CompactPoseWriter into up to maxPoses poses.
+// Returns false, with count 0, if the blob is malformed or of an unknown
+// version.
+bool DecodeCompactPoses(const void *data, std::size_t size, CompactPoseFormat &format,
+	CompactPose *poses, int maxPoses, int &count);
+
+// Same, from the blob argument of a received k_pchCompactPoseAddress
+// message. Throws osc::WrongArgumentTypeException if it isn't a blob.
+bool DecodeCompactPoses(const osc::ReceivedMessageArgument &argument, CompactPoseFormat &format,
+	CompactPose *poses, int maxPoses, int &count);
+
+#endif // _COMPACTPOSE_H_
@@ -0,0 +1,201 @@
+//
+// Quit, device list, latency and flight dump requests from signals and an OSC control port
+//
+
+#include "stdafx.h"
+#include "ControlChannel.h"
+#include "ip/PacketFlightRecorder.h"
+
+#include <signal.h>
+#include <string.h>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// How often the control thread looks for a device list or latencies to print
+static const int k_nControlPollMilliseconds = 100;
+
+// Set from signal handlers, where only lock-free atomics are safe
+static std::atomic<bool> s_signalQuit(false);
+static std::atomic<bool> s_signalDeviceList(false);
+static std::atomic<bool> s_signalLatency(false);
+static std::atomic<bool> s_signalFlightDump(false);
+
+#ifdef _WIN32
+static BOOL WINAPI ConsoleControlHandler(DWORD controlType) {
+	switch (controlType) {
+	case CTRL_C_EVENT:
+	case CTRL_BREAK_EVENT:
+	case CTRL_CLOSE_EVENT:
+	case CTRL_SHUTDOWN_EVENT:
+		s_signalQuit = true;
+		return TRUE;
+	}
+	return FALSE;
+}
+#else
+static void SignalHandler(int signal) {
+	if (signal == SIGUSR1)
+		s_signalDeviceList = true;
+	else if (signal == SIGUSR2)
+		s_signalLatency = true;
+	else if (signal == SIGQUIT)
+		s_signalFlightDump = true;
+	else
+		s_signalQuit = true;
+}
+#endif
+
+static const char *DeviceClassName(DeviceClass deviceClass) {
+	switch (deviceClass) {
+	case DeviceClass_HMD: return "HMD";
+	case DeviceClass_Controller: return "Controller";
+	case DeviceClass_GenericTracker: return "GenericTracker";
+	case DeviceClass_TrackingReference: return "TrackingReference";
+	case DeviceClass_DisplayRedirect: return "DisplayRedirect";
+	default: return "Invalid";
+	}
+}
+
+ControlChannel::ControlChannel()
+	: m_stop(false), m_quitRequested(false), m_deviceListRequested(false), m_latencyRequested(false)
+	, m_keyframeRequested(false), m_flightDumpRequested(false) {
+}
+
+ControlChannel::~ControlChannel() {
+	Stop();
+	delete m_pSocket;
+}
+
+bool ControlChannel::Start(int port) {
+	if (m_thread.joinable())
+		return true;
+
+#ifdef _WIN32
+	SetConsoleCtrlHandler(ConsoleControlHandler, TRUE);
+#else
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = SignalHandler;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	sigaction(SIGUSR1, &action, NULL);
+	sigaction(SIGUSR2, &action, NULL);
+	sigaction(SIGQUIT, &action, NULL);
+#endif
+
+	if (port != 0) {
+		try {
+			m_pSocket = new UdpReceiveSocket(IpEndpointName(IpEndpointName::ANY_ADDRESS, port));
+		} catch (std::runtime_error &e) {
+			printf_s("Can't listen for control messages on port %d: %s\n", port, e.what());
+			return false;
+		}
+		m_mux.AttachSocketListener(m_pSocket, this);
+	}
+	m_mux.AttachPeriodicTimerListener(k_nControlPollMilliseconds, this);
+	m_stop = false;
+	m_thread = std::thread(&SocketReceiveMultiplexer::Run, &m_mux);
+	return true;
+}
+
+void ControlChannel::Stop() {
+	if (!m_thread.joinable())
+		return;
+	// Run() clears a break that comes before it started, the timer catches that
+	m_stop = true;
+	m_mux.AsynchronousBreak();
+	m_thread.join();
+}
+
+bool ControlChannel::QuitRequested() const {
+	return m_quitRequested.load(std::memory_order_relaxed) || s_signalQuit.load(std::memory_order_relaxed);
+}
+
+bool ControlChannel::TakeDeviceListRequest() {
+	// Cheap check first, the exchanges are a locked instruction each
+	if (!m_deviceListRequested.load(std::memory_order_relaxed) && !s_signalDeviceList.load(std::memory_order_relaxed))
+		return false;
+	bool requested = m_deviceListRequested.exchange(false);
+	return s_signalDeviceList.exchange(false) || requested;
+}
+
+bool ControlChannel::TakeKeyframeRequest() {
+	return m_keyframeRequested.load(std::memory_order_relaxed) && m_keyframeRequested.exchange(false);
+}
+
+bool ControlChannel::TakeLatencyRequest() {
+	bool requested = m_latencyRequested.exchange(false);
+	return s_signalLatency.exchange(false) || requested;
+}
+
+void ControlChannel::PublishDevices(const DeviceRegistry &registry) {
+	std::lock_guard<std::mutex> lock(m_devicesMutex);
+	m_devices = registry;
+	m_devicesPending = true;
+}
+
+// Anyone can send to the control port, a malformed packet mustn't end the thread
+void ControlChannel::ProcessPacket(const char *data, int size, const IpEndpointName &remoteEndpoint) {
+	try {
+		osc::OscPacketListener::ProcessPacket(data, size, remoteEndpoint);
+	} catch (osc::Exception &e) {
+		printf_s("Ignoring malformed control message: %s\n", e.what());
+	}
+}
+
+void ControlChannel::ProcessMessage(const osc::ReceivedMessage &m, const IpEndpointName &remoteEndpoint) {
+	(void)remoteEndpoint;
+	if (strcmp(m.AddressPattern(), k_pchQuitAddress) == 0)
+		m_quitRequested = true;
+	else if (strcmp(m.AddressPattern(), k_pchDevicesAddress) == 0)
+		m_deviceListRequested = true;
+	else if (strcmp(m.AddressPattern(), k_pchLatencyAddress) == 0)
+		m_latencyRequested = true;
+	else if (strcmp(m.AddressPattern(), k_pchKeyframeAddress) == 0)
+		m_keyframeRequested = true;
+	else if (strcmp(m.AddressPattern(), k_pchFlightDumpAddress) == 0)
+		m_flightDumpRequested = true;
+}
+
+void ControlChannel::TimerExpired() {
+	if (m_stop) {
+		m_mux.Break();
+		return;
+	}
+
+	if (m_pLatency && TakeLatencyRequest()) {
+		printf_s("\n");
+		m_pLatency->Print();
+		fflush(stdout);
+	}
+
+	bool flightDumpRequested = m_flightDumpRequested.exchange(false);
+	if ((s_signalFlightDump.exchange(false) || flightDumpRequested) && m_pchFlightDumpPath) {
+		PacketFlightRecorder *recorder = PacketFlightRecorder::Active();
+		if (!recorder)
+			printf_s("\nThe flight recorder is off, nothing to dump\n");
+		else if (recorder->Dump(m_pchFlightDumpPath))
+			printf_s("\nFlight recorder dumped to %s\n", m_pchFlightDumpPath);
+		else
+			printf_s("\nCan't write flight recorder dump %s\n", m_pchFlightDumpPath);
+		fflush(stdout);
+	}
+
+	std::lock_guard<std::mutex> lock(m_devicesMutex);
+	if (!m_devicesPending)
+		return;
+	m_devicesPending = false;
+
+	printf_s("\nDevice list:\n---------------------------\n");
+	for (int n = 0; n < m_devices.DeviceCount(); n++) {
+		const RegisteredDevice &device = m_devices.Device(n);
+		printf_s("Device %d: [%s] [%s] %s\n", device.unDevice, DeviceClassName(device.deviceClass),
+			device.serial, device.oscAddress[0] ? device.oscAddress : "(not sent)");
+	}
+	printf_s("---------------------------\n\n");
+	fflush(stdout);
+}
@@ -0,0 +1,100 @@
+// CONTROLCHANNEL.h
+#ifndef _CONTROLCHANNEL_H_
+#define _CONTROLCHANNEL_H_
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "osc/OscPacketListener.h"
+#include "ip/UdpSocket.h"
+#include "ip/TimerListener.h"
+#include "DeviceRegistry.h"
+#include "LatencyHistogram.h"
+
+// OSC addresses the control port understands
+static const char *const k_pchQuitAddress = "/vive-osc-sender/quit";
+static const char *const k_pchDevicesAddress = "/vive-osc-sender/devices";
+static const char *const k_pchLatencyAddress = "/vive-osc-sender/latency";
+static const char *const k_pchKeyframeAddress = "/vive-osc-sender/keyframe";
+static const char *const k_pchFlightDumpAddress = "/vive-osc-sender/flight-dump";
+
+//
+// Quit, device list and latency requests for a sender running without a
+// console, from signals (SIGINT / SIGTERM quit, SIGUSR1 lists the devices,
+// SIGUSR2 prints the stage latencies, SIGQUIT dumps the packet flight
+// recorder; console close and Ctrl-C events on Windows) and from OSC
+// messages to a control port. Receivers of compact pose streams can also
+// ask for a keyframe there.
+//
+// Requests arrive on the control thread or in a signal handler and only
+// set flags; the frame loop polls those with an atomic load per frame.
+// A device list is handed back to the control thread as a copy of the
+// registry and printed there, so the frame loop never touches the console.
+// Latency histograms can be read while they are written, the control thread
+// prints them without involving the frame loop at all.
+//
+class ControlChannel : public osc::OscPacketListener, public TimerListener {
+private:
+	SocketReceiveMultiplexer m_mux;
+	UdpReceiveSocket *m_pSocket = NULL;
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+
+	std::atomic<bool> m_quitRequested;
+	std::atomic<bool> m_deviceListRequested;
+
+	// Registry copy from the frame loop, waiting to be printed
+	std::mutex m_devicesMutex;
+	DeviceRegistry m_devices;
+	bool m_devicesPending = false;
+
+	std::atomic<bool> m_latencyRequested;
+	std::atomic<bool> m_keyframeRequested;
+	const PipelineLatency *m_pLatency = NULL;
+
+	// Flight recorder dumps are written by the control thread
+	std::atomic<bool> m_flightDumpRequested;
+	const char *m_pchFlightDumpPath = NULL;
+
+	void ProcessPacket(const char *data, int size, const IpEndpointName &remoteEndpoint);
+	void ProcessMessage(const osc::ReceivedMessage &m, const IpEndpointName &remoteEndpoint);
+	void TimerExpired();
+
+	ControlChannel(const ControlChannel &);
+	ControlChannel &operator=(const ControlChannel &);
+
+public:
+	ControlChannel();
+	~ControlChannel();
+
+	// Histograms to print on a latency request, set before Start()
+	void SetLatencyReport(const PipelineLatency *latency) { m_pLatency = latency; }
+
+	// Where to dump the active PacketFlightRecorder on request, set before Start()
+	void SetFlightDumpPath(const char *path) { m_pchFlightDumpPath = path; }
+
+	// Install the signal handlers and start the control thread, listening
+	// for OSC requests on port if it isn't 0. False if the port can't be bound.
+	bool Start(int port);
+	void Stop();
+
+	// Polled by the frame loop
+	bool QuitRequested() const;
+
+	// True once per device list request
+	bool TakeDeviceListRequest();
+
+	// True once per keyframe request
+	bool TakeKeyframeRequest();
+
+	// True once per latency request. The control thread takes them itself
+	// when a latency report is set.
+	bool TakeLatencyRequest();
+
+	// Called by the frame loop after TakeDeviceListRequest(), the control
+	// thread prints the copy
+	void PublishDevices(const DeviceRegistry &registry);
+};
+
+#endif // _CONTROLCHANNEL_H_
@@ -0,0 +1,85 @@
+//
+// Per device change detection with keepalive
+//
+
+#include "stdafx.h"
+#include "DeadbandFilter.h"
+
+#include <math.h>
+#include <string.h>
+
+static const double k_dDegreesToRadians = 3.14159265358979323846 / 180.0;
+
+DeadbandFilter::DeadbandFilter() {
+	memset(m_devices, 0, sizeof(m_devices));
+	SetConfig(DeadbandConfig());
+}
+
+void DeadbandFilter::SetConfig(const DeadbandConfig &config) {
+	m_config = config;
+	m_positionThresholdSquared = config.positionThreshold * config.positionThreshold;
+	m_minQuaternionDot = static_cast<float>(cos(config.angleThreshold * k_dDegreesToRadians / 2));
+	m_keepaliveNs = static_cast<int64_t>(config.keepaliveSeconds * 1e9);
+}
+
+void DeadbandFilter::Reset(DeviceIndex device, const char *address) {
+	DeviceState &state = m_devices[device];
+	state.hasSent = false;
+	sprintf_s(state.address, sizeof(state.address), "%s", address);
+}
+
+bool DeadbandFilter::ShouldSend(DeviceIndex device, const float position[3], const float quaternion[4],
+	const float *values, int valueCount, int64_t nowNs) {
+	DeviceState &state = m_devices[device];
+
+	if (state.hasSent && m_config.enabled) {
+		float dx = position[0] - state.position[0];
+		float dy = position[1] - state.position[1];
+		float dz = position[2] - state.position[2];
+		float dot = quaternion[0] * state.quaternion[0] + quaternion[1] * state.quaternion[1]
+			+ quaternion[2] * state.quaternion[2] + quaternion[3] * state.quaternion[3];
+
+		bool moved = dx * dx + dy * dy + dz * dz > m_positionThresholdSquared
+			|| fabsf(dot) < m_minQuaternionDot
+			|| valueCount != state.valueCount;
+		for (int n = 0; n < valueCount && !moved; n++)
+			moved = (values[n] != state.values[n]);
+		if (!moved) {
+			if (nowNs - state.lastSentNs < m_keepaliveNs) {
+				state.suppressed++;
+				return false;
+			}
+			state.keepalives++;
+		}
+	}
+
+	state.hasSent = true;
+	memcpy(state.position, position, sizeof(state.position));
+	memcpy(state.quaternion, quaternion, sizeof(state.quaternion));
+	memcpy(state.values, values, valueCount * sizeof(float));
+	state.valueCount = valueCount;
+	state.lastSentNs = nowNs;
+	state.sent++;
+	return true;
+}
+
+void DeadbandFilter::PrintStatistics() const {
+	if (!m_config.enabled)
+		return;
+
+	printf_s("Deadband (%.1f mm, %.2f deg, keepalive %.0f ms):\n",
+		m_config.positionThreshold * 1000, m_config.angleThreshold, m_config.keepaliveSeconds * 1000);
+	unsigned long totalSent = 0, totalSuppressed = 0;
+	for (DeviceIndex i = 0; i < k_unMaxDeviceCount; i++) {
+		const DeviceState &state = m_devices[i];
+		unsigned long total = state.sent + state.suppressed;
+		if (total == 0)
+			continue;
+		printf_s("  %-16s sent %8lu (%lu keepalives), suppressed %8lu, %5.1f%% suppressed\n",
+			state.address, state.sent, state.keepalives, state.suppressed, 100.0 * state.suppressed / total);
+		totalSent += state.sent;
+		totalSuppressed += state.suppressed;
+	}
+	if (totalSent + totalSuppressed > 0)
+		printf_s("  all devices: %.1f%% of messages suppressed\n", 100.0 * totalSuppressed / (totalSent + totalSuppressed));
+}
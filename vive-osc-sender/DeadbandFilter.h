@@ -0,0 +1,80 @@
+// DEADBANDFILTER.h
+#ifndef _DEADBANDFILTER_H_
+#define _DEADBANDFILTER_H_
+
+#include <stdint.h>
+#include "PoseSource.h"
+#include "DeviceRegistry.h"
+
+struct DeadbandConfig {
+	bool enabled = false;
+	float positionThreshold = 0.001f;	// metres
+	float angleThreshold = 0.5f;		// degrees
+	double keepaliveSeconds = 0.5;		// resend an unchanged pose this often
+};
+
+// Values besides the pose compared per device: velocity, angular velocity,
+// trigger and the two axes
+static const int k_nMaxDeadbandValues = 9;
+
+//
+// Change detection for devices that sit still, trackers on props and stands
+// mostly.
+//
+// A device's pose is compared with the pose last *sent* for it, not the one
+// of the previous frame, so slow drift still adds up to a send. If it moved
+// less than the position threshold and turned less than the angle threshold
+// the message is suppressed, unless any of the other values it carries
+// (trigger, axes, velocities) changed at all: a thumb moving on the
+// trackpad of a controller held still must not wait for the keepalive.
+// An unchanged device is still sent every keepalive interval so receivers
+// can tell a still device from a lost one.
+//
+class DeadbandFilter {
+private:
+	struct DeviceState {
+		bool hasSent;
+		float position[3];
+		float quaternion[4];
+		float values[k_nMaxDeadbandValues];
+		int valueCount;
+		int64_t lastSentNs;
+
+		// Statistics
+		unsigned long sent;
+		unsigned long keepalives;
+		unsigned long suppressed;
+		char address[k_unMaxOscAddressSize];
+	};
+
+	DeadbandConfig m_config;
+	float m_positionThresholdSquared;
+	float m_minQuaternionDot;	// cos(angleThreshold / 2), compared against |q1 . q2|
+	int64_t m_keepaliveNs;
+	DeviceState m_devices[k_unMaxDeviceCount];
+
+public:
+	DeadbandFilter();
+
+	void SetConfig(const DeadbandConfig &config);
+	bool Enabled() const { return m_config.enabled; }
+
+	// Forget what was sent for a device so its next pose is sent, e.g.
+	// after its address changed. Keeps the statistics.
+	void Reset(DeviceIndex device, const char *address);
+
+	// Whether the pose and the valueCount other values of the device's
+	// message (up to k_nMaxDeadbandValues) have to be sent at nowNs,
+	// remembers them if so
+	bool ShouldSend(DeviceIndex device, const float position[3], const float quaternion[4],
+		const float *values, int valueCount, int64_t nowNs);
+
+	unsigned long Sent(DeviceIndex device) const { return m_devices[device].sent; }
+	unsigned long Keepalives(DeviceIndex device) const { return m_devices[device].keepalives; }
+	unsigned long Suppressed(DeviceIndex device) const { return m_devices[device].suppressed; }
+
+	// Per device suppression ratios
+	void PrintStatistics() const;
+};
+
+#endif // _DEADBANDFILTER_H_
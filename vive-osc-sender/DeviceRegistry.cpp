@@ -0,0 +1,89 @@
+//
+// Connected device list, refreshed from runtime events
+//
+
+#include "stdafx.h"
+#include "DeviceRegistry.h"
+
+void DeviceRegistry::ReadDevice(PoseSource &source, DeviceIndex device, RegisteredDevice &entry) {
+	entry.unDevice = device;
+	entry.deviceClass = source.GetDeviceClass(device);
+	entry.role = (entry.deviceClass == DeviceClass_Controller) ? source.GetControllerRole(device) : ControllerRole_Invalid;
+	if (!source.GetDeviceString(device, DeviceString_SerialNumber, entry.serial, sizeof(entry.serial)))
+		entry.serial[0] = '\0';
+}
+
+void DeviceRegistry::Refresh(PoseSource &source) {
+	int controllersFound = 0;
+	int trackersFound = 0;
+
+	m_deviceCount = 0;
+	m_slotCount = 0;
+	for (DeviceIndex i = 0; i < k_unMaxDeviceCount; i++) {
+		if (!source.IsDeviceConnected(i))
+			continue;
+
+		RegisteredDevice &entry = m_devices[m_deviceCount++];
+		ReadDevice(source, i, entry);
+		m_slotCount = i + 1;
+
+		// Addresses are numbered per class in slot order
+		switch (entry.deviceClass) {
+		case DeviceClass_Controller:
+			entry.ordinal = ++controllersFound;
+			sprintf_s(entry.oscAddress, sizeof(entry.oscAddress), "/controller/%d", entry.ordinal);
+			break;
+		case DeviceClass_GenericTracker:
+			entry.ordinal = ++trackersFound;
+			sprintf_s(entry.oscAddress, sizeof(entry.oscAddress), "/tracker/%d", entry.ordinal);
+			break;
+		case DeviceClass_TrackingReference:
+		case DeviceClass_HMD:
+		case DeviceClass_DisplayRedirect:
+		case DeviceClass_Invalid:
+		case DeviceClass_Max:
+			entry.ordinal = 0;
+			entry.oscAddress[0] = '\0';
+			break;
+		}
+	}
+
+	m_generation++;
+	m_refreshes++;
+}
+
+bool DeviceRegistry::ProcessEvent(PoseSource &source, const DeviceEvent &event) {
+	switch (event.eventType) {
+	// Any device coming or going can renumber the others
+	case DeviceEvent_Activated:
+	case DeviceEvent_Deactivated:
+	case DeviceEvent_RoleChanged:
+		Refresh(source);
+		return true;
+
+	// Most property changes (battery, firmware state, ...) don't touch
+	// anything kept here, so only rescan if the class or role moved
+	case DeviceEvent_PropertyChanged:
+		for (int n = 0; n < m_deviceCount; n++) {
+			RegisteredDevice &entry = m_devices[n];
+			if (entry.unDevice != event.trackedDeviceIndex)
+				continue;
+
+			DeviceClass deviceClass = entry.deviceClass;
+			ControllerRole role = entry.role;
+			ReadDevice(source, entry.unDevice, entry);
+			if (entry.deviceClass != deviceClass || entry.role != role) {
+				Refresh(source);
+				return true;
+			}
+			return false;
+		}
+		return false;
+
+	case DeviceEvent_None:
+	case DeviceEvent_Updated:
+	case DeviceEvent_Quit:
+		break;
+	}
+	return false;
+}
@@ -0,0 +1,55 @@
+// DEVICEREGISTRY.h
+#ifndef _DEVICEREGISTRY_H_
+#define _DEVICEREGISTRY_H_
+
+#include "PoseSource.h"
+
+static const std::size_t k_unMaxOscAddressSize = 32;
+static const std::size_t k_unMaxSerialSize = 64;
+
+// A connected device and everything about it that doesn't change per frame
+struct RegisteredDevice {
+	DeviceIndex unDevice;
+	DeviceClass deviceClass;
+	ControllerRole role;
+	int ordinal;							// n-th device of its class, in slot order
+	char serial[k_unMaxSerialSize];
+	char oscAddress[k_unMaxOscAddressSize];	// empty if the device isn't sent
+};
+
+//
+// Compact list of the connected devices, in slot order.
+//
+// Connection state, class, role and serial are runtime properties, and with
+// OpenVR every query is a call into vrserver. The registry queries them once
+// and is then only refreshed when a runtime event says they changed, so the
+// frame loop walks the live devices only, without any property queries.
+//
+class DeviceRegistry {
+private:
+	RegisteredDevice m_devices[k_unMaxDeviceCount];
+	int m_deviceCount = 0;
+	DeviceIndex m_slotCount = 0;	// highest connected slot + 1
+	unsigned int m_generation = 0;
+	unsigned long m_refreshes = 0;
+
+	void ReadDevice(PoseSource &source, DeviceIndex device, RegisteredDevice &entry);
+
+public:
+	// Rescan all device slots
+	void Refresh(PoseSource &source);
+
+	// Update after a runtime event, returns true if the device list or any
+	// address changed
+	bool ProcessEvent(PoseSource &source, const DeviceEvent &event);
+
+	int DeviceCount() const { return m_deviceCount; }
+	const RegisteredDevice &Device(int n) const { return m_devices[n]; }
+	DeviceIndex SlotCount() const { return m_slotCount; }
+
+	// Changes whenever device addresses may have changed
+	unsigned int Generation() const { return m_generation; }
+	unsigned long Refreshes() const { return m_refreshes; }
+};
+
+#endif // _DEVICEREGISTRY_H_
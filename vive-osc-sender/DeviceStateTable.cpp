@@ -0,0 +1,29 @@
+//
+// Per-slot device state of the frame loop
+//
+
+#include "stdafx.h"
+#include "DeviceStateTable.h"
+
+#include <string.h>
+
+DeviceStateTable::DeviceStateTable() {
+	memset(m_poses, 0, sizeof(m_poses));
+	Clear();
+}
+
+void DeviceStateTable::Clear() {
+	memset(m_states, 0, sizeof(m_states));	// DeviceClass_Invalid
+	m_activeCount = 0;
+}
+
+void DeviceStateTable::Set(DeviceIndex slot, const RegisteredDevice &device, unsigned int profiles) {
+	DeviceState &state = m_states[slot];
+	state.deviceClass = device.deviceClass;
+	state.ordinal = device.ordinal;
+	state.profiles = profiles;
+	memcpy(state.oscAddress, device.oscAddress, sizeof(state.oscAddress));
+	state.active = (profiles != 0 && device.oscAddress[0] != '\0');
+	if (state.active)
+		m_activeSlots[m_activeCount++] = slot;
+}
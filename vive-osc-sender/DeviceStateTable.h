@@ -0,0 +1,58 @@
+// DEVICESTATETABLE.h
+#ifndef _DEVICESTATETABLE_H_
+#define _DEVICESTATETABLE_H_
+
+#include "PoseSource.h"
+#include "DeviceRegistry.h"
+#include "SpscRing.h"	// k_unCacheLineSize
+
+// What the frame loop needs of a device slot, in one cache line
+struct alignas(k_unCacheLineSize) DeviceState {
+	bool active;				// connected, with an address, and taken by some profile
+	DeviceClass deviceClass;
+	int ordinal;				// n-th device of its class, as in its address
+	unsigned int profiles;		// bit n set if output profile n takes the device
+	char oscAddress[k_unMaxOscAddressSize];
+};
+
+//
+// Per-slot device state of the acquisition side, rebuilt from the registry
+// whenever its generation or the profiles change, so the frame loop reads
+// nothing else: a cache line per slot with class, address and profiles, the
+// latest poses as one column (the layout a batched pose fetch fills), and
+// the active slots as a dense list in slot order, so devices that aren't
+// sent cost nothing per frame.
+//
+// Only the acquisition thread touches it. What the transmit side keeps per
+// device (deadband poses, message templates) lives per profile in the
+// encoders. The table fills whole cache lines, so nothing the transmit
+// thread writes shares one with it.
+//
+class DeviceStateTable {
+private:
+	DeviceState m_states[k_unMaxDeviceCount];
+	alignas(k_unCacheLineSize) DevicePose m_poses[k_unMaxDeviceCount];
+	DeviceIndex m_activeSlots[k_unMaxDeviceCount];
+	int m_activeCount = 0;
+
+public:
+	DeviceStateTable();
+
+	// No device active, all profiles 0
+	void Clear();
+
+	// Set a slot's device and the profiles that take it. Set slots in
+	// ascending order after Clear(), the active list keeps that order.
+	void Set(DeviceIndex slot, const RegisteredDevice &device, unsigned int profiles);
+
+	const DeviceState &State(DeviceIndex slot) const { return m_states[slot]; }
+
+	// Latest pose of each slot, k_unMaxDeviceCount of them
+	DevicePose *Poses() { return m_poses; }
+	DevicePose &Pose(DeviceIndex slot) { return m_poses[slot]; }
+
+	int ActiveCount() const { return m_activeCount; }
+	DeviceIndex ActiveSlot(int n) const { return m_activeSlots[n]; }
+};
+
+#endif // _DEVICESTATETABLE_H_
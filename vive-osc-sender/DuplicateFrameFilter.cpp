@@ -0,0 +1,87 @@
+//
+// Bitwise detection of frames that repeat the previous one
+//
+
+#include "stdafx.h"
+#include "DuplicateFrameFilter.h"
+
+#include <stddef.h>
+#include <string.h>
+
+void DuplicateFrameFilter::SetConfig(bool enabled, double keepaliveSeconds) {
+	m_enabled = enabled;
+	m_keepaliveNs = static_cast<int64_t>(keepaliveSeconds * 1e9);
+}
+
+// Field by field, padding may differ between two copies of the same pose
+bool DuplicateFrameFilter::SameValues(const DeviceValues &last, const TrackedDeviceSample &sample) {
+	return last.unDevice == sample.unDevice
+		&& memcmp(&last.trigger, &sample.trigger, sizeof(last.trigger)) == 0
+		&& memcmp(last.axes, sample.axes, sizeof(last.axes)) == 0
+		&& memcmp(&last.pose, &sample.pose, offsetof(DevicePose, bPoseIsValid)) == 0
+		&& last.pose.bPoseIsValid == sample.pose.bPoseIsValid
+		&& last.pose.bTrackingOK == sample.pose.bTrackingOK;
+}
+
+bool DuplicateFrameFilter::Drop(const TrackingFrame &frame) {
+	if (m_frames++ == 0)
+		m_firstNs = frame.captureTimeNs;
+	m_lastNs = frame.captureTimeNs;
+
+	// Compared and remembered in one pass, from the first difference on
+	// every device is copied
+	bool duplicate = (frame.deviceCount == m_deviceCount && frame.templateGeneration == m_templateGeneration);
+	for (int n = 0; n < frame.deviceCount; n++) {
+		const TrackedDeviceSample &sample = frame.devices[n];
+		DeviceValues &last = m_last[n];
+		if (duplicate && SameValues(last, sample))
+			continue;
+		duplicate = false;
+		last.unDevice = sample.unDevice;
+		last.trigger = sample.trigger;
+		last.axes[0] = sample.axes[0];
+		last.axes[1] = sample.axes[1];
+		last.pose = sample.pose;
+	}
+	m_deviceCount = frame.deviceCount;
+	m_templateGeneration = frame.templateGeneration;
+
+	if (duplicate) {
+		m_duplicates++;
+	} else {
+		if (m_frames - m_duplicates == 1)
+			m_firstNewNs = frame.captureTimeNs;
+		m_lastNewNs = frame.captureTimeNs;
+	}
+
+	bool keepalive = m_keepaliveNs > 0 && frame.captureTimeNs - m_lastSentNs >= m_keepaliveNs;
+	if (duplicate && m_enabled && !keepalive) {
+		m_dropped++;
+		return true;
+	}
+	m_lastSentNs = frame.captureTimeNs;
+	return false;
+}
+
+double DuplicateFrameFilter::PollRate() const {
+	if (m_frames < 2 || m_lastNs <= m_firstNs)
+		return 0;
+	return (m_frames - 1) * 1e9 / (m_lastNs - m_firstNs);
+}
+
+double DuplicateFrameFilter::UpdateRate() const {
+	unsigned long updates = m_frames - m_duplicates;
+	if (updates < 2 || m_lastNewNs <= m_firstNewNs)
+		return 0;
+	return (updates - 1) * 1e9 / (m_lastNewNs - m_firstNewNs);
+}
+
+void DuplicateFrameFilter::PrintStatistics() const {
+	if (m_frames == 0)
+		return;
+
+	printf_s("Duplicate frames: %lu of %lu (%.1f%%)", m_duplicates, m_frames, 100.0 * m_duplicates / m_frames);
+	if (m_enabled)
+		printf_s(", %lu dropped", m_dropped);
+	printf_s(", polled at %.0f Hz, poses updated at %.0f Hz\n", PollRate(), UpdateRate());
+}
@@ -0,0 +1,72 @@
+// DUPLICATEFRAMEFILTER.h
+#ifndef _DUPLICATEFRAMEFILTER_H_
+#define _DUPLICATEFRAMEFILTER_H_
+
+#include <stdint.h>
+#include "TrackingFrame.h"
+
+//
+// Detects frames polled before the runtime had a new sample.
+//
+// The frame loop polls at its own rate, which isn't synchronized with the
+// tracking updates, so some polls read back exactly what the previous one
+// did. TrackedDevicePose_t carries no sample counter or timestamp, so a
+// frame counts as a duplicate when it has the same devices in the same
+// order as the last frame, under the same template generation, and every
+// pose, velocity, trigger and axis value is bitwise the same. Real tracking
+// data never repeats to the bit unless nothing was sampled.
+//
+// Duplicates are always counted, which with the poll rate tells the rate
+// the poses really update at. When enabled they are dropped before
+// recording, encoding or sending, except that one goes out anyway once no
+// frame has been sent for the keepalive interval, so receivers can tell a
+// paused runtime from a lost sender.
+//
+class DuplicateFrameFilter {
+private:
+	// What is compared of each device of the last frame
+	struct DeviceValues {
+		DeviceIndex unDevice;
+		float trigger;
+		float axes[2];
+		DevicePose pose;
+	};
+	static bool SameValues(const DeviceValues &last, const TrackedDeviceSample &sample);
+
+	bool m_enabled = false;
+	int64_t m_keepaliveNs = 0;
+
+	int m_deviceCount = -1;		// none yet
+	unsigned int m_templateGeneration = 0;
+	DeviceValues m_last[k_unMaxDeviceCount];
+	int64_t m_lastSentNs = 0;
+
+	// Statistics
+	unsigned long m_frames = 0;
+	unsigned long m_duplicates = 0;
+	unsigned long m_dropped = 0;
+	int64_t m_firstNs = 0;		// capture time of the first frame
+	int64_t m_lastNs = 0;		// and of the latest
+	int64_t m_firstNewNs = 0;	// first and latest frame that wasn't a duplicate
+	int64_t m_lastNewNs = 0;
+
+public:
+	// Drop duplicates, but send one every keepaliveSeconds (0 never does)
+	void SetConfig(bool enabled, double keepaliveSeconds);
+	bool Enabled() const { return m_enabled; }
+
+	// Whether the frame is to be dropped. Remembers the frame either way.
+	bool Drop(const TrackingFrame &frame);
+
+	unsigned long Frames() const { return m_frames; }
+	unsigned long Duplicates() const { return m_duplicates; }
+	unsigned long Dropped() const { return m_dropped; }
+
+	// Frames polled, and frames with new poses, per second so far
+	double PollRate() const;
+	double UpdateRate() const;
+
+	void PrintStatistics() const;
+};
+
+#endif // _DUPLICATEFRAMEFILTER_H_
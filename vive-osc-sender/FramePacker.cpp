@@ -0,0 +1,108 @@
+//
+// Packs the OSC messages of a tracking frame into bundles
+//
+
+#include "stdafx.h"
+#include "FramePacker.h"
+#include "RealtimeSetup.h"
+
+#include <string.h>
+
+// "#bundle" string plus the 8 byte time tag
+static const std::size_t k_unBundleHeaderSize = 16;
+
+// Every bundle element is preceded by its int32 size
+static const std::size_t k_unElementSizeSize = 4;
+
+static void WriteUInt32(char *p, osc::uint32 x) {
+	p[0] = static_cast<char>(x >> 24);
+	p[1] = static_cast<char>(x >> 16);
+	p[2] = static_cast<char>(x >> 8);
+	p[3] = static_cast<char>(x);
+}
+
+FramePacker::FramePacker(UdpFanout &output)
+	: m_output(output) {
+}
+
+void FramePacker::Queue(const char *data, std::size_t size) {
+	if (m_destinations.empty())
+		m_output.QueueToAll(data, size);
+	else
+		m_output.Queue(&m_destinations[0], m_destinations.size(), data, size);
+}
+
+void FramePacker::SetFrameBundling(bool enabled, std::size_t maxPacketSize) {
+	if (maxPacketSize > k_unMaxUdpPacketSize)
+		maxPacketSize = k_unMaxUdpPacketSize;
+	if (maxPacketSize < k_unBundleHeaderSize + k_unElementSizeSize)
+		maxPacketSize = k_unDefaultMaxPacketSize;
+
+	m_bundleFrames = enabled;
+	m_maxPacketSize = maxPacketSize;
+	m_size = 0;
+	// Room for a single oversized message on top of a full bundle
+	m_buffer.resize(enabled ? k_unMaxUdpPacketSize : 0);
+}
+
+std::size_t FramePacker::Prefault() {
+	return m_buffer.empty() ? 0 : PrefaultMemory(&m_buffer[0], m_buffer.size());
+}
+
+void FramePacker::BeginFrame(osc::uint64 timeTag) {
+	m_timeTag = timeTag;
+	m_size = 0;
+}
+
+void FramePacker::BeginBundle() {
+	char *p = &m_buffer[0];
+	memcpy(p, "#bundle\0", 8);
+	WriteUInt32(p + 8, static_cast<osc::uint32>(m_timeTag >> 32));
+	WriteUInt32(p + 12, static_cast<osc::uint32>(m_timeTag));
+	m_size = k_unBundleHeaderSize;
+}
+
+void FramePacker::FlushBundle() {
+	if (m_size > k_unBundleHeaderSize) {
+		Queue(&m_buffer[0], m_size);
+		m_packetsSent++;
+	}
+	m_size = 0;
+}
+
+void FramePacker::AddMessage(const char *data, std::size_t size) {
+	if (!m_bundleFrames) {
+		Queue(data, size);
+		m_messagesSent++;
+		m_packetsSent++;
+		return;
+	}
+
+	std::size_t elementSize = k_unElementSizeSize + size;
+
+	// Can't be sent over UDP in a bundle at all
+	if (k_unBundleHeaderSize + elementSize > m_buffer.size()) {
+		m_messagesDropped++;
+		return;
+	}
+
+	// Split the frame if this message doesn't fit anymore. A message that
+	// doesn't even fit an empty bundle of maxPacketSize still goes out,
+	// alone in its bundle.
+	if (m_size != 0 && m_size + elementSize > m_maxPacketSize)
+		FlushBundle();
+	m_messagesSent++;
+
+	if (m_size == 0)
+		BeginBundle();
+
+	char *p = &m_buffer[m_size];
+	WriteUInt32(p, static_cast<osc::uint32>(size));
+	memcpy(p + k_unElementSizeSize, data, size);
+	m_size += elementSize;
+}
+
+void FramePacker::EndFrame() {
+	if (m_bundleFrames)
+		FlushBundle();
+}
@@ -0,0 +1,75 @@
+// FRAMEPACKER.h
+#ifndef _FRAMEPACKER_H_
+#define _FRAMEPACKER_H_
+
+#include <cstring> // size_t
+#include <vector>
+
+#include "osc/OscTypes.h"
+#include "UdpFanout.h"
+
+// Largest UDP payload that fits an unfragmented Ethernet frame (1500 - IP - UDP headers)
+static const std::size_t k_unDefaultMaxPacketSize = 1472;
+
+//
+// Collects the OSC messages of one tracking frame and queues them on the
+// fanout, which sends them to every destination when the frame is flushed.
+//
+// With bundling enabled every message of the frame goes into one bundle
+// stamped with the frame's capture time, so receivers can tell which
+// messages belong together and the frame costs one datagram instead of one
+// per device. A bundle is only split when the next message would push it
+// past the maximum packet size; each part carries the same time tag.
+//
+// With bundling disabled every message is queued as its own datagram as soon
+// as it is added, which is what receivers got before bundling existed.
+//
+class FramePacker {
+private:
+	UdpFanout &m_output;
+	std::vector<int> m_destinations;	// fanout destinations, all of them if empty
+	bool m_bundleFrames = false;
+	std::size_t m_maxPacketSize = k_unDefaultMaxPacketSize;
+
+	std::vector<char> m_buffer;
+	std::size_t m_size = 0;		// bytes in the bundle being built, 0 if none
+	osc::uint64 m_timeTag = 1;
+
+	// Statistics
+	unsigned long m_packetsSent = 0;
+	unsigned long m_messagesSent = 0;
+	unsigned long m_messagesDropped = 0;	// too large for a bundle in a datagram
+
+	void Queue(const char *data, std::size_t size);
+	void BeginBundle();
+	void FlushBundle();
+
+public:
+	FramePacker(UdpFanout &output);
+
+	// Only send to these fanout destinations instead of all of them
+	void AddDestination(int destination) { m_destinations.push_back(destination); }
+	const std::vector<int> &Destinations() const { return m_destinations; }
+
+	// Bundle whole frames, splitting at maxPacketSize bytes
+	void SetFrameBundling(bool enabled, std::size_t maxPacketSize = k_unDefaultMaxPacketSize);
+	bool IsFrameBundling() const { return m_bundleFrames; }
+
+	// Fault in the bundle buffer, returns its size
+	std::size_t Prefault();
+
+	// Start a frame captured at the given OSC time tag
+	void BeginFrame(osc::uint64 timeTag);
+
+	// Add one complete, encoded OSC message to the frame
+	void AddMessage(const char *data, std::size_t size);
+
+	// Queue whatever is left of the frame, UdpFanout::Flush() sends it
+	void EndFrame();
+
+	unsigned long PacketsSent() const { return m_packetsSent; }
+	unsigned long MessagesSent() const { return m_messagesSent; }
+	unsigned long MessagesDropped() const { return m_messagesDropped; }
+};
+
+#endif // _FRAMEPACKER_H_
@@ -0,0 +1,84 @@
+//
+// Fixed rate frame pacing with absolute deadlines
+//
+
+#include "stdafx.h"
+#include "FrameScheduler.h"
+#include "MonotonicClock.h"
+
+#ifdef _WIN32
+#include <mmsystem.h>	// timeBeginPeriod, winmm.lib
+#else
+#include <errno.h>
+#include <time.h>
+#endif
+
+FrameScheduler::FrameScheduler(double rateHz, int spinMicroseconds) {
+	if (rateHz <= 0)
+		rateHz = 500;
+	m_periodNs = static_cast<int64_t>(1e9 / rateHz);
+	m_spinNs = static_cast<int64_t>(spinMicroseconds) * 1000;
+	if (m_spinNs > m_periodNs)
+		m_spinNs = m_periodNs;
+
+#ifdef _WIN32
+	// Sleep() is only accurate to the timer resolution, 15.6 ms by default
+	timeBeginPeriod(1);
+#endif
+}
+
+FrameScheduler::~FrameScheduler() {
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+void FrameScheduler::Start() {
+	m_deadlineNs = MonotonicNanoseconds() + m_periodNs;
+}
+
+void FrameScheduler::SleepUntil(int64_t deadlineNs) {
+#ifdef _WIN32
+	int64_t remainingNs = deadlineNs - MonotonicNanoseconds();
+	if (remainingNs >= 1000000)
+		Sleep(static_cast<DWORD>(remainingNs / 1000000));
+#else
+	struct timespec ts;
+	ts.tv_sec = static_cast<time_t>(deadlineNs / 1000000000LL);
+	ts.tv_nsec = static_cast<long>(deadlineNs % 1000000000LL);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+#endif
+}
+
+void FrameScheduler::WaitForNextFrame() {
+	m_frames++;
+
+	int64_t now = MonotonicNanoseconds();
+	int64_t lateness = now - m_deadlineNs;
+	if (lateness > 0) {
+		// The frame itself ran past the deadline it was meant to meet
+		m_overruns++;
+		if (lateness > m_maxLatenessNs)
+			m_maxLatenessNs = lateness;
+
+		// Drop whole periods that have already gone by, keeping the phase
+		int64_t missed = lateness / m_periodNs;
+		m_skippedFrames += static_cast<unsigned long>(missed);
+		m_deadlineNs += (missed + 1) * m_periodNs;
+	} else {
+		WaitUntil(m_deadlineNs);
+		m_deadlineNs += m_periodNs;
+	}
+}
+
+// Coarse sleep, then spin for the last stretch
+void FrameScheduler::WaitUntil(int64_t deadlineNs) {
+	if (deadlineNs - MonotonicNanoseconds() > m_spinNs)
+		SleepUntil(deadlineNs - m_spinNs);
+	while (MonotonicNanoseconds() < deadlineNs) {}
+}
+
+void FrameScheduler::PrintStatistics() const {
+	printf_s("Frame scheduler: %.0f Hz, %lu frames, %lu overruns (%lu frames skipped, worst %.0f us late)\n",
+		RateHz(), m_frames, m_overruns, m_skippedFrames, MaxLatenessMicroseconds());
+}
@@ -0,0 +1,59 @@
+// FRAMESCHEDULER.h
+#ifndef _FRAMESCHEDULER_H_
+#define _FRAMESCHEDULER_H_
+
+#include <stdint.h>
+
+//
+// Paces the frame loop at a fixed rate against absolute deadlines.
+//
+// Deadlines advance by exactly one period from the previous deadline, not
+// from when the frame finished, so frame time and sleep granularity don't
+// accumulate as drift. Waiting sleeps until shortly before the deadline and
+// spins the rest of the way, which gets sub-millisecond accuracy without
+// burning a core for the whole period.
+//
+// A frame that finishes after its deadline is an overrun. If it ran over by
+// more than a whole period the missed slots are skipped rather than run
+// back to back, so the loop doesn't send bursts of stale poses to catch up.
+//
+class FrameScheduler {
+private:
+	int64_t m_periodNs;
+	int64_t m_spinNs;
+	int64_t m_deadlineNs = 0;
+
+	// Statistics
+	unsigned long m_frames = 0;
+	unsigned long m_overruns = 0;
+	unsigned long m_skippedFrames = 0;
+	int64_t m_maxLatenessNs = 0;
+
+	void SleepUntil(int64_t deadlineNs);
+
+public:
+	// rateHz: frames per second, spinMicroseconds: how long before the
+	// deadline to stop sleeping and start spinning
+	FrameScheduler(double rateHz, int spinMicroseconds = 200);
+	~FrameScheduler();
+
+	// Sets the first deadline one period from now
+	void Start();
+
+	// Blocks until the next frame is due
+	void WaitForNextFrame();
+
+	// Blocks until MonotonicNanoseconds() reaches deadlineNs, the same way,
+	// for callers that keep their own deadlines
+	void WaitUntil(int64_t deadlineNs);
+
+	double RateHz() const { return 1e9 / m_periodNs; }
+	unsigned long Frames() const { return m_frames; }
+	unsigned long Overruns() const { return m_overruns; }
+	unsigned long SkippedFrames() const { return m_skippedFrames; }
+	double MaxLatenessMicroseconds() const { return m_maxLatenessNs / 1000.0; }
+
+	void PrintStatistics() const;
+};
+
+#endif // _FRAMESCHEDULER_H_
@@ -0,0 +1,143 @@
+//
+// Log-bucketed latency histograms for the stages of the frame pipeline
+//
+
+#include "stdafx.h"
+#include "LatencyHistogram.h"
+#include "MonotonicClock.h"
+#include "AllocationTracker.h"
+
+LatencyHistogram::LatencyHistogram()
+	: m_totalNs(0), m_maxNs(0) {
+	for (int n = 0; n < k_nLatencyBucketCount; n++)
+		m_counts[n].store(0, std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::BucketLowest(int index) {
+	if (index < 2 * k_nLatencySubBuckets)
+		return index;
+	int shift = index / k_nLatencySubBuckets - 1;
+	int64_t top = index % k_nLatencySubBuckets + k_nLatencySubBuckets;
+	return top << shift;
+}
+
+int64_t LatencyHistogram::BucketHighest(int index) {
+	if (index < 2 * k_nLatencySubBuckets)
+		return index;
+	int shift = index / k_nLatencySubBuckets - 1;
+	return BucketLowest(index) + (static_cast<int64_t>(1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::Count() const {
+	uint64_t count = 0;
+	for (int n = 0; n < k_nLatencyBucketCount; n++)
+		count += m_counts[n].load(std::memory_order_relaxed);
+	return count;
+}
+
+double LatencyHistogram::MeanNanoseconds() const {
+	uint64_t count = Count();
+	return count ? static_cast<double>(m_totalNs.load(std::memory_order_relaxed)) / count : 0;
+}
+
+int64_t LatencyHistogram::PercentileNanoseconds(double fraction) const {
+	// Work on a copy, so the total and the walk agree while samples come in
+	uint64_t counts[k_nLatencyBucketCount];
+	uint64_t total = 0;
+	for (int n = 0; n < k_nLatencyBucketCount; n++) {
+		counts[n] = m_counts[n].load(std::memory_order_relaxed);
+		total += counts[n];
+	}
+	if (total == 0)
+		return 0;
+
+	uint64_t rank = static_cast<uint64_t>(fraction * total + 0.5);
+	if (rank < 1)
+		rank = 1;
+	if (rank > total)
+		rank = total;
+	int64_t maxNs = MaxNanoseconds();
+	uint64_t seen = 0;
+	for (int n = 0; n < k_nLatencyBucketCount; n++) {
+		seen += counts[n];
+		if (seen >= rank) {
+			int64_t highest = BucketHighest(n);
+			return highest < maxNs ? highest : maxNs;
+		}
+	}
+	return maxNs;
+}
+
+const char *PipelineStageName(PipelineStage stage) {
+	switch (stage) {
+	case PipelineStage_Acquire: return "acquire";
+	case PipelineStage_Record: return "record";
+	case PipelineStage_Queued: return "queued";
+	case PipelineStage_Convert: return "convert";
+	case PipelineStage_Encode: return "encode";
+	case PipelineStage_Send: return "send";
+	case PipelineStage_Events: return "events";
+	case PipelineStage_Frame: return "frame";
+	default: return "?";
+	}
+}
+
+PipelineLatency::PipelineLatency() {
+	for (int n = 0; n < PipelineStage_Count; n++)
+		m_allocations[n].store(0, std::memory_order_relaxed);
+}
+
+void PipelineLatency::Print() const {
+	bool allocations = AllocationTrackingEnabled();
+	if (allocations)
+		printf_s("Latency per stage (us):  %10s %9s %9s %9s %9s %9s\n", "count", "p50", "p99", "p99.9", "max", "allocs");
+	else
+		printf_s("Latency per stage (us):  %10s %9s %9s %9s %9s\n", "count", "p50", "p99", "p99.9", "max");
+	uint64_t samples = 0;
+	for (int n = 0; n < PipelineStage_Count; n++) {
+		const LatencyHistogram &stage = m_stages[n];
+		uint64_t count = stage.Count();
+		samples += count;
+		if (count == 0)
+			continue;
+		printf_s("  %-22s %10llu %9.1f %9.1f %9.1f %9.1f", PipelineStageName(static_cast<PipelineStage>(n)),
+			static_cast<unsigned long long>(count),
+			stage.PercentileNanoseconds(0.5) / 1000.0, stage.PercentileNanoseconds(0.99) / 1000.0,
+			stage.PercentileNanoseconds(0.999) / 1000.0, stage.MaxNanoseconds() / 1000.0);
+		if (allocations)
+			printf_s(" %9llu", static_cast<unsigned long long>(m_allocations[n].load(std::memory_order_relaxed)));
+		printf_s("\n");
+	}
+
+	// Every sample is about one clock read and one Record()
+	const LatencyHistogram &frame = m_stages[PipelineStage_Frame];
+	uint64_t frames = frame.Count();
+	if (frames == 0)
+		return;
+	double samplesPerFrame = static_cast<double>(samples) / frames;
+	// Measured once, on the printing thread
+	static const double costNs = MeasureLatencyRecordCost();
+
+	// Threaded, the transmit stages run outside the frame loop's frame time
+	double workNs = frame.MeanNanoseconds();
+	if (m_stages[PipelineStage_Queued].Count() > 0)
+		workNs += m_stages[PipelineStage_Convert].MeanNanoseconds() + m_stages[PipelineStage_Encode].MeanNanoseconds()
+			+ m_stages[PipelineStage_Send].MeanNanoseconds();
+	printf_s("Timing cost: %.1f samples per frame at %.0f ns each, %.2f%% of the mean work per frame (%.1f us)\n",
+		samplesPerFrame, costNs, workNs > 0 ? 100.0 * samplesPerFrame * costNs / workNs : 0.0, workNs / 1000.0);
+}
+
+double MeasureLatencyRecordCost() {
+	static const int k_nIterations = 100000;
+	LatencyHistogram *histogram = new LatencyHistogram();
+	int64_t start = MonotonicNanoseconds();
+	int64_t previous = start;
+	for (int n = 0; n < k_nIterations; n++) {
+		int64_t now = MonotonicNanoseconds();
+		histogram->Record(now - previous);
+		previous = now;
+	}
+	double cost = static_cast<double>(MonotonicNanoseconds() - start) / k_nIterations;
+	delete histogram;
+	return cost;
+}
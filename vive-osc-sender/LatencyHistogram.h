@@ -0,0 +1,141 @@
+// LATENCYHISTOGRAM.h
+#ifndef _LATENCYHISTOGRAM_H_
+#define _LATENCYHISTOGRAM_H_
+
+#include <atomic>
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Linear sub-buckets per power of two, 32 keeps every bucket within 1/32
+// (about 3%) of the values it holds
+static const int k_nLatencySubBucketBits = 5;
+static const int k_nLatencySubBuckets = 1 << k_nLatencySubBucketBits;
+
+// Values up to 2^36 ns (about 68 s) get their own bucket, longer ones are
+// counted in the last
+static const int k_nLatencyMaxValueBits = 36;
+static const int k_nLatencyBucketCount = (k_nLatencyMaxValueBits - k_nLatencySubBucketBits + 1) * k_nLatencySubBuckets;
+
+//
+// Log-bucketed histogram of durations in nanoseconds, in the manner of
+// HdrHistogram: values below 32 ns are counted exactly, above that each
+// power of two is split into 32 equal buckets.
+//
+// Record() must only be called from one thread. It is a handful of relaxed
+// loads and stores and never locks or allocates, so any other thread can
+// read percentiles while samples are being recorded; a reading taken
+// meanwhile may miss the samples of the last few nanoseconds.
+//
+class LatencyHistogram {
+private:
+	std::atomic<uint64_t> m_counts[k_nLatencyBucketCount];
+	std::atomic<uint64_t> m_totalNs;
+	std::atomic<int64_t> m_maxNs;
+
+	static int HighestBit(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long bit;
+		_BitScanReverse64(&bit, value);
+		return static_cast<int>(bit);
+#elif defined(_MSC_VER)
+		unsigned long bit;
+		if (_BitScanReverse(&bit, static_cast<unsigned long>(value >> 32)))
+			return static_cast<int>(bit) + 32;
+		_BitScanReverse(&bit, static_cast<unsigned long>(value));
+		return static_cast<int>(bit);
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	LatencyHistogram(const LatencyHistogram &);
+	LatencyHistogram &operator=(const LatencyHistogram &);
+
+public:
+	LatencyHistogram();
+
+	void Record(int64_t nanoseconds) {
+		if (nanoseconds < 0)
+			nanoseconds = 0;
+		std::atomic<uint64_t> &count = m_counts[BucketIndex(nanoseconds)];
+		count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		m_totalNs.store(m_totalNs.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+		if (nanoseconds > m_maxNs.load(std::memory_order_relaxed))
+			m_maxNs.store(nanoseconds, std::memory_order_relaxed);
+	}
+
+	// Bucket of a value, and the range of values a bucket holds
+	static int BucketIndex(int64_t nanoseconds) {
+		if (nanoseconds < k_nLatencySubBuckets)
+			return static_cast<int>(nanoseconds);
+		int bit = HighestBit(static_cast<uint64_t>(nanoseconds));
+		if (bit >= k_nLatencyMaxValueBits)
+			return k_nLatencyBucketCount - 1;
+		int shift = bit - k_nLatencySubBucketBits;
+		return shift * k_nLatencySubBuckets + static_cast<int>(nanoseconds >> shift);
+	}
+	static int64_t BucketLowest(int index);
+	static int64_t BucketHighest(int index);
+
+	uint64_t Count() const;
+	double MeanNanoseconds() const;
+	int64_t MaxNanoseconds() const { return m_maxNs.load(std::memory_order_relaxed); }
+
+	// The highest value of the bucket that holds the given fraction of the
+	// samples (0.5, 0.99, ...), never more than the maximum. 0 when empty.
+	int64_t PercentileNanoseconds(double fraction) const;
+};
+
+// The stages of the frame pipeline that are timed, in pipeline order
+enum PipelineStage {
+	PipelineStage_Acquire,		// pose and controller state from the runtime
+	PipelineStage_Record,		// appending the frame to the session file, when recording
+	PipelineStage_Queued,		// capture to transmit start, threaded only
+	PipelineStage_Convert,		// matrix to quaternion
+	PipelineStage_Encode,		// prediction and OSC encoding of all profiles
+	PipelineStage_Send,			// handing the packets to the socket
+	PipelineStage_Events,		// polling runtime events
+	PipelineStage_Frame,		// the whole frame loop iteration, without the wait for the next
+	PipelineStage_Count
+};
+
+const char *PipelineStageName(PipelineStage stage);
+
+//
+// A latency histogram per pipeline stage, and the heap allocations each
+// stage made (counted only in instrumentation builds, see
+// AllocationTracker.h). Each stage is recorded by the thread that runs it,
+// printing reads them from any thread.
+//
+class PipelineLatency {
+private:
+	LatencyHistogram m_stages[PipelineStage_Count];
+	std::atomic<uint64_t> m_allocations[PipelineStage_Count];
+
+public:
+	PipelineLatency();
+
+	void Record(PipelineStage stage, int64_t nanoseconds) { m_stages[stage].Record(nanoseconds); }
+	const LatencyHistogram &Stage(PipelineStage stage) const { return m_stages[stage]; }
+
+	void RecordAllocations(PipelineStage stage, uint64_t count) {
+		if (count == 0)
+			return;
+		std::atomic<uint64_t> &allocations = m_allocations[stage];
+		allocations.store(allocations.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+	}
+	uint64_t Allocations(PipelineStage stage) const { return m_allocations[stage].load(std::memory_order_relaxed); }
+
+	// Prints count, p50, p99, p99.9 and max of each stage, with the
+	// allocations when they are counted, and what the timing itself costs
+	// per frame
+	void Print() const;
+};
+
+// Measures what one clock read plus one Record() costs, in nanoseconds
+double MeasureLatencyRecordCost();
+
+#endif // _LATENCYHISTOGRAM_H_
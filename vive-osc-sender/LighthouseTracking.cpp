@@ -1,350 +1,464 @@
-//
-// HTC Vive Lighthouse Tracking Example
-// By Peter Thor 2016, 2017, 2018, 2019
-//
-// Shows how to extract basic tracking data
-
-#include "stdafx.h"
-#include "LighthouseTracking.h"
-#include <filesystem>
-
-// Destructor
-LighthouseTracking::~LighthouseTracking() {
-	if (m_pHMD != NULL)
-	{
-		vr::VR_Shutdown();
-		m_pHMD = NULL;
-	}
-}
-
-// Constructor
-LighthouseTracking::LighthouseTracking(IpEndpointName ip)
-	: transmitSocket(ip) {
-	vr::EVRInitError eError = vr::VRInitError_None;
-	m_pHMD = vr::VR_Init(&eError, vr::VRApplication_Background);
-	char buf[1024];
-
-	if (eError != vr::VRInitError_None)
-	{
-		m_pHMD = NULL;
-		sprintf_s(buf, sizeof(buf), "Unable to init VR runtime: %s", vr::VR_GetVRInitErrorAsEnglishDescription(eError));
-		printf_s(buf);
-		exit(EXIT_FAILURE);
-	}
-
-	char buffer[1024];
-	osc::OutboundPacketStream p(buffer,1024);
-
-	p << osc::BeginBundleImmediate
-		<< osc::BeginMessage("/notice")
-		<< "vive-osc-sender launched"
-		<< osc::EndMessage << osc::EndBundle;
-	transmitSocket.Send(p.Data(), p.Size());
-}
-
-/*
-* Loop-listen for events then parses them (e.g. prints the to user)
-* Returns true if success or false if openvr has quit
-*/
-bool LighthouseTracking::RunProcedure() {
-
-	//ParseTrackingFrame(filterIndex);
-    ParseTrackingFrame();
-
-    vr::VREvent_t event;
-    while (m_pHMD->PollNextEvent(&event, sizeof(event))) {
-        if (!ProcessVREvent(event)) {
-            char buf[1024];
-            sprintf_s(buf, sizeof(buf), "(OpenVR) service quit\n");
-            printf_s(buf);
-            return false;
-        }
-    }
-
-	return true;
-}
-
-/*
-* Parse a Frame with data from the tracking system
-*
-* Handy reference:
-* https://github.com/TomorrowTodayLabs/NewtonVR/blob/master/Assets/SteamVR/Scripts/SteamVR_Utils.cs
-*
-* Also:
-* Open VR Convention (same as OpenGL)
-* right-handed system
-* +y is up
-* +x is to the right
-* -z is going away from you
-* http://www.3dgep.com/understanding-the-view-matrix/
-*
-*/
-void LighthouseTracking::ParseTrackingFrame() {
-    // Iterate over devices
-    int trackersFound = 0;
-    int controllersFound = 0;
-    printf_s("\r");
-    for (vr::TrackedDeviceIndex_t i = 0; i < vr::k_unMaxTrackedDeviceCount; i++)
-    {
-        bool deviceConnected = m_pHMD->IsTrackedDeviceConnected(i);
-        m_deviceConnected[i] = deviceConnected;
-        if (!deviceConnected) continue;
-
-        vr::TrackedDevicePose_t *devicePose = &m_rTrackedDevicePose[i];
-        vr::VRControllerState_t controllerState;
-        vr::VRControllerState_t *controllerState_ptr = &controllerState;
-        vr::VRSystem()->GetControllerStateWithPose(vr::TrackingUniverseRawAndUncalibrated, i, controllerState_ptr, sizeof(controllerState), devicePose);
-        float trigger = 0;
-
-        // Get what type of device it is and work with its data
-        vr::ETrackedDeviceClass trackedDeviceClass = vr::VRSystem()->GetTrackedDeviceClass(i);
-        switch (trackedDeviceClass) {
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_Controller:
-            controllersFound++;
-            // For now, I don't care about the role, but I may want it later
-            switch (vr::VRSystem()->GetControllerRoleForTrackedDeviceIndex(i)) {
-                case vr::TrackedControllerRole_Invalid: break;
-                case vr::TrackedControllerRole_LeftHand: break;
-                case vr::TrackedControllerRole_RightHand: break;
-                case vr::TrackedControllerRole_Treadmill: break;
-            }
-            break;
-
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_GenericTracker:
-            trackersFound++;
-            break;
-
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_TrackingReference:; // Lighthouse
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_HMD:
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_DisplayRedirect:
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_Invalid:
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_Max:
-            break;
-        } // switch vr::ETrackedDeviceClass
-
-        // If the pose is invalid, or the Tracking result not okay, don't send
-        if (!devicePose->bPoseIsValid || devicePose->eTrackingResult != vr::ETrackingResult::TrackingResult_Running_OK) continue;
-
-        {
-            vr::HmdVector3_t position = GetPosition(devicePose->mDeviceToAbsoluteTracking);
-            vr::HmdQuaternion_t quaternion = GetRotation(devicePose->mDeviceToAbsoluteTracking);
-            vr::HmdVector3_t vVel = devicePose->vVelocity;
-            vr::HmdVector3_t vAngVel = devicePose->vAngularVelocity;
-
-            bool send = false;
-            char type = 0;
-            char oscAddress[1024];
-            switch (trackedDeviceClass) {
-            case vr::TrackedDeviceClass_Controller:
-                sprintf_s(oscAddress, sizeof(oscAddress), "/controller/%d", controllersFound);
-                trigger = controllerState.rAxis[1].x; // get controller axis
-                type = 'C';
-                send = true;
-                break;
-            case vr::TrackedDeviceClass_GenericTracker:
-                sprintf_s(oscAddress, sizeof(oscAddress), "/tracker/%d", trackersFound);
-                type = 'T';
-                send = true;
-                break;
-            case vr::TrackedDeviceClass_TrackingReference:
-            case vr::TrackedDeviceClass_DisplayRedirect:
-            case vr::TrackedDeviceClass_HMD:
-            case vr::TrackedDeviceClass_Invalid:
-            case vr::TrackedDeviceClass_Max:
-                break;
-            }
-
-            // Create and send OSC message
-            if (send) {
-                char oscBuffer[2048];
-                osc::OutboundPacketStream pStream(oscBuffer, 2048);
-                pStream
-                    << osc::BeginMessage(oscAddress)
-                    << position.v[0] << position.v[1] << position.v[2]
-                    << static_cast<float>(quaternion.w) << static_cast<float>(quaternion.x)
-                    << static_cast<float>(quaternion.y) << static_cast<float>(quaternion.z);
-
-                if (trackedDeviceClass == vr::TrackedDeviceClass_Controller)
-                    pStream << trigger;
-
-                pStream << osc::EndMessage;
-                transmitSocket.Send(pStream.Data(), pStream.Size());
-                printf_s("%c(% .2f,  % .2f, % .2f) q(% .2f, % .2f, % .2f, % .2f) - ", type, position.v[0], position.v[1], position.v[2], quaternion.w, quaternion.x, quaternion.y, quaternion.z);
-            }
-        }
-    }
-}
-
-void LighthouseTracking::PrintDevices() {
-
-	printf_s("\nDevice list:\n---------------------------\n");
-
-	// Process SteamVR device states
-	for (vr::TrackedDeviceIndex_t unDevice = 0; unDevice < vr::k_unMaxTrackedDeviceCount; unDevice++)
-	{
-		if (!m_pHMD->IsTrackedDeviceConnected(unDevice))
-			continue;
-
-		vr::TrackedDevicePose_t trackedDevicePose;
-		vr::TrackedDevicePose_t *devicePose = &trackedDevicePose;
-
-		vr::VRControllerState_t controllerState;
-		vr::VRControllerState_t *ontrollerState_ptr = &controllerState;
-
-		// Get what type of device it is and work with its data
-		vr::ETrackedDeviceClass trackedDeviceClass = vr::VRSystem()->GetTrackedDeviceClass(unDevice);
-        switch (trackedDeviceClass) {
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_HMD: { printf_s("Device %d: [HMD]", unDevice); } break;
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_Controller: {
-            switch (vr::VRSystem()->GetControllerRoleForTrackedDeviceIndex(unDevice)) {
-            case vr::TrackedControllerRole_Invalid: printf_s("Device %d: [Invalid Controller]", unDevice); break;
-            case vr::TrackedControllerRole_LeftHand: printf_s("Device %d: [Controller - Left]", unDevice); break;
-            case vr::TrackedControllerRole_RightHand: printf_s("Device %d: [Controller - Right]", unDevice); break;
-            case vr::TrackedControllerRole_Treadmill: printf_s("Device %d: [Treadmill]", unDevice); break;
-            } break;
-        } break; // TrackedDeviceClass_Controller
-
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_GenericTracker: { printf_s("Device %d: [GenericTracker]", unDevice); } break;
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_TrackingReference: { printf_s("Device %d: [TrackingReference]", unDevice); } break;
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_DisplayRedirect: { printf_s("Device %d: [DisplayRedirect]", unDevice); } break;
-        case vr::ETrackedDeviceClass::TrackedDeviceClass_Invalid: { printf_s("Device %d: [Invalid]", unDevice); } break;
-		}
-
-		char manufacturer[64];
-		vr::VRSystem()->GetStringTrackedDeviceProperty(unDevice, vr::ETrackedDeviceProperty::Prop_ManufacturerName_String, manufacturer, sizeof(manufacturer));
-
-		char modelnumber[64];
-		vr::VRSystem()->GetStringTrackedDeviceProperty(unDevice, vr::ETrackedDeviceProperty::Prop_ModelNumber_String, modelnumber, sizeof(modelnumber));
-
-		char serialnumber[64];
-		vr::VRSystem()->GetStringTrackedDeviceProperty(unDevice, vr::ETrackedDeviceProperty::Prop_SerialNumber_String, serialnumber, sizeof(serialnumber));
-
-		printf_s(" %s - %s [%s] class(%d)\n", manufacturer, modelnumber, serialnumber, trackedDeviceClass);
-
-        // If the device is a controller, print each axis type
-        if (trackedDeviceClass == vr::ETrackedDeviceClass::TrackedDeviceClass_Controller) {
-            for (int j = 0; j < vr::k_unControllerStateAxisCount; j++) {
-                auto axis = static_cast<vr::ETrackedDeviceProperty>(j + vr::Prop_Axis0Type_Int32);
-                vr::TrackedPropertyError error;
-                auto enumAxis = static_cast<vr::EVRControllerAxisType> (
-                    vr::VRSystem()->GetInt32TrackedDeviceProperty(unDevice, axis, &error)
-                    );
-                if (!error) {
-                    printf_s("\taxis: %d - type: %d (%s) \n", j, enumAxis, vr::VRSystem()->GetControllerAxisTypeNameFromEnum(enumAxis));
-                }
-            }
-        }
-	}
-	printf_s("---------------------------\n\n");
-}
-
-
-//-----------------------------------------------------------------------------
-// Purpose: Processes a single VR event
-//-----------------------------------------------------------------------------
-
-bool LighthouseTracking::ProcessVREvent(const vr::VREvent_t & event) {
-    switch (event.eventType)
-    {
-    case vr::VREvent_TrackedDeviceActivated: { printf_s("(OpenVR) Device : %d attached\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_TrackedDeviceDeactivated: { printf_s("(OpenVR) Device : %d detached\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_TrackedDeviceUpdated: { printf_s("(OpenVR) Device : %d updated\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_DashboardActivated: { printf_s("(OpenVR) Dashboard activated\n"); } break;
-    case vr::VREvent_DashboardDeactivated: { printf_s("(OpenVR) Dashboard deactivated\n"); } break;
-    case vr::VREvent_ChaperoneDataHasChanged: { printf_s("(OpenVR) Chaperone data has changed\n"); } break;
-    case vr::VREvent_ChaperoneSettingsHaveChanged: { printf_s("(OpenVR) Chaperone settings have changed\n"); } break;
-    case vr::VREvent_ChaperoneUniverseHasChanged: { printf_s("(OpenVR) Chaperone universe has changed\n"); } break;
-    case vr::VREvent_ApplicationTransitionStarted: { printf_s("(OpenVR) Application Transition: Transition has started\n"); } break;
-    case vr::VREvent_ApplicationTransitionNewAppStarted: { printf_s("(OpenVR) Application transition: New app has started\n"); } break;
-    case vr::VREvent_TrackedDeviceRoleChanged: { printf_s("(OpenVR) TrackedDeviceRoleChanged: %d\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_Input_HapticVibration: { printf_s("(OpenVR) VREvent_Input_HapticVibration\n"); } break;
-    case vr::VREvent_Input_BindingLoadFailed: { printf_s("(OpenVR) VREvent_Input_BindingLoadFailed\n"); } break;
-    case vr::VREvent_Input_BindingLoadSuccessful: { printf_s("(OpenVR) VREvent_Input_BindingLoadSuccessful\n"); } break;
-    case vr::VREvent_Input_ActionManifestReloaded: { printf_s("(OpenVR) VREvent_Input_ActionManifestReloaded\n"); } break;
-    case vr::VREvent_Input_ActionManifestLoadFailed: { printf_s("(OpenVR) VREvent_Input_ActionManifestLoadFailed\n"); } break;
-    case vr::VREvent_Input_ProgressUpdate: { printf_s("(OpenVR) VREvent_Input_ProgressUpdate\n"); } break;
-    case vr::VREvent_Input_TrackerActivated: { printf_s("(OpenVR) VREvent_Input_TrackerActivated\n"); } break;
-    case vr::VREvent_Input_BindingsUpdated: { printf_s("(OpenVR) VREvent_Input_BindingsUpdated\n"); } break;
-    case vr::VREvent_ActionBindingReloaded: { printf_s("(OpenVR) VREvent_ActionBindingReloaded\n"); } break;
-    case vr::VREvent_ChaperoneFlushCache: { printf_s("(OpenVR) VREvent_ChaperoneFlushCache\n"); } break;
-    case vr::VREvent_ButtonTouch: { printf_s("(OpenVR) Event: Touch Device: %d\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_ButtonUntouch: { printf_s("(OpenVR) Event: Untouch Device: %d\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_ButtonPress: { printf_s("(OpenVR) Event: Press Device: %d\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_ButtonUnpress: { printf_s("(OpenVR) Event: Release Device: %d\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_EnterStandbyMode: { printf_s("(OpenVR) Event: Enter StandbyMode: %d\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_LeaveStandbyMode: { printf_s("(OpenVR) Event: Leave StandbyMode: %d\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_PropertyChanged: { printf_s("(OpenVR) Event: Property Changed Device: %d ETrackedDeviceProperty(%d)\n", event.trackedDeviceIndex, event.data.property.prop); } break;
-    case vr::VREvent_SceneApplicationChanged: { printf_s("(OpenVR) Event: Scene Application Changed\n"); } break;
-    case vr::VREvent_SceneFocusChanged: { printf_s("(OpenVR) Event: Scene Focus Changed\n"); } break;
-    case vr::VREvent_TrackedDeviceUserInteractionStarted: { printf_s("(OpenVR) Event: Tracked Device User Interaction Started Device: %d\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_TrackedDeviceUserInteractionEnded: { printf_s("(OpenVR) Event: Tracked Device User Interaction Ended Device: %d\n", event.trackedDeviceIndex); } break;
-    case vr::VREvent_ProcessDisconnected: { printf_s("(OpenVR) Event: A process was disconnected\n"); } break;
-    case vr::VREvent_ProcessConnected: { printf_s("(OpenVR) Event: A process was connected\n"); } break;
-    case (vr::VREvent_StatusUpdate): {
-        char* status = "unkown";
-        switch (event.data.status.statusState) {
-        case(vr::EVRState::VRState_NotReady): { status = "not Ready"; } break;
-        case(vr::EVRState::VRState_Off): { status = "off"; } break;
-        case(vr::EVRState::VRState_Ready): { status = "ready"; } break;
-        case(vr::EVRState::VRState_Ready_Alert): { status = "ready alert"; } break;
-        case(vr::EVRState::VRState_Ready_Alert_Low): { status = "ready alert low"; } break;
-        case(vr::EVRState::VRState_Searching): { status = "searching"; } break;
-        case(vr::EVRState::VRState_Searching_Alert): { status = "searching alert"; } break;
-        case(vr::EVRState::VRState_Standby): { status = "standby"; } break;
-        case(vr::EVRState::VRState_Undefined): { status = "undefined"; } break;
-        }
-        printf_s("(OpenVR) Device %d status: %s\n", event.trackedDeviceIndex, status);
-    } break;
-
-    case (vr::VREvent_Quit): {
-        printf_s("(OpenVR) Received SteamVR Quit (%d)\n", vr::VREvent_Quit);
-        return false;
-    } break;
-
-    case (vr::VREvent_ProcessQuit): {
-        printf_s("(OpenVR) SteamVR Quit Process (%d)\n", vr::VREvent_ProcessQuit);
-        return false;
-    } break;
-
-    case (vr::VREvent_QuitAborted_UserPrompt): {
-        printf_s("(OpenVR) SteamVR Quit Aborted UserPrompt (%d)\n", vr::VREvent_QuitAborted_UserPrompt);
-        return false;
-    } break;
-
-    case (vr::VREvent_QuitAcknowledged): {
-        printf_s("(OpenVR) SteamVR Quit Acknowledged (%d)\n", vr::VREvent_QuitAcknowledged);
-        return false;
-    } break;
- 
-    default: { printf_s("(OpenVR) Unmanaged Event: %d Device: %d\n", event.eventType, event.trackedDeviceIndex); } break;
-    }
-
-    return true;
-}
-
-
-// Get the quaternion representing the rotation
-vr::HmdQuaternion_t LighthouseTracking::GetRotation(vr::HmdMatrix34_t matrix) {
-    vr::HmdQuaternion_t q;
-
-    q.w = sqrt(fmax(0, 1 + matrix.m[0][0] + matrix.m[1][1] + matrix.m[2][2])) / 2;
-    q.x = sqrt(fmax(0, 1 + matrix.m[0][0] - matrix.m[1][1] - matrix.m[2][2])) / 2;
-    q.y = sqrt(fmax(0, 1 - matrix.m[0][0] + matrix.m[1][1] - matrix.m[2][2])) / 2;
-    q.z = sqrt(fmax(0, 1 - matrix.m[0][0] - matrix.m[1][1] + matrix.m[2][2])) / 2;
-    q.x = copysign(q.x, matrix.m[2][1] - matrix.m[1][2]);
-    q.y = copysign(q.y, matrix.m[0][2] - matrix.m[2][0]);
-    q.z = copysign(q.z, matrix.m[1][0] - matrix.m[0][1]);
-    return q;
-}
-
-// Get the vector representing the position
-vr::HmdVector3_t LighthouseTracking::GetPosition(vr::HmdMatrix34_t matrix) {
-    vr::HmdVector3_t vector;
-
-    vector.v[0] = matrix.m[0][3];
-    vector.v[1] = matrix.m[1][3];
-    vector.v[2] = matrix.m[2][3];
-
-    return vector;
-}
-
+//
+// HTC Vive Lighthouse Tracking Example
+// By Peter Thor 2016, 2017, 2018, 2019
+//
+// Shows how to extract basic tracking data
+
+#include "stdafx.h"
+#include "LighthouseTracking.h"
+#include "MonotonicClock.h"
+#include "AllocationTracker.h"
+#include <math.h>
+#include <string.h>
+
+// Destructor
+LighthouseTracking::~LighthouseTracking() {
+	StopRecording();
+	StopTransmitThread();
+	StopStatusDisplay();
+	delete m_pFrameRing;
+	for (ProfileEncoder *encoder : m_encoders)
+		delete encoder;
+}
+
+// Constructor
+LighthouseTracking::LighthouseTracking(PoseSource *source, IpEndpointName ip, const OutputProfile &profile)
+	: m_pSource(source), m_poseBatch(k_unMaxDeviceCount), m_stopTransmitting(false) {
+	m_registry.Refresh(*m_pSource);
+	AddDestination(ip, profile);
+}
+
+void LighthouseTracking::AddDestination(const IpEndpointName &ip, const OutputProfile &profile) {
+	// Destinations with the same profile get the same packets, encoded once
+	ProfileEncoder *encoder = NULL;
+	for (ProfileEncoder *existing : m_encoders)
+		if (existing->Profile() == profile)
+			encoder = existing;
+	if (!encoder) {
+		if (m_encoders.size() == static_cast<std::size_t>(k_nMaxOutputProfiles)) {
+			char name[IpEndpointName::ADDRESS_AND_PORT_STRING_LENGTH];
+			ip.AddressAndPortAsString(name);
+			printf_s("Too many different output profiles, not sending to %s\n", name);
+			return;
+		}
+		encoder = new ProfileEncoder(profile, static_cast<int>(m_encoders.size()), m_fanout);
+		encoder->SetFrameBundling(m_bundleFrames, m_maxPacketSize);
+		encoder->SetDeadband(m_deadbandConfig);
+		m_encoders.push_back(encoder);
+		m_profilesChanged = true;
+		BindEncoders();
+	}
+
+	int destination = m_fanout.AddDestination(ip);
+	encoder->AddDestination(destination);
+
+	char buffer[1024];
+	osc::OutboundPacketStream p(buffer,1024);
+
+	p << osc::BeginBundle(m_ntpClock.TimeTag(MonotonicNanoseconds()))
+		<< osc::BeginMessage("/notice")
+		<< "vive-osc-sender launched"
+		<< osc::EndMessage << osc::EndBundle;
+	m_fanout.Queue(destination, p.Data(), p.Size());
+	m_fanout.Flush();
+}
+
+// Point the encoders at the columns TransmitFrame fills. Profiles with
+// prediction extrapolate from them into columns of their own.
+void LighthouseTracking::BindEncoders() {
+	FrameColumns &columns = m_columns;
+	columns.position[0] = m_poseBatch.PositionX();
+	columns.position[1] = m_poseBatch.PositionY();
+	columns.position[2] = m_poseBatch.PositionZ();
+	columns.quaternion[0] = m_poseBatch.QuaternionW();
+	columns.quaternion[1] = m_poseBatch.QuaternionX();
+	columns.quaternion[2] = m_poseBatch.QuaternionY();
+	columns.quaternion[3] = m_poseBatch.QuaternionZ();
+	for (int row = 0; row < 3; row++)
+		for (int col = 0; col < 4; col++)
+			columns.matrix[row * 4 + col] = m_poseBatch.Matrix(row, col);
+	for (int axis = 0; axis < 3; axis++) {
+		columns.velocity[axis] = m_poseBatch.Velocity(axis);
+		columns.angularVelocity[axis] = m_poseBatch.AngularVelocity(axis);
+	}
+	columns.trigger = m_trigger;
+	columns.axes[0] = m_axisX;
+	columns.axes[1] = m_axisY;
+
+	for (ProfileEncoder *encoder : m_encoders)
+		encoder->Bind(columns);
+}
+
+void LighthouseTracking::SetFrameBundling(bool enabled, std::size_t maxPacketSize) {
+	m_bundleFrames = enabled;
+	m_maxPacketSize = maxPacketSize;
+	for (ProfileEncoder *encoder : m_encoders)
+		encoder->SetFrameBundling(enabled, maxPacketSize);
+}
+
+void LighthouseTracking::SetDeadband(const DeadbandConfig &config) {
+	m_deadbandConfig = config;
+	for (ProfileEncoder *encoder : m_encoders)
+		encoder->SetDeadband(config);
+}
+
+void LighthouseTracking::RequestKeyframe() {
+	for (ProfileEncoder *encoder : m_encoders)
+		encoder->RequestKeyframe();
+}
+
+// Which profiles take each registered device, evaluated once per device
+// change rather than per frame
+void LighthouseTracking::UpdateDeviceStates() {
+	m_deviceStates.Clear();
+	for (int n = 0; n < m_registry.DeviceCount(); n++) {
+		const RegisteredDevice &device = m_registry.Device(n);
+		unsigned int profiles = 0;
+		for (ProfileEncoder *encoder : m_encoders)
+			if (encoder->Profile().Accepts(device))
+				profiles |= encoder->ProfileBit();
+		m_deviceStates.Set(device.unDevice, device, profiles);
+	}
+	m_profiledGeneration = m_registry.Generation();
+	m_profilesChanged = false;
+}
+
+/*
+* Loop-listen for events then parses them (e.g. prints the to user)
+* Returns true if success or false if the runtime has quit
+*/
+bool LighthouseTracking::RunProcedure() {
+
+	//ParseTrackingFrame(filterIndex);
+    uint64_t frameAllocations = ThreadAllocationCount();
+    ParseTrackingFrame();
+
+    int64_t eventsStart = MonotonicNanoseconds();
+    uint64_t eventsAllocations = ThreadAllocationCount();
+    DeviceEvent event;
+    while (m_pSource->PollNextEvent(&event)) {
+        if (!ProcessEvent(event)) {
+            m_sourceQuit = true;
+            return false;
+        }
+    }
+
+    int64_t end = MonotonicNanoseconds();
+    uint64_t allocations = ThreadAllocationCount();
+    m_latency.Record(PipelineStage_Events, end - eventsStart);
+    m_latency.Record(PipelineStage_Frame, end - m_acquiredFrame.captureTimeNs);
+    m_latency.RecordAllocations(PipelineStage_Events, allocations - eventsAllocations);
+    m_latency.RecordAllocations(PipelineStage_Frame, allocations - frameAllocations);
+	return true;
+}
+
+/*
+* Parse a Frame with data from the tracking system
+*
+* Handy reference:
+* https://github.com/TomorrowTodayLabs/NewtonVR/blob/master/Assets/SteamVR/Scripts/SteamVR_Utils.cs
+*
+* Also:
+* Open VR Convention (same as OpenGL)
+* right-handed system
+* +y is up
+* +x is to the right
+* -z is going away from you
+* http://www.3dgep.com/understanding-the-view-matrix/
+*
+*/
+void LighthouseTracking::ParseTrackingFrame() {
+    AcquireFrame(m_acquiredFrame);
+    if (m_duplicateFrames.Drop(m_acquiredFrame))
+        return;
+    if (m_recorder.IsOpen()) {
+        int64_t start = MonotonicNanoseconds();
+        uint64_t allocations = ThreadAllocationCount();
+        m_recorder.Record(m_acquiredFrame, m_registry);
+        m_latency.Record(PipelineStage_Record, MonotonicNanoseconds() - start);
+        m_latency.RecordAllocations(PipelineStage_Record, ThreadAllocationCount() - allocations);
+    }
+    SubmitFrame(m_acquiredFrame);
+}
+
+void LighthouseTracking::SubmitFrame(const TrackingFrame &frame) {
+    if (m_pFrameRing)
+        m_pFrameRing->Push(frame, &m_stopTransmitting);
+    else
+        TransmitFrame(frame);
+}
+
+void LighthouseTracking::InjectFrame(TrackingFrame &frame, const RegisteredDevice *devices) {
+    frame.captureTimeNs = MonotonicNanoseconds();
+    frame.timeTag = m_ntpClock.TimeTag(frame.captureTimeNs);
+    frame.frameNumber = m_frameNumber++;
+
+    // Which profiles take each device, again only when the devices changed
+    if (m_profilesChanged || m_injectedGeneration != frame.templateGeneration) {
+        m_deviceStates.Clear();
+        for (DeviceIndex i = 0; i < k_unMaxDeviceCount; i++) {
+            unsigned int profiles = 0;
+            for (ProfileEncoder *encoder : m_encoders)
+                if (encoder->Profile().Accepts(devices[i]))
+                    profiles |= encoder->ProfileBit();
+            m_deviceStates.Set(i, devices[i], profiles);
+        }
+        m_injectedGeneration = frame.templateGeneration;
+        m_profilesChanged = false;
+    }
+    for (int n = 0; n < frame.deviceCount; n++)
+        frame.devices[n].profiles = m_deviceStates.State(frame.devices[n].unDevice).profiles;
+
+    SubmitFrame(frame);
+}
+
+void LighthouseTracking::AcquireFrame(TrackingFrame &frame) {
+    uint64_t allocations = ThreadAllocationCount();
+    frame.captureTimeNs = MonotonicNanoseconds();
+    frame.timeTag = m_ntpClock.TimeTag(frame.captureTimeNs);
+    frame.frameNumber = m_frameNumber++;
+    frame.templateGeneration = m_registry.Generation();
+    frame.deviceCount = 0;
+
+    if (m_profilesChanged || m_profiledGeneration != m_registry.Generation())
+        UpdateDeviceStates();
+
+    // All poses in one go, up to the highest connected slot
+    if (m_batchPoseFetch)
+        m_pSource->GetDevicePoses(m_deviceStates.Poses(), m_registry.SlotCount());
+
+    // Only the live devices that have an address and are wanted by some
+    // destination, the table already knows their class and address
+    for (int n = 0; n < m_deviceStates.ActiveCount(); n++)
+    {
+        DeviceIndex i = m_deviceStates.ActiveSlot(n);
+        const DeviceState &device = m_deviceStates.State(i);
+
+        DevicePose *devicePose = &m_deviceStates.Pose(i);
+        ControllerState controllerState;
+        if (m_batchPoseFetch) {
+            // Trackers have no controller state worth a round trip
+            if (device.deviceClass != DeviceClass_Controller || !m_pSource->GetControllerState(i, &controllerState))
+                memset(&controllerState, 0, sizeof(controllerState));
+        } else {
+            if (!m_pSource->GetDevicePose(i, devicePose, &controllerState)) continue;
+        }
+
+        // If the pose is invalid, or the Tracking result not okay, don't send
+        if (!devicePose->bPoseIsValid || !devicePose->bTrackingOK) continue;
+
+        TrackedDeviceSample &sample = frame.devices[frame.deviceCount++];
+        sample.unDevice = i;
+        sample.deviceClass = device.deviceClass;
+        sample.ordinal = device.ordinal;
+        sample.profiles = device.profiles;
+        bool isController = (device.deviceClass == DeviceClass_Controller);
+        sample.trigger = isController ? controllerState.rAxis[1].x : 0; // get controller axis
+        sample.axes[0] = isController ? controllerState.rAxis[0].x : 0;
+        sample.axes[1] = isController ? controllerState.rAxis[0].y : 0;
+        memcpy(sample.oscAddress, device.oscAddress, sizeof(sample.oscAddress));
+        sample.pose = *devicePose;
+    }
+
+    m_latency.Record(PipelineStage_Acquire, MonotonicNanoseconds() - frame.captureTimeNs);
+    m_latency.RecordAllocations(PipelineStage_Acquire, ThreadAllocationCount() - allocations);
+}
+
+void LighthouseTracking::TransmitFrame(const TrackingFrame &frame) {
+    int64_t start = MonotonicNanoseconds();
+    uint64_t startAllocations = ThreadAllocationCount();
+    if (m_pFrameRing)
+        m_latency.Record(PipelineStage_Queued, start - frame.captureTimeNs);
+
+    // Device addresses may have been renumbered since the last frame
+    if (frame.templateGeneration != m_transmittedGeneration) {
+        for (ProfileEncoder *encoder : m_encoders)
+            encoder->Invalidate();
+        m_transmittedGeneration = frame.templateGeneration;
+    }
+
+    // Position and quaternion of every device in one pass
+    m_poseBatch.Clear();
+    for (int n = 0; n < frame.deviceCount; n++) {
+        const TrackedDeviceSample &sample = frame.devices[n];
+        m_poseBatch.Add(sample.pose);
+        m_trigger[n] = sample.trigger;
+        m_axisX[n] = sample.axes[0];
+        m_axisY[n] = sample.axes[1];
+    }
+    ConvertPoses(m_poseBatch);
+    int64_t converted = MonotonicNanoseconds();
+    uint64_t convertedAllocations = ThreadAllocationCount();
+    m_latency.Record(PipelineStage_Convert, converted - start);
+    m_latency.RecordAllocations(PipelineStage_Convert, convertedAllocations - startAllocations);
+
+    // The encoders read from the columns filled above
+    for (ProfileEncoder *encoder : m_encoders)
+        encoder->Encode(frame);
+    int64_t encoded = MonotonicNanoseconds();
+    uint64_t encodedAllocations = ThreadAllocationCount();
+    m_latency.Record(PipelineStage_Encode, encoded - converted);
+    m_latency.RecordAllocations(PipelineStage_Encode, encodedAllocations - convertedAllocations);
+    m_fanout.Flush();
+    m_latency.Record(PipelineStage_Send, MonotonicNanoseconds() - encoded);
+    m_latency.RecordAllocations(PipelineStage_Send, ThreadAllocationCount() - encodedAllocations);
+
+    m_statusDisplay.Offer(frame, m_columns);
+}
+
+void LighthouseTracking::StartTransmitThread(RingOverflowPolicy policy) {
+    if (m_pFrameRing)
+        return;
+    m_pFrameRing = new SpscRing<TrackingFrame, k_unFrameRingSize>(policy);
+    if (m_prefault)
+        PrefaultMemory(m_pFrameRing, sizeof(*m_pFrameRing));
+    m_stopTransmitting = false;
+    m_transmitThread = std::thread(&LighthouseTracking::TransmitThreadMain, this);
+}
+
+std::size_t LighthouseTracking::PrefaultBuffers() {
+    m_prefault = true;
+    std::size_t bytes = PrefaultMemory(&m_deviceStates, sizeof(m_deviceStates))
+        + PrefaultMemory(&m_poseBatch, sizeof(m_poseBatch))
+        + PrefaultMemory(&m_acquiredFrame, sizeof(m_acquiredFrame))
+        + PrefaultMemory(&m_transmitFrame, sizeof(m_transmitFrame))
+        + m_fanout.Prefault();
+    for (ProfileEncoder *encoder : m_encoders)
+        bytes += encoder->Prefault();
+    return bytes;
+}
+
+// The ring is kept until destruction so its counters can still be printed
+void LighthouseTracking::StopTransmitThread() {
+    if (!m_transmitThread.joinable())
+        return;
+    m_stopTransmitting = true;
+    m_transmitThread.join();
+}
+
+void LighthouseTracking::TransmitThreadMain() {
+    if (m_prefault)
+        PrefaultStack();
+
+    while (!m_stopTransmitting) {
+        if (!m_pFrameRing->WaitForData(std::chrono::milliseconds(10)))
+            continue;
+        while (m_pFrameRing->Pop(m_transmitFrame))
+            TransmitFrame(m_transmitFrame);
+    }
+
+    // Send whatever was still queued
+    while (m_pFrameRing->Pop(m_transmitFrame))
+        TransmitFrame(m_transmitFrame);
+}
+
+unsigned long LighthouseTracking::PacketsSent() const {
+    unsigned long packets = 0;
+    for (const ProfileEncoder *encoder : m_encoders)
+        packets += encoder->PacketsSent();
+    return packets;
+}
+
+void LighthouseTracking::PrintStatistics() {
+    unsigned long messages = 0;
+    for (ProfileEncoder *encoder : m_encoders)
+        messages += encoder->MessagesSent();
+    printf_s("Sent %lu messages in %lu packets\n", messages, PacketsSent());
+    for (ProfileEncoder *encoder : m_encoders)
+        encoder->PrintStatistics(m_fanout);
+    m_fanout.PrintStatistics();
+    m_duplicateFrames.PrintStatistics();
+    printf_s("Time tags: offset re-estimated %lu times, stepped %lu times, last error %.1f us\n",
+        m_ntpClock.Estimates(), m_ntpClock.Steps(), m_ntpClock.LastErrorNanoseconds() / 1000.0);
+    m_latency.Print();
+    if (m_recorder.Frames() > 0 || m_recorder.Overruns() > 0)
+        m_recorder.PrintStatistics();
+    if (m_pFrameRing) {
+        printf_s("Frame ring: %lu frames queued, %lu dropped, producer blocked %lu times, peak occupancy %lu/%lu\n",
+            m_pFrameRing->Pushed(), m_pFrameRing->Dropped(), m_pFrameRing->Blocked(),
+            m_pFrameRing->MaxOccupancy(), static_cast<unsigned long>(k_unFrameRingSize));
+    }
+}
+
+void LighthouseTracking::PrintDevices() {
+
+	printf_s("\nDevice list:\n---------------------------\n");
+
+	// Process device states
+	for (DeviceIndex unDevice = 0; unDevice < k_unMaxDeviceCount; unDevice++)
+	{
+		if (!m_pSource->IsDeviceConnected(unDevice))
+			continue;
+
+		// Get what type of device it is and work with its data
+		DeviceClass trackedDeviceClass = m_pSource->GetDeviceClass(unDevice);
+        switch (trackedDeviceClass) {
+        case DeviceClass_HMD: { printf_s("Device %d: [HMD]", unDevice); } break;
+        case DeviceClass_Controller: {
+            switch (m_pSource->GetControllerRole(unDevice)) {
+            case ControllerRole_Invalid: printf_s("Device %d: [Invalid Controller]", unDevice); break;
+            case ControllerRole_LeftHand: printf_s("Device %d: [Controller - Left]", unDevice); break;
+            case ControllerRole_RightHand: printf_s("Device %d: [Controller - Right]", unDevice); break;
+            case ControllerRole_Treadmill: printf_s("Device %d: [Treadmill]", unDevice); break;
+            case ControllerRole_OptOut:
+            case ControllerRole_Max: break;
+            } break;
+        } break; // DeviceClass_Controller
+
+        case DeviceClass_GenericTracker: { printf_s("Device %d: [GenericTracker]", unDevice); } break;
+        case DeviceClass_TrackingReference: { printf_s("Device %d: [TrackingReference]", unDevice); } break;
+        case DeviceClass_DisplayRedirect: { printf_s("Device %d: [DisplayRedirect]", unDevice); } break;
+        case DeviceClass_Invalid: { printf_s("Device %d: [Invalid]", unDevice); } break;
+        case DeviceClass_Max: break;
+		}
+
+		char manufacturer[64] = "";
+		m_pSource->GetDeviceString(unDevice, DeviceString_ManufacturerName, manufacturer, sizeof(manufacturer));
+
+		char modelnumber[64] = "";
+		m_pSource->GetDeviceString(unDevice, DeviceString_ModelNumber, modelnumber, sizeof(modelnumber));
+
+		char serialnumber[64] = "";
+		m_pSource->GetDeviceString(unDevice, DeviceString_SerialNumber, serialnumber, sizeof(serialnumber));
+
+		printf_s(" %s - %s [%s] class(%d)\n", manufacturer, modelnumber, serialnumber, trackedDeviceClass);
+
+        // If the device is a controller, print each axis type
+        if (trackedDeviceClass == DeviceClass_Controller) {
+            for (int j = 0; j < k_unControllerAxisCount; j++) {
+                const char *axisName = m_pSource->GetControllerAxisTypeName(unDevice, j);
+                if (axisName) {
+                    printf_s("\taxis: %d - type: %s \n", j, axisName);
+                }
+            }
+        }
+	}
+	printf_s("---------------------------\n\n");
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Processes a single runtime event
+//-----------------------------------------------------------------------------
+
+bool LighthouseTracking::ProcessEvent(const DeviceEvent & event) {
+    switch (event.eventType)
+    {
+    case DeviceEvent_Quit: return false;
+
+    // Keep the device list current, a new registry generation makes the
+    // transmit side rebuild its templates
+    case DeviceEvent_Activated:
+    case DeviceEvent_Deactivated:
+    case DeviceEvent_RoleChanged:
+    case DeviceEvent_PropertyChanged:
+        m_registry.ProcessEvent(*m_pSource, event);
+        break;
+
+    case DeviceEvent_None:
+    case DeviceEvent_Updated:
+        break;
+    }
+
+    return true;
+}
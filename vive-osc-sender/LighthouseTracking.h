@@ -1,44 +1,215 @@
-// LIGHTHOUSETRACKING.h
-#ifndef _LIGHTHOUSETRACKING_H_
-#define _LIGHTHOUSETRACKING_H_
-
-// OpenVR
-#include <openvr.h>
-#include "ip\UdpSocket.h"
-#include "osc\OscOutboundPacketStream.h"
-#include "samples\shared\Matrices.h"
-
-class LighthouseTracking {
-private:
-
-	// Basic stuff
-	vr::IVRSystem *m_pHMD = NULL;
-	vr::TrackedDevicePose_t m_rTrackedDevicePose[vr::k_unMaxTrackedDeviceCount];
-    bool m_deviceConnected[vr::k_unMaxTrackedDeviceCount];
-	Matrix4 m_rmat4DevicePose[vr::k_unMaxTrackedDeviceCount];
-
-	// Position and rotation of pose
-	vr::HmdVector3_t LighthouseTracking::GetPosition(vr::HmdMatrix34_t matrix);
-	vr::HmdQuaternion_t LighthouseTracking::GetRotation(vr::HmdMatrix34_t matrix);
-
-	// UdpTransmitSocket
-	UdpTransmitSocket transmitSocket;
-
-public:
-	~LighthouseTracking();
-	LighthouseTracking(IpEndpointName ip);
-
-	// Main loop that listens for openvr events and calls process and parse routines, if false the service has quit
-	bool RunProcedure();
-
-	// Process a VR event and print some general info of what happens
-	bool ProcessVREvent(const vr::VREvent_t & event);
-
-	// Parse a tracking frame and print its position / rotation / events.
-	void ParseTrackingFrame();
-
-	// prints information of devices
-	void PrintDevices();
-};
-
-#endif _LIGHTHOUSETRACKING_H_
+// LIGHTHOUSETRACKING.h
+#ifndef _LIGHTHOUSETRACKING_H_
+#define _LIGHTHOUSETRACKING_H_
+
+#include "PoseSource.h"
+#include "ip/UdpSocket.h"
+#include "UdpFanout.h"
+#include "osc/OscOutboundPacketStream.h"
+#include "FramePacker.h"
+#include "ProfileEncoder.h"
+#include "StatusDisplay.h"
+#include "NtpClock.h"
+#include "LatencyHistogram.h"
+#include "PoseBatch.h"
+#include "DeadbandFilter.h"
+#include "DuplicateFrameFilter.h"
+#include "DeviceRegistry.h"
+#include "DeviceStateTable.h"
+#include "TrackingFrame.h"
+#include "SpscRing.h"
+#include "SessionRecorder.h"
+#include "RealtimeSetup.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Frames that can be queued between acquisition and the transmit thread
+static const std::size_t k_unFrameRingSize = 64;
+
+class LighthouseTracking {
+private:
+
+	// Basic stuff
+	PoseSource *m_pSource = NULL;
+
+	// Connected devices and their addresses, refreshed from runtime events
+	DeviceRegistry m_registry;
+
+	// What the frame loop reads per device slot: class, address, profiles
+	// and the latest pose, owned by the acquisition side and rebuilt when
+	// the registry or the profiles change
+	DeviceStateTable m_deviceStates;
+	unsigned int m_profiledGeneration = 0;
+	bool m_profilesChanged = true;
+	void UpdateDeviceStates();
+
+	// Positions and rotations of a frame, converted for all devices at once.
+	// The transmit side's state starts here, on a cache line of its own.
+	alignas(k_unCacheLineSize) PoseBatch m_poseBatch;
+
+	// Controller values of a frame, next to the pose columns of m_poseBatch
+	float m_trigger[k_unMaxDeviceCount];
+	float m_axisX[k_unMaxDeviceCount];
+	float m_axisY[k_unMaxDeviceCount];
+	FrameColumns m_columns;
+	void BindEncoders();
+
+	// Sends each frame's packets to every destination in one batch
+	UdpFanout m_fanout;
+
+	// One encoder per distinct output profile, shared by the destinations
+	// that use it. Each keeps its own message templates and deadband.
+	std::vector<ProfileEncoder *> m_encoders;
+	bool m_bundleFrames = false;
+	std::size_t m_maxPacketSize = k_unDefaultMaxPacketSize;
+	DeadbandConfig m_deadbandConfig;
+
+	// Stamps frames with their capture time, owned by the acquisition side
+	NtpClock m_ntpClock;
+
+	// Frame counter, owned by the acquisition side. The transmit side drops
+	// its templates when a frame carries a new registry generation.
+	unsigned long m_frameNumber = 0;
+
+	// Set when RunProcedure() stopped because the runtime quit
+	bool m_sourceQuit = false;
+
+	// Fetch all poses with one runtime call per frame instead of one per device
+	bool m_batchPoseFetch = false;
+
+	// Counts, and optionally drops, frames polled before the runtime had new
+	// poses. Owned by the acquisition side.
+	DuplicateFrameFilter m_duplicateFrames;
+	unsigned int m_transmittedGeneration = 0;
+
+	// Time spent in each stage of the frame pipeline, recorded by the
+	// thread that runs the stage
+	PipelineLatency m_latency;
+
+	// Console table of the latest frame, drawn by its own thread
+	StatusDisplay m_statusDisplay;
+
+	// Session file of the acquired frames, written on the acquisition side
+	SessionRecorder m_recorder;
+
+	// Threaded transmission: acquisition pushes frames, the transmit thread
+	// encodes and sends them
+	TrackingFrame m_acquiredFrame;
+	TrackingFrame m_transmitFrame;
+	SpscRing<TrackingFrame, k_unFrameRingSize> *m_pFrameRing = NULL;
+	std::thread m_transmitThread;
+	std::atomic<bool> m_stopTransmitting;
+	void TransmitThreadMain();
+
+	// Also fault in the frame ring and the transmit thread's stack when the
+	// thread starts
+	bool m_prefault = false;
+
+	// Encode and send a frame, and offer it to the status display
+	void TransmitFrame(const TrackingFrame &frame);
+
+	// Queue an acquired frame for the transmit thread, or send it right away
+	void SubmitFrame(const TrackingFrame &frame);
+
+	// Template generation of the last injected frame, for its profiles
+	unsigned int m_injectedGeneration = 0;
+
+public:
+	~LighthouseTracking();
+	LighthouseTracking(PoseSource *source, IpEndpointName ip, const OutputProfile &profile = OutputProfile());
+
+	// Also send frames to this endpoint, as its profile says. Call before
+	// the first frame.
+	void AddDestination(const IpEndpointName &ip, const OutputProfile &profile = OutputProfile());
+
+	// Send each frame as one OSC bundle (split at maxPacketSize bytes) instead of one datagram per device
+	void SetFrameBundling(bool enabled, std::size_t maxPacketSize = k_unDefaultMaxPacketSize);
+
+	// Send from a dedicated thread fed through a frame ring, so a slow send
+	// doesn't hold up pose acquisition. Call before the first frame.
+	void StartTransmitThread(RingOverflowPolicy policy);
+	void StopTransmitThread();
+
+	// The running transmit thread, to pin it or raise its priority (see
+	// RealtimeSetup)
+	RealtimeThread TransmitThreadHandle() { return m_transmitThread.native_handle(); }
+
+	// Fault in the frame, encode and socket buffers now instead of on the
+	// first frames, and the frame ring and the transmit thread's stack when
+	// it starts. Call once destinations and bundling are set, before
+	// StartTransmitThread(). Returns the bytes touched now.
+	std::size_t PrefaultBuffers();
+
+	// Show the latest frame's poses in a console table, redrawn refreshHz
+	// times a second by a separate thread. Without it nothing is printed
+	// per frame.
+	void StartStatusDisplay(double refreshHz) { m_statusDisplay.Start(refreshHz); }
+	void StopStatusDisplay() { m_statusDisplay.Stop(); }
+
+	// Append every acquired frame to a session file (see SessionRecorder),
+	// until StopRecording(). False if the file can't be created.
+	bool StartRecording(const char *path, std::size_t chunkSize = k_unDefaultSessionChunkSize) { return m_recorder.Open(path, chunkSize); }
+	void StopRecording() { m_recorder.Close(); }
+
+	// Fetch the poses of all devices in one runtime call per frame, controller
+	// state is then only queried for controllers
+	void SetBatchPoseFetch(bool enabled) { m_batchPoseFetch = enabled; }
+
+	// Skip devices that moved less than the thresholds since they were last
+	// sent, resending them only as a keepalive
+	void SetDeadband(const DeadbandConfig &config);
+
+	// Drop frames whose poses are bitwise the same as the previous frame's
+	// before they are recorded, encoded or sent, but still send one every
+	// keepaliveSeconds. Duplicates are counted either way.
+	void SetFrameDedup(bool enabled, double keepaliveSeconds = 0.5) { m_duplicateFrames.SetConfig(enabled, keepaliveSeconds); }
+	const DuplicateFrameFilter &DuplicateFrames() const { return m_duplicateFrames; }
+
+	// Make the next frame of every compact pose stream a keyframe, from any thread
+	void RequestKeyframe();
+
+	// Main loop that listens for runtime events and calls process and parse routines, if false the service has quit
+	bool RunProcedure();
+	bool SourceQuit() const { return m_sourceQuit; }
+
+	// Print send errors as they happen (the default); off, they are only
+	// counted for PrintStatistics()
+	void SetErrorReporting(bool enabled) { m_fanout.SetErrorReporting(enabled); }
+
+	// Process a runtime event, returns false if the runtime is quitting
+	bool ProcessEvent(const DeviceEvent & event);
+
+	// Parse a tracking frame and send it, or queue it for the transmit thread.
+	void ParseTrackingFrame();
+
+	// Read the poses of all devices that are to be sent, without sending
+	void AcquireFrame(TrackingFrame &frame);
+
+	// Send a frame that wasn't read from the pose source, e.g. one replayed
+	// from a session file, through the same pipeline as live frames. It is
+	// stamped with the current time and the next frame number, and its
+	// devices go to the profiles that accept devices[sample.unDevice], an
+	// array of k_unMaxDeviceCount slots. The
+	// frame's template generation must change whenever devices does. Don't
+	// mix with RunProcedure().
+	void InjectFrame(TrackingFrame &frame, const RegisteredDevice *devices);
+
+	// prints information of devices
+	void PrintDevices();
+
+	// The connected devices, as of the last frame
+	const DeviceRegistry &Registry() const { return m_registry; }
+
+	// Latency histograms of the pipeline stages, safe to print from any thread
+	const PipelineLatency &Latency() const { return m_latency; }
+
+	// Packets the encoders have handed to the fanout so far
+	unsigned long PacketsSent() const;
+
+	// prints packet counts per destination, stage latencies, the session file and, when threaded, frame ring occupancy and drops
+	void PrintStatistics();
+};
+
+#endif // _LIGHTHOUSETRACKING_H_
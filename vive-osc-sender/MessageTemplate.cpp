@@ -0,0 +1,33 @@
+//
+// Pre-encoded OSC messages with patchable float arguments
+//
+
+#include "stdafx.h"
+#include "MessageTemplate.h"
+
+#include "osc/OscOutboundPacketStream.h"
+
+bool MessageTemplate::Build(const char *address, int floatCount, bool timeTag) {
+	Clear();
+	if (floatCount < 0 || floatCount > k_unMaxTemplateFloats)
+		return false;
+
+	try {
+		osc::OutboundPacketStream p(m_data, sizeof(m_data));
+		p << osc::BeginMessage(address);
+		for (int i = 0; i < floatCount; i++)
+			p << 0.0f;
+		if (timeTag)
+			p << osc::TimeTag(1);
+		p << osc::EndMessage;
+
+		m_size = p.Size();
+	} catch (osc::OutOfBufferMemoryException &) {
+		return false;
+	}
+
+	m_floatCount = floatCount;
+	m_hasTimeTag = timeTag;
+	m_argumentsOffset = m_size - 4 * floatCount - (timeTag ? 8 : 0);
+	return true;
+}
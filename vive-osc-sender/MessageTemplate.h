@@ -0,0 +1,62 @@
+// MESSAGETEMPLATE.h
+#ifndef _MESSAGETEMPLATE_H_
+#define _MESSAGETEMPLATE_H_
+
+#include <cstring> // size_t
+
+#include "osc/OscTypes.h"
+
+// Room for an address of up to 63 characters, 32 float arguments and a time tag
+static const std::size_t k_unMaxTemplateSize = 248;
+static const int k_unMaxTemplateFloats = 32;
+
+//
+// A fully encoded OSC message whose arguments are all floats, optionally
+// followed by a time tag.
+//
+// The address, its padding and the ",fff..." type tag string are encoded
+// once in Build(); per frame only the float arguments change, and those
+// sit at fixed offsets at the end of the message, so updating the message
+// is a byte swap per value rather than a full OutboundPacketStream pass.
+//
+class MessageTemplate {
+private:
+	char m_data[k_unMaxTemplateSize];
+	std::size_t m_size = 0;
+	std::size_t m_argumentsOffset = 0;
+	int m_floatCount = 0;
+	bool m_hasTimeTag = false;
+
+public:
+	// Encode the address and type tags for floatCount float arguments and,
+	// if asked, a time tag argument after them. Returns false if the message
+	// doesn't fit the template buffer.
+	bool Build(const char *address, int floatCount, bool timeTag = false);
+	void Clear() { m_size = 0; m_floatCount = 0; m_hasTimeTag = false; }
+	bool IsBuilt() const { return m_size != 0; }
+
+	// Store argument index as a big endian float
+	void SetFloat(int index, float value) {
+		union { float f; unsigned int i; } u;
+		u.f = value;
+		char *p = m_data + m_argumentsOffset + 4 * index;
+		p[0] = static_cast<char>(u.i >> 24);
+		p[1] = static_cast<char>(u.i >> 16);
+		p[2] = static_cast<char>(u.i >> 8);
+		p[3] = static_cast<char>(u.i);
+	}
+
+	// Store the time tag argument, big endian
+	void SetTimeTag(osc::uint64 timeTag) {
+		char *p = m_data + m_argumentsOffset + 4 * m_floatCount;
+		for (int n = 0; n < 8; n++)
+			p[n] = static_cast<char>(timeTag >> (56 - 8 * n));
+	}
+
+	int FloatCount() const { return m_floatCount; }
+	bool HasTimeTag() const { return m_hasTimeTag; }
+	const char *Data() const { return m_data; }
+	std::size_t Size() const { return m_size; }
+};
+
+#endif // _MESSAGETEMPLATE_H_
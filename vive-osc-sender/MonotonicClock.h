@@ -0,0 +1,37 @@
+// MONOTONICCLOCK.h
+#ifndef _MONOTONICCLOCK_H_
+#define _MONOTONICCLOCK_H_
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+//
+// Nanoseconds on the system's monotonic clock (QueryPerformanceCounter on
+// Windows, CLOCK_MONOTONIC elsewhere). The epoch is arbitrary, only
+// differences are meaningful. CLOCK_MONOTONIC is also what the POSIX frame
+// scheduler sleeps against, so deadlines and readings share one timebase.
+//
+inline int64_t MonotonicNanoseconds() {
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	// split to avoid overflowing the multiplication
+	int64_t seconds = counter.QuadPart / frequency.QuadPart;
+	int64_t remainder = counter.QuadPart % frequency.QuadPart;
+	return seconds * 1000000000LL + remainder * 1000000000LL / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+#endif // _MONOTONICCLOCK_H_
@@ -0,0 +1,58 @@
+//
+// Monotonic clock to NTP time, with a periodically re-estimated offset
+//
+
+#include "stdafx.h"
+#include "NtpClock.h"
+#include "MonotonicClock.h"
+
+#include <chrono>
+
+// Readings per estimate, the one with the shortest bracket wins
+static const int k_nOffsetSamples = 3;
+
+static int64_t UnixNow() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+NtpClock::NtpClock(double intervalSeconds)
+	: m_intervalNs(static_cast<int64_t>(intervalSeconds * 1e9)) {
+}
+
+int64_t NtpClock::MeasureOffset() {
+	int64_t bestOffset = 0;
+	int64_t bestBracket = INT64_MAX;
+	for (int n = 0; n < k_nOffsetSamples; n++) {
+		int64_t before = MonotonicNanoseconds();
+		int64_t wall = UnixNow();
+		int64_t after = MonotonicNanoseconds();
+		if (after - before < bestBracket) {
+			bestBracket = after - before;
+			bestOffset = wall - (before + (after - before) / 2);
+		}
+	}
+	return bestOffset;
+}
+
+void NtpClock::Reestimate(int64_t monotonicNs) {
+	int64_t measured = MeasureOffset();
+	int64_t error = measured - m_offsetNs;
+	m_lastErrorNs = error;
+
+	int64_t maxSlew = static_cast<int64_t>(m_intervalNs * k_dNtpClockMaxSlew);
+	if (m_estimates == 0 || error > k_nNtpClockStepThresholdNs || error < -k_nNtpClockStepThresholdNs) {
+		m_offsetNs = measured;
+		if (m_estimates != 0)
+			m_steps++;
+	} else if (error > maxSlew) {
+		m_offsetNs += maxSlew;
+	} else if (error < -maxSlew) {
+		m_offsetNs -= maxSlew;
+	} else {
+		m_offsetNs = measured;
+	}
+
+	m_estimates++;
+	m_nextEstimateNs = monotonicNs + m_intervalNs;
+}
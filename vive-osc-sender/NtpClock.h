@@ -0,0 +1,67 @@
+// NTPCLOCK.h
+#ifndef _NTPCLOCK_H_
+#define _NTPCLOCK_H_
+
+#include <stdint.h>
+#include "osc/OscTypes.h"
+
+// Corrections up to this size are slewed in, larger ones are stepped
+static const int64_t k_nNtpClockStepThresholdNs = 100000000;	// 100 ms
+
+// Slew rate limit, as much as NTP itself slews the system clock
+static const double k_dNtpClockMaxSlew = 500e-6;				// 500 ppm
+
+//
+// Maps MonotonicNanoseconds() readings to wall clock time and OSC time tags.
+//
+// The wall clock can be stepped or slewed at any moment, so stamping each
+// frame with it directly would put the clock's jumps into the time tags.
+// Frames are stamped from the monotonic capture time plus an offset to the
+// wall clock instead. The offset is re-estimated periodically, from the
+// tightest of a few system clock readings bracketed by monotonic ones, and
+// small changes are slewed in at a bounded rate so consecutive time tags
+// keep their spacing; only a large difference (the wall clock was set) is
+// taken over at once.
+//
+class NtpClock {
+private:
+	int64_t m_offsetNs = 0;				// unix time minus monotonic time
+	int64_t m_intervalNs;
+	int64_t m_nextEstimateNs = 0;
+
+	// Statistics
+	unsigned long m_estimates = 0;
+	unsigned long m_steps = 0;
+	int64_t m_lastErrorNs = 0;
+
+public:
+	// Re-estimate the offset every intervalSeconds
+	explicit NtpClock(double intervalSeconds = 1.0);
+
+	// Unix time of a monotonic reading, in nanoseconds
+	int64_t UnixNanoseconds(int64_t monotonicNs) {
+		if (monotonicNs >= m_nextEstimateNs)
+			Reestimate(monotonicNs);
+		return monotonicNs + m_offsetNs;
+	}
+
+	// OSC time tag of a monotonic reading
+	osc::uint64 TimeTag(int64_t monotonicNs) {
+		return osc::TimeTagFromUnixNanoseconds(UnixNanoseconds(monotonicNs));
+	}
+
+	// Measure the offset now and move towards it
+	void Reestimate(int64_t monotonicNs);
+
+	// One bracketed reading of the wall clock against the monotonic clock
+	static int64_t MeasureOffset();
+
+	int64_t OffsetNanoseconds() const { return m_offsetNs; }
+	unsigned long Estimates() const { return m_estimates; }
+	unsigned long Steps() const { return m_steps; }
+
+	// Difference between the offset in use and the last measurement
+	int64_t LastErrorNanoseconds() const { return m_lastErrorNs; }
+};
+
+#endif // _NTPCLOCK_H_
@@ -0,0 +1,226 @@
+//
+// OpenVR backend for the pose source
+//
+
+#include "stdafx.h"
+#include "OpenVRPoseSource.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+// Destructor
+OpenVRPoseSource::~OpenVRPoseSource() {
+	if (m_pHMD != NULL)
+	{
+		vr::VR_Shutdown();
+		m_pHMD = NULL;
+	}
+}
+
+// Constructor
+OpenVRPoseSource::OpenVRPoseSource() {
+	vr::EVRInitError eError = vr::VRInitError_None;
+	m_pHMD = vr::VR_Init(&eError, vr::VRApplication_Background);
+	char buf[1024];
+
+	if (eError != vr::VRInitError_None)
+	{
+		m_pHMD = NULL;
+		sprintf_s(buf, sizeof(buf), "Unable to init VR runtime: %s", vr::VR_GetVRInitErrorAsEnglishDescription(eError));
+		printf_s(buf);
+		exit(EXIT_FAILURE);
+	}
+}
+
+bool OpenVRPoseSource::IsDeviceConnected(DeviceIndex device) {
+	return m_pHMD->IsTrackedDeviceConnected(device);
+}
+
+DeviceClass OpenVRPoseSource::GetDeviceClass(DeviceIndex device) {
+	return static_cast<DeviceClass>(m_pHMD->GetTrackedDeviceClass(device));
+}
+
+ControllerRole OpenVRPoseSource::GetControllerRole(DeviceIndex device) {
+	return static_cast<ControllerRole>(m_pHMD->GetControllerRoleForTrackedDeviceIndex(device));
+}
+
+bool OpenVRPoseSource::GetDeviceString(DeviceIndex device, DeviceString prop, char *buf, uint32_t bufSize) {
+	vr::ETrackedDeviceProperty vrProp = vr::ETrackedDeviceProperty::Prop_SerialNumber_String;
+	switch (prop) {
+	case DeviceString_ManufacturerName: vrProp = vr::ETrackedDeviceProperty::Prop_ManufacturerName_String; break;
+	case DeviceString_ModelNumber: vrProp = vr::ETrackedDeviceProperty::Prop_ModelNumber_String; break;
+	case DeviceString_SerialNumber: vrProp = vr::ETrackedDeviceProperty::Prop_SerialNumber_String; break;
+	}
+
+	vr::TrackedPropertyError error = vr::TrackedProp_Success;
+	m_pHMD->GetStringTrackedDeviceProperty(device, vrProp, buf, bufSize, &error);
+	return error == vr::TrackedProp_Success;
+}
+
+const char *OpenVRPoseSource::GetControllerAxisTypeName(DeviceIndex device, int axis) {
+	auto axisProp = static_cast<vr::ETrackedDeviceProperty>(axis + vr::Prop_Axis0Type_Int32);
+	vr::TrackedPropertyError error;
+	auto enumAxis = static_cast<vr::EVRControllerAxisType> (
+		m_pHMD->GetInt32TrackedDeviceProperty(device, axisProp, &error)
+		);
+	if (error)
+		return NULL;
+	return m_pHMD->GetControllerAxisTypeNameFromEnum(enumAxis);
+}
+
+static void CopyPose(const vr::TrackedDevicePose_t &vrPose, DevicePose *pose) {
+	memcpy(&pose->mDeviceToAbsoluteTracking, &vrPose.mDeviceToAbsoluteTracking, sizeof(pose->mDeviceToAbsoluteTracking));
+	memcpy(&pose->vVelocity, &vrPose.vVelocity, sizeof(pose->vVelocity));
+	memcpy(&pose->vAngularVelocity, &vrPose.vAngularVelocity, sizeof(pose->vAngularVelocity));
+	pose->bPoseIsValid = vrPose.bPoseIsValid;
+	pose->bTrackingOK = vrPose.eTrackingResult == vr::ETrackingResult::TrackingResult_Running_OK;
+}
+
+static void CopyControllerState(const vr::VRControllerState_t &vrControllerState, ControllerState *controllerState) {
+	controllerState->unPacketNum = vrControllerState.unPacketNum;
+	controllerState->ulButtonPressed = vrControllerState.ulButtonPressed;
+	controllerState->ulButtonTouched = vrControllerState.ulButtonTouched;
+	for (int j = 0; j < k_unControllerAxisCount; j++) {
+		controllerState->rAxis[j].x = vrControllerState.rAxis[j].x;
+		controllerState->rAxis[j].y = vrControllerState.rAxis[j].y;
+	}
+}
+
+bool OpenVRPoseSource::GetDevicePose(DeviceIndex device, DevicePose *pose, ControllerState *controllerState) {
+	vr::TrackedDevicePose_t vrPose;
+	vr::VRControllerState_t vrControllerState;
+	memset(&vrPose, 0, sizeof(vrPose));
+	if (!m_pHMD->GetControllerStateWithPose(vr::TrackingUniverseRawAndUncalibrated, device, &vrControllerState, sizeof(vrControllerState), &vrPose)) {
+		// Not a controller (e.g. a tracker), the runtime still fills in the pose
+		memset(&vrControllerState, 0, sizeof(vrControllerState));
+	}
+
+	CopyPose(vrPose, pose);
+	if (controllerState)
+		CopyControllerState(vrControllerState, controllerState);
+	return true;
+}
+
+void OpenVRPoseSource::GetDevicePoses(DevicePose *poses, uint32_t count) {
+	vr::TrackedDevicePose_t vrPoses[vr::k_unMaxTrackedDeviceCount];
+	if (count > vr::k_unMaxTrackedDeviceCount)
+		count = vr::k_unMaxTrackedDeviceCount;
+
+	// One round trip to vrserver for every device, no prediction
+	m_pHMD->GetDeviceToAbsoluteTrackingPose(vr::TrackingUniverseRawAndUncalibrated, 0, vrPoses, count);
+	for (uint32_t i = 0; i < count; i++)
+		CopyPose(vrPoses[i], &poses[i]);
+}
+
+bool OpenVRPoseSource::GetControllerState(DeviceIndex device, ControllerState *controllerState) {
+	vr::VRControllerState_t vrControllerState;
+	if (!m_pHMD->GetControllerState(device, &vrControllerState, sizeof(vrControllerState)))
+		return false;
+	CopyControllerState(vrControllerState, controllerState);
+	return true;
+}
+
+bool OpenVRPoseSource::PollNextEvent(DeviceEvent *event) {
+	vr::VREvent_t vrEvent;
+	if (!m_pHMD->PollNextEvent(&vrEvent, sizeof(vrEvent)))
+		return false;
+
+	event->eventType = ProcessVREvent(vrEvent);
+	event->trackedDeviceIndex = vrEvent.trackedDeviceIndex;
+	return true;
+}
+
+
+// Event lines are printed from the frame loop, unless logging is off
+void OpenVRPoseSource::LogEvent(const char *format, ...) {
+	if (!m_logEvents)
+		return;
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Processes a single VR event
+//-----------------------------------------------------------------------------
+
+DeviceEventType OpenVRPoseSource::ProcessVREvent(const vr::VREvent_t & event) {
+    m_events++;
+    switch (event.eventType)
+    {
+    case vr::VREvent_TrackedDeviceActivated: { LogEvent("(OpenVR) Device : %d attached\n", event.trackedDeviceIndex); return DeviceEvent_Activated; } break;
+    case vr::VREvent_TrackedDeviceDeactivated: { LogEvent("(OpenVR) Device : %d detached\n", event.trackedDeviceIndex); return DeviceEvent_Deactivated; } break;
+    case vr::VREvent_TrackedDeviceUpdated: { LogEvent("(OpenVR) Device : %d updated\n", event.trackedDeviceIndex); return DeviceEvent_Updated; } break;
+    case vr::VREvent_DashboardActivated: { LogEvent("(OpenVR) Dashboard activated\n"); } break;
+    case vr::VREvent_DashboardDeactivated: { LogEvent("(OpenVR) Dashboard deactivated\n"); } break;
+    case vr::VREvent_ChaperoneDataHasChanged: { LogEvent("(OpenVR) Chaperone data has changed\n"); } break;
+    case vr::VREvent_ChaperoneSettingsHaveChanged: { LogEvent("(OpenVR) Chaperone settings have changed\n"); } break;
+    case vr::VREvent_ChaperoneUniverseHasChanged: { LogEvent("(OpenVR) Chaperone universe has changed\n"); } break;
+    case vr::VREvent_ApplicationTransitionStarted: { LogEvent("(OpenVR) Application Transition: Transition has started\n"); } break;
+    case vr::VREvent_ApplicationTransitionNewAppStarted: { LogEvent("(OpenVR) Application transition: New app has started\n"); } break;
+    case vr::VREvent_TrackedDeviceRoleChanged: { LogEvent("(OpenVR) TrackedDeviceRoleChanged: %d\n", event.trackedDeviceIndex); return DeviceEvent_RoleChanged; } break;
+    case vr::VREvent_Input_HapticVibration: { LogEvent("(OpenVR) VREvent_Input_HapticVibration\n"); } break;
+    case vr::VREvent_Input_BindingLoadFailed: { LogEvent("(OpenVR) VREvent_Input_BindingLoadFailed\n"); } break;
+    case vr::VREvent_Input_BindingLoadSuccessful: { LogEvent("(OpenVR) VREvent_Input_BindingLoadSuccessful\n"); } break;
+    case vr::VREvent_Input_ActionManifestReloaded: { LogEvent("(OpenVR) VREvent_Input_ActionManifestReloaded\n"); } break;
+    case vr::VREvent_Input_ActionManifestLoadFailed: { LogEvent("(OpenVR) VREvent_Input_ActionManifestLoadFailed\n"); } break;
+    case vr::VREvent_Input_ProgressUpdate: { LogEvent("(OpenVR) VREvent_Input_ProgressUpdate\n"); } break;
+    case vr::VREvent_Input_TrackerActivated: { LogEvent("(OpenVR) VREvent_Input_TrackerActivated\n"); } break;
+    case vr::VREvent_Input_BindingsUpdated: { LogEvent("(OpenVR) VREvent_Input_BindingsUpdated\n"); } break;
+    case vr::VREvent_ActionBindingReloaded: { LogEvent("(OpenVR) VREvent_ActionBindingReloaded\n"); } break;
+    case vr::VREvent_ChaperoneFlushCache: { LogEvent("(OpenVR) VREvent_ChaperoneFlushCache\n"); } break;
+    case vr::VREvent_ButtonTouch: { LogEvent("(OpenVR) Event: Touch Device: %d\n", event.trackedDeviceIndex); } break;
+    case vr::VREvent_ButtonUntouch: { LogEvent("(OpenVR) Event: Untouch Device: %d\n", event.trackedDeviceIndex); } break;
+    case vr::VREvent_ButtonPress: { LogEvent("(OpenVR) Event: Press Device: %d\n", event.trackedDeviceIndex); } break;
+    case vr::VREvent_ButtonUnpress: { LogEvent("(OpenVR) Event: Release Device: %d\n", event.trackedDeviceIndex); } break;
+    case vr::VREvent_EnterStandbyMode: { LogEvent("(OpenVR) Event: Enter StandbyMode: %d\n", event.trackedDeviceIndex); } break;
+    case vr::VREvent_LeaveStandbyMode: { LogEvent("(OpenVR) Event: Leave StandbyMode: %d\n", event.trackedDeviceIndex); } break;
+    case vr::VREvent_PropertyChanged: { LogEvent("(OpenVR) Event: Property Changed Device: %d ETrackedDeviceProperty(%d)\n", event.trackedDeviceIndex, event.data.property.prop); return DeviceEvent_PropertyChanged; } break;
+    case vr::VREvent_SceneApplicationChanged: { LogEvent("(OpenVR) Event: Scene Application Changed\n"); } break;
+    case vr::VREvent_SceneFocusChanged: { LogEvent("(OpenVR) Event: Scene Focus Changed\n"); } break;
+    case vr::VREvent_TrackedDeviceUserInteractionStarted: { LogEvent("(OpenVR) Event: Tracked Device User Interaction Started Device: %d\n", event.trackedDeviceIndex); } break;
+    case vr::VREvent_TrackedDeviceUserInteractionEnded: { LogEvent("(OpenVR) Event: Tracked Device User Interaction Ended Device: %d\n", event.trackedDeviceIndex); } break;
+    case vr::VREvent_ProcessDisconnected: { LogEvent("(OpenVR) Event: A process was disconnected\n"); } break;
+    case vr::VREvent_ProcessConnected: { LogEvent("(OpenVR) Event: A process was connected\n"); } break;
+    case (vr::VREvent_StatusUpdate): {
+        const char* status = "unkown";
+        switch (event.data.status.statusState) {
+        case(vr::EVRState::VRState_NotReady): { status = "not Ready"; } break;
+        case(vr::EVRState::VRState_Off): { status = "off"; } break;
+        case(vr::EVRState::VRState_Ready): { status = "ready"; } break;
+        case(vr::EVRState::VRState_Ready_Alert): { status = "ready alert"; } break;
+        case(vr::EVRState::VRState_Ready_Alert_Low): { status = "ready alert low"; } break;
+        case(vr::EVRState::VRState_Searching): { status = "searching"; } break;
+        case(vr::EVRState::VRState_Searching_Alert): { status = "searching alert"; } break;
+        case(vr::EVRState::VRState_Standby): { status = "standby"; } break;
+        case(vr::EVRState::VRState_Undefined): { status = "undefined"; } break;
+        }
+        LogEvent("(OpenVR) Device %d status: %s\n", event.trackedDeviceIndex, status);
+    } break;
+
+    case (vr::VREvent_Quit): {
+        LogEvent("(OpenVR) Received SteamVR Quit (%d)\n", vr::VREvent_Quit);
+        return DeviceEvent_Quit;
+    } break;
+
+    case (vr::VREvent_ProcessQuit): {
+        LogEvent("(OpenVR) SteamVR Quit Process (%d)\n", vr::VREvent_ProcessQuit);
+        return DeviceEvent_Quit;
+    } break;
+
+    case (vr::VREvent_QuitAborted_UserPrompt): {
+        LogEvent("(OpenVR) SteamVR Quit Aborted UserPrompt (%d)\n", vr::VREvent_QuitAborted_UserPrompt);
+        return DeviceEvent_Quit;
+    } break;
+
+    case (vr::VREvent_QuitAcknowledged): {
+        LogEvent("(OpenVR) SteamVR Quit Acknowledged (%d)\n", vr::VREvent_QuitAcknowledged);
+        return DeviceEvent_Quit;
+    } break;
+
+    default: { LogEvent("(OpenVR) Unmanaged Event: %d Device: %d\n", event.eventType, event.trackedDeviceIndex); } break;
+    }
+
+    return DeviceEvent_None;
+}
@@ -0,0 +1,44 @@
+// OPENVRPOSESOURCE.h
+#ifndef _OPENVRPOSESOURCE_H_
+#define _OPENVRPOSESOURCE_H_
+
+// OpenVR
+#include <openvr.h>
+#include "PoseSource.h"
+
+//
+// PoseSource backed by the OpenVR runtime. Only built where openvr.h
+// and openvr_api are available (VIVE_OSC_WITH_OPENVR).
+//
+class OpenVRPoseSource : public PoseSource {
+private:
+	vr::IVRSystem *m_pHMD = NULL;
+	bool m_logEvents = true;
+	unsigned long m_events = 0;
+
+	// Process a VR event and print some general info of what happens,
+	// returns the portable event type the sender cares about
+	DeviceEventType ProcessVREvent(const vr::VREvent_t & event);
+	void LogEvent(const char *format, ...);
+
+public:
+	~OpenVRPoseSource();
+	OpenVRPoseSource();
+
+	bool IsDeviceConnected(DeviceIndex device);
+	DeviceClass GetDeviceClass(DeviceIndex device);
+	ControllerRole GetControllerRole(DeviceIndex device);
+	bool GetDeviceString(DeviceIndex device, DeviceString prop, char *buf, uint32_t bufSize);
+	const char *GetControllerAxisTypeName(DeviceIndex device, int axis);
+	bool GetDevicePose(DeviceIndex device, DevicePose *pose, ControllerState *controllerState);
+	void GetDevicePoses(DevicePose *poses, uint32_t count);
+	bool GetControllerState(DeviceIndex device, ControllerState *controllerState);
+	bool PollNextEvent(DeviceEvent *event);
+
+	// Print a line per runtime event (the default); without a console
+	// they are only counted
+	void SetEventLogging(bool enabled) { m_logEvents = enabled; }
+	unsigned long EventCount() const { return m_events; }
+};
+
+#endif // _OPENVRPOSESOURCE_H_
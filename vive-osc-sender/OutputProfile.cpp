@@ -0,0 +1,146 @@
+//
+// Per destination output profiles: rate, device filter and fields
+//
+
+#include "stdafx.h"
+#include "OutputProfile.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+static const struct { const char *name; unsigned int field; } k_profileFieldNames[] = {
+	{ "pos", ProfileField_Position },
+	{ "quat", ProfileField_Quaternion },
+	{ "matrix", ProfileField_Matrix },
+	{ "vel", ProfileField_Velocity },
+	{ "angvel", ProfileField_AngularVelocity },
+	{ "trigger", ProfileField_Trigger },
+	{ "axes", ProfileField_Axes },
+	{ "time", ProfileField_TimeTag },
+	{ "compact", ProfileField_Compact },
+};
+
+bool OutputProfile::Accepts(const RegisteredDevice &device) const {
+	unsigned int deviceClass = (device.deviceClass == DeviceClass_Controller) ? ProfileDevices_Controllers
+		: (device.deviceClass == DeviceClass_GenericTracker) ? ProfileDevices_Trackers : 0;
+	if ((devices & deviceClass) == 0)
+		return false;
+	return serial[0] == '\0' || strstr(device.serial, serial) != NULL;
+}
+
+bool OutputProfile::operator==(const OutputProfile &other) const {
+	return rate == other.rate && devices == other.devices && fields == other.fields
+		&& strcmp(serial, other.serial) == 0 && compact == other.compact && keyframeInterval == other.keyframeInterval
+		&& predict == other.predict && predictionSeconds == other.predictionSeconds;
+}
+
+// Calls item for every comma separated item, stops at the first it rejects
+template<typename Item>
+static bool ForEachListItem(const char *list, Item item) {
+	std::string items(list);
+	std::size_t start = 0;
+	while (start <= items.size()) {
+		std::size_t end = items.find(',', start);
+		if (end == std::string::npos)
+			end = items.size();
+		if (end > start && !item(items.substr(start, end - start)))
+			return false;
+		start = end + 1;
+	}
+	return true;
+}
+
+bool ParseProfileDevices(const char *list, OutputProfile &profile) {
+	unsigned int devices = 0;
+	bool ok = ForEachListItem(list, [&](const std::string &item) {
+		if (item == "controllers") devices |= ProfileDevices_Controllers;
+		else if (item == "trackers") devices |= ProfileDevices_Trackers;
+		else if (item.compare(0, 7, "serial=") == 0) sprintf_s(profile.serial, sizeof(profile.serial), "%s", item.c_str() + 7);
+		else return false;
+		return true;
+	});
+
+	// A serial filter alone keeps both classes
+	if (devices != 0)
+		profile.devices = devices;
+	return ok;
+}
+
+bool ParseProfileFields(const char *list, unsigned int &fields) {
+	unsigned int parsed = 0;
+	bool ok = ForEachListItem(list, [&](const std::string &item) {
+		for (auto &name : k_profileFieldNames) {
+			if (item == name.name) {
+				parsed |= name.field;
+				return true;
+			}
+		}
+		return false;
+	});
+	if (parsed != 0)
+		fields = parsed;
+	return ok;
+}
+
+bool ParseCompactPoseFormat(const char *text, CompactPoseFormat &format) {
+	CompactPoseFormat parsed = format;
+	int item = 0;
+	bool ok = ForEachListItem(text, [&](const std::string &value) {
+		switch (item++) {
+		case 0: parsed.resolution = static_cast<float>(atof(value.c_str()) / 1000); break;
+		case 1: parsed.positionBits = atoi(value.c_str()); break;
+		case 2: parsed.rotationBits = atoi(value.c_str()); break;
+		default: return false;
+		}
+		return true;
+	});
+	if (!ok || !parsed.IsValid())
+		return false;
+	format = parsed;
+	return true;
+}
+
+void DescribeProfile(const OutputProfile &profile, char *buffer, std::size_t size) {
+	std::string description;
+	if (profile.devices == (ProfileDevices_Controllers | ProfileDevices_Trackers))
+		description = "all devices";
+	else if (profile.devices == ProfileDevices_Controllers)
+		description = "controllers";
+	else if (profile.devices == ProfileDevices_Trackers)
+		description = "trackers";
+	else
+		description = "no devices";
+	if (profile.serial[0] != '\0')
+		description += std::string(" matching \"") + profile.serial + "\"";
+
+	char rate[32];
+	if (profile.rate > 0)
+		sprintf_s(rate, sizeof(rate), ", %g Hz,", profile.rate);
+	else
+		sprintf_s(rate, sizeof(rate), ", every frame,");
+	description += rate;
+
+	for (auto &name : k_profileFieldNames)
+		if (profile.fields & name.field)
+			description += std::string(" ") + name.name;
+
+	if (profile.fields & ProfileField_Compact) {
+		char compact[64];
+		sprintf_s(compact, sizeof(compact), " (%g mm, %d/%d bits)", profile.compact.resolution * 1000.0,
+			profile.compact.positionBits, profile.compact.rotationBits);
+		description += compact;
+		if (profile.keyframeInterval > 0) {
+			sprintf_s(compact, sizeof(compact), ", keyframe every %d frames", profile.keyframeInterval);
+			description += compact;
+		}
+	}
+
+	if (profile.predict) {
+		char prediction[64];
+		sprintf_s(prediction, sizeof(prediction), ", predicted %g ms past sending", profile.predictionSeconds * 1000.0);
+		description += prediction;
+	}
+
+	sprintf_s(buffer, size, "%s", description.c_str());
+}
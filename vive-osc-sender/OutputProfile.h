@@ -0,0 +1,69 @@
+// OUTPUTPROFILE.h
+#ifndef _OUTPUTPROFILE_H_
+#define _OUTPUTPROFILE_H_
+
+#include "DeviceRegistry.h"
+#include "CompactPose.h"
+
+// Values that can be sent of a device, in message argument order
+enum ProfileField {
+	ProfileField_Position = 1 << 0,			// x, y, z
+	ProfileField_Quaternion = 1 << 1,		// w, x, y, z
+	ProfileField_Matrix = 1 << 2,			// raw 3x4 tracking matrix, row by row
+	ProfileField_Velocity = 1 << 3,			// m/s
+	ProfileField_AngularVelocity = 1 << 4,	// rad/s
+	ProfileField_Trigger = 1 << 5,			// controllers only
+	ProfileField_Axes = 1 << 6,				// trackpad x, y, controllers only
+	ProfileField_TimeTag = 1 << 7,			// the frame's capture time, as an OSC time tag
+	ProfileField_Compact = 1 << 8			// position and quaternion of all devices quantized into one blob message
+};
+
+// Classes of devices that can be sent
+enum ProfileDevices {
+	ProfileDevices_Controllers = 1 << 0,
+	ProfileDevices_Trackers = 1 << 1
+};
+
+// The messages the sender always sent: position, quaternion and, for
+// controllers, the trigger
+static const unsigned int k_unDefaultProfileFields = ProfileField_Position | ProfileField_Quaternion | ProfileField_Trigger;
+
+// Every profile is a bit in the frame's per device profile mask
+static const int k_nMaxOutputProfiles = 32;
+
+//
+// What a destination receives: how often, of which devices, and which
+// values of each device.
+//
+struct OutputProfile {
+	double rate = 0;	// frames per second, 0 for every frame
+	unsigned int devices = ProfileDevices_Controllers | ProfileDevices_Trackers;
+	char serial[k_unMaxSerialSize] = {};	// if set, only devices whose serial contains it
+	unsigned int fields = k_unDefaultProfileFields;
+	CompactPoseFormat compact;	// with ProfileField_Compact
+	int keyframeInterval = 0;	// with ProfileField_Compact, send deltas between keyframes this many frames apart
+	bool predict = false;		// extrapolate positions and rotations to the time the frame is sent
+	double predictionSeconds = 0;	// with predict, plus this many seconds
+
+	// Whether the device passes the class and serial filter
+	bool Accepts(const RegisteredDevice &device) const;
+
+	bool operator==(const OutputProfile &other) const;
+};
+
+// Comma separated "controllers", "trackers" and "serial=<text>", returns
+// false if an item isn't one of those
+bool ParseProfileDevices(const char *list, OutputProfile &profile);
+
+// Comma separated "pos", "quat", "matrix", "vel", "angvel", "trigger",
+// "axes", "time" and "compact", returns false if an item isn't one of those
+bool ParseProfileFields(const char *list, unsigned int &fields);
+
+// "<resolution mm>[,<position bits>[,<rotation bits>]]", returns false if
+// the format isn't one CompactPoseFormat supports
+bool ParseCompactPoseFormat(const char *text, CompactPoseFormat &format);
+
+// Short summary for the statistics, e.g. "trackers, 60 Hz, pos quat"
+void DescribeProfile(const OutputProfile &profile, char *buffer, std::size_t size);
+
+#endif // _OUTPUTPROFILE_H_
@@ -0,0 +1,245 @@
+//
+// Batch matrix to quaternion conversion, scalar, SSE and AVX2
+//
+
+#include "stdafx.h"
+#include "PoseBatch.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define POSEBATCH_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define POSEBATCH_AVX2_TARGET
+#else
+#define POSEBATCH_AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+// 12 matrix elements, 4 quaternion components, 6 velocities, 7 predicted
+static const std::size_t k_unPoseBatchColumns = 29;
+
+PoseBatch::PoseBatch(std::size_t capacity) : m_capacity(capacity) {
+	m_stride = (capacity + 7) & ~static_cast<std::size_t>(7);
+	if (m_stride == 0)
+		m_stride = 8;
+
+	// 8 spare floats to align the base to 32 bytes, zeroed so padding lanes
+	// convert to something harmless
+	m_storage.assign(k_unPoseBatchColumns * m_stride + 8, 0.0f);
+	uintptr_t address = reinterpret_cast<uintptr_t>(&m_storage[0]);
+	m_base = &m_storage[0] + ((32 - (address & 31)) & 31) / sizeof(float);
+}
+
+std::size_t PoseBatch::Add(const PoseMatrix34 &matrix) {
+	std::size_t n = m_count++;
+	for (int row = 0; row < 3; row++)
+		for (int col = 0; col < 4; col++)
+			Matrix(row, col)[n] = matrix.m[row][col];
+	for (int axis = 0; axis < 3; axis++) {
+		Velocity(axis)[n] = 0;
+		AngularVelocity(axis)[n] = 0;
+	}
+	return n;
+}
+
+std::size_t PoseBatch::Add(const DevicePose &pose) {
+	std::size_t n = Add(pose.mDeviceToAbsoluteTracking);
+	for (int axis = 0; axis < 3; axis++) {
+		Velocity(axis)[n] = pose.vVelocity.v[axis];
+		AngularVelocity(axis)[n] = pose.vAngularVelocity.v[axis];
+	}
+	return n;
+}
+
+//
+// All kernels compute, per device,
+//
+//   w = sqrt(max(0, 1 + m00 + m11 + m22)) / 2
+//   x = sqrt(max(0, 1 + m00 - m11 - m22)) / 2 with the sign of m21 - m12
+//   y = sqrt(max(0, 1 - m00 + m11 - m22)) / 2 with the sign of m02 - m20
+//   z = sqrt(max(0, 1 - m00 - m11 + m22)) / 2 with the sign of m10 - m01
+//
+// and then normalize. The four radicands add up to 4 before clamping, so
+// the norm is never below 1 and needs no zero check.
+//
+
+static void ConvertPosesScalar(PoseBatch &batch) {
+	const float *m00 = batch.Matrix(0, 0), *m01 = batch.Matrix(0, 1), *m02 = batch.Matrix(0, 2);
+	const float *m10 = batch.Matrix(1, 0), *m11 = batch.Matrix(1, 1), *m12 = batch.Matrix(1, 2);
+	const float *m20 = batch.Matrix(2, 0), *m21 = batch.Matrix(2, 1), *m22 = batch.Matrix(2, 2);
+	float *qw = batch.QuaternionW(), *qx = batch.QuaternionX(), *qy = batch.QuaternionY(), *qz = batch.QuaternionZ();
+
+	for (std::size_t i = 0; i < batch.Count(); i++) {
+		float w = sqrtf(fmaxf(0.0f, 1.0f + m00[i] + m11[i] + m22[i])) * 0.5f;
+		float x = sqrtf(fmaxf(0.0f, 1.0f + m00[i] - m11[i] - m22[i])) * 0.5f;
+		float y = sqrtf(fmaxf(0.0f, 1.0f - m00[i] + m11[i] - m22[i])) * 0.5f;
+		float z = sqrtf(fmaxf(0.0f, 1.0f - m00[i] - m11[i] + m22[i])) * 0.5f;
+		x = copysignf(x, m21[i] - m12[i]);
+		y = copysignf(y, m02[i] - m20[i]);
+		z = copysignf(z, m10[i] - m01[i]);
+
+		float inverseNorm = 1.0f / sqrtf(w * w + x * x + y * y + z * z);
+		qw[i] = w * inverseNorm;
+		qx[i] = x * inverseNorm;
+		qy[i] = y * inverseNorm;
+		qz[i] = z * inverseNorm;
+	}
+}
+
+#ifdef POSEBATCH_X86
+
+static void ConvertPosesSSE(PoseBatch &batch) {
+	const float *m00 = batch.Matrix(0, 0), *m01 = batch.Matrix(0, 1), *m02 = batch.Matrix(0, 2);
+	const float *m10 = batch.Matrix(1, 0), *m11 = batch.Matrix(1, 1), *m12 = batch.Matrix(1, 2);
+	const float *m20 = batch.Matrix(2, 0), *m21 = batch.Matrix(2, 1), *m22 = batch.Matrix(2, 2);
+	float *qw = batch.QuaternionW(), *qx = batch.QuaternionX(), *qy = batch.QuaternionY(), *qz = batch.QuaternionZ();
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 sign = _mm_set1_ps(-0.0f);
+
+	for (std::size_t i = 0; i < batch.PaddedCount(); i += 4) {
+		__m128 a = _mm_load_ps(m00 + i), b = _mm_load_ps(m11 + i), c = _mm_load_ps(m22 + i);
+
+		__m128 w = _mm_add_ps(_mm_add_ps(one, a), _mm_add_ps(b, c));
+		__m128 x = _mm_sub_ps(_mm_add_ps(one, a), _mm_add_ps(b, c));
+		__m128 y = _mm_sub_ps(_mm_add_ps(one, b), _mm_add_ps(a, c));
+		__m128 z = _mm_sub_ps(_mm_add_ps(one, c), _mm_add_ps(a, b));
+		w = _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(zero, w)), half);
+		x = _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(zero, x)), half);
+		y = _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(zero, y)), half);
+		z = _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(zero, z)), half);
+
+		// copysign: the magnitudes are positive, or in the sign bit
+		x = _mm_or_ps(x, _mm_and_ps(sign, _mm_sub_ps(_mm_load_ps(m21 + i), _mm_load_ps(m12 + i))));
+		y = _mm_or_ps(y, _mm_and_ps(sign, _mm_sub_ps(_mm_load_ps(m02 + i), _mm_load_ps(m20 + i))));
+		z = _mm_or_ps(z, _mm_and_ps(sign, _mm_sub_ps(_mm_load_ps(m10 + i), _mm_load_ps(m01 + i))));
+
+		__m128 norm = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w, w), _mm_mul_ps(x, x)), _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z)));
+		__m128 inverseNorm = _mm_div_ps(one, _mm_sqrt_ps(norm));
+		_mm_store_ps(qw + i, _mm_mul_ps(w, inverseNorm));
+		_mm_store_ps(qx + i, _mm_mul_ps(x, inverseNorm));
+		_mm_store_ps(qy + i, _mm_mul_ps(y, inverseNorm));
+		_mm_store_ps(qz + i, _mm_mul_ps(z, inverseNorm));
+	}
+}
+
+POSEBATCH_AVX2_TARGET
+static void ConvertPosesAVX2(PoseBatch &batch) {
+	const float *m00 = batch.Matrix(0, 0), *m01 = batch.Matrix(0, 1), *m02 = batch.Matrix(0, 2);
+	const float *m10 = batch.Matrix(1, 0), *m11 = batch.Matrix(1, 1), *m12 = batch.Matrix(1, 2);
+	const float *m20 = batch.Matrix(2, 0), *m21 = batch.Matrix(2, 1), *m22 = batch.Matrix(2, 2);
+	float *qw = batch.QuaternionW(), *qx = batch.QuaternionX(), *qy = batch.QuaternionY(), *qz = batch.QuaternionZ();
+
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+
+	for (std::size_t i = 0; i < batch.PaddedCount(); i += 8) {
+		__m256 a = _mm256_load_ps(m00 + i), b = _mm256_load_ps(m11 + i), c = _mm256_load_ps(m22 + i);
+
+		__m256 w = _mm256_add_ps(_mm256_add_ps(one, a), _mm256_add_ps(b, c));
+		__m256 x = _mm256_sub_ps(_mm256_add_ps(one, a), _mm256_add_ps(b, c));
+		__m256 y = _mm256_sub_ps(_mm256_add_ps(one, b), _mm256_add_ps(a, c));
+		__m256 z = _mm256_sub_ps(_mm256_add_ps(one, c), _mm256_add_ps(a, b));
+		w = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_max_ps(zero, w)), half);
+		x = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_max_ps(zero, x)), half);
+		y = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_max_ps(zero, y)), half);
+		z = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_max_ps(zero, z)), half);
+
+		x = _mm256_or_ps(x, _mm256_and_ps(sign, _mm256_sub_ps(_mm256_load_ps(m21 + i), _mm256_load_ps(m12 + i))));
+		y = _mm256_or_ps(y, _mm256_and_ps(sign, _mm256_sub_ps(_mm256_load_ps(m02 + i), _mm256_load_ps(m20 + i))));
+		z = _mm256_or_ps(z, _mm256_and_ps(sign, _mm256_sub_ps(_mm256_load_ps(m10 + i), _mm256_load_ps(m01 + i))));
+
+		__m256 norm = _mm256_fmadd_ps(w, w, _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z))));
+		__m256 inverseNorm = _mm256_div_ps(one, _mm256_sqrt_ps(norm));
+		_mm256_store_ps(qw + i, _mm256_mul_ps(w, inverseNorm));
+		_mm256_store_ps(qx + i, _mm256_mul_ps(x, inverseNorm));
+		_mm256_store_ps(qy + i, _mm256_mul_ps(y, inverseNorm));
+		_mm256_store_ps(qz + i, _mm256_mul_ps(z, inverseNorm));
+	}
+}
+
+// AVX2 needs the CPU to have it and the OS to save the ymm registers
+static bool CpuHasAVX2() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool fma = (info[2] & (1 << 12)) != 0;
+	if (!osxsave || !fma || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+#endif // POSEBATCH_X86
+
+bool PoseKernelSupported(PoseKernel kernel) {
+	switch (kernel) {
+	case PoseKernel_Scalar:
+	case PoseKernel_Auto:
+		return true;
+#ifdef POSEBATCH_X86
+	case PoseKernel_SSE:
+		return true;
+	case PoseKernel_AVX2: {
+		static const bool avx2 = CpuHasAVX2();
+		return avx2;
+	}
+#else
+	case PoseKernel_SSE:
+	case PoseKernel_AVX2:
+		return false;
+#endif
+	}
+	return false;
+}
+
+PoseKernel BestPoseKernel() {
+	if (PoseKernelSupported(PoseKernel_AVX2))
+		return PoseKernel_AVX2;
+	if (PoseKernelSupported(PoseKernel_SSE))
+		return PoseKernel_SSE;
+	return PoseKernel_Scalar;
+}
+
+const char *PoseKernelName(PoseKernel kernel) {
+	switch (kernel) {
+	case PoseKernel_Scalar: return "scalar";
+	case PoseKernel_SSE: return "SSE";
+	case PoseKernel_AVX2: return "AVX2";
+	case PoseKernel_Auto: return PoseKernelName(BestPoseKernel());
+	}
+	return "unknown";
+}
+
+void ConvertPoses(PoseBatch &batch, PoseKernel kernel) {
+	static const PoseKernel best = BestPoseKernel();
+	if (kernel == PoseKernel_Auto || !PoseKernelSupported(kernel))
+		kernel = best;
+
+	switch (kernel) {
+#ifdef POSEBATCH_X86
+	case PoseKernel_AVX2: ConvertPosesAVX2(batch); break;
+	case PoseKernel_SSE: ConvertPosesSSE(batch); break;
+#else
+	case PoseKernel_AVX2:
+	case PoseKernel_SSE:
+#endif
+	case PoseKernel_Scalar:
+	case PoseKernel_Auto:
+		ConvertPosesScalar(batch);
+		break;
+	}
+}
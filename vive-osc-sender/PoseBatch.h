@@ -0,0 +1,90 @@
+// POSEBATCH.h
+#ifndef _POSEBATCH_H_
+#define _POSEBATCH_H_
+
+#include <vector>
+#include "PoseSource.h"
+
+enum PoseKernel {
+	PoseKernel_Scalar,
+	PoseKernel_SSE,		// 4 devices per step
+	PoseKernel_AVX2,	// 8 devices per step
+	PoseKernel_Auto		// best one the CPU supports
+};
+
+//
+// Poses of many devices in structure-of-arrays layout: one array per matrix
+// element and per quaternion component, so a SIMD register holds the same
+// element of 4 or 8 devices and the matrix to quaternion conversion needs
+// no shuffling.
+//
+// Arrays are 32 byte aligned and padded to a multiple of 8 devices, the
+// kernels always run whole registers and the padding lanes are ignored.
+//
+class PoseBatch {
+private:
+	std::vector<float> m_storage;
+	float *m_base;				// first 32 byte aligned float in m_storage
+	std::size_t m_capacity;
+	std::size_t m_stride;		// floats between two columns
+	std::size_t m_count = 0;
+
+	float *Column(int n) const { return m_base + n * m_stride; }
+
+	PoseBatch(const PoseBatch &);
+	PoseBatch &operator=(const PoseBatch &);
+
+public:
+	explicit PoseBatch(std::size_t capacity);
+
+	std::size_t Capacity() const { return m_capacity; }
+	std::size_t Count() const { return m_count; }
+	void Clear() { m_count = 0; }
+
+	// Appends a device's tracking matrix, returns its index in the batch
+	std::size_t Add(const PoseMatrix34 &matrix);
+
+	// Same, with the velocities prediction needs
+	std::size_t Add(const DevicePose &pose);
+
+	// Input, element [row][col] of every device
+	float *Matrix(int row, int col) const { return Column(row * 4 + col); }
+
+	// Output, the translation column is the position as is
+	const float *PositionX() const { return Matrix(0, 3); }
+	const float *PositionY() const { return Matrix(1, 3); }
+	const float *PositionZ() const { return Matrix(2, 3); }
+	float *QuaternionW() const { return Column(12); }
+	float *QuaternionX() const { return Column(13); }
+	float *QuaternionY() const { return Column(14); }
+	float *QuaternionZ() const { return Column(15); }
+
+	// Input for prediction, world space, m/s and rad/s
+	float *Velocity(int axis) const { return Column(16 + axis); }
+	float *AngularVelocity(int axis) const { return Column(19 + axis); }
+
+	// Output of PredictPoses
+	float *PredictedPositionX() const { return Column(22); }
+	float *PredictedPositionY() const { return Column(23); }
+	float *PredictedPositionZ() const { return Column(24); }
+	float *PredictedQuaternionW() const { return Column(25); }
+	float *PredictedQuaternionX() const { return Column(26); }
+	float *PredictedQuaternionY() const { return Column(27); }
+	float *PredictedQuaternionZ() const { return Column(28); }
+
+	// Rounded up to the widest kernel
+	std::size_t PaddedCount() const { return (m_count + 7) & ~static_cast<std::size_t>(7); }
+};
+
+// Converts the rotation of every device in the batch to a normalized
+// quaternion, with the given kernel or the best supported one
+void ConvertPoses(PoseBatch &batch, PoseKernel kernel = PoseKernel_Auto);
+
+// Whether the CPU (and the build) can run a kernel
+bool PoseKernelSupported(PoseKernel kernel);
+
+// The kernel PoseKernel_Auto resolves to
+PoseKernel BestPoseKernel();
+const char *PoseKernelName(PoseKernel kernel);
+
+#endif // _POSEBATCH_H_
@@ -0,0 +1,59 @@
+//
+// Velocity based pose extrapolation
+//
+
+#include "stdafx.h"
+#include "PosePrediction.h"
+
+#include <math.h>
+
+// Below this rate (rad/s) sin(x)/x is taken as 1
+static const float k_fMinAngularRate = 1e-6f;
+
+void PredictPoses(PoseBatch &batch, float seconds) {
+	const float *position[3] = { batch.PositionX(), batch.PositionY(), batch.PositionZ() };
+	const float *quaternion[4] = { batch.QuaternionW(), batch.QuaternionX(), batch.QuaternionY(), batch.QuaternionZ() };
+	const float *velocity[3] = { batch.Velocity(0), batch.Velocity(1), batch.Velocity(2) };
+	const float *angularVelocity[3] = { batch.AngularVelocity(0), batch.AngularVelocity(1), batch.AngularVelocity(2) };
+	float *predictedPosition[3] = { batch.PredictedPositionX(), batch.PredictedPositionY(), batch.PredictedPositionZ() };
+	float *predictedQuaternion[4] = { batch.PredictedQuaternionW(), batch.PredictedQuaternionX(),
+		batch.PredictedQuaternionY(), batch.PredictedQuaternionZ() };
+	PredictPoses(position, quaternion, velocity, angularVelocity, batch.Count(), seconds, predictedPosition, predictedQuaternion);
+}
+
+void PredictPoses(const float *const position[3], const float *const quaternion[4],
+	const float *const velocity[3], const float *const angularVelocity[3], std::size_t count, float seconds,
+	float *const predictedPosition[3], float *const predictedQuaternion[4]) {
+	const float *px = position[0], *py = position[1], *pz = position[2];
+	const float *vx = velocity[0], *vy = velocity[1], *vz = velocity[2];
+	const float *ax = angularVelocity[0], *ay = angularVelocity[1], *az = angularVelocity[2];
+	const float *qw = quaternion[0], *qx = quaternion[1], *qy = quaternion[2], *qz = quaternion[3];
+	float *outPx = predictedPosition[0], *outPy = predictedPosition[1], *outPz = predictedPosition[2];
+	float *outQw = predictedQuaternion[0], *outQx = predictedQuaternion[1];
+	float *outQy = predictedQuaternion[2], *outQz = predictedQuaternion[3];
+
+	for (std::size_t i = 0; i < count; i++) {
+		outPx[i] = px[i] + vx[i] * seconds;
+		outPy[i] = py[i] + vy[i] * seconds;
+		outPz[i] = pz[i] + vz[i] * seconds;
+
+		// Rotation over the horizon, axis scaled by sin(angle / 2)
+		float rate = sqrtf(ax[i] * ax[i] + ay[i] * ay[i] + az[i] * az[i]);
+		float halfAngle = 0.5f * rate * seconds;
+		float dw = cosf(halfAngle);
+		float scale = (rate > k_fMinAngularRate) ? sinf(halfAngle) / rate : 0.5f * seconds;
+		float dx = ax[i] * scale, dy = ay[i] * scale, dz = az[i] * scale;
+
+		// dq * q
+		float w = dw * qw[i] - dx * qx[i] - dy * qy[i] - dz * qz[i];
+		float x = dw * qx[i] + dx * qw[i] + dy * qz[i] - dz * qy[i];
+		float y = dw * qy[i] - dx * qz[i] + dy * qw[i] + dz * qx[i];
+		float z = dw * qz[i] + dx * qy[i] - dy * qx[i] + dz * qw[i];
+
+		float inverseNorm = 1.0f / sqrtf(w * w + x * x + y * y + z * z);
+		outQw[i] = w * inverseNorm;
+		outQx[i] = x * inverseNorm;
+		outQy[i] = y * inverseNorm;
+		outQz[i] = z * inverseNorm;
+	}
+}
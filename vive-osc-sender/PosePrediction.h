@@ -0,0 +1,29 @@
+// POSEPREDICTION.h
+#ifndef _POSEPREDICTION_H_
+#define _POSEPREDICTION_H_
+
+#include "PoseBatch.h"
+
+//
+// Extrapolates every pose in a batch by a time horizon using the velocities
+// the runtime reports with it, to hide the latency between reading a pose
+// and the receiver using it.
+//
+// Position moves along the linear velocity. Orientation is rotated by the
+// angular velocity integrated over the horizon, as a quaternion: the
+// angular velocity is in world space, so the rotation it describes,
+// dq = (cos(|w|t/2), sin(|w|t/2) w/|w|), is applied on the left, q' = dq q.
+//
+// Reads the converted pose (run ConvertPoses first) and writes the
+// Predicted columns of the batch, the converted pose stays as it was so
+// the same batch can be predicted for several horizons.
+//
+void PredictPoses(PoseBatch &batch, float seconds);
+
+// The same on separate columns of count devices, e.g. the converted batch
+// columns into arrays of an encoder's own, for horizons per destination
+void PredictPoses(const float *const position[3], const float *const quaternion[4],
+	const float *const velocity[3], const float *const angularVelocity[3], std::size_t count, float seconds,
+	float *const predictedPosition[3], float *const predictedQuaternion[4]);
+
+#endif // _POSEPREDICTION_H_
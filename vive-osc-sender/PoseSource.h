@@ -0,0 +1,128 @@
+// POSESOURCE.h
+#ifndef _POSESOURCE_H_
+#define _POSESOURCE_H_
+
+#include <stdint.h>
+
+//
+// Portable description of the tracking data the sender works with. These
+// mirror the OpenVR types (vr::HmdMatrix34_t, vr::TrackedDevicePose_t, ...)
+// closely enough that the OpenVR backend can copy straight across, but do
+// not require openvr.h, so the sender core also builds where SteamVR is
+// not available (see SyntheticPoseSource).
+//
+
+typedef uint32_t DeviceIndex;
+
+// Same as vr::k_unMaxTrackedDeviceCount
+static const DeviceIndex k_unMaxDeviceCount = 64;
+
+// Values match vr::ETrackedDeviceClass
+enum DeviceClass {
+	DeviceClass_Invalid = 0,
+	DeviceClass_HMD = 1,
+	DeviceClass_Controller = 2,
+	DeviceClass_GenericTracker = 3,
+	DeviceClass_TrackingReference = 4,
+	DeviceClass_DisplayRedirect = 5,
+	DeviceClass_Max
+};
+
+// Values match vr::ETrackedControllerRole
+enum ControllerRole {
+	ControllerRole_Invalid = 0,
+	ControllerRole_LeftHand = 1,
+	ControllerRole_RightHand = 2,
+	ControllerRole_OptOut = 3,
+	ControllerRole_Treadmill = 4,
+	ControllerRole_Max
+};
+
+// Row major 3x4 matrix, same layout as vr::HmdMatrix34_t
+struct PoseMatrix34 {
+	float m[3][4];
+};
+
+struct PoseVector3 {
+	float v[3];
+};
+
+struct PoseQuaternion {
+	double w, x, y, z;
+};
+
+// Same content as vr::TrackedDevicePose_t
+struct DevicePose {
+	PoseMatrix34 mDeviceToAbsoluteTracking;
+	PoseVector3 vVelocity;
+	PoseVector3 vAngularVelocity;
+	bool bPoseIsValid;
+	bool bTrackingOK;		// eTrackingResult == TrackingResult_Running_OK
+};
+
+static const int k_unControllerAxisCount = 5;
+
+// Same content as vr::VRControllerState_t
+struct ControllerState {
+	uint32_t unPacketNum;
+	uint64_t ulButtonPressed;
+	uint64_t ulButtonTouched;
+	struct { float x, y; } rAxis[k_unControllerAxisCount];
+};
+
+enum DeviceString {
+	DeviceString_ManufacturerName,
+	DeviceString_ModelNumber,
+	DeviceString_SerialNumber
+};
+
+// The subset of runtime events the sender reacts to
+enum DeviceEventType {
+	DeviceEvent_None,
+	DeviceEvent_Activated,
+	DeviceEvent_Deactivated,
+	DeviceEvent_Updated,
+	DeviceEvent_RoleChanged,
+	DeviceEvent_PropertyChanged,
+	DeviceEvent_Quit
+};
+
+struct DeviceEvent {
+	DeviceEventType eventType;
+	DeviceIndex trackedDeviceIndex;
+};
+
+//
+// Where tracking data comes from. One implementation talks to the OpenVR
+// runtime (OpenVRPoseSource), another generates deterministic motion for
+// headless profiling and load tests (SyntheticPoseSource).
+//
+class PoseSource {
+public:
+	virtual ~PoseSource() {}
+
+	virtual bool IsDeviceConnected(DeviceIndex device) = 0;
+	virtual DeviceClass GetDeviceClass(DeviceIndex device) = 0;
+	virtual ControllerRole GetControllerRole(DeviceIndex device) = 0;
+
+	// Copies a string property into buf, returns false if the device doesn't have it
+	virtual bool GetDeviceString(DeviceIndex device, DeviceString prop, char *buf, uint32_t bufSize) = 0;
+
+	// Name of the axis type of a controller axis, or NULL if the axis isn't there
+	virtual const char *GetControllerAxisTypeName(DeviceIndex device, int axis) = 0;
+
+	// Latest pose and controller state of a device, returns false if none is available
+	virtual bool GetDevicePose(DeviceIndex device, DevicePose *pose, ControllerState *controllerState) = 0;
+
+	// Latest poses of devices 0 to count - 1 in a single call, devices
+	// without a pose come back with bPoseIsValid false
+	virtual void GetDevicePoses(DevicePose *poses, uint32_t count) = 0;
+
+	// Latest controller state of a device, returns false if it isn't a controller
+	virtual bool GetControllerState(DeviceIndex device, ControllerState *controllerState) = 0;
+
+	// Next pending runtime event, returns false if the queue is empty
+	virtual bool PollNextEvent(DeviceEvent *event) = 0;
+};
+
+#endif // _POSESOURCE_H_
@@ -0,0 +1,326 @@
+//
+// Compact pose streams: keyframes and bit-packed deltas against them
+//
+
+#include "stdafx.h"
+#include "PoseStream.h"
+
+#include <string.h>
+
+// Widest difference a record can carry, 24 bit positions apart
+static const int k_nMaxPositionWidth = 25;
+static const int k_nMaxRotationWidth = 16;
+
+// Reference for devices a keyframe didn't have, and for keyframes
+static const QuantizedPose k_originPose = { { 0, 0, 0 }, -1, { 0, 0, 0 } };
+
+static uint32_t ZigZag(int32_t value) {
+	return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int32_t UnZigZag(uint32_t value) {
+	return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+// Bits needed to hold value
+static int BitWidth(uint32_t value) {
+	int width = 0;
+	while (value) {
+		width++;
+		value >>= 1;
+	}
+	return width;
+}
+
+static void WriteBigEndian32(char *p, uint32_t value) {
+	p[0] = static_cast<char>(value >> 24);
+	p[1] = static_cast<char>(value >> 16);
+	p[2] = static_cast<char>(value >> 8);
+	p[3] = static_cast<char>(value);
+}
+
+static uint32_t ReadBigEndian32(const char *p) {
+	const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+	return (static_cast<uint32_t>(u[0]) << 24) | (static_cast<uint32_t>(u[1]) << 16)
+		| (static_cast<uint32_t>(u[2]) << 8) | u[3];
+}
+
+// Reads the record bit stream, most significant bit first. Reading past
+// the end gives zeros and marks the stream as overrun.
+class BitReader {
+private:
+	const unsigned char *m_data;
+	std::size_t m_size;
+	std::size_t m_position = 0;
+	uint64_t m_bits = 0;
+	int m_bitCount = 0;
+	bool m_overrun = false;
+
+public:
+	BitReader(const char *data, std::size_t size)
+		: m_data(reinterpret_cast<const unsigned char *>(data)), m_size(size) {}
+
+	uint32_t Read(int count) {
+		while (m_bitCount < count) {
+			if (m_position == m_size) {
+				m_overrun = true;
+				return 0;
+			}
+			m_bits = (m_bits << 8) | m_data[m_position++];
+			m_bitCount += 8;
+		}
+		m_bitCount -= count;
+		uint32_t value = static_cast<uint32_t>((m_bits >> m_bitCount) & ((static_cast<uint64_t>(1) << count) - 1));
+		m_bits &= (static_cast<uint64_t>(1) << m_bitCount) - 1;
+		return value;
+	}
+
+	bool Overrun() const { return m_overrun; }
+
+	// Whether all bytes were read, apart from the zero padding
+	bool AtEnd() const { return m_position == m_size && m_bits == 0; }
+};
+
+PoseStreamEncoder::PoseStreamEncoder(const CompactPoseFormat &format, int keyframeInterval)
+	: m_format(format), m_keyframeInterval(keyframeInterval), m_keyframeRequested(true) {
+	memset(m_keyframe, 0, sizeof(m_keyframe));
+}
+
+void PoseStreamEncoder::Begin() {
+	// Cheap check first, the exchange is a locked instruction
+	bool requested = m_keyframeRequested.load(std::memory_order_relaxed) && m_keyframeRequested.exchange(false);
+	m_isKeyframe = requested || m_framesSinceKeyframe >= m_keyframeInterval;
+	if (m_isKeyframe) {
+		m_framesSinceKeyframe = 0;
+		m_keyframeSequence = m_sequence;
+		for (int id = 0; id < k_nPoseStreamDeviceIds; id++)
+			m_keyframe[id].valid = false;
+	}
+
+	union { float f; uint32_t i; } u;
+	u.f = m_format.resolution;
+	m_data[0] = static_cast<char>(k_nPoseStreamVersion);
+	m_data[1] = static_cast<char>(m_isKeyframe ? PoseStreamKind_Keyframe : PoseStreamKind_Delta);
+	m_data[2] = static_cast<char>(m_format.positionBits);
+	m_data[3] = static_cast<char>(m_format.rotationBits);
+	WriteBigEndian32(m_data + 4, u.i);
+	WriteBigEndian32(m_data + 8, m_sequence);
+	WriteBigEndian32(m_data + 12, m_keyframeSequence);
+	m_data[16] = 0;
+	m_size = k_unPoseStreamHeaderSize;
+	m_count = 0;
+	m_bits = 0;
+	m_bitCount = 0;
+}
+
+void PoseStreamEncoder::WriteBits(uint32_t value, int count) {
+	if (count == 0)
+		return;
+	m_bits = (m_bits << count) | (value & ((static_cast<uint64_t>(1) << count) - 1));
+	m_bitCount += count;
+	while (m_bitCount >= 8) {
+		m_bitCount -= 8;
+		m_data[m_size++] = static_cast<char>(m_bits >> m_bitCount);
+	}
+	m_bits &= (static_cast<uint64_t>(1) << m_bitCount) - 1;
+}
+
+bool PoseStreamEncoder::Add(bool isController, int ordinal, const float position[3], const float quaternion[4]) {
+	if (m_count == 255 || m_size + 1 + k_unMaxPoseStreamRecordSize > sizeof(m_data))
+		return false;
+
+	int id = (isController ? 0x80 : 0) | (ordinal & 0x7f);
+	QuantizedPose pose;
+	QuantizePose(m_format, position, quaternion, pose);
+	Reference &reference = m_keyframe[id];
+	const QuantizedPose &base = (!m_isKeyframe && reference.valid) ? reference.pose : k_originPose;
+
+	WriteBits(static_cast<uint32_t>(id), 8);
+
+	uint32_t positionDelta[3];
+	uint32_t widest = 0;
+	for (int k = 0; k < 3; k++) {
+		positionDelta[k] = ZigZag(pose.position[k] - base.position[k]);
+		widest |= positionDelta[k];
+	}
+	int width = BitWidth(widest);
+	WriteBits(static_cast<uint32_t>(width), 5);
+	for (int k = 0; k < 3; k++)
+		WriteBits(positionDelta[k], width);
+
+	// A rotation difference only makes sense with the same component left out
+	uint32_t rotationDelta[3] = { 0, 0, 0 };
+	width = k_nMaxRotationWidth + 1;
+	if (pose.largest == base.largest) {
+		widest = 0;
+		for (int k = 0; k < 3; k++) {
+			rotationDelta[k] = ZigZag(pose.rotation[k] - base.rotation[k]);
+			widest |= rotationDelta[k];
+		}
+		width = BitWidth(widest);
+	}
+	if (5 + 3 * width < 2 + 3 * m_format.rotationBits) {
+		WriteBits(1, 1);
+		WriteBits(static_cast<uint32_t>(width), 5);
+		for (int k = 0; k < 3; k++)
+			WriteBits(rotationDelta[k], width);
+	} else {
+		WriteBits(0, 1);
+		WriteBits(static_cast<uint32_t>(pose.largest), 2);
+		for (int k = 0; k < 3; k++)
+			WriteBits(static_cast<uint32_t>(pose.rotation[k]), m_format.rotationBits);
+	}
+
+	if (m_isKeyframe) {
+		reference.valid = true;
+		reference.pose = pose;
+	}
+	m_count++;
+	return true;
+}
+
+void PoseStreamEncoder::End() {
+	if (m_bitCount > 0) {
+		m_data[m_size++] = static_cast<char>(m_bits << (8 - m_bitCount));
+		m_bits = 0;
+		m_bitCount = 0;
+	}
+	m_data[16] = static_cast<char>(m_count);
+
+	// Nothing to send; an empty keyframe is tried again next frame so
+	// receivers don't wait for a keyframe they never got
+	if (m_count == 0) {
+		if (m_isKeyframe)
+			m_framesSinceKeyframe = m_keyframeInterval;
+		return;
+	}
+
+	m_sequence++;
+	m_framesSinceKeyframe++;
+	if (m_isKeyframe) {
+		m_keyframes++;
+		m_keyframeBytes += static_cast<unsigned long>(m_size);
+	} else {
+		m_deltas++;
+		m_deltaBytes += static_cast<unsigned long>(m_size);
+	}
+}
+
+void PoseStreamEncoder::PrintStatistics() const {
+	printf_s("  Pose stream: %lu keyframes of %.0f bytes, %lu deltas of %.0f bytes on average\n",
+		m_keyframes, m_keyframes ? static_cast<double>(m_keyframeBytes) / m_keyframes : 0.0,
+		m_deltas, m_deltas ? static_cast<double>(m_deltaBytes) / m_deltas : 0.0);
+}
+
+// A frame that fails to decode gives no poses at all
+static PoseStreamResult Malformed(int &count) {
+	count = 0;
+	return PoseStreamResult_Malformed;
+}
+
+PoseStreamDecoder::PoseStreamDecoder() {
+	memset(m_keyframe, 0, sizeof(m_keyframe));
+}
+
+PoseStreamResult PoseStreamDecoder::Decode(const void *data, std::size_t size, CompactPoseFormat &format,
+	CompactPose *poses, int maxPoses, int &count) {
+	count = 0;
+	const char *p = static_cast<const char *>(data);
+	if (size < k_unPoseStreamHeaderSize || p[0] != k_nPoseStreamVersion)
+		return PoseStreamResult_Malformed;
+	int kind = static_cast<unsigned char>(p[1]);
+	if (kind != PoseStreamKind_Keyframe && kind != PoseStreamKind_Delta)
+		return PoseStreamResult_Malformed;
+
+	union { float f; uint32_t i; } u;
+	u.i = ReadBigEndian32(p + 4);
+	format.positionBits = static_cast<unsigned char>(p[2]);
+	format.rotationBits = static_cast<unsigned char>(p[3]);
+	format.resolution = u.f;
+	if (!format.IsValid())
+		return PoseStreamResult_Malformed;
+	uint32_t sequence = ReadBigEndian32(p + 8);
+	uint32_t keyframeSequence = ReadBigEndian32(p + 12);
+	int devices = static_cast<unsigned char>(p[16]);
+
+	// Frames that never arrived, late ones aren't counted twice
+	int32_t step = static_cast<int32_t>(sequence - m_lastSequence);
+	if (m_hasSequence && step > 1)
+		m_framesLost += static_cast<unsigned long>(step - 1);
+	if (!m_hasSequence || step > 0)
+		m_lastSequence = sequence;
+	m_hasSequence = true;
+
+	bool isKeyframe = (kind == PoseStreamKind_Keyframe);
+	if (!isKeyframe && (!m_hasKeyframe || keyframeSequence != m_keyframeSequence)) {
+		m_framesWaiting++;
+		return PoseStreamResult_WaitingForKeyframe;
+	}
+	if (isKeyframe) {
+		m_hasKeyframe = false;
+		for (int id = 0; id < k_nPoseStreamDeviceIds; id++)
+			m_keyframe[id].valid = false;
+	}
+
+	BitReader reader(p + k_unPoseStreamHeaderSize, size - k_unPoseStreamHeaderSize);
+	int32_t rotationLimit = (1 << format.rotationBits) - 1;
+	for (int n = 0; n < devices; n++) {
+		int id = static_cast<int>(reader.Read(8));
+		Reference &reference = m_keyframe[id];
+		const QuantizedPose &base = (!isKeyframe && reference.valid) ? reference.pose : k_originPose;
+		QuantizedPose pose;
+
+		int width = static_cast<int>(reader.Read(5));
+		if (width > k_nMaxPositionWidth)
+			return Malformed(count);
+		for (int k = 0; k < 3; k++)
+			pose.position[k] = base.position[k] + UnZigZag(reader.Read(width));
+
+		if (reader.Read(1)) {
+			width = static_cast<int>(reader.Read(5));
+			if (width > k_nMaxRotationWidth || base.largest < 0)
+				return Malformed(count);
+			pose.largest = base.largest;
+			for (int k = 0; k < 3; k++)
+				pose.rotation[k] = base.rotation[k] + UnZigZag(reader.Read(width));
+		} else {
+			pose.largest = static_cast<int>(reader.Read(2));
+			for (int k = 0; k < 3; k++)
+				pose.rotation[k] = static_cast<int32_t>(reader.Read(format.rotationBits));
+		}
+		for (int k = 0; k < 3; k++)
+			if (pose.rotation[k] < 0 || pose.rotation[k] > rotationLimit)
+				return Malformed(count);
+		if (reader.Overrun())
+			return Malformed(count);
+
+		if (isKeyframe) {
+			reference.valid = true;
+			reference.pose = pose;
+		}
+		if (n < maxPoses) {
+			CompactPose &decoded = poses[n];
+			decoded.isController = (id & 0x80) != 0;
+			decoded.ordinal = id & 0x7f;
+			DequantizePose(format, pose, decoded.position, decoded.quaternion);
+			count++;
+		}
+	}
+	if (!reader.AtEnd())
+		return Malformed(count);
+
+	if (isKeyframe) {
+		m_hasKeyframe = true;
+		m_keyframeSequence = sequence;
+		return PoseStreamResult_Keyframe;
+	}
+	return PoseStreamResult_Delta;
+}
+
+PoseStreamResult PoseStreamDecoder::Decode(const osc::ReceivedMessageArgument &argument, CompactPoseFormat &format,
+	CompactPose *poses, int maxPoses, int &count) {
+	const void *data;
+	osc::osc_bundle_element_size_t size;
+	argument.AsBlob(data, size);
+	return Decode(data, static_cast<std::size_t>(size), format, poses, maxPoses, count);
+}
@@ -0,0 +1,162 @@
+// POSESTREAM.h
+#ifndef _POSESTREAM_H_
+#define _POSESTREAM_H_
+
+#include <atomic>
+#include <stdint.h>
+
+#include "CompactPose.h"
+
+// Compact pose blobs with keyframes and deltas, sent to
+// k_pchCompactPoseAddress like the plain ones
+static const int k_nPoseStreamVersion = 2;
+
+// Version, kind, position bits, rotation bits, resolution (float),
+// sequence, keyframe sequence, device count
+static const std::size_t k_unPoseStreamHeaderSize = 17;
+
+// Id, width, 3 x 25 bit position difference, flag, 2 + 3 x 15 bit
+// rotation: 139 bits
+static const std::size_t k_unMaxPoseStreamRecordSize = 18;
+static const std::size_t k_unMaxPoseStreamSize = k_unPoseStreamHeaderSize + k_unMaxDeviceCount * k_unMaxPoseStreamRecordSize;
+
+// Device ids are a byte, bit 7 for controllers and the ordinal below it
+static const int k_nPoseStreamDeviceIds = 256;
+
+enum PoseStreamKind {
+	PoseStreamKind_Keyframe,
+	PoseStreamKind_Delta
+};
+
+//
+// Compact poses as a stream of keyframes and deltas.
+//
+// Every keyframeInterval frames (and whenever asked to) a keyframe carries
+// every device's quantized pose. The frames in between only carry each
+// device's difference to its pose in the last keyframe, bit-packed at the
+// width the largest of its differences needs, so a device that sits still
+// costs under 3 bytes. The rotation is sent whole when the largest
+// quaternion component changed since the keyframe, and devices that
+// weren't in the keyframe are sent as differences to the origin.
+//
+// Frames carry a sequence number and the sequence number of their
+// keyframe. Deltas only depend on the keyframe, so a receiver that lost
+// deltas can go on decoding; one that lost the keyframe has to wait for
+// the next.
+//
+//   header: version, kind, position bits, rotation bits (1 byte each),
+//           resolution in metres (float), sequence, keyframe sequence
+//           (4 bytes each), device count (1 byte)
+//   record: device id (8 bits), position width w (5 bits), x, y, z
+//           differences (w bits each, zigzag), rotation flag (1 bit),
+//           then either the rotation width r (5 bits) and three r bit
+//           zigzag differences (flag 1) or the largest component's index
+//           (2 bits) and three rotationBits values (flag 0), whichever
+//           is shorter
+//
+// The records form one big endian bit stream, zero padded to whole bytes.
+// Nothing is allocated per frame, on either side.
+//
+class PoseStreamEncoder {
+private:
+	struct Reference {
+		bool valid;
+		QuantizedPose pose;
+	};
+
+	CompactPoseFormat m_format;
+	int m_keyframeInterval;
+	Reference m_keyframe[k_nPoseStreamDeviceIds];
+	uint32_t m_sequence = 0;
+	uint32_t m_keyframeSequence = 0;
+	int m_framesSinceKeyframe = 0;
+	bool m_isKeyframe = false;
+	std::atomic<bool> m_keyframeRequested;
+
+	char m_data[k_unMaxPoseStreamSize];
+	std::size_t m_size = 0;
+	int m_count = 0;
+	uint64_t m_bits = 0;	// not yet written bits of the stream
+	int m_bitCount = 0;
+	void WriteBits(uint32_t value, int count);
+
+	// Statistics
+	unsigned long m_keyframes = 0;
+	unsigned long m_deltas = 0;
+	unsigned long m_keyframeBytes = 0;
+	unsigned long m_deltaBytes = 0;
+
+	PoseStreamEncoder(const PoseStreamEncoder &);
+	PoseStreamEncoder &operator=(const PoseStreamEncoder &);
+
+public:
+	PoseStreamEncoder(const CompactPoseFormat &format, int keyframeInterval);
+
+	// Make the next frame a keyframe, from any thread
+	void RequestKeyframe() { m_keyframeRequested = true; }
+
+	// Start a frame, a keyframe if one is due
+	void Begin();
+
+	// Returns false when the frame is full
+	bool Add(bool isController, int ordinal, const float position[3], const float quaternion[4]);
+
+	// Finish the frame, Data() is complete after this
+	void End();
+
+	bool IsKeyframe() const { return m_isKeyframe; }
+	int Count() const { return m_count; }
+	const char *Data() const { return m_data; }
+	std::size_t Size() const { return m_size; }
+
+	unsigned long Keyframes() const { return m_keyframes; }
+	unsigned long Deltas() const { return m_deltas; }
+	void PrintStatistics() const;
+};
+
+enum PoseStreamResult {
+	PoseStreamResult_Keyframe,
+	PoseStreamResult_Delta,
+	PoseStreamResult_WaitingForKeyframe,	// the delta's keyframe was lost, no poses
+	PoseStreamResult_Malformed
+};
+
+//
+// Receiver side of a PoseStreamEncoder stream, decodes one blob at a time
+// in arrival order.
+//
+class PoseStreamDecoder {
+private:
+	struct Reference {
+		bool valid;
+		QuantizedPose pose;
+	};
+
+	Reference m_keyframe[k_nPoseStreamDeviceIds];
+	bool m_hasKeyframe = false;
+	uint32_t m_keyframeSequence = 0;
+	bool m_hasSequence = false;
+	uint32_t m_lastSequence = 0;
+
+	// Statistics
+	unsigned long m_framesLost = 0;
+	unsigned long m_framesWaiting = 0;
+
+public:
+	PoseStreamDecoder();
+
+	PoseStreamResult Decode(const void *data, std::size_t size, CompactPoseFormat &format,
+		CompactPose *poses, int maxPoses, int &count);
+
+	// Same, from the blob argument of a received message. Throws
+	// osc::WrongArgumentTypeException if it isn't a blob.
+	PoseStreamResult Decode(const osc::ReceivedMessageArgument &argument, CompactPoseFormat &format,
+		CompactPose *poses, int maxPoses, int &count);
+
+	// Frames missing from the sequence, and frames that couldn't be decoded
+	// for want of their keyframe
+	unsigned long FramesLost() const { return m_framesLost; }
+	unsigned long FramesWaiting() const { return m_framesWaiting; }
+};
+
+#endif // _POSESTREAM_H_
@@ -0,0 +1,201 @@
+//
+// Encodes tracking frames as specified by an output profile
+//
+
+#include "stdafx.h"
+#include "ProfileEncoder.h"
+#include "RealtimeSetup.h"
+#include "PosePrediction.h"
+#include "MonotonicClock.h"
+#include "osc/OscOutboundPacketStream.h"
+
+ProfileEncoder::ProfileEncoder(const OutputProfile &profile, int profileIndex, UdpFanout &output)
+	: m_profile(profile), m_profileBit(1u << profileIndex), m_packer(output)
+	, m_compact((profile.fields & ProfileField_Compact) != 0)
+	, m_poseStreaming(m_compact && profile.keyframeInterval > 0)
+	, m_poseStream(profile.compact, profile.keyframeInterval) {
+	if (m_profile.rate > 0)
+		m_periodNs = static_cast<int64_t>(1e9 / m_profile.rate);
+}
+
+// The columns of the profile's fields, in argument order
+int ProfileEncoder::SelectColumns(bool isController, const float **columns) const {
+	unsigned int fields = m_profile.fields;
+	int count = 0;
+	// Position and quaternion go into the compact blob instead
+	if (fields & ProfileField_Compact)
+		fields &= ~(ProfileField_Position | ProfileField_Quaternion);
+	if (fields & ProfileField_Position)
+		for (int n = 0; n < 3; n++) columns[count++] = m_columns.position[n];
+	if (fields & ProfileField_Quaternion)
+		for (int n = 0; n < 4; n++) columns[count++] = m_columns.quaternion[n];
+	if (fields & ProfileField_Matrix)
+		for (int n = 0; n < 12; n++) columns[count++] = m_columns.matrix[n];
+	if (fields & ProfileField_Velocity)
+		for (int n = 0; n < 3; n++) columns[count++] = m_columns.velocity[n];
+	if (fields & ProfileField_AngularVelocity)
+		for (int n = 0; n < 3; n++) columns[count++] = m_columns.angularVelocity[n];
+	if (isController && (fields & ProfileField_Trigger))
+		columns[count++] = m_columns.trigger;
+	if (isController && (fields & ProfileField_Axes))
+		for (int n = 0; n < 2; n++) columns[count++] = m_columns.axes[n];
+	return count;
+}
+
+// The columns the deadband compares exactly, of the fields that are sent
+int ProfileEncoder::SelectDeadbandColumns(bool isController, const float **columns) const {
+	unsigned int fields = m_profile.fields;
+	int count = 0;
+	if (fields & ProfileField_Velocity)
+		for (int n = 0; n < 3; n++) columns[count++] = m_columns.velocity[n];
+	if (fields & ProfileField_AngularVelocity)
+		for (int n = 0; n < 3; n++) columns[count++] = m_columns.angularVelocity[n];
+	if (isController && (fields & ProfileField_Trigger))
+		columns[count++] = m_columns.trigger;
+	if (isController && (fields & ProfileField_Axes))
+		for (int n = 0; n < 2; n++) columns[count++] = m_columns.axes[n];
+	return count;
+}
+
+std::size_t ProfileEncoder::Prefault() {
+	return PrefaultMemory(this, sizeof(*this)) + m_packer.Prefault();
+}
+
+void ProfileEncoder::Bind(const FrameColumns &columns) {
+	m_sourceColumns = columns;
+	m_columns = columns;
+	if (m_profile.predict) {
+		for (int n = 0; n < 3; n++)
+			m_columns.position[n] = m_predicted[n];
+		for (int n = 0; n < 4; n++)
+			m_columns.quaternion[n] = m_predicted[3 + n];
+	}
+	m_controllerFloats = SelectColumns(true, m_controllerColumns);
+	m_trackerFloats = SelectColumns(false, m_trackerColumns);
+	m_controllerDeadbandValues = SelectDeadbandColumns(true, m_controllerDeadbandColumns);
+	m_trackerDeadbandValues = SelectDeadbandColumns(false, m_trackerDeadbandColumns);
+	Invalidate();
+}
+
+void ProfileEncoder::Invalidate() {
+	for (DeviceIndex i = 0; i < k_unMaxDeviceCount; i++)
+		m_templates[i].Clear();
+	// Device ids may now belong to other devices
+	m_poseStream.RequestKeyframe();
+}
+
+// The poses are as old as the frame by now, extrapolate them past that
+void ProfileEncoder::Predict(const TrackingFrame &frame) {
+	double horizon = (MonotonicNanoseconds() - frame.captureTimeNs) / 1e9 + m_profile.predictionSeconds;
+	float *position[3] = { m_predicted[0], m_predicted[1], m_predicted[2] };
+	float *quaternion[4] = { m_predicted[3], m_predicted[4], m_predicted[5], m_predicted[6] };
+	PredictPoses(m_sourceColumns.position, m_sourceColumns.quaternion, m_sourceColumns.velocity, m_sourceColumns.angularVelocity,
+		static_cast<std::size_t>(frame.deviceCount), static_cast<float>(horizon), position, quaternion);
+}
+
+void ProfileEncoder::Encode(const TrackingFrame &frame) {
+	if (m_periodNs > 0) {
+		if (frame.captureTimeNs < m_nextFrameNs) {
+			m_framesSkipped++;
+			return;
+		}
+		// Keep the phase, unless frames were missed for a whole period
+		m_nextFrameNs += m_periodNs;
+		if (m_nextFrameNs <= frame.captureTimeNs)
+			m_nextFrameNs = frame.captureTimeNs + m_periodNs;
+	}
+	m_framesSent++;
+	if (m_profile.predict)
+		Predict(frame);
+
+	const FrameColumns &c = m_columns;
+	m_packer.BeginFrame(frame.timeTag);
+	if (m_poseStreaming)
+		m_poseStream.Begin();
+	else if (m_compact)
+		m_compactPoses.Begin(m_profile.compact);
+	for (int n = 0; n < frame.deviceCount; n++)
+	{
+		const TrackedDeviceSample &sample = frame.devices[n];
+		if ((sample.profiles & m_profileBit) == 0)
+			continue;
+
+		bool isController = (sample.deviceClass == DeviceClass_Controller);
+		MessageTemplate &message = m_templates[sample.unDevice];
+		if (!message.IsBuilt()) {
+			message.Build(sample.oscAddress, isController ? m_controllerFloats : m_trackerFloats, (m_profile.fields & ProfileField_TimeTag) != 0);
+			m_deadband.Reset(sample.unDevice, sample.oscAddress);
+		}
+
+		// Devices that sit still are only sent as a keepalive
+		if (m_deadband.Enabled()) {
+			float position[3] = { c.position[0][n], c.position[1][n], c.position[2][n] };
+			float quaternion[4] = { c.quaternion[0][n], c.quaternion[1][n], c.quaternion[2][n], c.quaternion[3][n] };
+			const float *const *columns = isController ? m_controllerDeadbandColumns : m_trackerDeadbandColumns;
+			int valueCount = isController ? m_controllerDeadbandValues : m_trackerDeadbandValues;
+			float values[k_nMaxDeadbandValues];
+			for (int k = 0; k < valueCount; k++)
+				values[k] = columns[k][n];
+			if (!m_deadband.ShouldSend(sample.unDevice, position, quaternion, values, valueCount, frame.captureTimeNs))
+				continue;
+		}
+
+		if (m_compact) {
+			float position[3] = { c.position[0][n], c.position[1][n], c.position[2][n] };
+			float quaternion[4] = { c.quaternion[0][n], c.quaternion[1][n], c.quaternion[2][n], c.quaternion[3][n] };
+			if (m_poseStreaming)
+				m_poseStream.Add(isController, sample.ordinal, position, quaternion);
+			else
+				m_compactPoses.Add(isController, sample.ordinal, position, quaternion);
+			if (message.FloatCount() == 0)
+				continue;
+		}
+
+		const float *const *columns = isController ? m_controllerColumns : m_trackerColumns;
+		int floatCount = message.FloatCount();
+		for (int k = 0; k < floatCount; k++)
+			message.SetFloat(k, columns[k][n]);
+		if (message.HasTimeTag())
+			message.SetTimeTag(frame.timeTag);
+
+		m_packer.AddMessage(message.Data(), message.Size());
+	}
+	if (m_poseStreaming) {
+		m_poseStream.End();
+		if (m_poseStream.Count() > 0)
+			AddCompactMessage(frame, m_poseStream.Data(), m_poseStream.Size());
+	} else if (m_compact && m_compactPoses.Count() > 0) {
+		AddCompactMessage(frame, m_compactPoses.Data(), m_compactPoses.Size());
+	}
+	m_packer.EndFrame();
+}
+
+// The frame's compact poses or pose stream frame as one blob, followed by the capture time if
+// the profile has it
+void ProfileEncoder::AddCompactMessage(const TrackingFrame &frame, const char *blob, std::size_t size) {
+	osc::OutboundPacketStream p(m_compactMessage, sizeof(m_compactMessage));
+	p << osc::BeginMessage(k_pchCompactPoseAddress)
+		<< osc::Blob(blob, static_cast<osc::osc_bundle_element_size_t>(size));
+	if (m_profile.fields & ProfileField_TimeTag)
+		p << osc::TimeTag(frame.timeTag);
+	p << osc::EndMessage;
+	m_packer.AddMessage(p.Data(), p.Size());
+}
+
+void ProfileEncoder::PrintStatistics(const UdpFanout &output) const {
+	char description[256];
+	DescribeProfile(m_profile, description, sizeof(description));
+	printf_s("Profile (%s) to", description);
+	if (m_packer.Destinations().empty())
+		printf_s(" all destinations");
+	for (int destination : m_packer.Destinations())
+		printf_s(" %s", output.DestinationName(destination));
+	printf_s(": %lu frames (%lu skipped by rate), %lu messages in %lu packets",
+		m_framesSent, m_framesSkipped, m_packer.MessagesSent(), m_packer.PacketsSent());
+	if (m_packer.MessagesDropped() > 0)
+		printf_s(", %lu messages too large to send", m_packer.MessagesDropped());
+	printf_s("\n");
+	if (m_poseStreaming)
+		m_poseStream.PrintStatistics();
+	m_deadband.PrintStatistics();
+}
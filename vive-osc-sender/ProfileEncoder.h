@@ -0,0 +1,132 @@
+// PROFILEENCODER.h
+#ifndef _PROFILEENCODER_H_
+#define _PROFILEENCODER_H_
+
+#include <stdint.h>
+
+#include "OutputProfile.h"
+#include "FramePacker.h"
+#include "MessageTemplate.h"
+#include "DeadbandFilter.h"
+#include "CompactPose.h"
+#include "PoseStream.h"
+#include "TrackingFrame.h"
+
+// Where the values of a frame's devices are, one array per value, indexed
+// like the frame's devices
+struct FrameColumns {
+	const float *position[3];
+	const float *quaternion[4];
+	const float *matrix[12];		// row by row
+	const float *velocity[3];
+	const float *angularVelocity[3];
+	const float *trigger;
+	const float *axes[2];
+};
+
+//
+// Encodes frames for one output profile and queues them for the
+// destinations that use it.
+//
+// Nothing the profile decides is looked at per device. Which devices it
+// takes is a bit in each frame sample, set on the acquisition side when the
+// devices change; which values make up a device's message is resolved in
+// Bind() into a list of columns per device class. Encoding a device is then
+// a gather of its row from those columns into its message template.
+//
+// A compact profile sends position and quaternion of all its devices in a
+// single k_pchCompactPoseAddress message per frame instead, quantized as
+// its CompactPoseFormat says, or as a PoseStreamEncoder stream if the
+// profile has a keyframe interval. Devices get a message of their own only
+// for fields that aren't in the blob.
+//
+class ProfileEncoder {
+private:
+	OutputProfile m_profile;
+	unsigned int m_profileBit;
+	FramePacker m_packer;
+	DeadbandFilter m_deadband;
+
+	// Rate limit, the next frame is sent once its capture time reaches this
+	int64_t m_periodNs = 0;
+	int64_t m_nextFrameNs = 0;
+
+	// Argument n of a device's message is column n at the device's row
+	const float *m_controllerColumns[k_unMaxTemplateFloats];
+	const float *m_trackerColumns[k_unMaxTemplateFloats];
+	int m_controllerFloats = 0;
+	int m_trackerFloats = 0;
+	FrameColumns m_columns;
+
+	// What the deadband compares besides the pose, per device class
+	const float *m_controllerDeadbandColumns[k_nMaxDeadbandValues];
+	const float *m_trackerDeadbandColumns[k_nMaxDeadbandValues];
+	int m_controllerDeadbandValues = 0;
+	int m_trackerDeadbandValues = 0;
+
+	// With prediction the messages read position and quaternion from these,
+	// extrapolated per frame from the shared columns by the profile's horizon
+	FrameColumns m_sourceColumns;
+	alignas(32) float m_predicted[7][k_unMaxDeviceCount];
+	void Predict(const TrackingFrame &frame);
+
+	MessageTemplate m_templates[k_unMaxDeviceCount];
+
+	// With ProfileField_Compact, positions and rotations of the whole frame
+	// go into one blob message; the other fields still go per device. With
+	// a keyframe interval the blobs are keyframes and deltas.
+	bool m_compact;
+	bool m_poseStreaming;
+	CompactPoseWriter m_compactPoses;
+	PoseStreamEncoder m_poseStream;
+	char m_compactMessage[k_unMaxPoseStreamSize + 32];
+	void AddCompactMessage(const TrackingFrame &frame, const char *blob, std::size_t size);
+
+	// Statistics
+	unsigned long m_framesSent = 0;
+	unsigned long m_framesSkipped = 0;
+
+	ProfileEncoder(const ProfileEncoder &);
+	ProfileEncoder &operator=(const ProfileEncoder &);
+
+	int SelectColumns(bool isController, const float **columns) const;
+	int SelectDeadbandColumns(bool isController, const float **columns) const;
+
+public:
+	// Profile number profileIndex, i.e. bit profileIndex of the samples' profile mask
+	ProfileEncoder(const OutputProfile &profile, int profileIndex, UdpFanout &output);
+
+	const OutputProfile &Profile() const { return m_profile; }
+	unsigned int ProfileBit() const { return m_profileBit; }
+
+	void AddDestination(int destination) { m_packer.AddDestination(destination); }
+	void SetFrameBundling(bool enabled, std::size_t maxPacketSize) { m_packer.SetFrameBundling(enabled, maxPacketSize); }
+	void SetDeadband(const DeadbandConfig &config) { m_deadband.SetConfig(config); }
+
+	// Fault in the message templates and packet buffers, after bundling is
+	// set. Returns the bytes touched.
+	std::size_t Prefault();
+
+	// Resolve the profile's fields to the columns frames are encoded from
+	void Bind(const FrameColumns &columns);
+
+	// Drop the message templates, device addresses have changed
+	void Invalidate();
+
+	// Make the next compact pose blob a keyframe, from any thread
+	void RequestKeyframe() { m_poseStream.RequestKeyframe(); }
+
+	// Encode the frame's devices that are in the profile and queue them,
+	// unless the rate limit skips the frame. With prediction, poses are
+	// extrapolated to now plus the profile's horizon first.
+	void Encode(const TrackingFrame &frame);
+
+	unsigned long FramesSent() const { return m_framesSent; }
+	unsigned long MessagesSent() const { return m_packer.MessagesSent(); }
+	unsigned long PacketsSent() const { return m_packer.PacketsSent(); }
+
+	// Profile, destinations and counts, plus the deadband statistics
+	void PrintStatistics(const UdpFanout &output) const;
+};
+
+#endif // _PROFILEENCODER_H_
@@ -0,0 +1,253 @@
+//
+// Core pinning, real-time priority, memory locking and prefaulting
+//
+
+#include "stdafx.h"
+#include "RealtimeSetup.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>		// _alloca
+#else
+#include <alloca.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+
+const char *RealtimeOutcomeName(RealtimeOutcome outcome) {
+	switch (outcome) {
+	case RealtimeOutcome_NotRequested: return "not requested";
+	case RealtimeOutcome_Granted: return "granted";
+	case RealtimeOutcome_Denied: return "denied";
+	case RealtimeOutcome_Unsupported: return "unsupported";
+	}
+	return "unknown";
+}
+
+RealtimeThread CurrentRealtimeThread() {
+#ifdef _WIN32
+	return GetCurrentThread();
+#else
+	return pthread_self();
+#endif
+}
+
+int CurrentCpu() {
+#ifdef _WIN32
+	return static_cast<int>(GetCurrentProcessorNumber());
+#elif defined(__linux__)
+	return sched_getcpu();
+#else
+	return -1;
+#endif
+}
+
+#ifdef _WIN32
+
+static RealtimeOutcome SetAffinity(RealtimeThread thread, int cpu, int &error) {
+	if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+		error = ERROR_INVALID_PARAMETER;
+		return RealtimeOutcome_Denied;
+	}
+	if (SetThreadAffinityMask(thread, static_cast<DWORD_PTR>(1) << cpu) == 0) {
+		error = static_cast<int>(GetLastError());
+		return RealtimeOutcome_Denied;
+	}
+	return RealtimeOutcome_Granted;
+}
+
+// Time critical is the highest priority outside the real-time priority class
+static RealtimeOutcome SetPriority(RealtimeThread thread, int priority, int &error) {
+	int wanted = (priority > 0) ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_NORMAL;
+	if (!SetThreadPriority(thread, wanted)) {
+		error = static_cast<int>(GetLastError());
+		return RealtimeOutcome_Denied;
+	}
+	return (GetThreadPriority(thread) == wanted) ? RealtimeOutcome_Granted : RealtimeOutcome_Denied;
+}
+
+#else
+
+static RealtimeOutcome SetAffinity(RealtimeThread thread, int cpu, int &error) {
+#ifdef __linux__
+	if (cpu >= CPU_SETSIZE) {
+		error = EINVAL;
+		return RealtimeOutcome_Denied;
+	}
+	cpu_set_t wanted;
+	CPU_ZERO(&wanted);
+	CPU_SET(cpu, &wanted);
+	error = pthread_setaffinity_np(thread, sizeof(wanted), &wanted);
+	if (error != 0)
+		return RealtimeOutcome_Denied;
+
+	cpu_set_t actual;
+	CPU_ZERO(&actual);
+	if (pthread_getaffinity_np(thread, sizeof(actual), &actual) != 0 || !CPU_EQUAL(&wanted, &actual))
+		return RealtimeOutcome_Denied;
+	return RealtimeOutcome_Granted;
+#else
+	(void)thread;
+	(void)cpu;
+	(void)error;
+	return RealtimeOutcome_Unsupported;
+#endif
+}
+
+static RealtimeOutcome SetPriority(RealtimeThread thread, int priority, int &error) {
+	int wantedPolicy = (priority > 0) ? SCHED_FIFO : SCHED_OTHER;
+	sched_param wanted;
+	memset(&wanted, 0, sizeof(wanted));
+	wanted.sched_priority = (priority > 0) ? priority : 0;
+	error = pthread_setschedparam(thread, wantedPolicy, &wanted);
+	if (error != 0)
+		return RealtimeOutcome_Denied;
+
+	int policy = 0;
+	sched_param actual;
+	if (pthread_getschedparam(thread, &policy, &actual) != 0
+		|| policy != wantedPolicy || actual.sched_priority != wanted.sched_priority)
+		return RealtimeOutcome_Denied;
+	return RealtimeOutcome_Granted;
+}
+
+#endif
+
+ThreadRealtimeStatus ConfigureThread(RealtimeThread thread, int cpu, int priority) {
+	ThreadRealtimeStatus status;
+	if (cpu >= 0)
+		status.affinity = SetAffinity(thread, cpu, status.affinityError);
+	if (priority != 0)
+		status.priority = SetPriority(thread, priority, status.priorityError);
+	return status;
+}
+
+RealtimeOutcome LockMemory(int &error) {
+	error = 0;
+#ifdef _WIN32
+	return RealtimeOutcome_Unsupported;
+#else
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+		error = errno;
+		return RealtimeOutcome_Denied;
+	}
+	return RealtimeOutcome_Granted;
+#endif
+}
+
+void UnlockMemory() {
+#ifndef _WIN32
+	munlockall();
+#endif
+}
+
+static std::size_t PageSize() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+std::size_t PrefaultMemory(const void *data, std::size_t size) {
+	if (size == 0)
+		return 0;
+	const std::size_t page = PageSize();
+	uintptr_t start = reinterpret_cast<uintptr_t>(data);
+	uintptr_t end = start + size;
+
+#ifdef MADV_POPULATE_WRITE
+	uintptr_t firstPage = start & ~static_cast<uintptr_t>(page - 1);
+	if (madvise(reinterpret_cast<void *>(firstPage), end - firstPage, MADV_POPULATE_WRITE) == 0)
+		return size;
+#endif
+
+	// A byte of each page, written back as it was
+	for (uintptr_t p = start; p < end; p = (p | (page - 1)) + 1) {
+		volatile char *byte = reinterpret_cast<volatile char *>(p);
+		*byte = *byte;
+	}
+	return size;
+}
+
+// Top down, the order the stack grows in
+void PrefaultStack(std::size_t size) {
+	const std::size_t page = PageSize();
+#ifdef _WIN32
+	volatile char *stack = static_cast<volatile char *>(_alloca(size));
+#else
+	volatile char *stack = static_cast<volatile char *>(alloca(size));
+#endif
+	for (std::size_t offset = 0; offset < size; offset += page)
+		stack[size - 1 - offset] = 0;
+	stack[0] = 0;
+}
+
+// Windows error codes (GetLastError, WSAGetLastError) aren't errno values,
+// strerror doesn't know them
+const char *SystemErrorText(int error, char *buffer, std::size_t size) {
+#ifdef _WIN32
+	DWORD length = FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL,
+		static_cast<DWORD>(error), 0, buffer, static_cast<DWORD>(size), NULL);
+	if (length == 0)
+		sprintf_s(buffer, size, "error %d", error);
+	// The messages end with a period and a line break
+	while (length > 0 && (buffer[length - 1] == '\n' || buffer[length - 1] == '\r' || buffer[length - 1] == '.'))
+		buffer[--length] = '\0';
+#else
+	snprintf(buffer, size, "%s", strerror(error));
+#endif
+	return buffer;
+}
+
+static void PrintOutcome(RealtimeOutcome outcome, int error) {
+	char text[128];
+	if (outcome == RealtimeOutcome_Denied && error != 0)
+		printf_s("%s (%s)", RealtimeOutcomeName(outcome), SystemErrorText(error, text, sizeof(text)));
+	else
+		printf_s("%s", RealtimeOutcomeName(outcome));
+}
+
+void PrintThreadRealtime(const char *thread, int cpu, int priority, const ThreadRealtimeStatus &status) {
+	if (status.affinity == RealtimeOutcome_NotRequested && status.priority == RealtimeOutcome_NotRequested)
+		return;
+	printf_s("Real-time: %s thread", thread);
+	if (status.affinity != RealtimeOutcome_NotRequested) {
+		printf_s(" pinned to CPU %d ", cpu);
+		PrintOutcome(status.affinity, status.affinityError);
+		if (status.priority != RealtimeOutcome_NotRequested)
+			printf_s(",");
+	}
+	if (status.priority != RealtimeOutcome_NotRequested) {
+#ifdef _WIN32
+		(void)priority;
+		printf_s(" time critical priority ");
+#else
+		printf_s(" SCHED_FIFO priority %d ", priority);
+#endif
+		PrintOutcome(status.priority, status.priorityError);
+	}
+	printf_s("\n");
+}
+
+void PrintMemoryLock(RealtimeOutcome outcome, int error) {
+	if (outcome == RealtimeOutcome_NotRequested)
+		return;
+	printf_s("Real-time: memory lock ");
+	PrintOutcome(outcome, error);
+#ifndef _WIN32
+	rlimit limit;
+	if (outcome == RealtimeOutcome_Denied && getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+		printf_s(", limit %lu KiB (ulimit -l)", static_cast<unsigned long>(limit.rlim_cur / 1024));
+#endif
+	printf_s("\n");
+}
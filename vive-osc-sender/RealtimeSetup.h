@@ -0,0 +1,85 @@
+// REALTIMESETUP.h
+#ifndef _REALTIMESETUP_H_
+#define _REALTIMESETUP_H_
+
+#include <cstddef>
+#include <thread>
+
+//
+// Real-time scheduling for the acquisition and transmit threads: pinning a
+// thread to a core, real-time priority, keeping all memory resident and
+// faulting buffers and stacks in before the first frame.
+//
+// Everything is a request the OS may refuse (no CAP_SYS_NICE or RTPRIO
+// limit for SCHED_FIFO, a memory lock limit smaller than the process, a
+// CPU outside the allowed set). Nothing here fails the sender; each call
+// says what was actually granted, read back from the OS rather than taken
+// from the call's return value, so it can be reported at startup.
+//
+// Linux: pthread_setaffinity_np, SCHED_FIFO and mlockall. Windows: thread
+// affinity masks and THREAD_PRIORITY_TIME_CRITICAL; there is no mlockall,
+// memory locking is unsupported there but prefaulting still works.
+//
+
+enum RealtimeOutcome {
+	RealtimeOutcome_NotRequested,
+	RealtimeOutcome_Granted,
+	RealtimeOutcome_Denied,
+	RealtimeOutcome_Unsupported
+};
+
+const char *RealtimeOutcomeName(RealtimeOutcome outcome);
+
+// Stack bytes faulted in per thread by PrefaultStack()
+static const std::size_t k_unPrefaultStackSize = 256 * 1024;
+
+struct RealtimeConfig {
+	int acquisitionCpu = -1;	// core of the acquisition (main) thread, -1 leaves it to the scheduler
+	int transmitCpu = -1;		// core of the transmit thread
+	int priority = 0;			// SCHED_FIFO priority of both threads, 1 to 99, 0 keeps normal scheduling
+	bool lockMemory = false;	// lock current and future pages in RAM, implies prefault
+	bool prefault = false;		// touch stacks and frame, encode and socket buffers before the first frame
+
+	bool Requested() const { return acquisitionCpu >= 0 || transmitCpu >= 0 || priority > 0 || lockMemory || prefault; }
+};
+
+// What ConfigureThread() got, with the OS error of each refusal
+struct ThreadRealtimeStatus {
+	RealtimeOutcome affinity = RealtimeOutcome_NotRequested;
+	int affinityError = 0;
+	RealtimeOutcome priority = RealtimeOutcome_NotRequested;
+	int priorityError = 0;
+};
+
+typedef std::thread::native_handle_type RealtimeThread;
+
+// The calling thread, and the core it is running on (-1 if unknown)
+RealtimeThread CurrentRealtimeThread();
+int CurrentCpu();
+
+// Pin a thread to cpu (unless negative) and give it real-time priority
+// (unless 0). A priority of -1 puts a thread back to normal scheduling.
+ThreadRealtimeStatus ConfigureThread(RealtimeThread thread, int cpu, int priority);
+
+// Lock all current and future pages of the process in RAM, and undo it
+RealtimeOutcome LockMemory(int &error);
+void UnlockMemory();
+
+// Fault in size bytes at data for writing, without changing them. Call
+// before other threads use the memory: where the kernel can't populate the
+// pages itself (MADV_POPULATE_WRITE, Linux 5.14), a byte of each page is
+// written back with its own value. Returns size.
+std::size_t PrefaultMemory(const void *data, std::size_t size);
+
+// Fault in the next size bytes of the calling thread's stack
+void PrefaultStack(std::size_t size = k_unPrefaultStackSize);
+
+// Description of an OS error code: errno values elsewhere, GetLastError()
+// and WSAGetLastError() codes on Windows. Returns buffer.
+const char *SystemErrorText(int error, char *buffer, std::size_t size);
+
+// One startup line per thread and for the memory lock
+void PrintThreadRealtime(const char *thread, int cpu, int priority, const ThreadRealtimeStatus &status);
+void PrintMemoryLock(RealtimeOutcome outcome, int error);
+
+#endif // _REALTIMESETUP_H_
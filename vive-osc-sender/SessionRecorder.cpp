@@ -0,0 +1,385 @@
+//
+// Session files: frames appended through memory mapped chunks, and read back
+//
+
+#include "stdafx.h"
+#include "SessionRecorder.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(SessionRecord) == k_unSessionRecordSize, "session records are fixed size");
+static_assert(sizeof(SessionHeader) == k_unSessionRecordSize, "the session header takes one record");
+
+// How often the background thread looks for chunks to map or retire, and
+// starts writing back the current one. A default chunk lasts 2 s at 64
+// devices and 1 kHz.
+static const int k_nRecorderPollMilliseconds = 10;
+
+// Touched once per page to prefault a chunk; at most the real page size
+static const std::size_t k_unPrefaultStride = 4096;
+
+SessionRecorder::SessionRecorder()
+	: m_pNextChunk(NULL), m_pRetiredChunk(NULL), m_stop(false) {
+	memset(m_serials, 0, sizeof(m_serials));
+}
+
+SessionRecorder::~SessionRecorder() {
+	Close();
+}
+
+bool SessionRecorder::Open(const char *path, std::size_t chunkSize) {
+	if (IsOpen())
+		return true;
+	m_chunkSize = (chunkSize + k_unSessionChunkAlignment - 1) / k_unSessionChunkAlignment * k_unSessionChunkAlignment;
+	if (m_chunkSize == 0)
+		m_chunkSize = k_unSessionChunkAlignment;
+	m_recordsPerChunk = m_chunkSize / k_unSessionRecordSize;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		printf_s("Can't create session file %s: error %lu\n", path, GetLastError());
+		return false;
+	}
+	m_file = file;
+#else
+	m_file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (m_file < 0) {
+		printf_s("Can't create session file %s: %s\n", path, strerror(errno));
+		return false;
+	}
+#endif
+
+	// The first chunk is mapped here, the background thread maps the rest
+	m_chunk = 0;
+	m_pChunk = MapChunk(0);
+	if (!m_pChunk) {
+		printf_s("Can't map session file %s\n", path);
+#ifdef _WIN32
+		CloseHandle(m_file);
+		m_file = NULL;
+#else
+		close(m_file);
+		m_file = -1;
+#endif
+		return false;
+	}
+
+	SessionHeader *header = reinterpret_cast<SessionHeader *>(m_pChunk);
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, k_pchSessionMagic, sizeof(header->magic));
+	header->version = k_unSessionVersion;
+	header->recordSize = static_cast<uint32_t>(k_unSessionRecordSize);
+	header->chunkSize = m_chunkSize;
+	m_chunkRecord = 1;
+	m_recordCount = 0;
+	m_haveSerials = false;
+	m_frames = 0;
+	m_overruns = 0;
+
+	m_pNextChunk = NULL;
+	m_pRetiredChunk = NULL;
+	m_stop = false;
+	m_thread = std::thread(&SessionRecorder::ThreadMain, this);
+	return true;
+}
+
+char *SessionRecorder::MapChunk(uint64_t chunk) {
+	uint64_t offset = chunk * m_chunkSize;
+	uint64_t end = offset + m_chunkSize;
+	char *data = NULL;
+
+#ifdef _WIN32
+	LARGE_INTEGER size;
+	size.QuadPart = static_cast<LONGLONG>(end);
+	if (!SetFilePointerEx(m_file, size, NULL, FILE_BEGIN) || !SetEndOfFile(m_file))
+		return NULL;
+	HANDLE mapping = CreateFileMappingA(m_file, NULL, PAGE_READWRITE, static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), NULL);
+	if (!mapping)
+		return NULL;
+	data = static_cast<char *>(MapViewOfFile(mapping, FILE_MAP_WRITE, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), m_chunkSize));
+	CloseHandle(mapping);	// the view keeps it
+	if (!data)
+		return NULL;
+#else
+	// Allocate the blocks now rather than on the writer's first touch;
+	// not every file system can, a sparse extension will do there
+	if (posix_fallocate(m_file, static_cast<off_t>(offset), static_cast<off_t>(m_chunkSize)) != 0
+		&& ftruncate(m_file, static_cast<off_t>(end)) != 0)
+		return NULL;
+	void *mapped = mmap(NULL, m_chunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, static_cast<off_t>(offset));
+	if (mapped == MAP_FAILED)
+		return NULL;
+	data = static_cast<char *>(mapped);
+	madvise(data, m_chunkSize, MADV_SEQUENTIAL);
+#endif
+
+	// Take every page fault here instead of on the acquisition thread
+	for (std::size_t n = 0; n < m_chunkSize; n += k_unPrefaultStride)
+		*static_cast<volatile char *>(data + n) = 0;
+	return data;
+}
+
+void SessionRecorder::SyncChunk(char *data, bool wait) {
+#ifdef _WIN32
+	FlushViewOfFile(data, 0);
+	if (wait)
+		FlushFileBuffers(m_file);
+#else
+	msync(data, m_chunkSize, wait ? MS_SYNC : MS_ASYNC);
+#endif
+}
+
+void SessionRecorder::UnmapChunk(char *data, uint64_t chunk) {
+#ifdef _WIN32
+	(void)chunk;
+	UnmapViewOfFile(data);
+#else
+	munmap(data, m_chunkSize);
+
+	// Written and synced, nobody will read it back soon
+	posix_fadvise(m_file, static_cast<off_t>(chunk * m_chunkSize), static_cast<off_t>(m_chunkSize), POSIX_FADV_DONTNEED);
+#endif
+}
+
+void SessionRecorder::ThreadMain() {
+	uint64_t mappedChunks = 1;
+	uint64_t retiredChunks = 0;
+	char *current = m_pChunk;
+	char *handedOut = NULL;
+	bool reportedFailure = false;
+
+	while (!m_stop) {
+		if (m_pNextChunk.load() == NULL) {
+			// The writer took the chunk handed out last, and retired the one
+			// before it
+			if (handedOut) {
+				current = handedOut;
+				handedOut = NULL;
+			}
+			char *retired = m_pRetiredChunk.exchange(NULL);
+			if (retired) {
+				SyncChunk(retired, true);
+				UnmapChunk(retired, retiredChunks++);
+			}
+
+			char *next = MapChunk(mappedChunks);
+			if (next) {
+				mappedChunks++;
+				handedOut = next;
+				m_pNextChunk = next;
+			} else if (!reportedFailure) {
+				printf_s("Can't grow the session file, frames are being dropped\n");
+				reportedFailure = true;
+			}
+		}
+
+		// Start writing back what the writer has added so far
+		SyncChunk(current, false);
+		std::this_thread::sleep_for(std::chrono::milliseconds(k_nRecorderPollMilliseconds));
+	}
+}
+
+void SessionRecorder::Record(const TrackingFrame &frame, const DeviceRegistry &registry) {
+	if (!m_pChunk || frame.deviceCount == 0)
+		return;
+
+	if (!m_haveSerials || frame.templateGeneration != m_serialGeneration) {
+		for (int n = 0; n < registry.DeviceCount(); n++) {
+			const RegisteredDevice &device = registry.Device(n);
+			strncpy(m_serials[device.unDevice], device.serial, k_unSessionSerialSize);
+		}
+		m_serialGeneration = frame.templateGeneration;
+		m_haveSerials = true;
+	}
+
+	// Whole frames only, never wait for the next chunk
+	std::size_t count = static_cast<std::size_t>(frame.deviceCount);
+	if (m_chunkRecord + count > m_recordsPerChunk && m_pNextChunk.load() == NULL) {
+		m_overruns++;
+		return;
+	}
+
+	for (std::size_t n = 0; n < count; n++) {
+		if (m_chunkRecord == m_recordsPerChunk) {
+			m_pRetiredChunk = m_pChunk;
+			m_pChunk = m_pNextChunk.exchange(NULL);
+			m_chunk++;
+			m_chunkRecord = 0;
+		}
+
+		const TrackedDeviceSample &sample = frame.devices[n];
+		const DevicePose &pose = sample.pose;
+		SessionRecord &record = *reinterpret_cast<SessionRecord *>(m_pChunk + m_chunkRecord * k_unSessionRecordSize);
+		record.captureTimeNs = frame.captureTimeNs;
+		record.timeTag = frame.timeTag;
+		record.frameNumber = static_cast<uint32_t>(frame.frameNumber);
+		record.deviceIndex = static_cast<uint8_t>(sample.unDevice);
+		record.deviceClass = static_cast<uint8_t>(sample.deviceClass);
+		record.ordinal = static_cast<uint8_t>(sample.ordinal);
+		record.frameDeviceCount = static_cast<uint8_t>(count);
+		record.frameDevice = static_cast<uint8_t>(n);
+		record.reserved[0] = record.reserved[1] = 0;
+		memcpy(record.serial, m_serials[sample.unDevice], sizeof(record.serial));
+		memcpy(record.matrix, pose.mDeviceToAbsoluteTracking.m, sizeof(record.matrix));
+		memcpy(record.velocity, pose.vVelocity.v, sizeof(record.velocity));
+		memcpy(record.angularVelocity, pose.vAngularVelocity.v, sizeof(record.angularVelocity));
+		record.trigger = sample.trigger;
+		record.axes[0] = sample.axes[0];
+		record.axes[1] = sample.axes[1];
+		record.flags = static_cast<uint8_t>(SessionRecord_Present
+			| (pose.bPoseIsValid ? SessionRecord_PoseValid : 0)
+			| (pose.bTrackingOK ? SessionRecord_TrackingOK : 0)
+			| (sample.deviceClass == DeviceClass_Controller ? SessionRecord_Controller : 0));
+		m_chunkRecord++;
+	}
+	m_recordCount += count;
+	m_frames++;
+}
+
+void SessionRecorder::Close() {
+	if (!IsOpen())
+		return;
+	m_stop = true;
+	if (m_thread.joinable())
+		m_thread.join();
+
+	char *retired = m_pRetiredChunk.exchange(NULL);
+	if (retired) {
+		SyncChunk(retired, true);
+		UnmapChunk(retired, m_chunk - 1);
+	}
+	char *next = m_pNextChunk.exchange(NULL);
+	if (next)
+		UnmapChunk(next, m_chunk + 1);
+	SyncChunk(m_pChunk, true);
+	UnmapChunk(m_pChunk, m_chunk);
+	m_pChunk = NULL;
+
+	// Everything is unmapped, the header's count and the file length can
+	// be set through the file
+	uint64_t size = (1 + m_recordCount) * k_unSessionRecordSize;
+	const std::size_t countOffset = offsetof(SessionHeader, recordCount);
+#ifdef _WIN32
+	LARGE_INTEGER position;
+	position.QuadPart = static_cast<LONGLONG>(countOffset);
+	DWORD written = 0;
+	SetFilePointerEx(m_file, position, NULL, FILE_BEGIN);
+	WriteFile(m_file, &m_recordCount, sizeof(m_recordCount), &written, NULL);
+	position.QuadPart = static_cast<LONGLONG>(size);
+	SetFilePointerEx(m_file, position, NULL, FILE_BEGIN);
+	SetEndOfFile(m_file);
+	CloseHandle(m_file);
+	m_file = NULL;
+#else
+	if (pwrite(m_file, &m_recordCount, sizeof(m_recordCount), static_cast<off_t>(countOffset)) != static_cast<ssize_t>(sizeof(m_recordCount))
+		|| ftruncate(m_file, static_cast<off_t>(size)) != 0)
+		printf_s("Can't finish the session file: %s\n", strerror(errno));
+	close(m_file);
+	m_file = -1;
+#endif
+}
+
+void SessionRecorder::PrintStatistics() const {
+	printf_s("Session: %lu frames in %llu records (%.1f MB, %llu chunks), %lu frames dropped waiting for the next chunk\n",
+		m_frames, static_cast<unsigned long long>(m_recordCount), static_cast<double>(m_recordCount * k_unSessionRecordSize) / 1e6,
+		static_cast<unsigned long long>(m_chunk + 1), m_overruns);
+}
+
+bool SessionReader::Open(const char *path) {
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		printf_s("Can't open session file %s: error %lu\n", path, GetLastError());
+		return false;
+	}
+	m_file = file;
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	m_size = static_cast<std::size_t>(size.QuadPart);
+	if (m_size >= sizeof(SessionHeader)) {
+		m_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_mapping)
+			m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	m_file = open(path, O_RDONLY);
+	if (m_file < 0) {
+		printf_s("Can't open session file %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	struct stat status;
+	fstat(m_file, &status);
+	m_size = static_cast<std::size_t>(status.st_size);
+	if (m_size >= sizeof(SessionHeader)) {
+		void *mapped = mmap(NULL, m_size, PROT_READ, MAP_SHARED, m_file, 0);
+		if (mapped != MAP_FAILED) {
+			m_data = static_cast<const char *>(mapped);
+			madvise(mapped, m_size, MADV_SEQUENTIAL);
+		}
+	}
+#endif
+
+	const SessionHeader *header = reinterpret_cast<const SessionHeader *>(m_data);
+	if (!m_data || memcmp(header->magic, k_pchSessionMagic, sizeof(header->magic)) != 0
+		|| header->version != k_unSessionVersion || header->recordSize != k_unSessionRecordSize) {
+		printf_s("%s is not a session file\n", path);
+		Close();
+		return false;
+	}
+
+	// A file that wasn't closed has no count, its records end at the first
+	// one never written. Written records are a prefix, so bisect.
+	m_records = reinterpret_cast<const SessionRecord *>(m_data + k_unSessionRecordSize);
+	std::size_t slots = m_size / k_unSessionRecordSize - 1;
+	if (header->recordCount > 0 && header->recordCount <= slots) {
+		m_recordCount = static_cast<std::size_t>(header->recordCount);
+	} else {
+		std::size_t low = 0, high = slots;
+		while (low < high) {
+			std::size_t middle = low + (high - low) / 2;
+			if (m_records[middle].flags & SessionRecord_Present)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		m_recordCount = low;
+	}
+	return true;
+}
+
+void SessionReader::Close() {
+#ifdef _WIN32
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file)
+		CloseHandle(m_file);
+	m_mapping = NULL;
+	m_file = NULL;
+#else
+	if (m_data)
+		munmap(const_cast<char *>(m_data), m_size);
+	if (m_file >= 0)
+		close(m_file);
+	m_file = -1;
+#endif
+	m_data = NULL;
+	m_size = 0;
+	m_records = NULL;
+	m_recordCount = 0;
+}
@@ -0,0 +1,184 @@
+// SESSIONRECORDER.h
+#ifndef _SESSIONRECORDER_H_
+#define _SESSIONRECORDER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+#include "TrackingFrame.h"
+
+static const char k_pchSessionMagic[8] = { 'V', 'O', 'S', 'C', 'S', 'E', 'S', 'S' };
+static const uint32_t k_unSessionVersion = 1;
+
+// Size of the file header and of each record, so records never straddle a
+// page or a cache line
+static const std::size_t k_unSessionRecordSize = 128;
+
+// A chunk is mapped at a time; multiple of the 64 KiB Windows mapping
+// granularity (and so of any page size)
+static const std::size_t k_unSessionChunkAlignment = 65536;
+static const std::size_t k_unDefaultSessionChunkSize = 16 << 20;
+
+// Part of a session record's device serial, NUL padded
+static const std::size_t k_unSessionSerialSize = 16;
+
+enum SessionRecordFlag {
+	SessionRecord_Present = 1,		// set in every written record
+	SessionRecord_PoseValid = 2,
+	SessionRecord_TrackingOK = 4,
+	SessionRecord_Controller = 8
+};
+
+//
+// One device of one frame, as the acquisition side saw it. A frame's
+// devices are consecutive records with the same frame number. Host byte
+// order, like the rest of the file.
+//
+struct SessionRecord {
+	int64_t captureTimeNs;		// MonotonicNanoseconds() when the frame was read
+	uint64_t timeTag;			// NTP time tag of the frame
+	uint32_t frameNumber;
+	uint8_t flags;				// SessionRecordFlag
+	uint8_t deviceIndex;		// runtime slot
+	uint8_t deviceClass;		// DeviceClass
+	uint8_t ordinal;			// as in the device's OSC address
+	uint8_t frameDeviceCount;	// devices in the frame
+	uint8_t frameDevice;		// this record's place among them
+	uint8_t reserved[2];
+	char serial[k_unSessionSerialSize];
+	float matrix[3][4];			// device to absolute tracking
+	float velocity[3];
+	float angularVelocity[3];
+	float trigger;
+	float axes[2];
+};
+
+struct SessionHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+	uint64_t chunkSize;
+	uint64_t recordCount;		// 0 until the recorder is closed
+	char reserved[k_unSessionRecordSize - 32];
+};
+
+//
+// Appends the frames the acquisition side reads to a session file.
+//
+// The file is a header followed by fixed size records, grown a chunk at a
+// time and written through a memory mapping, so recording a frame is a
+// copy into memory. A background thread does everything that can wait on
+// the disk: it extends the file and maps and prefaults the next chunk
+// ahead of the writer, and msyncs and unmaps chunks the writer is done
+// with, dropping them from the page cache. The chunks are handed over
+// through two atomic pointers.
+//
+// Frames are recorded whole or not at all: if a frame needs the next chunk
+// and the background thread hasn't mapped it yet, the frame is dropped and
+// counted as an overrun rather than waiting.
+//
+// The records that made it to the mapping survive a crash of the sender;
+// a file that wasn't closed ends at the first record without
+// SessionRecord_Present set.
+//
+class SessionRecorder {
+private:
+#ifdef _WIN32
+	void *m_file = NULL;
+#else
+	int m_file = -1;
+#endif
+	std::size_t m_chunkSize = k_unDefaultSessionChunkSize;
+	std::size_t m_recordsPerChunk = 0;
+
+	// Owned by the writer
+	char *m_pChunk = NULL;
+	uint64_t m_chunk = 0;				// index of m_pChunk in the file
+	std::size_t m_chunkRecord = 0;		// next record in m_pChunk
+	uint64_t m_recordCount = 0;
+
+	// Serials of the frame's devices, looked up when the registry changes
+	char m_serials[k_unMaxDeviceCount][k_unSessionSerialSize];
+	unsigned int m_serialGeneration = 0;
+	bool m_haveSerials = false;
+
+	// Handed over between the writer and the background thread. The writer
+	// stores the chunk it leaves before it takes the next, so the
+	// background thread finds the old one retired whenever it finds the
+	// next one gone.
+	std::atomic<char *> m_pNextChunk;		// mapped and prefaulted, not yet written
+	std::atomic<char *> m_pRetiredChunk;	// written, to be synced and unmapped
+
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+
+	// Statistics
+	unsigned long m_frames = 0;
+	unsigned long m_overruns = 0;
+
+	char *MapChunk(uint64_t chunk);
+	void SyncChunk(char *data, bool wait);
+	void UnmapChunk(char *data, uint64_t chunk);
+	void ThreadMain();
+
+	SessionRecorder(const SessionRecorder &);
+	SessionRecorder &operator=(const SessionRecorder &);
+
+public:
+	SessionRecorder();
+	~SessionRecorder();
+
+	// Create (or replace) the file and start the background thread.
+	// chunkSize is rounded up to k_unSessionChunkAlignment. False, with a
+	// message, if the file can't be created.
+	bool Open(const char *path, std::size_t chunkSize = k_unDefaultSessionChunkSize);
+
+	// Stop the background thread, sync everything and cut the file to the
+	// records written
+	void Close();
+	bool IsOpen() const { return m_pChunk != NULL; }
+
+	// Append a frame, from the acquisition thread. The registry is the one
+	// the frame was acquired with, for the device serials.
+	void Record(const TrackingFrame &frame, const DeviceRegistry &registry);
+
+	uint64_t RecordCount() const { return m_recordCount; }
+	unsigned long Frames() const { return m_frames; }
+	unsigned long Overruns() const { return m_overruns; }
+	void PrintStatistics() const;
+};
+
+//
+// Read-only view of a session file, mapped whole.
+//
+class SessionReader {
+private:
+#ifdef _WIN32
+	void *m_file = NULL;
+	void *m_mapping = NULL;
+#else
+	int m_file = -1;
+#endif
+	const char *m_data = NULL;
+	std::size_t m_size = 0;
+	const SessionRecord *m_records = NULL;
+	std::size_t m_recordCount = 0;
+
+	SessionReader(const SessionReader &);
+	SessionReader &operator=(const SessionReader &);
+
+public:
+	SessionReader() {}
+	~SessionReader() { Close(); }
+
+	// False, with a message, if the file can't be read or isn't a session
+	bool Open(const char *path);
+	void Close();
+
+	std::size_t RecordCount() const { return m_recordCount; }
+	const SessionRecord &Record(std::size_t n) const { return m_records[n]; }
+	const SessionRecord *Records() const { return m_records; }
+};
+
+#endif // _SESSIONRECORDER_H_
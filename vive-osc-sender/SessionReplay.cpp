@@ -0,0 +1,182 @@
+//
+// Playback of recorded sessions into the sender
+//
+
+#include "stdafx.h"
+#include "SessionReplay.h"
+#include "MonotonicClock.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Sleeps 1 ms at most at a time, the spin is what makes a frame punctual
+static const double k_fPacerRateHz = 1000;
+
+SessionReplay::SessionReplay(const SessionReader &reader, const ReplayConfig &config)
+	: m_reader(reader), m_config(config), m_pacer(k_fPacerRateHz) {
+	memset(m_devices, 0, sizeof(m_devices));
+	if (m_config.speed <= 0)
+		m_config.speed = 1.0;
+}
+
+double SessionReplay::DurationSeconds() const {
+	std::size_t count = m_reader.RecordCount();
+	if (count == 0)
+		return 0;
+	return (m_reader.Record(count - 1).captureTimeNs - m_reader.Record(0).captureTimeNs) / 1e9;
+}
+
+bool SessionReplay::Seek(double seconds) {
+	std::size_t count = m_reader.RecordCount();
+	m_started = false;
+	if (count == 0) {
+		m_nextRecord = 0;
+		return false;
+	}
+
+	// Capture times only go forward, so bisect for the first one due
+	int64_t target = m_reader.Record(0).captureTimeNs + static_cast<int64_t>(seconds * 1e9);
+	std::size_t low = 0, high = count;
+	while (low < high) {
+		std::size_t middle = low + (high - low) / 2;
+		if (m_reader.Record(middle).captureTimeNs < target)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	// Back to the first device of that frame
+	if (low < count && m_reader.Record(low).frameDevice <= low)
+		low -= m_reader.Record(low).frameDevice;
+	m_nextRecord = low;
+	return low < count;
+}
+
+// A slot only gets a new generation when a different device shows up in it
+void SessionReplay::UpdateDevice(const SessionRecord &record) {
+	RegisteredDevice &device = m_devices[record.deviceIndex];
+	if (device.deviceClass == static_cast<DeviceClass>(record.deviceClass) && device.ordinal == record.ordinal
+		&& strncmp(device.serial, record.serial, k_unSessionSerialSize) == 0)
+		return;
+
+	device.unDevice = record.deviceIndex;
+	device.deviceClass = static_cast<DeviceClass>(record.deviceClass);
+	device.role = ControllerRole_Invalid;
+	device.ordinal = record.ordinal;
+	memset(device.serial, 0, sizeof(device.serial));
+	memcpy(device.serial, record.serial, k_unSessionSerialSize);
+	if (device.deviceClass == DeviceClass_Controller)
+		sprintf_s(device.oscAddress, sizeof(device.oscAddress), "/controller/%d", device.ordinal);
+	else if (device.deviceClass == DeviceClass_GenericTracker)
+		sprintf_s(device.oscAddress, sizeof(device.oscAddress), "/tracker/%d", device.ordinal);
+	else
+		device.oscAddress[0] = '\0';
+	m_generation++;
+}
+
+bool SessionReplay::NextFrame(TrackingFrame &frame) {
+	std::size_t count = m_reader.RecordCount();
+	if (m_started)
+		m_endNs = MonotonicNanoseconds();
+
+	// The records of one frame are consecutive; skip ahead to the next
+	// frame start past anything that isn't
+	const SessionRecord *records = NULL;
+	std::size_t deviceCount = 0;
+	while (m_nextRecord < count) {
+		records = &m_reader.Record(m_nextRecord);
+		deviceCount = records[0].frameDeviceCount;
+		if (m_nextRecord + deviceCount > count) {
+			// Cut short by a crash
+			m_nextRecord = count;
+			break;
+		}
+		bool wellFormed = (deviceCount > 0 && deviceCount <= k_unMaxDeviceCount);
+		for (std::size_t n = 0; wellFormed && n < deviceCount; n++) {
+			const SessionRecord &record = records[n];
+			wellFormed = (record.frameDevice == n && record.frameNumber == records[0].frameNumber
+				&& record.deviceIndex < k_unMaxDeviceCount && (record.flags & SessionRecord_Present) != 0);
+		}
+		if (wellFormed)
+			break;
+		m_malformedFrames++;
+		m_nextRecord++;
+		while (m_nextRecord < count && m_reader.Record(m_nextRecord).frameDevice != 0)
+			m_nextRecord++;
+	}
+	if (m_nextRecord >= count)
+		return false;
+	m_nextRecord += deviceCount;
+
+	// Wait until the frame is due, relative to the first one played
+	int64_t recordedNs = records[0].captureTimeNs;
+	if (!m_started) {
+		m_started = true;
+		m_startNs = MonotonicNanoseconds();
+		m_startRecordedNs = recordedNs;
+	} else if (m_config.timing != ReplayTiming_MaxSpeed) {
+		double speed = (m_config.timing == ReplayTiming_Scaled) ? m_config.speed : 1.0;
+		int64_t dueNs = m_startNs + static_cast<int64_t>((recordedNs - m_startRecordedNs) / speed);
+		if (MonotonicNanoseconds() > dueNs)
+			m_lateFrames++;
+		else
+			m_pacer.WaitUntil(dueNs);
+	}
+	m_lastRecordedNs = recordedNs;
+
+	for (std::size_t n = 0; n < deviceCount; n++)
+		UpdateDevice(records[n]);
+
+	frame.captureTimeNs = recordedNs;
+	frame.timeTag = records[0].timeTag;
+	frame.frameNumber = records[0].frameNumber;
+	frame.templateGeneration = m_generation;
+	frame.deviceCount = static_cast<int>(deviceCount);
+	for (std::size_t n = 0; n < deviceCount; n++) {
+		const SessionRecord &record = records[n];
+		const RegisteredDevice &device = m_devices[record.deviceIndex];
+		TrackedDeviceSample &sample = frame.devices[n];
+		sample.unDevice = record.deviceIndex;
+		sample.deviceClass = device.deviceClass;
+		sample.ordinal = device.ordinal;
+		sample.profiles = 0;
+		sample.trigger = record.trigger;
+		sample.axes[0] = record.axes[0];
+		sample.axes[1] = record.axes[1];
+		memcpy(sample.oscAddress, device.oscAddress, sizeof(sample.oscAddress));
+		memcpy(sample.pose.mDeviceToAbsoluteTracking.m, record.matrix, sizeof(record.matrix));
+		memcpy(sample.pose.vVelocity.v, record.velocity, sizeof(record.velocity));
+		memcpy(sample.pose.vAngularVelocity.v, record.angularVelocity, sizeof(record.angularVelocity));
+		sample.pose.bPoseIsValid = (record.flags & SessionRecord_PoseValid) != 0;
+		sample.pose.bTrackingOK = (record.flags & SessionRecord_TrackingOK) != 0;
+	}
+
+	m_frames++;
+	return true;
+}
+
+double SessionReplay::FramesPerSecond() const {
+	double elapsed = ElapsedSeconds();
+	return (elapsed > 0) ? m_frames / elapsed : 0;
+}
+
+void SessionReplay::PrintStatistics(unsigned long packetsSent) const {
+	double elapsed = ElapsedSeconds();
+	double recorded = (m_lastRecordedNs - m_startRecordedNs) / 1e9;
+	printf_s("Replay: %lu frames in %.2f s, %.0f frames/s, %.0f packets/s, %.2fx recorded speed, %lu frames late, %lu malformed frames skipped\n",
+		m_frames, elapsed, FramesPerSecond(), (elapsed > 0) ? packetsSent / elapsed : 0,
+		(elapsed > 0) ? recorded / elapsed : 0, m_lateFrames, m_malformedFrames);
+}
+
+bool ParseReplaySpeed(const char *text, ReplayConfig &config) {
+	if (strcmp(text, "max") == 0) {
+		config.timing = ReplayTiming_MaxSpeed;
+		return true;
+	}
+	double speed = atof(text);
+	if (speed <= 0)
+		return false;
+	config.timing = (speed == 1.0) ? ReplayTiming_Original : ReplayTiming_Scaled;
+	config.speed = speed;
+	return true;
+}
@@ -0,0 +1,98 @@
+// SESSIONREPLAY.h
+#ifndef _SESSIONREPLAY_H_
+#define _SESSIONREPLAY_H_
+
+#include <stdint.h>
+
+#include "SessionRecorder.h"
+#include "FrameScheduler.h"
+#include "TrackingFrame.h"
+
+enum ReplayTiming {
+	ReplayTiming_Original,	// frames as far apart as they were recorded
+	ReplayTiming_Scaled,	// recorded spacing divided by ReplayConfig::speed
+	ReplayTiming_MaxSpeed	// back to back, as fast as the sender takes them
+};
+
+struct ReplayConfig {
+	ReplayTiming timing = ReplayTiming_Original;
+	double speed = 1.0;
+};
+
+//
+// Plays the frames of a session file back as TrackingFrames, for
+// LighthouseTracking::InjectFrame to encode and send like live ones.
+//
+// Frames are due at their recorded distance from the first frame played,
+// divided by the speed, against absolute deadlines like FrameScheduler. A
+// frame that is due already goes out at once, so a replay that falls
+// behind catches up instead of drifting; how many were late is counted.
+//
+// Device addresses are rebuilt from the recorded class and number, not
+// renumbered, so a receiver sees the same addresses as in the session. The
+// template generation only changes when a slot turns up with a different
+// device, not when a device merely drops out of some frames.
+//
+class SessionReplay {
+private:
+	const SessionReader &m_reader;
+	ReplayConfig m_config;
+	FrameScheduler m_pacer;
+
+	std::size_t m_nextRecord = 0;
+
+	// Devices seen so far, by slot, for the profiles and addresses
+	RegisteredDevice m_devices[k_unMaxDeviceCount];
+	unsigned int m_generation = 1;
+
+	// Pacing: wall clock time of the first frame played and its recorded time
+	bool m_started = false;
+	int64_t m_startNs = 0;
+	int64_t m_startRecordedNs = 0;
+	int64_t m_lastRecordedNs = 0;
+
+	// Statistics
+	unsigned long m_frames = 0;
+	unsigned long m_lateFrames = 0;
+	unsigned long m_malformedFrames = 0;
+	int64_t m_endNs = 0;
+
+	void UpdateDevice(const SessionRecord &record);
+
+	SessionReplay(const SessionReplay &);
+	SessionReplay &operator=(const SessionReplay &);
+
+public:
+	// The reader must stay open while replaying
+	SessionReplay(const SessionReader &reader, const ReplayConfig &config = ReplayConfig());
+
+	// Recorded time from the first to the last frame of the session
+	double DurationSeconds() const;
+
+	// Continue with the first frame captured at or after the given number of
+	// seconds into the session. False if the session ends before that.
+	// Pacing restarts from the next frame.
+	bool Seek(double seconds);
+
+	// Read the next frame into frame, once it is due. False at the end of
+	// the session.
+	bool NextFrame(TrackingFrame &frame);
+
+	// Devices of the frames read so far, indexed by slot; DeviceClass_Invalid
+	// for slots not seen yet
+	const RegisteredDevice *Devices() const { return m_devices; }
+
+	unsigned long Frames() const { return m_frames; }
+	unsigned long LateFrames() const { return m_lateFrames; }
+	double ElapsedSeconds() const { return (m_endNs - m_startNs) / 1e9; }
+	double FramesPerSecond() const;
+
+	// Frames and packets per second achieved, given the packets the sender
+	// sent while replaying
+	void PrintStatistics(unsigned long packetsSent) const;
+};
+
+// Parses "max" or a speed factor such as "1", "0.5" or "4"
+bool ParseReplaySpeed(const char *text, ReplayConfig &config);
+
+#endif // _SESSIONREPLAY_H_
@@ -0,0 +1,148 @@
+// SPSCRING.h
+#ifndef _SPSCRING_H_
+#define _SPSCRING_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Size of a cache line on the machines we run on, keeps the producer and
+// consumer indices from sharing (and bouncing) a line
+static const std::size_t k_unCacheLineSize = 64;
+
+enum RingOverflowPolicy {
+	RingOverflow_DropOldest,	// overwrite the oldest queued record, the producer never waits
+	RingOverflow_Block			// the producer waits for the consumer to make room
+};
+
+//
+// Bounded single-producer/single-consumer ring of fixed-size records.
+//
+// Push() must only be called from one thread and Pop() from one other
+// thread. Records are copied in and out, so T must be trivially copyable.
+//
+// With RingOverflow_DropOldest a full ring makes the producer advance the
+// consumer index itself. The consumer therefore copies a record out first
+// and only then claims it with a compare-and-swap on the tail; if the
+// producer dropped that record in the meantime the copy is discarded and
+// the consumer moves on to the next one.
+//
+template <typename T, std::size_t Capacity>
+class SpscRing {
+private:
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	// Written by the producer
+	alignas(k_unCacheLineSize) std::atomic<uint64_t> m_head;
+	// Written by the consumer, and by the producer when dropping
+	alignas(k_unCacheLineSize) std::atomic<uint64_t> m_tail;
+
+	// Statistics, written by the producer only
+	alignas(k_unCacheLineSize) std::atomic<unsigned long> m_pushed;
+	std::atomic<unsigned long> m_dropped;
+	std::atomic<unsigned long> m_blocked;
+	std::atomic<unsigned long> m_maxOccupancy;
+
+	RingOverflowPolicy m_policy;
+
+	// Lets an idle consumer sleep instead of spin
+	alignas(k_unCacheLineSize) std::atomic<bool> m_consumerWaiting;
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+
+	T m_records[Capacity];
+
+public:
+	SpscRing(RingOverflowPolicy policy = RingOverflow_DropOldest)
+		: m_head(0), m_tail(0), m_pushed(0), m_dropped(0), m_blocked(0), m_maxOccupancy(0)
+		, m_policy(policy), m_consumerWaiting(false) {}
+
+	void SetOverflowPolicy(RingOverflowPolicy policy) { m_policy = policy; }
+
+	// Producer side. Returns false only if the producer gave up waiting
+	// for room (RingOverflow_Block and abort set).
+	bool Push(const T &record, const std::atomic<bool> *abort = NULL) {
+		uint64_t head = m_head.load(std::memory_order_relaxed);
+		uint64_t tail = m_tail.load(std::memory_order_acquire);
+
+		if (head - tail >= Capacity) {
+			if (m_policy == RingOverflow_DropOldest) {
+				// Claim the oldest record; if the consumer got there first
+				// there is room now anyway
+				if (m_tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel))
+					m_dropped.fetch_add(1, std::memory_order_relaxed);
+			} else {
+				m_blocked.fetch_add(1, std::memory_order_relaxed);
+				while (head - m_tail.load(std::memory_order_acquire) >= Capacity) {
+					if (abort && abort->load(std::memory_order_relaxed))
+						return false;
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		memcpy(&m_records[head & (Capacity - 1)], &record, sizeof(T));
+		m_head.store(head + 1, std::memory_order_release);
+
+		m_pushed.fetch_add(1, std::memory_order_relaxed);
+		unsigned long occupancy = static_cast<unsigned long>(head + 1 - m_tail.load(std::memory_order_relaxed));
+		if (occupancy > m_maxOccupancy.load(std::memory_order_relaxed))
+			m_maxOccupancy.store(occupancy, std::memory_order_relaxed);
+
+		// The head store and the flag load, against the consumer's flag store
+		// and head load: with a full fence on each side at least one of
+		// the two threads sees the other's store, so a consumer about to
+		// sleep either finds the record or gets woken
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_consumerWaiting.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> lock(m_wakeMutex);
+			m_wake.notify_one();
+		}
+		return true;
+	}
+
+	// Consumer side. Copies the oldest record out, returns false if empty.
+	bool Pop(T &record) {
+		uint64_t tail = m_tail.load(std::memory_order_acquire);
+		for (;;) {
+			uint64_t head = m_head.load(std::memory_order_acquire);
+			if (tail == head)
+				return false;
+
+			memcpy(&record, &m_records[tail & (Capacity - 1)], sizeof(T));
+
+			// Fails if the producer dropped this record while we copied it,
+			// tail then holds the new oldest record
+			if (m_tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel))
+				return true;
+		}
+	}
+
+	// Consumer side. Waits up to timeout for a record to arrive.
+	bool WaitForData(std::chrono::microseconds timeout) {
+		if (Size() > 0)
+			return true;
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_consumerWaiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		bool ready = m_wake.wait_for(lock, timeout, [this] { return Size() > 0; });
+		m_consumerWaiting.store(false, std::memory_order_relaxed);
+		return ready;
+	}
+
+	std::size_t Size() const {
+		return static_cast<std::size_t>(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+	}
+
+	unsigned long Pushed() const { return m_pushed.load(std::memory_order_relaxed); }
+	unsigned long Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+	unsigned long Blocked() const { return m_blocked.load(std::memory_order_relaxed); }
+	unsigned long MaxOccupancy() const { return m_maxOccupancy.load(std::memory_order_relaxed); }
+};
+
+#endif // _SPSCRING_H_
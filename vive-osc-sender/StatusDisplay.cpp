@@ -0,0 +1,121 @@
+//
+// Console status table, redrawn at a fixed rate by its own thread
+//
+
+#include "stdafx.h"
+#include "StatusDisplay.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+StatusDisplay::StatusDisplay()
+	: m_ring(RingOverflow_DropOldest), m_stop(false), m_running(false) {
+}
+
+StatusDisplay::~StatusDisplay() {
+	Stop();
+}
+
+void StatusDisplay::Start(double refreshHz) {
+	if (m_running.load(std::memory_order_relaxed) || refreshHz <= 0)
+		return;
+	m_periodNs = static_cast<int64_t>(1e9 / refreshHz);
+
+#ifdef _WIN32
+	// The table is redrawn in place with VT cursor movement, which Windows
+	// 10 consoles only understand when asked to
+	HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+	DWORD mode = 0;
+	if (GetConsoleMode(console, &mode))
+		SetConsoleMode(console, mode | 0x0004 /* ENABLE_VIRTUAL_TERMINAL_PROCESSING */);
+#endif
+
+	m_stop = false;
+	m_running.store(true, std::memory_order_release);
+	m_thread = std::thread(&StatusDisplay::ThreadMain, this);
+}
+
+void StatusDisplay::Stop() {
+	if (!m_thread.joinable())
+		return;
+	m_stop = true;
+	m_thread.join();
+	m_running.store(false, std::memory_order_release);
+}
+
+void StatusDisplay::Publish(const TrackingFrame &frame, const FrameColumns &columns) {
+	StatusSnapshot &snapshot = m_snapshot;
+	snapshot.frameNumber = frame.frameNumber;
+	snapshot.captureTimeNs = frame.captureTimeNs;
+	snapshot.deviceCount = frame.deviceCount;
+	for (int n = 0; n < frame.deviceCount; n++) {
+		StatusDevice &device = snapshot.devices[n];
+		memcpy(device.oscAddress, frame.devices[n].oscAddress, sizeof(device.oscAddress));
+		device.isController = (frame.devices[n].deviceClass == DeviceClass_Controller);
+		for (int k = 0; k < 3; k++)
+			device.position[k] = columns.position[k][n];
+		for (int k = 0; k < 4; k++)
+			device.quaternion[k] = columns.quaternion[k][n];
+		device.trigger = columns.trigger[n];
+	}
+	m_ring.Push(snapshot);
+}
+
+void StatusDisplay::ThreadMain() {
+	while (!m_stop) {
+		if (!m_ring.WaitForData(std::chrono::milliseconds(50)))
+			continue;
+
+		// Only the latest one is worth drawing
+		bool popped = false;
+		while (m_ring.Pop(m_shown))
+			popped = true;
+		if (popped)
+			Draw(m_shown);
+	}
+}
+
+void StatusDisplay::Draw(const StatusSnapshot &snapshot) {
+	char line[256];
+	m_text.clear();
+
+	// Back to the top of the previous table
+	if (m_linesDrawn > 0) {
+		sprintf_s(line, sizeof(line), "\x1b[%dA", m_linesDrawn);
+		m_text += line;
+	}
+
+	double frameRate = 0;
+	if (m_lastCaptureTimeNs != 0 && snapshot.captureTimeNs > m_lastCaptureTimeNs)
+		frameRate = (snapshot.frameNumber - m_lastFrameNumber) * 1e9 / (snapshot.captureTimeNs - m_lastCaptureTimeNs);
+	m_lastFrameNumber = snapshot.frameNumber;
+	m_lastCaptureTimeNs = snapshot.captureTimeNs;
+
+	sprintf_s(line, sizeof(line), "frame %lu, %.0f frames/s, %d devices\x1b[K\n", snapshot.frameNumber, frameRate, snapshot.deviceCount);
+	m_text += line;
+	for (int n = 0; n < snapshot.deviceCount; n++) {
+		const StatusDevice &device = snapshot.devices[n];
+		sprintf_s(line, sizeof(line), "  %-16s (% .2f, % .2f, % .2f) q(% .2f, % .2f, % .2f, % .2f)",
+			device.oscAddress, device.position[0], device.position[1], device.position[2],
+			device.quaternion[0], device.quaternion[1], device.quaternion[2], device.quaternion[3]);
+		m_text += line;
+		if (device.isController) {
+			sprintf_s(line, sizeof(line), " trigger %.2f", device.trigger);
+			m_text += line;
+		}
+		m_text += "\x1b[K\n";
+	}
+
+	// Clear what is left of a longer previous table
+	int lines = snapshot.deviceCount + 1;
+	if (lines < m_linesDrawn)
+		m_text += "\x1b[J";
+	m_linesDrawn = lines;
+
+	fwrite(m_text.data(), 1, m_text.size(), stdout);
+	fflush(stdout);
+}
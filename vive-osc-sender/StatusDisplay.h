@@ -0,0 +1,82 @@
+// STATUSDISPLAY.h
+#ifndef _STATUSDISPLAY_H_
+#define _STATUSDISPLAY_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "ProfileEncoder.h"
+#include "SpscRing.h"
+
+// One device row of the status table
+struct StatusDevice {
+	char oscAddress[k_unMaxOscAddressSize];
+	bool isController;
+	float position[3];
+	float quaternion[4];
+	float trigger;
+};
+
+// What the status table shows of a frame
+struct StatusSnapshot {
+	unsigned long frameNumber;
+	int64_t captureTimeNs;
+	int deviceCount;
+	StatusDevice devices[k_unMaxDeviceCount];
+};
+
+//
+// Console status, drawn by its own thread.
+//
+// Formatting floats and writing them to a console every frame can cost
+// more than the rest of the frame, on Windows consoles especially. The
+// frame loop only offers the display a frame; once per refresh interval
+// (by capture time, no clock read) that frame is copied into a small ring
+// and the display thread redraws the table in place from it. All other
+// frames cost one comparison.
+//
+class StatusDisplay {
+private:
+	int64_t m_periodNs = 100000000;
+	int64_t m_nextSnapshotNs = 0;
+	StatusSnapshot m_snapshot;		// filled by the frame loop
+
+	SpscRing<StatusSnapshot, 4> m_ring;
+	StatusSnapshot m_shown;			// owned by the display thread
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+	// Set by Start() once m_periodNs is, on whichever thread starts the
+	// display; Offer() reads both on the frame loop's thread
+	std::atomic<bool> m_running;
+
+	std::string m_text;
+	int m_linesDrawn = 0;
+	unsigned long m_lastFrameNumber = 0;
+	int64_t m_lastCaptureTimeNs = 0;
+
+	void ThreadMain();
+	void Draw(const StatusSnapshot &snapshot);
+
+public:
+	StatusDisplay();
+	~StatusDisplay();
+
+	// Redraw refreshHz times a second from its own thread
+	void Start(double refreshHz);
+	void Stop();
+	bool IsRunning() const { return m_running.load(std::memory_order_acquire); }
+
+	// Called by the frame loop for every frame, keeps one per refresh
+	// interval. The columns are those the frame's devices were encoded from.
+	void Offer(const TrackingFrame &frame, const FrameColumns &columns) {
+		if (!m_running.load(std::memory_order_acquire) || frame.captureTimeNs < m_nextSnapshotNs)
+			return;
+		m_nextSnapshotNs = frame.captureTimeNs + m_periodNs;
+		Publish(frame, columns);
+	}
+	void Publish(const TrackingFrame &frame, const FrameColumns &columns);
+};
+
+#endif // _STATUSDISPLAY_H_
@@ -0,0 +1,240 @@
+//
+// Synthetic backend for the pose source, generates deterministic motion
+// for N devices so the sender can be profiled without SteamVR
+//
+
+#include "stdafx.h"
+#include "SyntheticPoseSource.h"
+
+#include <chrono>
+#include <math.h>
+#include <string.h>
+
+static const double k_dPi = 3.14159265358979323846;
+
+static double SteadyNow() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SyntheticPoseSource::SyntheticPoseSource(const SyntheticConfig &config)
+	: m_config(config), m_startTime(SteadyNow()) {
+
+	for (DeviceIndex i = 0; i < k_unMaxDeviceCount; i++) {
+		m_deviceClass[i] = DeviceClass_Invalid;
+		m_deviceRole[i] = ControllerRole_Invalid;
+		m_deviceConnected[i] = false;
+		m_deviceOrdinal[i] = 0;
+	}
+
+	// Lay the devices out like the runtime does, clipping at the slot count
+	DeviceIndex slot = 0;
+	struct { DeviceClass deviceClass; int count; } layout[] = {
+		{ DeviceClass_HMD, m_config.includeHmd ? 1 : 0 },
+		{ DeviceClass_TrackingReference, m_config.baseStationCount },
+		{ DeviceClass_Controller, m_config.controllerCount },
+		{ DeviceClass_GenericTracker, m_config.trackerCount },
+	};
+	for (auto &group : layout) {
+		for (int n = 0; n < group.count && slot < k_unMaxDeviceCount; n++, slot++) {
+			m_deviceClass[slot] = group.deviceClass;
+			m_deviceConnected[slot] = true;
+			m_deviceOrdinal[slot] = n;
+			if (group.deviceClass == DeviceClass_Controller)
+				m_deviceRole[slot] = (n == 0) ? ControllerRole_LeftHand : (n == 1) ? ControllerRole_RightHand : ControllerRole_Invalid;
+		}
+	}
+}
+
+void SyntheticPoseSource::SetTime(double seconds) {
+	m_manualClock = true;
+	m_manualTime = seconds;
+}
+
+void SyntheticPoseSource::SetDeviceConnected(DeviceIndex device, bool connected) {
+	if (device >= k_unMaxDeviceCount || m_deviceClass[device] == DeviceClass_Invalid || m_deviceConnected[device] == connected)
+		return;
+	m_deviceConnected[device] = connected;
+	PushEvent(connected ? DeviceEvent_Activated : DeviceEvent_Deactivated, device);
+}
+
+void SyntheticPoseSource::SetControllerRole(DeviceIndex device, ControllerRole role) {
+	if (device >= k_unMaxDeviceCount || m_deviceClass[device] != DeviceClass_Controller)
+		return;
+	m_deviceRole[device] = role;
+	PushEvent(DeviceEvent_RoleChanged, device);
+}
+
+void SyntheticPoseSource::RequestQuit() {
+	PushEvent(DeviceEvent_Quit, 0);
+}
+
+int SyntheticPoseSource::DeviceCount() const {
+	int count = 0;
+	for (DeviceIndex i = 0; i < k_unMaxDeviceCount; i++)
+		if (m_deviceConnected[i]) count++;
+	return count;
+}
+
+void SyntheticPoseSource::PushEvent(DeviceEventType type, DeviceIndex device) {
+	if (m_eventCount == k_unEventQueueSize)
+		return; // the runtime drops events too if nobody polls
+	DeviceEvent &event = m_events[(m_eventHead + m_eventCount) % k_unEventQueueSize];
+	event.eventType = type;
+	event.trackedDeviceIndex = device;
+	m_eventCount++;
+}
+
+// Current time quantised to the simulated runtime sample rate
+double SyntheticPoseSource::SampleTime() {
+	double t = m_manualClock ? m_manualTime : SteadyNow() - m_startTime;
+	if (m_config.sampleRate > 0)
+		t = floor(t * m_config.sampleRate) / m_config.sampleRate;
+	return t;
+}
+
+bool SyntheticPoseSource::IsDeviceConnected(DeviceIndex device) {
+	return device < k_unMaxDeviceCount && m_deviceConnected[device];
+}
+
+DeviceClass SyntheticPoseSource::GetDeviceClass(DeviceIndex device) {
+	return device < k_unMaxDeviceCount ? m_deviceClass[device] : DeviceClass_Invalid;
+}
+
+ControllerRole SyntheticPoseSource::GetControllerRole(DeviceIndex device) {
+	return device < k_unMaxDeviceCount ? m_deviceRole[device] : ControllerRole_Invalid;
+}
+
+bool SyntheticPoseSource::GetDeviceString(DeviceIndex device, DeviceString prop, char *buf, uint32_t bufSize) {
+	if (!IsDeviceConnected(device) || bufSize == 0)
+		return false;
+
+	const char *model = "Synthetic Device";
+	char classLetter = 'X';
+	switch (m_deviceClass[device]) {
+	case DeviceClass_HMD: model = "Synthetic HMD"; classLetter = 'H'; break;
+	case DeviceClass_Controller: model = "Synthetic Controller"; classLetter = 'C'; break;
+	case DeviceClass_GenericTracker: model = "Synthetic Tracker"; classLetter = 'T'; break;
+	case DeviceClass_TrackingReference: model = "Synthetic Base Station"; classLetter = 'B'; break;
+	default: break;
+	}
+
+	switch (prop) {
+	case DeviceString_ManufacturerName: snprintf(buf, bufSize, "Synthetic"); break;
+	case DeviceString_ModelNumber: snprintf(buf, bufSize, "%s", model); break;
+	case DeviceString_SerialNumber: snprintf(buf, bufSize, "SYN-%c-%03d", classLetter, m_deviceOrdinal[device]); break;
+	}
+	return true;
+}
+
+const char *SyntheticPoseSource::GetControllerAxisTypeName(DeviceIndex device, int axis) {
+	if (GetDeviceClass(device) != DeviceClass_Controller)
+		return NULL;
+	switch (axis) {
+	case 0: return "k_eControllerAxis_TrackPad";
+	case 1: return "k_eControllerAxis_Trigger";
+	}
+	return NULL;
+}
+
+bool SyntheticPoseSource::GetDevicePose(DeviceIndex device, DevicePose *pose, ControllerState *controllerState) {
+	if (!IsDeviceConnected(device))
+		return false;
+
+	DeviceClass deviceClass = m_deviceClass[device];
+	double t = SampleTime();
+	bool still = m_config.motion == SyntheticMotion_Static
+		|| deviceClass == DeviceClass_TrackingReference
+		|| (deviceClass == DeviceClass_GenericTracker && m_deviceOrdinal[device] < m_config.staticTrackerCount);
+	double w = still ? 0 : m_config.angularSpeed;
+	double tm = still ? 0 : t;
+
+	// Spread devices evenly around the circle
+	double a = 2 * k_dPi * device / k_unMaxDeviceCount + w * tm;
+	double r = m_config.radius;
+
+	double px, py, pz, vx, vy, vz;
+	if (deviceClass == DeviceClass_TrackingReference) {
+		// Base stations sit high up in opposite corners
+		px = (m_deviceOrdinal[device] % 2) ? -2.0 : 2.0;
+		py = 2.5;
+		pz = (m_deviceOrdinal[device] % 2) ? -2.0 : 2.0;
+		vx = vy = vz = 0;
+	} else {
+		px = r * cos(a);
+		py = 1.0 + 0.1 * sin(2 * a);
+		pz = r * sin(a);
+		vx = -w * r * sin(a);
+		vy = 0.2 * w * cos(2 * a);
+		vz = w * r * cos(a);
+	}
+
+	// Orientation: yaw to face along the path, with a little pitch wobble.
+	// R = Ry(yaw) * Rx(pitch)
+	double yaw = -a;
+	double pitch = 0.2 * sin(a);
+	double cy = cos(yaw), sy = sin(yaw), cp = cos(pitch), sp = sin(pitch);
+	double R[3][3] = {
+		{ cy,  sy * sp, sy * cp },
+		{ 0,   cp,      -sp },
+		{ -sy, cy * sp, cy * cp },
+	};
+
+	for (int row = 0; row < 3; row++)
+		for (int col = 0; col < 3; col++)
+			pose->mDeviceToAbsoluteTracking.m[row][col] = static_cast<float>(R[row][col]);
+	pose->mDeviceToAbsoluteTracking.m[0][3] = static_cast<float>(px);
+	pose->mDeviceToAbsoluteTracking.m[1][3] = static_cast<float>(py);
+	pose->mDeviceToAbsoluteTracking.m[2][3] = static_cast<float>(pz);
+
+	pose->vVelocity.v[0] = static_cast<float>(vx);
+	pose->vVelocity.v[1] = static_cast<float>(vy);
+	pose->vVelocity.v[2] = static_cast<float>(vz);
+
+	// World angular velocity: yaw rate about +y plus the pitch rate about
+	// the yawed x axis
+	double pitchRate = 0.2 * cos(a) * w;
+	pose->vAngularVelocity.v[0] = static_cast<float>(cy * pitchRate);
+	pose->vAngularVelocity.v[1] = static_cast<float>(-w);
+	pose->vAngularVelocity.v[2] = static_cast<float>(-sy * pitchRate);
+
+	pose->bPoseIsValid = true;
+	pose->bTrackingOK = true;
+
+	if (controllerState)
+		FillControllerState(device, t, controllerState);
+	return true;
+}
+
+void SyntheticPoseSource::FillControllerState(DeviceIndex device, double t, ControllerState *controllerState) {
+	memset(controllerState, 0, sizeof(*controllerState));
+	if (m_deviceClass[device] == DeviceClass_Controller) {
+		controllerState->unPacketNum = static_cast<uint32_t>(t * m_config.sampleRate);
+		controllerState->rAxis[0].x = static_cast<float>(cos(t));
+		controllerState->rAxis[0].y = static_cast<float>(sin(t));
+		controllerState->rAxis[1].x = static_cast<float>(0.5 + 0.5 * sin(2 * t + device));
+	}
+}
+
+void SyntheticPoseSource::GetDevicePoses(DevicePose *poses, uint32_t count) {
+	for (DeviceIndex i = 0; i < count && i < k_unMaxDeviceCount; i++) {
+		if (!GetDevicePose(i, &poses[i], NULL)) {
+			memset(&poses[i], 0, sizeof(poses[i]));
+		}
+	}
+}
+
+bool SyntheticPoseSource::GetControllerState(DeviceIndex device, ControllerState *controllerState) {
+	if (!IsDeviceConnected(device) || m_deviceClass[device] != DeviceClass_Controller)
+		return false;
+	FillControllerState(device, SampleTime(), controllerState);
+	return true;
+}
+
+bool SyntheticPoseSource::PollNextEvent(DeviceEvent *event) {
+	if (m_eventCount == 0)
+		return false;
+	*event = m_events[m_eventHead];
+	m_eventHead = (m_eventHead + 1) % k_unEventQueueSize;
+	m_eventCount--;
+	return true;
+}
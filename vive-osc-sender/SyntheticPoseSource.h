@@ -0,0 +1,85 @@
+// SYNTHETICPOSESOURCE.h
+#ifndef _SYNTHETICPOSESOURCE_H_
+#define _SYNTHETICPOSESOURCE_H_
+
+#include "PoseSource.h"
+
+enum SyntheticMotion {
+	SyntheticMotion_Static,		// every device holds its start pose
+	SyntheticMotion_Orbit		// devices circle the origin while yawing and bobbing
+};
+
+struct SyntheticConfig {
+	int controllerCount = 2;
+	int trackerCount = 4;
+	int baseStationCount = 2;
+	bool includeHmd = true;
+
+	SyntheticMotion motion = SyntheticMotion_Orbit;
+	double radius = 1.0;			// metres
+	double angularSpeed = 1.0;		// radians per second
+	int staticTrackerCount = 0;		// the first N trackers never move, like props on a stand
+
+	// Rate the simulated runtime produces new samples at. Between samples the
+	// same pose is returned, like the real runtime does when polled too fast.
+	double sampleRate = 250.0;
+};
+
+//
+// Deterministic PoseSource for headless profiling and load tests. The pose
+// of every device is a pure function of its slot and the sample time, so
+// two runs with the same config and clock produce identical streams.
+//
+// Slots are laid out like the real runtime does it: the HMD at index 0,
+// then base stations, then controllers, then trackers.
+//
+class SyntheticPoseSource : public PoseSource {
+private:
+	static const int k_unEventQueueSize = 2 * k_unMaxDeviceCount;
+
+	SyntheticConfig m_config;
+	DeviceClass m_deviceClass[k_unMaxDeviceCount];
+	ControllerRole m_deviceRole[k_unMaxDeviceCount];
+	bool m_deviceConnected[k_unMaxDeviceCount];
+	int m_deviceOrdinal[k_unMaxDeviceCount];	// n-th device of its class
+
+	// Clock, either free running from construction or set explicitly
+	bool m_manualClock = false;
+	double m_manualTime = 0;
+	double m_startTime;
+
+	// Small fixed event queue so polling never allocates
+	DeviceEvent m_events[k_unEventQueueSize];
+	int m_eventHead = 0;
+	int m_eventCount = 0;
+
+	void PushEvent(DeviceEventType type, DeviceIndex device);
+	double SampleTime();
+	void FillControllerState(DeviceIndex device, double t, ControllerState *controllerState);
+
+public:
+	SyntheticPoseSource(const SyntheticConfig &config);
+
+	// Freeze the clock at the given time (seconds), subsequent poses are
+	// computed for that time only. Used by tests and benchmarks.
+	void SetTime(double seconds);
+
+	// Simulate devices coming and going, or the runtime shutting down
+	void SetDeviceConnected(DeviceIndex device, bool connected);
+	void SetControllerRole(DeviceIndex device, ControllerRole role);
+	void RequestQuit();
+
+	int DeviceCount() const;
+
+	bool IsDeviceConnected(DeviceIndex device);
+	DeviceClass GetDeviceClass(DeviceIndex device);
+	ControllerRole GetControllerRole(DeviceIndex device);
+	bool GetDeviceString(DeviceIndex device, DeviceString prop, char *buf, uint32_t bufSize);
+	const char *GetControllerAxisTypeName(DeviceIndex device, int axis);
+	bool GetDevicePose(DeviceIndex device, DevicePose *pose, ControllerState *controllerState);
+	void GetDevicePoses(DevicePose *poses, uint32_t count);
+	bool GetControllerState(DeviceIndex device, ControllerState *controllerState);
+	bool PollNextEvent(DeviceEvent *event);
+};
+
+#endif // _SYNTHETICPOSESOURCE_H_
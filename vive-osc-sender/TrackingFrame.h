@@ -0,0 +1,35 @@
+// TRACKINGFRAME.h
+#ifndef _TRACKINGFRAME_H_
+#define _TRACKINGFRAME_H_
+
+#include "PoseSource.h"
+#include "DeviceRegistry.h"
+#include "osc/OscTypes.h"
+
+// One device that is to be sent in a frame
+struct TrackedDeviceSample {
+	DeviceIndex unDevice;
+	DeviceClass deviceClass;	// DeviceClass_Controller or DeviceClass_GenericTracker
+	int ordinal;				// n-th device of its class, as in its address
+	unsigned int profiles;		// bit n set if output profile n takes the device
+	float trigger;				// controllers only
+	float axes[2];				// trackpad, controllers only
+	char oscAddress[k_unMaxOscAddressSize];
+	DevicePose pose;
+};
+
+//
+// Everything the transmit side needs to encode and send one frame, captured
+// by the acquisition side. Fixed size, so it can be copied through a ring
+// without allocating.
+//
+struct TrackingFrame {
+	osc::uint64 timeTag;
+	int64_t captureTimeNs;				// MonotonicNanoseconds() when the poses were read
+	unsigned long frameNumber;
+	unsigned int templateGeneration;	// bumped whenever device addresses may have changed
+	int deviceCount;
+	TrackedDeviceSample devices[k_unMaxDeviceCount];
+};
+
+#endif // _TRACKINGFRAME_H_
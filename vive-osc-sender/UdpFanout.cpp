@@ -0,0 +1,123 @@
+//
+// Sends every packet of a frame to all destinations with one batched send
+//
+
+#include "stdafx.h"
+#include "UdpFanout.h"
+#include "RealtimeSetup.h"
+
+#include <string.h>
+
+UdpFanout::UdpFanout()
+	: m_arena(k_unFanoutArenaSize),
+	m_packets(k_unFanoutMaxPackets),
+	m_packetDestinations(k_unFanoutMaxPackets) {
+}
+
+std::size_t UdpFanout::Prefault() {
+	return PrefaultMemory(&m_arena[0], m_arena.size())
+		+ PrefaultMemory(&m_packets[0], m_packets.size() * sizeof(UdpPacket))
+		+ PrefaultMemory(&m_packetDestinations[0], m_packetDestinations.size() * sizeof(int));
+}
+
+int UdpFanout::AddDestination(const IpEndpointName &endpoint) {
+	Destination destination;
+	destination.endpoint = endpoint;
+	endpoint.AddressAndPortAsString(destination.name);
+	destination.packetsSent = 0;
+	destination.bytesSent = 0;
+	destination.errors = 0;
+	destination.lastError = 0;
+	m_destinations.push_back(destination);
+	return static_cast<int>(m_destinations.size()) - 1;
+}
+
+// Room for size bytes and packetCount packets, flushing first if the
+// frame doesn't fit anymore. NULL if the datagram can't be sent at all.
+char *UdpFanout::CopyToArena(const char *data, std::size_t size, std::size_t packetCount) {
+	if (size > m_arena.size() || packetCount > m_packets.size())
+		return NULL;
+
+	if (m_packetCount + packetCount > m_packets.size() || m_arenaUsed + size > m_arena.size())
+		Flush();
+
+	char *copy = &m_arena[m_arenaUsed];
+	memcpy(copy, data, size);
+	m_arenaUsed += size;
+	return copy;
+}
+
+void UdpFanout::AddPacket(int destination, const char *copy, std::size_t size) {
+	UdpPacket &packet = m_packets[m_packetCount];
+	packet.remoteEndpoint = m_destinations[destination].endpoint;
+	packet.data = copy;
+	packet.size = size;
+	packet.error = 0;
+	m_packetDestinations[m_packetCount] = destination;
+	m_packetCount++;
+}
+
+void UdpFanout::Queue(int destination, const char *data, std::size_t size) {
+	Queue(&destination, 1, data, size);
+}
+
+void UdpFanout::Queue(const int *destinations, std::size_t count, const char *data, std::size_t size) {
+	char *copy = CopyToArena(data, size, count);
+	if (!copy)
+		return;
+	for (std::size_t n = 0; n < count; n++)
+		AddPacket(destinations[n], copy, size);
+}
+
+void UdpFanout::QueueToAll(const char *data, std::size_t size) {
+	char *copy = CopyToArena(data, size, m_destinations.size());
+	if (!copy)
+		return;
+	for (std::size_t n = 0; n < m_destinations.size(); n++)
+		AddPacket(static_cast<int>(n), copy, size);
+}
+
+void UdpFanout::Flush() {
+	if (m_packetCount == 0)
+		return;
+
+	m_socket.SendToMultiple(&m_packets[0], m_packetCount);
+	m_sendCalls++;
+
+	for (std::size_t n = 0; n < m_packetCount; n++) {
+		Destination &destination = m_destinations[m_packetDestinations[n]];
+		if (m_packets[n].error == 0) {
+			destination.packetsSent++;
+			destination.bytesSent += static_cast<unsigned long>(m_packets[n].size);
+			destination.lastError = 0;
+		} else {
+			ReportError(destination, m_packets[n].error);
+		}
+	}
+
+	m_packetCount = 0;
+	m_arenaUsed = 0;
+}
+
+// Only a new kind of failure is printed, a destination that keeps failing
+// the same way would otherwise flood the console at the frame rate
+void UdpFanout::ReportError(Destination &destination, int error) {
+	destination.errors++;
+	if (m_reportErrors && error != destination.lastError) {
+		char text[256];
+		printf_s("\nSending to %s failed: error %d (%s)\n", destination.name, error, SystemErrorText(error, text, sizeof(text)));
+	}
+	destination.lastError = error;
+}
+
+void UdpFanout::PrintStatistics() const {
+	for (const Destination &destination : m_destinations) {
+		printf_s("%s: %lu packets, %lu bytes sent, %lu send errors",
+			destination.name, destination.packetsSent, destination.bytesSent, destination.errors);
+		char text[256];
+		if (destination.lastError != 0)
+			printf_s(" (last: %s)", SystemErrorText(destination.lastError, text, sizeof(text)));
+		printf_s("\n");
+	}
+	printf_s("%lu batched sends\n", m_sendCalls);
+}
@@ -0,0 +1,89 @@
+// UDPFANOUT.h
+#ifndef _UDPFANOUT_H_
+#define _UDPFANOUT_H_
+
+#include <cstring> // size_t
+#include <vector>
+
+#include "ip/UdpSocket.h"
+
+// Largest payload a single UDP datagram can carry
+static const std::size_t k_unMaxUdpPacketSize = 65507;
+
+// Bytes and datagrams that can be queued before a flush is forced
+static const std::size_t k_unFanoutArenaSize = 256 * 1024;
+static const std::size_t k_unFanoutMaxPackets = 1024;
+
+//
+// Sends the packets of a frame to every destination from one socket.
+//
+// Packets are queued (copied into an arena allocated up front) while the
+// frame is encoded and go out together in Flush(), as a single
+// UdpSocket::SendToMultiple() call, i.e. one sendmmsg() on Linux, however
+// many packets and destinations there are.
+//
+// Send errors are counted per destination; a destination that fails, or
+// starts failing with a different error, is reported as it happens unless
+// error reporting is off, e.g. without a console.
+//
+class UdpFanout {
+private:
+	struct Destination {
+		IpEndpointName endpoint;
+		char name[IpEndpointName::ADDRESS_AND_PORT_STRING_LENGTH];
+
+		// Statistics
+		unsigned long packetsSent;
+		unsigned long bytesSent;
+		unsigned long errors;
+		int lastError;
+	};
+
+	UdpSocket m_socket;
+	std::vector<Destination> m_destinations;
+
+	std::vector<char> m_arena;
+	std::size_t m_arenaUsed = 0;
+	std::vector<UdpPacket> m_packets;
+	std::vector<int> m_packetDestinations;	// destination index of each queued packet
+	std::size_t m_packetCount = 0;
+
+	unsigned long m_sendCalls = 0;
+	bool m_reportErrors = true;
+
+	char *CopyToArena(const char *data, std::size_t size, std::size_t packetCount);
+	void AddPacket(int destination, const char *copy, std::size_t size);
+	void ReportError(Destination &destination, int error);
+
+public:
+	UdpFanout();
+
+	// Returns the new destination's index
+	int AddDestination(const IpEndpointName &endpoint);
+	int DestinationCount() const { return static_cast<int>(m_destinations.size()); }
+	const char *DestinationName(int destination) const { return m_destinations[destination].name; }
+
+	// Queue a datagram for one destination, some or all of them. The data
+	// is copied once, however many destinations it goes to.
+	void Queue(int destination, const char *data, std::size_t size);
+	void Queue(const int *destinations, std::size_t count, const char *data, std::size_t size);
+	void QueueToAll(const char *data, std::size_t size);
+
+	// Print new send errors as they happen (the default), or only count them
+	void SetErrorReporting(bool enabled) { m_reportErrors = enabled; }
+
+	// Send everything queued in one batch
+	void Flush();
+
+	// Fault in the arena and packet lists, returns the bytes touched
+	std::size_t Prefault();
+
+	unsigned long SendCalls() const { return m_sendCalls; }
+	unsigned long Errors(int destination) const { return m_destinations[destination].errors; }
+	unsigned long PacketsSent(int destination) const { return m_destinations[destination].packetsSent; }
+
+	// Per destination packet, byte and error counts
+	void PrintStatistics() const;
+};
+
+#endif // _UDPFANOUT_H_
@@ -0,0 +1,83 @@
+//
+// What the flight recorder adds per packet: recording one against copying
+// it with memcpy, and sending on a socket with and without the recorder
+//
+
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MonotonicClock.h"
+#include "ip/PacketFlightRecorder.h"
+#include "ip/UdpSocket.h"
+
+static const int k_nBenchPort = 17398;
+
+static volatile std::size_t sink_;
+
+static double Report(std::size_t size, const char *name, int64_t start, int packets, double baselineNs) {
+	double ns = static_cast<double>(MonotonicNanoseconds() - start) / packets;
+	if (baselineNs > 0)
+		printf_s("%5u bytes  %-22s %8.1f ns/packet  (%.2fx memcpy)\n", static_cast<unsigned int>(size), name, ns, ns / baselineNs);
+	else
+		printf_s("%5u bytes  %-22s %8.1f ns/packet\n", static_cast<unsigned int>(size), name, ns);
+	return ns;
+}
+
+static void Run(std::size_t size, int packets) {
+	static char packet[2048];
+	for (std::size_t n = 0; n < size; n++)
+		packet[n] = static_cast<char>(n);
+	IpEndpointName destination("127.0.0.1", k_nBenchPort);
+
+	// Baseline: copying the packet into a ring of the same size, no header
+	const std::size_t k_unRingSize = 16 << 20;
+	char *ring = new char[k_unRingSize];
+	memset(ring, 0, k_unRingSize);
+	std::size_t offset = 0;
+	int64_t start = MonotonicNanoseconds();
+	for (int n = 0; n < packets; n++) {
+		if (offset + size > k_unRingSize)
+			offset = 0;
+		memcpy(ring + offset, packet, size);
+		offset += size;
+		sink_ = offset;
+	}
+	double memcpyNs = Report(size, "memcpy", start, packets, 0);
+	delete[] ring;
+
+	PacketFlightRecorder recorder;
+	recorder.Start(k_unRingSize, 10);
+	start = MonotonicNanoseconds();
+	for (int n = 0; n < packets; n++)
+		recorder.Record(destination, packet, size, PacketFlightRecorder::Now());
+	Report(size, "Record", start, packets, memcpyNs);
+
+	// The socket path, where the clock read and the check for a recorder
+	// are included too
+	UdpTransmitSocket socket(destination);
+	int sends = packets / 10;
+	start = MonotonicNanoseconds();
+	for (int n = 0; n < sends; n++)
+		socket.Send(packet, size);
+	Report(size, "Send, recording", start, sends, memcpyNs);
+
+	recorder.Stop();
+	start = MonotonicNanoseconds();
+	for (int n = 0; n < sends; n++)
+		socket.Send(packet, size);
+	Report(size, "Send", start, sends, memcpyNs);
+	printf_s("\n");
+}
+
+int main(int argc, char* argv[])
+{
+	// FlightRecorderBench [packets per size]
+	int packets = (argc > 1) ? atoi(argv[1]) : 1000000;
+
+	const std::size_t sizes[] = { 60, 512, 1400 };
+	for (std::size_t size : sizes)
+		Run(size, packets);
+	return 0;
+}
@@ -0,0 +1,85 @@
+//
+// Cost of the acquisition side of the frame loop, what LighthouseTracking
+// does per frame around the runtime calls, against a source whose calls
+// cost next to nothing. All devices sent, or only the trackers.
+//
+
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "LighthouseTracking.h"
+#include "SyntheticPoseSource.h"
+#include "MonotonicClock.h"
+
+// The synthetic devices, with their poses computed once
+class CannedPoseSource : public PoseSource {
+private:
+	SyntheticPoseSource m_inner;
+	DevicePose m_poses[k_unMaxDeviceCount];
+	ControllerState m_states[k_unMaxDeviceCount];
+
+public:
+	CannedPoseSource(const SyntheticConfig &config) : m_inner(config) {
+		memset(m_states, 0, sizeof(m_states));
+		for (DeviceIndex i = 0; i < k_unMaxDeviceCount; i++)
+			if (!m_inner.GetDevicePose(i, &m_poses[i], &m_states[i]))
+				memset(&m_poses[i], 0, sizeof(m_poses[i]));
+	}
+
+	bool IsDeviceConnected(DeviceIndex device) { return m_inner.IsDeviceConnected(device); }
+	DeviceClass GetDeviceClass(DeviceIndex device) { return m_inner.GetDeviceClass(device); }
+	ControllerRole GetControllerRole(DeviceIndex device) { return m_inner.GetControllerRole(device); }
+	bool GetDeviceString(DeviceIndex device, DeviceString prop, char *buf, uint32_t bufSize) { return m_inner.GetDeviceString(device, prop, buf, bufSize); }
+	const char *GetControllerAxisTypeName(DeviceIndex device, int axis) { return m_inner.GetControllerAxisTypeName(device, axis); }
+
+	bool GetDevicePose(DeviceIndex device, DevicePose *pose, ControllerState *controllerState) {
+		*pose = m_poses[device];
+		if (controllerState)
+			*controllerState = m_states[device];
+		return true;
+	}
+	void GetDevicePoses(DevicePose *poses, uint32_t count) { memcpy(poses, m_poses, count * sizeof(DevicePose)); }
+	bool GetControllerState(DeviceIndex device, ControllerState *controllerState) { *controllerState = m_states[device]; return true; }
+
+	bool PollNextEvent(DeviceEvent *event) { return m_inner.PollNextEvent(event); }
+};
+
+static void Run(int trackers, bool batch, bool trackersOnly, int frames) {
+	SyntheticConfig config;
+	config.trackerCount = trackers;
+	config.controllerCount = 2;
+	CannedPoseSource source(config);
+	OutputProfile profile;
+	if (trackersOnly)
+		profile.devices = ProfileDevices_Trackers;
+	LighthouseTracking tracking(&source, IpEndpointName("127.0.0.1", 17399), profile);
+	tracking.SetBatchPoseFetch(batch);
+
+	TrackingFrame *frame = new TrackingFrame;
+	tracking.AcquireFrame(*frame);
+	int64_t start = MonotonicNanoseconds();
+	for (int i = 0; i < frames; i++)
+		tracking.AcquireFrame(*frame);
+	int64_t elapsed = MonotonicNanoseconds() - start;
+
+	printf_s("%8d  %-10s %-13s %8d %12.0f\n", trackers, batch ? "batch" : "per-device",
+		trackersOnly ? "trackers" : "all", frame->deviceCount, static_cast<double>(elapsed) / frames);
+	delete frame;
+}
+
+int main(int argc, char* argv[])
+{
+	// FrameLoopBench [frames]
+	int frames = (argc > 1) ? atoi(argv[1]) : 200000;
+
+	printf_s("%8s  %-10s %-13s %8s %12s\n", "trackers", "fetch", "sent", "devices", "ns/frame");
+	const int trackerCounts[] = { 4, 16, 58 };
+	for (int trackers : trackerCounts) {
+		Run(trackers, false, false, frames);
+		Run(trackers, true, false, frames);
+		Run(trackers, true, true, frames);
+	}
+	return 0;
+}
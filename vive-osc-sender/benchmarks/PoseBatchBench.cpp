@@ -0,0 +1,90 @@
+//
+// Matrix to quaternion throughput: the old per device double precision
+// conversion against the batch kernels, at 64 and 1024 devices
+//
+
+#include "stdafx.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "PoseBatch.h"
+#include "MonotonicClock.h"
+
+// What LighthouseTracking::GetRotation did, matrix by value included
+static PoseQuaternion PerDeviceRotation(PoseMatrix34 matrix) {
+	PoseQuaternion q;
+	q.w = sqrt(fmax(0, 1 + matrix.m[0][0] + matrix.m[1][1] + matrix.m[2][2])) / 2;
+	q.x = sqrt(fmax(0, 1 + matrix.m[0][0] - matrix.m[1][1] - matrix.m[2][2])) / 2;
+	q.y = sqrt(fmax(0, 1 - matrix.m[0][0] + matrix.m[1][1] - matrix.m[2][2])) / 2;
+	q.z = sqrt(fmax(0, 1 - matrix.m[0][0] - matrix.m[1][1] + matrix.m[2][2])) / 2;
+	q.x = copysign(q.x, matrix.m[2][1] - matrix.m[1][2]);
+	q.y = copysign(q.y, matrix.m[0][2] - matrix.m[2][0]);
+	q.z = copysign(q.z, matrix.m[1][0] - matrix.m[0][1]);
+	return q;
+}
+
+static PoseMatrix34 YawMatrix(double a) {
+	PoseMatrix34 m = { { { 0 } } };
+	m.m[0][0] = static_cast<float>(cos(a)); m.m[0][2] = static_cast<float>(sin(a));
+	m.m[1][1] = 1;
+	m.m[2][0] = static_cast<float>(-sin(a)); m.m[2][2] = static_cast<float>(cos(a));
+	m.m[0][3] = static_cast<float>(a);
+	return m;
+}
+
+static volatile float sink_;
+
+static void Run(std::size_t devices, int iterations) {
+	PoseMatrix34 *matrices = new PoseMatrix34[devices];
+	float *out = new float[devices * 7];
+	PoseBatch batch(devices);
+	for (std::size_t n = 0; n < devices; n++) {
+		matrices[n] = YawMatrix(0.01 * n);
+		batch.Add(matrices[n]);
+	}
+
+	// Baseline: per device, narrowed to float like the OSC message does
+	int64_t start = MonotonicNanoseconds();
+	for (int it = 0; it < iterations; it++) {
+		for (std::size_t n = 0; n < devices; n++) {
+			PoseQuaternion q = PerDeviceRotation(matrices[n]);
+			float *o = out + n * 7;
+			o[0] = matrices[n].m[0][3]; o[1] = matrices[n].m[1][3]; o[2] = matrices[n].m[2][3];
+			o[3] = static_cast<float>(q.w); o[4] = static_cast<float>(q.x); o[5] = static_cast<float>(q.y); o[6] = static_cast<float>(q.z);
+		}
+		sink_ = out[3];
+	}
+	double baselineNs = static_cast<double>(MonotonicNanoseconds() - start) / iterations / devices;
+	printf_s("%6lu  %-22s %8.2f ns/device %8.1f Mdevices/s\n", static_cast<unsigned long>(devices), "per-device double", baselineNs, 1e3 / baselineNs);
+
+	const PoseKernel kernels[] = { PoseKernel_Scalar, PoseKernel_SSE, PoseKernel_AVX2 };
+	for (PoseKernel kernel : kernels) {
+		if (!PoseKernelSupported(kernel))
+			continue;
+		start = MonotonicNanoseconds();
+		for (int it = 0; it < iterations; it++) {
+			ConvertPoses(batch, kernel);
+			sink_ = batch.QuaternionW()[0];
+		}
+		double ns = static_cast<double>(MonotonicNanoseconds() - start) / iterations / devices;
+		char name[32];
+		sprintf_s(name, sizeof(name), "batch %s", PoseKernelName(kernel));
+		printf_s("%6lu  %-22s %8.2f ns/device %8.1f Mdevices/s  (%.1fx)\n", static_cast<unsigned long>(devices), name, ns, 1e3 / ns, baselineNs / ns);
+	}
+
+	delete[] matrices;
+	delete[] out;
+}
+
+int main(int argc, char* argv[])
+{
+	// PoseBatchBench [conversions per size, in devices]
+	long conversions = (argc > 1) ? atol(argv[1]) : 20000000;
+
+	printf_s("best kernel: %s\n\n", PoseKernelName(PoseKernel_Auto));
+	const std::size_t sizes[] = { 64, 1024 };
+	for (std::size_t devices : sizes)
+		Run(devices, static_cast<int>(conversions / static_cast<long>(devices)));
+	return 0;
+}
@@ -0,0 +1,92 @@
+//
+// Frame acquisition cost, one pose query per device versus one batched
+// query per frame, against a stub runtime that charges a fixed cost per
+// call like the IPC round trip into vrserver does
+//
+
+#include "stdafx.h"
+
+#include <stdlib.h>
+
+#include "LighthouseTracking.h"
+#include "SyntheticPoseSource.h"
+#include "MonotonicClock.h"
+
+// Stands in for IVRSystem: every call is one runtime round trip
+class StubRuntimePoseSource : public PoseSource {
+private:
+	SyntheticPoseSource m_inner;
+	int64_t m_callCostNs;
+
+	void RoundTrip() {
+		int64_t until = MonotonicNanoseconds() + m_callCostNs;
+		while (MonotonicNanoseconds() < until) {}
+	}
+
+public:
+	unsigned long propertyCalls = 0;
+	unsigned long poseCalls = 0;
+	unsigned long controllerCalls = 0;
+
+	StubRuntimePoseSource(const SyntheticConfig &config, int64_t callCostNs) : m_inner(config), m_callCostNs(callCostNs) {}
+
+	void ResetCounts() { propertyCalls = poseCalls = controllerCalls = 0; }
+	unsigned long Calls() const { return propertyCalls + poseCalls + controllerCalls; }
+
+	bool IsDeviceConnected(DeviceIndex device) { propertyCalls++; RoundTrip(); return m_inner.IsDeviceConnected(device); }
+	DeviceClass GetDeviceClass(DeviceIndex device) { propertyCalls++; RoundTrip(); return m_inner.GetDeviceClass(device); }
+	ControllerRole GetControllerRole(DeviceIndex device) { propertyCalls++; RoundTrip(); return m_inner.GetControllerRole(device); }
+	bool GetDeviceString(DeviceIndex device, DeviceString prop, char *buf, uint32_t bufSize) { propertyCalls++; RoundTrip(); return m_inner.GetDeviceString(device, prop, buf, bufSize); }
+	const char *GetControllerAxisTypeName(DeviceIndex device, int axis) { propertyCalls++; RoundTrip(); return m_inner.GetControllerAxisTypeName(device, axis); }
+
+	// GetControllerStateWithPose
+	bool GetDevicePose(DeviceIndex device, DevicePose *pose, ControllerState *controllerState) { poseCalls++; RoundTrip(); return m_inner.GetDevicePose(device, pose, controllerState); }
+	// GetDeviceToAbsoluteTrackingPose
+	void GetDevicePoses(DevicePose *poses, uint32_t count) { poseCalls++; RoundTrip(); m_inner.GetDevicePoses(poses, count); }
+	// GetControllerState
+	bool GetControllerState(DeviceIndex device, ControllerState *controllerState) { controllerCalls++; RoundTrip(); return m_inner.GetControllerState(device, controllerState); }
+
+	bool PollNextEvent(DeviceEvent *event) { return m_inner.PollNextEvent(event); }
+};
+
+static void Run(int trackers, bool batch, int frames, int64_t callCostNs) {
+	SyntheticConfig config;
+	config.trackerCount = trackers;
+	config.controllerCount = 2;
+	StubRuntimePoseSource source(config, callCostNs);
+	LighthouseTracking tracking(&source, IpEndpointName("127.0.0.1", 17399));
+	tracking.SetBatchPoseFetch(batch);
+
+	TrackingFrame *frame = new TrackingFrame;
+	source.ResetCounts();
+	int64_t start = MonotonicNanoseconds();
+	for (int i = 0; i < frames; i++)
+		tracking.AcquireFrame(*frame);
+	int64_t elapsed = MonotonicNanoseconds() - start;
+
+	printf_s("%8d  %-10s %10.1f %10.1f %10.1f %10.1f %12.2f\n",
+		trackers, batch ? "batch" : "per-device",
+		static_cast<double>(source.Calls()) / frames,
+		static_cast<double>(source.poseCalls) / frames,
+		static_cast<double>(source.controllerCalls) / frames,
+		static_cast<double>(source.propertyCalls) / frames,
+		elapsed / 1000.0 / frames);
+	delete frame;
+}
+
+int main(int argc, char* argv[])
+{
+	// PoseFetchBench [frames] [call cost in microseconds]
+	int frames = (argc > 1) ? atoi(argv[1]) : 2000;
+	double callCostUs = (argc > 2) ? atof(argv[2]) : 10;
+	int64_t callCostNs = static_cast<int64_t>(callCostUs * 1000);
+
+	printf_s("%d frames, %.1f us per runtime call\n\n", frames, callCostUs);
+	printf_s("%8s  %-10s %10s %10s %10s %10s %12s\n", "trackers", "mode", "calls", "pose", "controller", "property", "us/frame");
+	const int trackerCounts[] = { 4, 16, 48 };
+	for (int trackers : trackerCounts) {
+		Run(trackers, false, frames, callCostNs);
+		Run(trackers, true, frames, callCostNs);
+	}
+	return 0;
+}
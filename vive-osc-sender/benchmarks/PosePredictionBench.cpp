@@ -0,0 +1,61 @@
+//
+// CPU cost prediction adds per device, on top of the matrix to quaternion
+// conversion every frame does anyway
+//
+
+#include "stdafx.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "PosePrediction.h"
+#include "MonotonicClock.h"
+
+static volatile float sink_;
+
+static void Run(std::size_t devices, int iterations) {
+	PoseBatch batch(devices);
+	for (std::size_t n = 0; n < devices; n++) {
+		DevicePose pose = {};
+		double a = 0.01 * n;
+		pose.mDeviceToAbsoluteTracking.m[0][0] = static_cast<float>(cos(a));
+		pose.mDeviceToAbsoluteTracking.m[0][2] = static_cast<float>(sin(a));
+		pose.mDeviceToAbsoluteTracking.m[1][1] = 1;
+		pose.mDeviceToAbsoluteTracking.m[2][0] = static_cast<float>(-sin(a));
+		pose.mDeviceToAbsoluteTracking.m[2][2] = static_cast<float>(cos(a));
+		pose.vVelocity.v[0] = 0.3f;
+		pose.vAngularVelocity.v[0] = 0.1f * (n % 7);
+		pose.vAngularVelocity.v[1] = 1.0f;
+		batch.Add(pose);
+	}
+
+	int64_t start = MonotonicNanoseconds();
+	for (int it = 0; it < iterations; it++) {
+		ConvertPoses(batch);
+		sink_ = batch.QuaternionW()[0];
+	}
+	double convertNs = static_cast<double>(MonotonicNanoseconds() - start) / iterations / devices;
+
+	start = MonotonicNanoseconds();
+	for (int it = 0; it < iterations; it++) {
+		ConvertPoses(batch);
+		PredictPoses(batch, 0.004f);
+		sink_ = batch.PredictedQuaternionW()[0];
+	}
+	double predictNs = static_cast<double>(MonotonicNanoseconds() - start) / iterations / devices;
+
+	printf_s("%6lu devices: convert %6.2f ns/device, convert + predict %6.2f ns/device, prediction adds %6.2f ns/device\n",
+		static_cast<unsigned long>(devices), convertNs, predictNs, predictNs - convertNs);
+}
+
+int main(int argc, char* argv[])
+{
+	// PosePredictionBench [predictions per size, in devices]
+	long predictions = (argc > 1) ? atol(argv[1]) : 10000000;
+
+	printf_s("conversion kernel: %s\n\n", PoseKernelName(PoseKernel_Auto));
+	const std::size_t sizes[] = { 8, 64, 1024 };
+	for (std::size_t devices : sizes)
+		Run(devices, static_cast<int>(predictions / static_cast<long>(devices)));
+	return 0;
+}
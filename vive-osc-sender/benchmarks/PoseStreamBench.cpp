@@ -0,0 +1,150 @@
+//
+// Encoding cost and size of one frame of poses: a float message per device
+// through OutboundPacketStream, the compact blob, and the keyframe / delta
+// stream on both ends, at 16 and 64 devices
+//
+
+#include "stdafx.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "PoseStream.h"
+#include "MonotonicClock.h"
+#include "osc/OscOutboundPacketStream.h"
+
+static const int k_nKeyframeInterval = 100;
+
+static volatile std::size_t sink_;
+
+// Devices moving about 1 m/s and 90 degrees/s at 1 kHz
+static void MovePoses(int frame, int devices, float positions[][3], float quaternions[][4]) {
+	for (int n = 0; n < devices; n++) {
+		double t = frame * 0.001 + n;
+		positions[n][0] = static_cast<float>(sin(t));
+		positions[n][1] = static_cast<float>(1 + 0.05 * n);
+		positions[n][2] = static_cast<float>(cos(t));
+		double a = t * 3.14159265358979323846 / 4;
+		quaternions[n][0] = static_cast<float>(cos(a));
+		quaternions[n][1] = 0;
+		quaternions[n][2] = static_cast<float>(sin(a));
+		quaternions[n][3] = 0;
+	}
+}
+
+static void Report(int devices, const char *name, int64_t start, int frames, double bytes, double baselineNs) {
+	double ns = static_cast<double>(MonotonicNanoseconds() - start) / frames;
+	if (baselineNs > 0)
+		printf_s("%4d  %-18s %9.0f ns/frame %7.0f bytes/frame  (%.1fx)\n", devices, name, ns, bytes, baselineNs / ns);
+	else
+		printf_s("%4d  %-18s %9.0f ns/frame %7.0f bytes/frame\n", devices, name, ns, bytes);
+}
+
+static void Run(int devices, int frames) {
+	// Poses are computed up front so only the encoding is timed
+	const int k_nPoseFrames = 1000;
+	float (*positions)[k_unMaxDeviceCount][3] = new float[k_nPoseFrames][k_unMaxDeviceCount][3];
+	float (*quaternions)[k_unMaxDeviceCount][4] = new float[k_nPoseFrames][k_unMaxDeviceCount][4];
+	for (int frame = 0; frame < k_nPoseFrames; frame++)
+		MovePoses(frame, devices, positions[frame], quaternions[frame]);
+	char addresses[k_unMaxDeviceCount][24];
+	for (int n = 0; n < devices; n++)
+		sprintf_s(addresses[n], sizeof(addresses[n]), "/tracker/%d", n + 1);
+
+	// Baseline: what ProfileEncoder sends without compact, one message of
+	// seven floats per device
+	static char buffer[8192];
+	std::size_t bytes = 0;
+	int64_t start = MonotonicNanoseconds();
+	for (int frame = 0; frame < frames; frame++) {
+		const int f = frame % k_nPoseFrames;
+		for (int n = 0; n < devices; n++) {
+			osc::OutboundPacketStream p(buffer, sizeof(buffer));
+			p << osc::BeginMessage(addresses[n]);
+			for (int k = 0; k < 3; k++)
+				p << positions[f][n][k];
+			for (int k = 0; k < 4; k++)
+				p << quaternions[f][n][k];
+			p << osc::EndMessage;
+			bytes += p.Size();
+		}
+		sink_ = bytes;
+	}
+	double baselineNs = static_cast<double>(MonotonicNanoseconds() - start) / frames;
+	Report(devices, "float messages", start, frames, static_cast<double>(bytes) / frames, 0);
+
+	CompactPoseFormat format;
+	CompactPoseWriter *writer = new CompactPoseWriter();
+	bytes = 0;
+	start = MonotonicNanoseconds();
+	for (int frame = 0; frame < frames; frame++) {
+		const int f = frame % k_nPoseFrames;
+		writer->Begin(format);
+		for (int n = 0; n < devices; n++)
+			writer->Add(false, n + 1, positions[f][n], quaternions[f][n]);
+		osc::OutboundPacketStream p(buffer, sizeof(buffer));
+		p << osc::BeginMessage(k_pchCompactPoseAddress)
+			<< osc::Blob(writer->Data(), static_cast<osc::osc_bundle_element_size_t>(writer->Size())) << osc::EndMessage;
+		bytes += p.Size();
+		sink_ = bytes;
+	}
+	Report(devices, "compact", start, frames, static_cast<double>(bytes) / frames, baselineNs);
+
+	// The stream's frames are kept for the decoder
+	PoseStreamEncoder *encoder = new PoseStreamEncoder(format, k_nKeyframeInterval);
+	char (*encoded)[k_unMaxPoseStreamSize] = new char[k_nPoseFrames][k_unMaxPoseStreamSize];
+	std::size_t *encodedSize = new std::size_t[k_nPoseFrames];
+	bytes = 0;
+	start = MonotonicNanoseconds();
+	for (int frame = 0; frame < frames; frame++) {
+		const int f = frame % k_nPoseFrames;
+		encoder->Begin();
+		for (int n = 0; n < devices; n++)
+			encoder->Add(false, n + 1, positions[f][n], quaternions[f][n]);
+		encoder->End();
+		osc::OutboundPacketStream p(buffer, sizeof(buffer));
+		p << osc::BeginMessage(k_pchCompactPoseAddress)
+			<< osc::Blob(encoder->Data(), static_cast<osc::osc_bundle_element_size_t>(encoder->Size())) << osc::EndMessage;
+		bytes += p.Size();
+		if (frame < k_nPoseFrames) {
+			memcpy(encoded[frame], encoder->Data(), encoder->Size());
+			encodedSize[frame] = encoder->Size();
+		}
+		sink_ = bytes;
+	}
+	Report(devices, "keyframe + delta", start, frames, static_cast<double>(bytes) / frames, baselineNs);
+
+	PoseStreamDecoder *decoder = new PoseStreamDecoder();
+	CompactPose poses[k_unMaxDeviceCount];
+	int count = 0;
+	int decodedFrames = frames < k_nPoseFrames ? frames : k_nPoseFrames;
+	int repeats = frames / decodedFrames;
+	start = MonotonicNanoseconds();
+	for (int repeat = 0; repeat < repeats; repeat++) {
+		for (int frame = 0; frame < decodedFrames; frame++)
+			decoder->Decode(encoded[frame], encodedSize[frame], format, poses, k_unMaxDeviceCount, count);
+		sink_ = count;
+	}
+	Report(devices, "  decode", start, repeats * decodedFrames, static_cast<double>(bytes) / frames, 0);
+	encoder->PrintStatistics();
+	printf_s("\n");
+
+	delete writer;
+	delete encoder;
+	delete decoder;
+	delete[] encoded;
+	delete[] encodedSize;
+	delete[] positions;
+	delete[] quaternions;
+}
+
+int main(int argc, char* argv[])
+{
+	// PoseStreamBench [frames per size]
+	int frames = (argc > 1) ? atoi(argv[1]) : 200000;
+
+	const int sizes[] = { 16, 64 };
+	for (int devices : sizes)
+		Run(devices, frames);
+	return 0;
+}
@@ -0,0 +1,93 @@
+//
+// Recording 64 devices at 1 kHz, paced by the clock as the frame loop is:
+// frames dropped because the next chunk wasn't mapped in time, and how
+// long recording a frame took
+//
+
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "SessionRecorder.h"
+#include "SyntheticPoseSource.h"
+#include "MonotonicClock.h"
+
+static const char *const k_pchBenchFile = "SessionRecorderBench.session";
+
+// Every registered device at the frame's time, as LighthouseTracking reads them
+static void AcquireFrame(SyntheticPoseSource &source, const DeviceRegistry &registry, unsigned long frameNumber, TrackingFrame &frame) {
+	source.SetTime(frameNumber * 0.001);
+	frame.captureTimeNs = MonotonicNanoseconds();
+	frame.timeTag = 0;
+	frame.frameNumber = frameNumber;
+	frame.templateGeneration = registry.Generation();
+	frame.deviceCount = 0;
+	for (int n = 0; n < registry.DeviceCount(); n++) {
+		const RegisteredDevice &device = registry.Device(n);
+		TrackedDeviceSample &sample = frame.devices[frame.deviceCount++];
+		ControllerState state;
+		source.GetDevicePose(device.unDevice, &sample.pose, &state);
+		sample.unDevice = device.unDevice;
+		sample.deviceClass = device.deviceClass;
+		sample.ordinal = device.ordinal;
+		sample.profiles = 1;
+		sample.trigger = 0;
+		sample.axes[0] = 0;
+		sample.axes[1] = 0;
+		memcpy(sample.oscAddress, device.oscAddress, sizeof(sample.oscAddress));
+	}
+}
+
+static void Run(std::size_t chunkSize, int frames) {
+	SyntheticConfig config;
+	config.controllerCount = 2;
+	config.trackerCount = 62;
+	config.baseStationCount = 0;
+	config.includeHmd = false;
+	SyntheticPoseSource source(config);
+	DeviceRegistry registry;
+	registry.Refresh(source);
+
+	SessionRecorder recorder;
+	if (!recorder.Open(k_pchBenchFile, chunkSize))
+		return;
+
+	TrackingFrame *frame = new TrackingFrame;
+	std::vector<int64_t> times;
+	times.reserve(frames);
+	std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+	for (int n = 0; n < frames; n++) {
+		AcquireFrame(source, registry, static_cast<unsigned long>(n), *frame);
+		int64_t start = MonotonicNanoseconds();
+		recorder.Record(*frame, registry);
+		times.push_back(MonotonicNanoseconds() - start);
+		next += std::chrono::microseconds(1000);
+		std::this_thread::sleep_until(next);
+	}
+	unsigned long overruns = recorder.Overruns();
+	recorder.Close();
+	remove(k_pchBenchFile);
+	delete frame;
+
+	std::sort(times.begin(), times.end());
+	printf_s("%6u KiB %8d %9lu %10.1f %10.1f %10.1f\n", static_cast<unsigned int>(chunkSize / 1024), frames, overruns,
+		times[times.size() / 2] / 1000.0, times[times.size() * 99 / 100] / 1000.0, times.back() / 1000.0);
+}
+
+int main(int argc, char* argv[])
+{
+	// SessionRecorderBench [frames]
+	int frames = (argc > 1) ? atoi(argv[1]) : 5000;
+
+	printf_s("64 devices at 1 kHz\n");
+	printf_s("%10s %8s %9s %10s %10s %10s\n", "chunk", "frames", "overruns", "p50 us", "p99 us", "max us");
+	const std::size_t chunkSizes[] = { 1 << 20, k_unDefaultSessionChunkSize };
+	for (std::size_t chunkSize : chunkSizes)
+		Run(chunkSize, frames);
+	return 0;
+}
@@ -0,0 +1,116 @@
+//
+// Replaying a recorded session at max speed: frames read back per second
+// and the time per frame, for a few and for many devices
+//
+
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "SessionReplay.h"
+#include "SyntheticPoseSource.h"
+#include "MonotonicClock.h"
+
+static const char *const k_pchBenchFile = "SessionReplayBench.session";
+
+// Every registered device, with capture times 1 ms apart
+static void AcquireFrame(SyntheticPoseSource &source, const DeviceRegistry &registry, int64_t startNs, unsigned long frameNumber, TrackingFrame &frame) {
+	source.SetTime(frameNumber * 0.001);
+	frame.captureTimeNs = startNs + static_cast<int64_t>(frameNumber) * 1000000;
+	frame.timeTag = 0;
+	frame.frameNumber = frameNumber;
+	frame.templateGeneration = registry.Generation();
+	frame.deviceCount = 0;
+	for (int n = 0; n < registry.DeviceCount(); n++) {
+		const RegisteredDevice &device = registry.Device(n);
+		TrackedDeviceSample &sample = frame.devices[frame.deviceCount++];
+		ControllerState state;
+		source.GetDevicePose(device.unDevice, &sample.pose, &state);
+		sample.unDevice = device.unDevice;
+		sample.deviceClass = device.deviceClass;
+		sample.ordinal = device.ordinal;
+		sample.profiles = 1;
+		sample.trigger = 0;
+		sample.axes[0] = 0;
+		sample.axes[1] = 0;
+		memcpy(sample.oscAddress, device.oscAddress, sizeof(sample.oscAddress));
+	}
+}
+
+static bool WriteSession(int trackers, int frames) {
+	SyntheticConfig config;
+	config.controllerCount = 2;
+	config.trackerCount = trackers;
+	config.baseStationCount = 0;
+	config.includeHmd = false;
+	SyntheticPoseSource source(config);
+	DeviceRegistry registry;
+	registry.Refresh(source);
+
+	SessionRecorder recorder;
+	if (!recorder.Open(k_pchBenchFile))
+		return false;
+	TrackingFrame *frame = new TrackingFrame;
+	int64_t startNs = MonotonicNanoseconds();
+	for (int n = 0; n < frames; n++) {
+		AcquireFrame(source, registry, startNs, static_cast<unsigned long>(n), *frame);
+		// Unpaced, the next chunk may not be mapped yet; the frame goes in
+		// once it is
+		for (unsigned long overruns = recorder.Overruns(); ; overruns = recorder.Overruns()) {
+			recorder.Record(*frame, registry);
+			if (recorder.Overruns() == overruns)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	recorder.Close();
+	delete frame;
+	return true;
+}
+
+static void Run(int trackers, int frames, int repeats) {
+	if (!WriteSession(trackers, frames))
+		return;
+	SessionReader reader;
+	if (!reader.Open(k_pchBenchFile))
+		return;
+
+	ReplayConfig config;
+	config.timing = ReplayTiming_MaxSpeed;
+	TrackingFrame *frame = new TrackingFrame;
+	std::vector<double> rates;
+	unsigned long played = 0;
+	for (int r = 0; r < repeats; r++) {
+		SessionReplay replay(reader, config);
+		int64_t start = MonotonicNanoseconds();
+		while (replay.NextFrame(*frame)) {}
+		int64_t elapsed = MonotonicNanoseconds() - start;
+		played = replay.Frames();
+		rates.push_back(played * 1e9 / elapsed);
+	}
+	delete frame;
+	reader.Close();
+	remove(k_pchBenchFile);
+
+	// The best run, the others were disturbed by something else
+	double best = *std::max_element(rates.begin(), rates.end());
+	printf_s("%8d %8lu %14.0f %12.2f\n", trackers + 2, played, best, 1e6 / best);
+}
+
+int main(int argc, char* argv[])
+{
+	// SessionReplayBench [frames]
+	int frames = (argc > 1) ? atoi(argv[1]) : 20000;
+
+	printf_s("Replay at max speed, best of 5\n");
+	printf_s("%8s %8s %14s %12s\n", "devices", "frames", "frames/s", "us/frame");
+	const int trackerCounts[] = { 4, 62 };
+	for (int trackers : trackerCounts)
+		Run(trackers, frames, 5);
+	return 0;
+}
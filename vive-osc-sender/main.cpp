@@ -4,28 +4,74 @@
 //
 
 #include "stdafx.h"
-#include "Windows.h"
 #include <string>
-#include <conio.h>
 #include <iomanip>		// for std::setprecision
 #include <iostream>
 
 #include "LighthouseTracking.h"
+#include "SyntheticPoseSource.h"
+#include "FrameScheduler.h"
+#include "ControlChannel.h"
+#include "SessionReplay.h"
+#include "RealtimeSetup.h"
+#include "ip/PacketFlightRecorder.h"
+#ifdef VIVE_OSC_WITH_OPENVR
+#include "OpenVRPoseSource.h"
+#endif
 
+#ifdef _WIN32
+#include "Windows.h"
 // windows keyboard input
 #include <conio.h>
+#endif
 #include <vector>
 
 using std::vector;
 using std::string;
 
-int _tmain(int argc, _TCHAR* argv[])
+int main(int argc, char* argv[])
 {
 	int shouldListDevicesAndQuit = 0;
 	int port = 9999;
 	char ip_address[128];
 	sprintf_s(ip_address, sizeof(ip_address), "127.0.0.1");
 
+	// Synthetic pose source, the only one available without OpenVR
+#ifdef VIVE_OSC_WITH_OPENVR
+	bool useSynthetic = false;
+#else
+	bool useSynthetic = true;
+#endif
+	SyntheticConfig syntheticConfig;
+	long maxFrames = 0;		// 0 runs until quit
+	bool bundleFrames = false;
+	int maxPacketSize = static_cast<int>(k_unDefaultMaxPacketSize);
+	double frameRate = 500;	// Hz
+	bool threadedSend = false;
+	bool batchPoseFetch = false;
+	bool quiet = false;
+	bool daemon = false;
+	int controlPort = 0;
+	double statusRate = 10;	// Hz
+	bool predictPoses = false;
+	double predictionMs = 0;
+	DeadbandConfig deadband;
+	bool dedupFrames = false;
+	RingOverflowPolicy overflowPolicy = RingOverflow_DropOldest;
+	vector<IpEndpointName> destinations;	// --dest, in addition to --ip / --port if those are given
+	vector<OutputProfile> profiles;			// one per --dest
+	OutputProfile defaultProfile;			// for --ip / --port
+	bool explicitIpOrPort = false;
+	const char *recordPath = NULL;
+	double recordChunkMb = k_unDefaultSessionChunkSize / 1048576.0;
+	const char *replayPath = NULL;
+	ReplayConfig replayConfig;
+	double replayFrom = 0;	// seconds into the session
+	double flightSeconds = 10;	// 0 turns the flight recorder off
+	double flightMb = 16;
+	const char *flightDumpPath = "vive-osc-sender.flight";
+	RealtimeConfig realtime;
+
 	// very basic command line parser, from:
 	// http://stackoverflow.com/questions/17144037/change-a-command-line-argument-argv
 	vector<string> validArgs;
@@ -34,44 +80,304 @@ int _tmain(int argc, _TCHAR* argv[])
 	// parse all user input
 	for (int i = 1; i<argc; ++i) {
 		const std::string myArg(argv[i]);
+		const char *next = (i + 1 < argc) ? argv[i + 1] : "";
 
-		if (myArg == std::string("--listdevices")) shouldListDevicesAndQuit = atoi(argv[i + 1]);
-		if (myArg == std::string("--ip")) sprintf_s(ip_address, sizeof(ip_address), argv[i + 1]);
-		if (myArg == std::string("--port")) port = atoi(argv[i + 1]);
+		if (myArg == std::string("--listdevices")) shouldListDevicesAndQuit = atoi(next);
+		if (myArg == std::string("--ip")) { sprintf_s(ip_address, sizeof(ip_address), "%s", next); explicitIpOrPort = true; }
+		if (myArg == std::string("--port")) { port = atoi(next); explicitIpOrPort = true; }
+		if (myArg == std::string("--dest")) {
+			// ip:port, split at the last colon
+			std::string dest(next);
+			std::size_t colon = dest.rfind(':');
+			if (colon == std::string::npos)
+				destinations.push_back(IpEndpointName(dest.c_str(), port));
+			else
+				destinations.push_back(IpEndpointName(dest.substr(0, colon).c_str(), atoi(dest.c_str() + colon + 1)));
+			profiles.push_back(OutputProfile());
+		}
+
+		// profile of the last --dest: [--dest-rate hz] [--dest-devices controllers,trackers,serial=text] [--dest-fields pos,quat,matrix,vel,angvel,trigger,axes,time,compact] [--dest-compact mm,bits,bits] [--dest-keyframes frames] [--dest-predict ms]
+		OutputProfile &profile = profiles.empty() ? defaultProfile : profiles.back();
+		if (myArg == std::string("--dest-rate")) profile.rate = atof(next);
+		if (myArg == std::string("--dest-devices") && !ParseProfileDevices(next, profile))
+			printf_s("Ignoring unknown device filter in \"%s\"\n", next);
+		if (myArg == std::string("--dest-fields")) {
+			// keeps an earlier --dest-compact
+			unsigned int compact = profile.fields & ProfileField_Compact;
+			if (!ParseProfileFields(next, profile.fields))
+				printf_s("Ignoring unknown field in \"%s\"\n", next);
+			profile.fields |= compact;
+		}
+		if (myArg == std::string("--dest-predict")) { profile.predict = true; profile.predictionSeconds = atof(next) / 1000; }
+		if (myArg == std::string("--dest-keyframes")) { profile.keyframeInterval = atoi(next); profile.fields |= ProfileField_Compact; }
+		if (myArg == std::string("--dest-compact")) {
+			if (ParseCompactPoseFormat(next, profile.compact))
+				profile.fields |= ProfileField_Compact;
+			else
+				printf_s("Ignoring compact format \"%s\", expected <mm>[,16|24[,10..15]]\n", next);
+		}
+		if (myArg == std::string("--bundle")) bundleFrames = true;
+		if (myArg == std::string("--mtu")) maxPacketSize = atoi(next);
+		if (myArg == std::string("--rate")) frameRate = atof(next);
+		if (myArg == std::string("--threaded")) threadedSend = true;
+		if (myArg == std::string("--batch-poses")) batchPoseFetch = true;
+		if (myArg == std::string("--quiet")) quiet = true;
+		if (myArg == std::string("--daemon")) { daemon = true; quiet = true; }
+		if (myArg == std::string("--control-port")) controlPort = atoi(next);
+		if (myArg == std::string("--status-rate")) statusRate = atof(next);
+		if (myArg == std::string("--predict")) { predictPoses = true; predictionMs = atof(next); }
+		if (myArg == std::string("--deadband")) deadband.enabled = true;
+		if (myArg == std::string("--deadband-mm")) { deadband.enabled = true; deadband.positionThreshold = static_cast<float>(atof(next) / 1000); }
+		if (myArg == std::string("--deadband-deg")) { deadband.enabled = true; deadband.angleThreshold = static_cast<float>(atof(next)); }
+		if (myArg == std::string("--dedup")) dedupFrames = true;
+		if (myArg == std::string("--keepalive")) deadband.keepaliveSeconds = atof(next) / 1000;
+		if (myArg == std::string("--record")) recordPath = next;
+		if (myArg == std::string("--record-chunk-mb")) recordChunkMb = atof(next);
+		if (myArg == std::string("--replay")) replayPath = next;
+		if (myArg == std::string("--replay-speed") && !ParseReplaySpeed(next, replayConfig))
+			printf_s("Ignoring replay speed \"%s\", expected a factor or \"max\"\n", next);
+		if (myArg == std::string("--replay-from")) replayFrom = atof(next);
+		if (myArg == std::string("--flight-recorder")) flightSeconds = atof(next);
+		if (myArg == std::string("--flight-recorder-mb")) flightMb = atof(next);
+		if (myArg == std::string("--flight-dump")) flightDumpPath = next;
+		if (myArg == std::string("--cpu")) realtime.acquisitionCpu = atoi(next);
+		if (myArg == std::string("--transmit-cpu")) realtime.transmitCpu = atoi(next);
+		if (myArg == std::string("--rt-priority")) realtime.priority = atoi(next);
+		if (myArg == std::string("--lock-memory")) realtime.lockMemory = true;
+		if (myArg == std::string("--prefault")) realtime.prefault = true;
+		if (myArg == std::string("--overflow")) overflowPolicy = (std::string(next) == "block") ? RingOverflow_Block : RingOverflow_DropOldest;
+
+		// synthetic source: --synthetic <trackers> [--controllers n] [--sample-rate hz] [--static-trackers n] [--motion static|orbit]
+		if (myArg == std::string("--synthetic")) { useSynthetic = true; syntheticConfig.trackerCount = atoi(next); }
+		if (myArg == std::string("--controllers")) syntheticConfig.controllerCount = atoi(next);
+		if (myArg == std::string("--sample-rate")) syntheticConfig.sampleRate = atof(next);
+		if (myArg == std::string("--static-trackers")) syntheticConfig.staticTrackerCount = atoi(next);
+		if (myArg == std::string("--motion")) syntheticConfig.motion = (std::string(next) == "static") ? SyntheticMotion_Static : SyntheticMotion_Orbit;
+		if (myArg == std::string("--frames")) maxFrames = atol(next);
 
 		validArgs.push_back(myArg);
 	}
 
+	// Keeps the packets of the last seconds, dumped on request or a crash
+	PacketFlightRecorder flightRecorder;
+	if (flightSeconds > 0) {
+		if (flightRecorder.Start(static_cast<std::size_t>(flightMb * 1048576), flightSeconds))
+			flightRecorder.DumpOnCrash(flightDumpPath);
+		else
+			printf_s("Can't map a %.0f MB flight recorder, running without one\n", flightMb);
+	}
+
+	// A replay sends the session's devices, the source only has to be there
+	if (replayPath) {
+		useSynthetic = true;
+		syntheticConfig = SyntheticConfig();
+		syntheticConfig.trackerCount = 0;
+		syntheticConfig.controllerCount = 0;
+		syntheticConfig.baseStationCount = 0;
+		syntheticConfig.includeHmd = false;
+	}
+
+	PoseSource *poseSource = NULL;
+#ifdef VIVE_OSC_WITH_OPENVR
+	OpenVRPoseSource *openVRSource = NULL;
+#endif
+	if (useSynthetic)
+		poseSource = new SyntheticPoseSource(syntheticConfig);
+#ifdef VIVE_OSC_WITH_OPENVR
+	else {
+		// Nothing is printed from the frame loop when quiet, runtime
+		// events are only counted
+		openVRSource = new OpenVRPoseSource();
+		openVRSource->SetEventLogging(!quiet);
+		poseSource = openVRSource;
+	}
+#endif
+
 	// Create a new LighthouseTracking instance and parse as needed
-	LighthouseTracking *lighthouseTracking = new LighthouseTracking(IpEndpointName(ip_address, port));
+	if (destinations.empty() || explicitIpOrPort) {
+		destinations.insert(destinations.begin(), IpEndpointName(ip_address, port));
+		profiles.insert(profiles.begin(), defaultProfile);
+	}
+
+	// --predict is the horizon of the destinations without a --dest-predict
+	if (predictPoses) {
+		for (OutputProfile &profile : profiles) {
+			if (!profile.predict) {
+				profile.predict = true;
+				profile.predictionSeconds = predictionMs / 1000.0;
+			}
+		}
+	}
+	LighthouseTracking *lighthouseTracking = new LighthouseTracking(poseSource, destinations[0], profiles[0]);
 	if (lighthouseTracking) {
+		lighthouseTracking->SetErrorReporting(!quiet);
+
+		for (std::size_t n = 1; n < destinations.size(); n++)
+			lighthouseTracking->AddDestination(destinations[n], profiles[n]);
+
+		lighthouseTracking->SetFrameBundling(bundleFrames, maxPacketSize);
+		lighthouseTracking->SetBatchPoseFetch(batchPoseFetch);
+		lighthouseTracking->SetDeadband(deadband);
+		lighthouseTracking->SetFrameDedup(dedupFrames, deadband.keepaliveSeconds);
+
+		// Buffers are faulted in before the transmit thread starts using them
+		std::size_t prefaulted = 0;
+		if (realtime.prefault || realtime.lockMemory) {
+			prefaulted = lighthouseTracking->PrefaultBuffers();
+			PrefaultStack();
+		}
+		if (threadedSend)
+			lighthouseTracking->StartTransmitThread(overflowPolicy);
+		if (recordPath && !lighthouseTracking->StartRecording(recordPath, static_cast<std::size_t>(recordChunkMb * 1048576))) {
+			delete lighthouseTracking;
+			delete poseSource;
+			return EXIT_FAILURE;
+		}
 
 		lighthouseTracking->PrintDevices();
 
 		if (!shouldListDevicesAndQuit) {
-			printf_s("Press 'q' to quit. Starting capture of tracking data...\n");
+			// Quit, device list and flight dump requests come from signals,
+			// in every mode, so Ctrl-C or SIGTERM still close the session
+			// file and SIGQUIT dumps the flight recorder instead of killing
+			// the process. Without a console they also come from the control
+			// port, handled on the channel's own thread.
+			ControlChannel control;
+			control.SetLatencyReport(&lighthouseTracking->Latency());
+			control.SetFlightDumpPath(flightDumpPath);
+			if (!control.Start(daemon ? controlPort : 0)) {
+				delete lighthouseTracking;
+				delete poseSource;
+				return EXIT_FAILURE;
+			}
+			if (daemon) {
+				printf_s("Running as a daemon. Starting capture of tracking data...\n");
+			} else {
+				printf_s("Press 'q' to quit. Starting capture of tracking data...\n");
+			}
+			fflush(stdout);
+			if (!quiet)
+				lighthouseTracking->StartStatusDisplay(statusRate);
 
-			// This is our main loop run
-			while (lighthouseTracking->RunProcedure()) {
+			// Pinning and priority come last, so the helper threads started
+			// above don't inherit them. Whatever the OS refuses is reported
+			// and the sender runs anyway.
+			if (realtime.Requested()) {
+				if (realtime.priority < 0)
+					realtime.priority = 0;
+				if (realtime.priority > 99)
+					realtime.priority = 99;
+				int lockError = 0;
+				RealtimeOutcome locked = realtime.lockMemory ? LockMemory(lockError) : RealtimeOutcome_NotRequested;
+				PrintMemoryLock(locked, lockError);
+				if (prefaulted > 0)
+					printf_s("Real-time: prefaulted %lu KiB of frame, encode and socket buffers\n", static_cast<unsigned long>(prefaulted / 1024));
+				PrintThreadRealtime("acquisition", realtime.acquisitionCpu, realtime.priority,
+					ConfigureThread(CurrentRealtimeThread(), realtime.acquisitionCpu, realtime.priority));
+				if (threadedSend)
+					PrintThreadRealtime("transmit", realtime.transmitCpu, realtime.priority,
+						ConfigureThread(lighthouseTracking->TransmitThreadHandle(), realtime.transmitCpu, realtime.priority));
+				else if (realtime.transmitCpu >= 0)
+					printf_s("Real-time: --transmit-cpu needs --threaded, ignored\n");
+				fflush(stdout);
+			}
 
+			// Requests from the control channel or the keyboard, false to quit
+			auto handleInput = [&]() -> bool {
+				if (control.QuitRequested())
+					return false;
+				if (control.TakeDeviceListRequest())
+					control.PublishDevices(lighthouseTracking->Registry());
+				if (control.TakeKeyframeRequest())
+					lighthouseTracking->RequestKeyframe();
+#ifdef _WIN32
 				// Windows quit routine - adapt as you need
-				if (_kbhit()) {
+				if (!daemon && _kbhit()) {
 					char ch = _getch();
 					if ('q' == ch) {
 						printf_s("User pressed 'q' - exiting...");
-						break;
+						return false;
 					} else if ('l' == ch) {
 						lighthouseTracking->PrintDevices();
+					} else if ('t' == ch) {
+						lighthouseTracking->Latency().Print();
+					} else if ('k' == ch) {
+						lighthouseTracking->RequestKeyframe();
+					} else if ('f' == ch && flightRecorder.IsActive()) {
+						if (flightRecorder.Dump(flightDumpPath))
+							printf_s("Flight recorder dumped to %s\n", flightDumpPath);
 					}
 				}
+#endif
+				return true;
+			};
 
-				// a delay to not overheat your computer... :)
-				Sleep(2);
+			FrameScheduler scheduler(frameRate);
+			SessionReader replayReader;
+			SessionReplay *replay = NULL;
+			if (replayPath) {
+				// Frames come from the session file, paced by its own timing
+				if (!replayReader.Open(replayPath)) {
+					lighthouseTracking->StopTransmitThread();
+					lighthouseTracking->StopStatusDisplay();
+					delete lighthouseTracking;
+					delete poseSource;
+					return EXIT_FAILURE;
+				}
+				replay = new SessionReplay(replayReader, replayConfig);
+				printf_s("Replaying %.1f s of \"%s\" from %.1f s\n", replay->DurationSeconds(), replayPath, replayFrom);
+				replay->Seek(replayFrom);
+				TrackingFrame *frame = new TrackingFrame;
+				long frameCount = 0;
+				while (replay->NextFrame(*frame)) {
+					lighthouseTracking->InjectFrame(*frame, replay->Devices());
+					if (maxFrames > 0 && ++frameCount >= maxFrames)
+						break;
+					if (!handleInput())
+						break;
+				}
+				delete frame;
+			} else {
+				// This is our main loop run, paced at a fixed frame rate
+				scheduler.Start();
+				long frame = 0;
+				while (lighthouseTracking->RunProcedure()) {
+
+					if (maxFrames > 0 && ++frame >= maxFrames)
+						break;
+					if (!handleInput())
+						break;
+
+					scheduler.WaitForNextFrame();
+				}
+			}
+
+			lighthouseTracking->StopRecording();
+			lighthouseTracking->StopTransmitThread();
+			lighthouseTracking->StopStatusDisplay();
+			control.Stop();
+			printf_s("\n");
+			if (replay) {
+				replay->PrintStatistics(lighthouseTracking->PacketsSent());
+				delete replay;
+			} else {
+				scheduler.PrintStatistics();
+			}
+			if (lighthouseTracking->SourceQuit())
+				printf_s("(OpenVR) service quit\n");
+			lighthouseTracking->PrintStatistics();
+#ifdef VIVE_OSC_WITH_OPENVR
+			if (openVRSource)
+				printf_s("%lu runtime events\n", openVRSource->EventCount());
+#endif
+			if (flightRecorder.IsActive()) {
+				printf_s("Flight recorder: %.1f MB of packets, the %.0f MB ring holds about the last %.1f s\n",
+					flightRecorder.BytesRecorded() / 1048576.0, flightRecorder.Capacity() / 1048576.0, flightRecorder.SecondsHeld());
 			}
 		}
 
 		delete lighthouseTracking;
 	}
+	delete poseSource;
 	return EXIT_SUCCESS;
 }
-
@@ -1,15 +1,23 @@
-// stdafx.h : include file for standard system include files,
-// or project specific include files that are used frequently, but
-// are changed infrequently
-//
-
-#pragma once
-
-#include "targetver.h"
-
-#include <stdio.h>
-#include <tchar.h>
-
-
-
-// TODO: reference additional headers your program requires here
+// stdafx.h : include file for standard system include files,
+// or project specific include files that are used frequently, but
+// are changed infrequently
+//
+
+#pragma once
+
+#ifdef _WIN32
+#include "targetver.h"
+#include <tchar.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// The portable build (see oscpack_1_1_0/CMakeLists.txt) uses the plain C
+// library, map the MSVC "secure" variants onto it
+#ifndef _MSC_VER
+#define printf_s printf
+#define sprintf_s snprintf
+#endif
+
+// TODO: reference additional headers your program requires here
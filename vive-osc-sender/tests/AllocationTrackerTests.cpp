@@ -0,0 +1,218 @@
+//
+// Tests for the allocation hooks, and that the frame pipeline makes no heap
+// allocations once it has warmed up, in every send mode. Linked with
+// AllocationHooks.cpp.
+//
+
+#include "SenderTestSupport.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#if defined(__GLIBC__)
+#include <malloc.h>		// memalign
+#endif
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AllocationTracker.h"
+#include "SyntheticPoseSource.h"
+#include "LighthouseTracking.h"
+
+static const int k_nTestPort = 17361;
+
+// Frames before counting starts, and counted frames
+static const int k_nWarmupFrames = 200;
+static const int k_nFrames = 5000;
+
+// Every allocation is stored here before it is freed, otherwise an
+// optimizing compiler may drop the pair of calls altogether
+static void *volatile sink_;
+
+// Allocated with the aligned forms of operator new
+struct alignas(64) CacheLine {
+	char bytes[64];
+};
+
+static void TestCounting() {
+	assertTrue(AllocationTrackingEnabled());
+
+	uint64_t before = ThreadAllocationCount();
+	int *single = new int(1);
+	sink_ = single;
+	int *array = new int[16];
+	sink_ = array;
+	delete single;
+	delete[] array;
+	assertEqual(ThreadAllocationCount() - before, static_cast<uint64_t>(2));
+
+	before = ThreadAllocationCount();
+	void *block = malloc(64);
+	sink_ = block;
+	block = realloc(block, 4096);
+	sink_ = block;
+	void *zeroed = calloc(4, 16);
+	sink_ = zeroed;
+	free(block);
+	free(zeroed);
+#if defined(__GLIBC__)
+	assertEqual(ThreadAllocationCount() - before, static_cast<uint64_t>(3));
+
+	before = ThreadAllocationCount();
+	void *aligned = aligned_alloc(64, 128);
+	sink_ = aligned;
+	free(aligned);
+	aligned = memalign(64, 128);
+	sink_ = aligned;
+	free(aligned);
+	aligned = NULL;
+	assertEqual(posix_memalign(&aligned, 64, 128), 0);
+	sink_ = aligned;
+	free(aligned);
+	assertEqual(ThreadAllocationCount() - before, static_cast<uint64_t>(3));
+#endif
+
+	// Over-aligned types take the aligned forms of new
+	before = ThreadAllocationCount();
+	CacheLine *line = new CacheLine;
+	sink_ = line;
+	assertEqual(reinterpret_cast<uintptr_t>(line) % 64, static_cast<uintptr_t>(0));
+	CacheLine *lines = new CacheLine[4];
+	sink_ = lines;
+	CacheLine *maybe = new (std::nothrow) CacheLine;
+	sink_ = maybe;
+	delete line;
+	delete[] lines;
+	delete maybe;
+	assertEqual(ThreadAllocationCount() - before, static_cast<uint64_t>(3));
+
+	// Standard containers go through operator new
+	before = ThreadAllocationCount();
+	std::string text(100, 'x');
+	std::vector<int> numbers(10);
+	sink_ = &text[0];
+	sink_ = &numbers[0];
+	assertTrue(ThreadAllocationCount() - before >= 2);
+
+	// Other threads count on their own, and in the total
+	before = ThreadAllocationCount();
+	uint64_t totalBefore = TotalAllocationCount();
+	uint64_t threadCount = 0;
+	std::thread thread([&threadCount] {
+		uint64_t start = ThreadAllocationCount();
+		for (int n = 0; n < 10; n++) {
+			int *number = new int(n);
+			sink_ = number;
+			delete number;
+		}
+		threadCount = ThreadAllocationCount() - start;
+	});
+	thread.join();
+	assertEqual(threadCount, static_cast<uint64_t>(10));
+	assertTrue(TotalAllocationCount() - totalBefore >= 10);
+}
+
+// 2 controllers and 16 trackers, a few of them standing still
+static SyntheticConfig TestConfig() {
+	SyntheticConfig config;
+	config.controllerCount = 2;
+	config.trackerCount = 16;
+	config.staticTrackerCount = 4;
+	config.sampleRate = 1000;
+	return config;
+}
+
+// Every field with prediction, compact poses as a keyframe / delta stream
+// predicted further ahead, and only the trackers at a lower rate
+static void AddDestinations(LighthouseTracking &tracking) {
+	OutputProfile everything;
+	everything.fields = ProfileField_Position | ProfileField_Quaternion | ProfileField_Matrix | ProfileField_Velocity
+		| ProfileField_AngularVelocity | ProfileField_Trigger | ProfileField_Axes | ProfileField_TimeTag;
+	everything.predict = true;
+	everything.predictionSeconds = 0.01;
+	tracking.AddDestination(IpEndpointName("127.0.0.1", k_nTestPort + 1), everything);
+
+	OutputProfile stream;
+	stream.fields = ProfileField_Compact;
+	stream.keyframeInterval = 50;
+	stream.predict = true;
+	stream.predictionSeconds = 0.03;
+	tracking.AddDestination(IpEndpointName("127.0.0.1", k_nTestPort + 2), stream);
+
+	OutputProfile trackers;
+	trackers.devices = ProfileDevices_Trackers;
+	trackers.rate = 100;
+	tracking.AddDestination(IpEndpointName("127.0.0.1", k_nTestPort + 3), trackers);
+}
+
+// Allocations of all stages so far
+static uint64_t StageAllocations(const PipelineLatency &latency) {
+	uint64_t allocations = 0;
+	for (int n = 0; n < PipelineStage_Count; n++)
+		allocations += latency.Allocations(static_cast<PipelineStage>(n));
+	return allocations;
+}
+
+static void PrintStageAllocations(const PipelineLatency &latency) {
+	for (int n = 0; n < PipelineStage_Count; n++) {
+		PipelineStage stage = static_cast<PipelineStage>(n);
+		if (latency.Allocations(stage) > 0)
+			std::cout << "    " << PipelineStageName(stage) << ": " << latency.Allocations(stage) << " allocations\n";
+	}
+}
+
+enum SendMode {
+	SendMode_Messages,
+	SendMode_Bundled,
+	SendMode_Threaded
+};
+
+static void TestSteadyState(SendMode mode) {
+	SyntheticPoseSource source(TestConfig());
+	LighthouseTracking tracking(&source, IpEndpointName("127.0.0.1", k_nTestPort));
+	AddDestinations(tracking);
+	tracking.SetFrameBundling(mode != SendMode_Messages);
+	DeadbandConfig deadband;
+	deadband.enabled = true;
+	tracking.SetDeadband(deadband);
+	if (mode == SendMode_Threaded)
+		tracking.StartTransmitThread(RingOverflow_Block);
+
+	double time = 0;
+	for (int n = 0; n < k_nWarmupFrames; n++) {
+		source.SetTime(time += 0.002);
+		tracking.RunProcedure();
+	}
+
+	// Counted on this thread, and per stage for the transmit thread
+	uint64_t before = ThreadAllocationCount();
+	uint64_t stagesBefore = StageAllocations(tracking.Latency());
+	unsigned long packetsBefore = tracking.PacketsSent();
+	for (int n = 0; n < k_nFrames; n++) {
+		source.SetTime(time += 0.002);
+		tracking.RunProcedure();
+	}
+	uint64_t allocations = ThreadAllocationCount() - before;
+	if (mode == SendMode_Threaded)
+		tracking.StopTransmitThread();
+	uint64_t stageAllocations = StageAllocations(tracking.Latency()) - stagesBefore;
+
+	assertTrue(tracking.PacketsSent() - packetsBefore > static_cast<unsigned long>(k_nFrames));
+	assertEqual(allocations, static_cast<uint64_t>(0));
+	assertEqual(stageAllocations, static_cast<uint64_t>(0));
+	if (allocations != 0 || stageAllocations != 0)
+		PrintStageAllocations(tracking.Latency());
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestCounting();
+	TestSteadyState(SendMode_Messages);
+	TestSteadyState(SendMode_Bundled);
+	TestSteadyState(SendMode_Threaded);
+	return PrintTestSummary();
+}
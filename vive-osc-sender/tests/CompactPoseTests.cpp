@@ -0,0 +1,210 @@
+//
+// Tests for the compact pose blob: quantization accuracy, the wire layout
+// and decoding from a received OSC message
+//
+
+#include "SenderTestSupport.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "CompactPose.h"
+#include "OutputProfile.h"
+#include "osc/OscOutboundPacketStream.h"
+
+// Angle between two rotations, in degrees. From the chord length, which
+// unlike acos of the dot product stays accurate for tiny angles.
+static double AngleBetween(const float a[4], const float b[4]) {
+	double dot = 0, difference = 0, sum = 0;
+	for (int k = 0; k < 4; k++) {
+		dot += static_cast<double>(a[k]) * b[k];
+		difference += (static_cast<double>(a[k]) - b[k]) * (static_cast<double>(a[k]) - b[k]);
+		sum += (static_cast<double>(a[k]) + b[k]) * (static_cast<double>(a[k]) + b[k]);
+	}
+	double chord = sqrt(dot < 0 ? sum : difference);
+	return 4 * asin(chord / 2 < 1 ? chord / 2 : 1) * 180 / 3.14159265358979323846;
+}
+
+static void RandomQuaternion(float q[4]) {
+	double norm = 0;
+	double v[4];
+	for (int k = 0; k < 4; k++) {
+		v[k] = rand() / static_cast<double>(RAND_MAX) * 2 - 1;
+		norm += v[k] * v[k];
+	}
+	norm = sqrt(norm);
+	for (int k = 0; k < 4; k++)
+		q[k] = static_cast<float>(v[k] / norm);
+}
+
+// Worst position and angle error over many random poses
+static void RoundTrip(const CompactPoseFormat &format, float range, double &positionError, double &angleError) {
+	positionError = angleError = 0;
+	srand(17);
+	for (int batch = 0; batch < 100; batch++) {
+		CompactPose sent[k_unMaxDeviceCount];
+		CompactPoseWriter writer;
+		writer.Begin(format);
+		for (int n = 0; n < static_cast<int>(k_unMaxDeviceCount); n++) {
+			sent[n].isController = (n % 3) == 0;
+			sent[n].ordinal = n + 1;
+			for (int k = 0; k < 3; k++)
+				sent[n].position[k] = (rand() / static_cast<float>(RAND_MAX) * 2 - 1) * range;
+			RandomQuaternion(sent[n].quaternion);
+			writer.Add(sent[n].isController, sent[n].ordinal, sent[n].position, sent[n].quaternion);
+		}
+		assertEqual(writer.Size(), k_unCompactPoseHeaderSize + k_unMaxDeviceCount * format.RecordSize());
+
+		CompactPose received[k_unMaxDeviceCount];
+		CompactPoseFormat decodedFormat;
+		int count = 0;
+		assertTrue(DecodeCompactPoses(writer.Data(), writer.Size(), decodedFormat, received, k_unMaxDeviceCount, count));
+		assertEqual(count, static_cast<int>(k_unMaxDeviceCount));
+		assertTrue(decodedFormat == format);
+		for (int n = 0; n < count; n++) {
+			if (received[n].isController != sent[n].isController || received[n].ordinal != sent[n].ordinal)
+				fail_("device id", __FILE__, __LINE__);
+			for (int k = 0; k < 3; k++) {
+				double error = fabs(received[n].position[k] - sent[n].position[k]);
+				if (error > positionError) positionError = error;
+			}
+			double angle = AngleBetween(received[n].quaternion, sent[n].quaternion);
+			if (angle > angleError) angleError = angle;
+		}
+	}
+}
+
+static void TestRoundTripAccuracy() {
+	double positionError, angleError;
+
+	// Defaults: 0.2 mm, 16 bit positions, 15 bit rotations, 13 bytes a device
+	CompactPoseFormat format;
+	assertEqual(format.RecordSize(), static_cast<std::size_t>(13));
+	RoundTrip(format, 6.0f, positionError, angleError);
+	assertTrue(positionError <= 0.0001 + 1e-6);
+	assertTrue(angleError < 0.01);
+	std::cout << "    16/15 bits: " << positionError * 1000 << " mm, " << angleError << " degrees\n";
+
+	// Fine 24 bit positions, coarse 10 bit rotations, 14 bytes a device
+	format.resolution = 0.00001f;
+	format.positionBits = 24;
+	format.rotationBits = 10;
+	assertEqual(format.RecordSize(), static_cast<std::size_t>(14));
+	RoundTrip(format, 50.0f, positionError, angleError);
+	assertTrue(positionError <= 0.000005 + 1e-5);
+	assertTrue(angleError < 0.25);
+	std::cout << "    24/10 bits: " << positionError * 1000 << " mm, " << angleError << " degrees\n";
+}
+
+static void TestLayoutAndClamping() {
+	CompactPoseFormat format;
+	CompactPoseWriter writer;
+	writer.Begin(format);
+
+	// The identity, and a position far outside the 16 bit range
+	const float position[3] = { 0.001f, -100.0f, 100.0f };
+	const float identity[4] = { 1, 0, 0, 0 };
+	assertTrue(writer.Add(false, 5, position, identity));
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(writer.Data());
+	assertEqual(static_cast<int>(p[0]), k_nCompactPoseVersion);
+	assertEqual(static_cast<int>(p[1]), 16);
+	assertEqual(static_cast<int>(p[2]), 15);
+	assertEqual(static_cast<int>(p[3]), 1);
+	assertEqual(static_cast<int>(p[8]), 5);					// tracker 5
+	assertEqual(p[9] * 256 + p[10], 5);						// 1 mm in 0.2 mm steps
+	assertEqual(p[11] * 256 + p[12], 0x8001);				// clamped to -32767
+	assertEqual(p[13] * 256 + p[14], 0x7fff);
+	assertEqual(static_cast<int>(p[15] >> 6), 0);			// w is the largest
+
+	// -q is the same rotation, and comes out with a positive largest component
+	const float negated[4] = { -1, 0, 0, 0 };
+	writer.Begin(format);
+	writer.Add(true, 2, position, negated);
+	CompactPose pose;
+	int count = 0;
+	assertTrue(DecodeCompactPoses(writer.Data(), writer.Size(), format, &pose, 1, count));
+	assertTrue(pose.isController);
+	assertEqual(pose.ordinal, 2);
+	assertNear(pose.quaternion[0], 1.0, 1e-6);
+	assertNear(pose.position[1], -32767 * 0.0002, 1e-6);
+}
+
+static void TestMalformedBlobs() {
+	CompactPoseFormat format;
+	CompactPoseWriter writer;
+	writer.Begin(format);
+	const float position[3] = { 0, 0, 0 };
+	const float identity[4] = { 1, 0, 0, 0 };
+	writer.Add(false, 1, position, identity);
+
+	CompactPose pose;
+	int count = 1;
+	char copy[64];
+	memcpy(copy, writer.Data(), writer.Size());
+	assertTrue(!DecodeCompactPoses(copy, writer.Size() - 1, format, &pose, 1, count));
+	assertEqual(count, 0);
+	assertTrue(!DecodeCompactPoses(copy, 4, format, &pose, 1, count));
+	copy[0] = 2;	// unknown version
+	assertTrue(!DecodeCompactPoses(copy, writer.Size(), format, &pose, 1, count));
+	copy[0] = static_cast<char>(k_nCompactPoseVersion);
+	copy[2] = 16;	// too many rotation bits
+	assertTrue(!DecodeCompactPoses(copy, writer.Size(), format, &pose, 1, count));
+
+	assertTrue(!ParseCompactPoseFormat("0.1,20", format));
+	assertTrue(!ParseCompactPoseFormat("0.1,16,9", format));
+	assertTrue(ParseCompactPoseFormat("0.05,24,12", format));
+	assertNear(format.resolution, 0.00005, 1e-9);
+	assertEqual(format.positionBits, 24);
+	assertEqual(format.rotationBits, 12);
+}
+
+static void TestReceivedMessage() {
+	CompactPoseFormat format;
+	CompactPoseWriter writer;
+	writer.Begin(format);
+	const float position[3] = { 1.0f, 1.5f, -2.0f };
+	const float rotation[4] = { 0.5f, 0.5f, -0.5f, 0.5f };
+	writer.Add(false, 1, position, rotation);
+	writer.Add(true, 1, position, rotation);
+
+	char buffer[256];
+	osc::OutboundPacketStream p(buffer, sizeof(buffer));
+	p << osc::BeginMessage(k_pchCompactPoseAddress)
+		<< osc::Blob(writer.Data(), static_cast<osc::osc_bundle_element_size_t>(writer.Size())) << osc::EndMessage;
+
+	// 2 devices in 52 bytes, as float messages they are 108
+	assertEqual(p.Size(), static_cast<std::size_t>(8 + 4 + 4 + 36));
+
+	osc::ReceivedMessage m(osc::ReceivedPacket(p.Data(), static_cast<osc::osc_bundle_element_size_t>(p.Size())));
+	CompactPose poses[4];
+	int count = 0;
+	assertTrue(DecodeCompactPoses(*m.ArgumentsBegin(), format, poses, 4, count));
+	assertEqual(count, 2);
+	assertTrue(!poses[0].isController && poses[1].isController);
+	assertNear(poses[1].position[2], -2.0, 0.0001);
+	assertTrue(AngleBetween(poses[1].quaternion, rotation) < 0.01);
+
+	// A float argument is not a blob
+	p.Clear();
+	p << osc::BeginMessage(k_pchCompactPoseAddress) << 1.0f << osc::EndMessage;
+	osc::ReceivedMessage wrong(osc::ReceivedPacket(p.Data(), static_cast<osc::osc_bundle_element_size_t>(p.Size())));
+	bool threw = false;
+	try {
+		DecodeCompactPoses(*wrong.ArgumentsBegin(), format, poses, 4, count);
+	} catch (osc::WrongArgumentTypeException &) {
+		threw = true;
+	}
+	assertTrue(threw);
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestRoundTripAccuracy();
+	TestLayoutAndClamping();
+	TestMalformedBlobs();
+	TestReceivedMessage();
+	return PrintTestSummary();
+}
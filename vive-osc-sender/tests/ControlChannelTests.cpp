@@ -0,0 +1,92 @@
+//
+// Tests for ControlChannel: requests from the control port and from
+// signals reach the frame loop's flags
+//
+
+#include "SenderTestSupport.h"
+
+#include <signal.h>
+#include <chrono>
+#include <thread>
+
+#include "ControlChannel.h"
+#include "osc/OscOutboundPacketStream.h"
+
+static const int k_nTestPort = 17331;
+
+static void SendControlMessage(const char *address) {
+	char buffer[256];
+	osc::OutboundPacketStream p(buffer, sizeof(buffer));
+	p << osc::BeginMessage(address) << osc::EndMessage;
+	UdpTransmitSocket socket(IpEndpointName("127.0.0.1", k_nTestPort));
+	socket.Send(p.Data(), p.Size());
+}
+
+// Polls like the frame loop would, for up to a second
+template<typename Condition>
+static bool WaitFor(Condition condition) {
+	for (int n = 0; n < 1000; n++) {
+		if (condition())
+			return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return false;
+}
+
+static void TestControlPort() {
+	ControlChannel control;
+	assertTrue(control.Start(k_nTestPort));
+	assertTrue(!control.QuitRequested());
+	assertTrue(!control.TakeDeviceListRequest());
+
+	// Garbage doesn't stop the control thread
+	UdpTransmitSocket socket(IpEndpointName("127.0.0.1", k_nTestPort));
+	socket.Send("not osc", 7);
+
+	SendControlMessage(k_pchDevicesAddress);
+	assertTrue(WaitFor([&] { return control.TakeDeviceListRequest(); }));
+	assertTrue(!control.TakeDeviceListRequest());
+
+	SendControlMessage(k_pchLatencyAddress);
+	assertTrue(WaitFor([&] { return control.TakeLatencyRequest(); }));
+	assertTrue(!control.TakeLatencyRequest());
+
+	SendControlMessage(k_pchKeyframeAddress);
+	assertTrue(WaitFor([&] { return control.TakeKeyframeRequest(); }));
+	assertTrue(!control.TakeKeyframeRequest());
+
+	SendControlMessage(k_pchQuitAddress);
+	assertTrue(WaitFor([&] { return control.QuitRequested(); }));
+	control.Stop();
+}
+
+#ifndef _WIN32
+static void TestSignals() {
+	ControlChannel control;
+	assertTrue(control.Start(0));
+
+	raise(SIGUSR1);
+	assertTrue(control.TakeDeviceListRequest());
+	assertTrue(!control.QuitRequested());
+
+	raise(SIGUSR2);
+	assertTrue(control.TakeLatencyRequest());
+	assertTrue(!control.TakeDeviceListRequest());
+
+	raise(SIGTERM);
+	assertTrue(control.QuitRequested());
+	control.Stop();
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestControlPort();
+#ifndef _WIN32
+	TestSignals();
+#endif
+	return PrintTestSummary();
+}
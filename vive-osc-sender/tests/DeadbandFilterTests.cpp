@@ -0,0 +1,143 @@
+//
+// Tests for DeadbandFilter: still devices are suppressed until the
+// keepalive, movement past either threshold and any change of the other
+// values are sent right away
+//
+
+#include "SenderTestSupport.h"
+
+#include <math.h>
+
+#include "DeadbandFilter.h"
+
+static const int64_t k_ulMillisecond = 1000000;
+
+static DeadbandConfig TestConfig() {
+	DeadbandConfig config;
+	config.enabled = true;
+	config.positionThreshold = 0.002f;	// 2 mm
+	config.angleThreshold = 1.0f;		// 1 degree
+	config.keepaliveSeconds = 0.1;
+	return config;
+}
+
+static void TestStillDeviceOnlyKeepalive() {
+	DeadbandFilter filter;
+	filter.SetConfig(TestConfig());
+	filter.Reset(3, "/tracker/1");
+
+	float position[3] = { 1.0f, 1.5f, -0.5f };
+	float quaternion[4] = { 1, 0, 0, 0 };
+
+	// 2 ms frames for a second, with sub-threshold jitter
+	int sent = 0;
+	for (int frame = 0; frame < 500; frame++) {
+		position[0] = 1.0f + ((frame % 2) ? 0.0005f : -0.0005f);
+		if (filter.ShouldSend(3, position, quaternion, NULL, 0, frame * 2 * k_ulMillisecond))
+			sent++;
+	}
+
+	// The first frame, then one every 100 ms
+	assertEqual(sent, 10);
+	assertEqual(filter.Sent(3), 10ul);
+	assertEqual(filter.Keepalives(3), 9ul);
+	assertEqual(filter.Suppressed(3), 490ul);
+}
+
+static void TestMovementIsSent() {
+	DeadbandFilter filter;
+	filter.SetConfig(TestConfig());
+	filter.Reset(0, "/tracker/1");
+
+	float position[3] = { 0, 0, 0 };
+	float quaternion[4] = { 1, 0, 0, 0 };
+	assertTrue(filter.ShouldSend(0, position, quaternion, NULL, 0, 0));
+
+	// Drift is compared with the last sent pose, so it adds up
+	position[0] = 0.0015f;
+	assertTrue(!filter.ShouldSend(0, position, quaternion, NULL, 0, 1 * k_ulMillisecond));
+	position[0] = 0.0025f;
+	assertTrue(filter.ShouldSend(0, position, quaternion, NULL, 0, 2 * k_ulMillisecond));
+
+	// 0.8 degrees is inside the deadband, 1.2 degrees isn't
+	double half = 0.8 * 3.14159265358979 / 180 / 2;
+	float turned[4] = { static_cast<float>(cos(half)), 0, static_cast<float>(sin(half)), 0 };
+	assertTrue(!filter.ShouldSend(0, position, turned, NULL, 0, 3 * k_ulMillisecond));
+	half = 1.2 * 3.14159265358979 / 180 / 2;
+	turned[0] = static_cast<float>(cos(half));
+	turned[2] = static_cast<float>(sin(half));
+	assertTrue(filter.ShouldSend(0, position, turned, NULL, 0, 4 * k_ulMillisecond));
+
+	// -q is the same rotation as q
+	float negated[4] = { -turned[0], -turned[1], -turned[2], -turned[3] };
+	assertTrue(!filter.ShouldSend(0, position, negated, NULL, 0, 5 * k_ulMillisecond));
+
+	// A trigger change always goes out
+	float trigger = 0;
+	assertTrue(filter.ShouldSend(0, position, turned, &trigger, 1, 6 * k_ulMillisecond));
+	assertTrue(!filter.ShouldSend(0, position, turned, &trigger, 1, 7 * k_ulMillisecond));
+	trigger = 0.25f;
+	assertTrue(filter.ShouldSend(0, position, turned, &trigger, 1, 8 * k_ulMillisecond));
+}
+
+// A controller held still while the thumb moves on the trackpad, then
+// a tracker whose velocity changes: any change is sent, however small
+static void TestValueChangesAreSent() {
+	DeadbandFilter filter;
+	filter.SetConfig(TestConfig());
+	filter.Reset(1, "/controller/1");
+
+	float position[3] = { 0, 1, 0 };
+	float quaternion[4] = { 1, 0, 0, 0 };
+	float controls[3] = { 0, 0, 0 };	// trigger, axis x, axis y
+	assertTrue(filter.ShouldSend(1, position, quaternion, controls, 3, 0));
+	assertTrue(!filter.ShouldSend(1, position, quaternion, controls, 3, k_ulMillisecond));
+	int64_t now = 2 * k_ulMillisecond;
+	for (int step = 1; step <= 10; step++, now += k_ulMillisecond) {
+		controls[1] = step * 0.001f;
+		controls[2] = -step * 0.002f;
+		assertTrue(filter.ShouldSend(1, position, quaternion, controls, 3, now));
+	}
+	assertTrue(!filter.ShouldSend(1, position, quaternion, controls, 3, now));
+	assertEqual(filter.Keepalives(1), 0ul);
+
+	filter.Reset(2, "/tracker/1");
+	float velocities[6] = { 0, 0, 0, 0, 0, 0 };	// velocity, angular velocity
+	assertTrue(filter.ShouldSend(2, position, quaternion, velocities, 6, 0));
+	assertTrue(!filter.ShouldSend(2, position, quaternion, velocities, 6, k_ulMillisecond));
+	velocities[4] = 0.01f;
+	assertTrue(filter.ShouldSend(2, position, quaternion, velocities, 6, 2 * k_ulMillisecond));
+}
+
+static void TestResetAndDisabled() {
+	DeadbandFilter filter;
+	filter.SetConfig(TestConfig());
+	filter.Reset(5, "/tracker/2");
+
+	float position[3] = { 0, 1, 0 };
+	float quaternion[4] = { 1, 0, 0, 0 };
+	assertTrue(filter.ShouldSend(5, position, quaternion, NULL, 0, 0));
+	assertTrue(!filter.ShouldSend(5, position, quaternion, NULL, 0, k_ulMillisecond));
+
+	// A renumbered device is sent at once under its new address
+	filter.Reset(5, "/tracker/1");
+	assertTrue(filter.ShouldSend(5, position, quaternion, NULL, 0, 2 * k_ulMillisecond));
+
+	DeadbandConfig off = TestConfig();
+	off.enabled = false;
+	filter.SetConfig(off);
+	assertTrue(filter.ShouldSend(5, position, quaternion, NULL, 0, 3 * k_ulMillisecond));
+	assertTrue(filter.ShouldSend(5, position, quaternion, NULL, 0, 4 * k_ulMillisecond));
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestStillDeviceOnlyKeepalive();
+	TestMovementIsSent();
+	TestValueChangesAreSent();
+	TestResetAndDisabled();
+	return PrintTestSummary();
+}
@@ -0,0 +1,120 @@
+//
+// Tests for DeviceRegistry: addresses are numbered like the per-frame scan
+// used to number them, and property queries only happen on events
+//
+
+#include "SenderTestSupport.h"
+
+#include <string.h>
+
+#include "DeviceRegistry.h"
+#include "SyntheticPoseSource.h"
+
+// Counts the property queries that would be IPC calls with OpenVR
+class CountingPoseSource : public PoseSource {
+public:
+	SyntheticPoseSource inner;
+	unsigned long queries = 0;
+
+	CountingPoseSource(const SyntheticConfig &config) : inner(config) {}
+
+	bool IsDeviceConnected(DeviceIndex device) { queries++; return inner.IsDeviceConnected(device); }
+	DeviceClass GetDeviceClass(DeviceIndex device) { queries++; return inner.GetDeviceClass(device); }
+	ControllerRole GetControllerRole(DeviceIndex device) { queries++; return inner.GetControllerRole(device); }
+	bool GetDeviceString(DeviceIndex device, DeviceString prop, char *buf, uint32_t bufSize) { queries++; return inner.GetDeviceString(device, prop, buf, bufSize); }
+	const char *GetControllerAxisTypeName(DeviceIndex device, int axis) { return inner.GetControllerAxisTypeName(device, axis); }
+	bool GetDevicePose(DeviceIndex device, DevicePose *pose, ControllerState *controllerState) { return inner.GetDevicePose(device, pose, controllerState); }
+	void GetDevicePoses(DevicePose *poses, uint32_t count) { inner.GetDevicePoses(poses, count); }
+	bool GetControllerState(DeviceIndex device, ControllerState *controllerState) { return inner.GetControllerState(device, controllerState); }
+	bool PollNextEvent(DeviceEvent *event) { return inner.PollNextEvent(event); }
+};
+
+static SyntheticConfig TestConfig() {
+	SyntheticConfig config;
+	config.controllerCount = 2;
+	config.trackerCount = 3;
+	config.baseStationCount = 2;
+	config.includeHmd = true;
+	return config;
+}
+
+static const RegisteredDevice *FindAddress(const DeviceRegistry &registry, const char *address) {
+	for (int n = 0; n < registry.DeviceCount(); n++)
+		if (strcmp(registry.Device(n).oscAddress, address) == 0)
+			return &registry.Device(n);
+	return NULL;
+}
+
+static void TestAddressesInSlotOrder() {
+	CountingPoseSource source(TestConfig());
+	DeviceRegistry registry;
+	registry.Refresh(source);
+
+	// HMD, 2 base stations, 2 controllers, 3 trackers
+	assertEqual(registry.DeviceCount(), 8);
+	assertEqual(registry.Device(0).deviceClass, DeviceClass_HMD);
+	assertEqual(registry.Device(0).oscAddress[0], '\0');
+
+	const RegisteredDevice *controller = FindAddress(registry, "/controller/2");
+	const RegisteredDevice *tracker = FindAddress(registry, "/tracker/3");
+	assertTrue(controller != NULL && controller->deviceClass == DeviceClass_Controller);
+	assertTrue(tracker != NULL && tracker->deviceClass == DeviceClass_GenericTracker);
+	assertTrue(tracker != NULL && tracker->serial[0] != '\0');
+	assertTrue(FindAddress(registry, "/tracker/4") == NULL);
+
+	bool slotOrder = true;
+	for (int n = 1; n < registry.DeviceCount(); n++)
+		slotOrder = slotOrder && registry.Device(n - 1).unDevice < registry.Device(n).unDevice;
+	assertTrue(slotOrder);
+}
+
+static void TestDeactivationRenumbers() {
+	CountingPoseSource source(TestConfig());
+	DeviceRegistry registry;
+	registry.Refresh(source);
+	unsigned int generation = registry.Generation();
+
+	const RegisteredDevice *first = FindAddress(registry, "/tracker/1");
+	DeviceIndex firstTracker = first->unDevice;
+	DeviceIndex secondTracker = FindAddress(registry, "/tracker/2")->unDevice;
+	source.inner.SetDeviceConnected(firstTracker, false);
+
+	DeviceEvent event;
+	assertTrue(source.PollNextEvent(&event));
+	assertTrue(registry.ProcessEvent(source, event));
+	assertTrue(registry.Generation() != generation);
+	assertEqual(registry.DeviceCount(), 7);
+	assertEqual(FindAddress(registry, "/tracker/1")->unDevice, secondTracker);
+	assertTrue(FindAddress(registry, "/tracker/3") == NULL);
+}
+
+static void TestOnlyEventsQuery() {
+	CountingPoseSource source(TestConfig());
+	DeviceRegistry registry;
+	registry.Refresh(source);
+	unsigned long afterRefresh = source.queries;
+	unsigned int generation = registry.Generation();
+
+	// Events that don't change anything kept in the registry cost nothing
+	DeviceEvent updated = { DeviceEvent_Updated, registry.Device(3).unDevice };
+	assertTrue(!registry.ProcessEvent(source, updated));
+	assertEqual(source.queries, afterRefresh);
+
+	// A property change re-reads one device only, without a full rescan
+	DeviceEvent property = { DeviceEvent_PropertyChanged, registry.Device(3).unDevice };
+	assertTrue(!registry.ProcessEvent(source, property));
+	assertTrue(source.queries - afterRefresh < 5);
+	assertEqual(registry.Generation(), generation);
+	assertEqual(registry.Refreshes(), 1ul);
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestAddressesInSlotOrder();
+	TestDeactivationRenumbers();
+	TestOnlyEventsQuery();
+	return PrintTestSummary();
+}
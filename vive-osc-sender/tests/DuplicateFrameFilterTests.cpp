@@ -0,0 +1,140 @@
+//
+// Tests for DuplicateFrameFilter: frames that repeat the last one bit for
+// bit are counted and, when enabled, dropped until the keepalive, and a
+// poll rate above the sample rate drops the repeats before anything is sent
+//
+
+#include "SenderTestSupport.h"
+
+#include <string.h>
+
+#include "DuplicateFrameFilter.h"
+#include "SyntheticPoseSource.h"
+#include "LighthouseTracking.h"
+
+static const int64_t k_ulMillisecond = 1000000;
+static const int k_nTestPort = 17381;
+
+// Two devices at rest
+static void MakeFrame(TrackingFrame &frame, int64_t captureTimeNs) {
+	memset(&frame, 0, sizeof(frame));
+	frame.captureTimeNs = captureTimeNs;
+	frame.templateGeneration = 1;
+	frame.deviceCount = 2;
+	for (int n = 0; n < frame.deviceCount; n++) {
+		TrackedDeviceSample &sample = frame.devices[n];
+		sample.unDevice = 3 + n;
+		sample.deviceClass = DeviceClass_GenericTracker;
+		sample.pose.mDeviceToAbsoluteTracking.m[0][0] = 1;
+		sample.pose.mDeviceToAbsoluteTracking.m[1][1] = 1;
+		sample.pose.mDeviceToAbsoluteTracking.m[2][2] = 1;
+		sample.pose.mDeviceToAbsoluteTracking.m[1][3] = 1.5f;
+		sample.pose.bPoseIsValid = true;
+		sample.pose.bTrackingOK = true;
+	}
+}
+
+static void TestDetection() {
+	DuplicateFrameFilter filter;
+	filter.SetConfig(true, 0);
+	TrackingFrame *frame = new TrackingFrame;
+
+	MakeFrame(*frame, 0);
+	assertTrue(!filter.Drop(*frame));
+	MakeFrame(*frame, 2 * k_ulMillisecond);
+	assertTrue(filter.Drop(*frame));
+
+	// Any value of any device, to the last bit
+	frame->devices[1].pose.vAngularVelocity.v[2] = 1e-30f;
+	assertTrue(!filter.Drop(*frame));
+	assertTrue(filter.Drop(*frame));
+	frame->devices[0].trigger = 0.25f;
+	assertTrue(!filter.Drop(*frame));
+	frame->devices[0].axes[1] = -0.0f;
+	assertTrue(!filter.Drop(*frame));
+
+	// A device more or less, or renumbered ones, is a new frame
+	frame->deviceCount = 1;
+	assertTrue(!filter.Drop(*frame));
+	frame->deviceCount = 2;
+	assertTrue(!filter.Drop(*frame));
+	frame->templateGeneration = 2;
+	assertTrue(!filter.Drop(*frame));
+	frame->devices[1].unDevice = 7;
+	assertTrue(!filter.Drop(*frame));
+	assertTrue(filter.Drop(*frame));
+
+	assertEqual(filter.Frames(), 11ul);
+	assertEqual(filter.Duplicates(), 3ul);
+	assertEqual(filter.Dropped(), 3ul);
+
+	// Disabled, duplicates are only counted
+	filter.SetConfig(false, 0);
+	assertTrue(!filter.Drop(*frame));
+	assertEqual(filter.Duplicates(), 4ul);
+	assertEqual(filter.Dropped(), 3ul);
+	delete frame;
+}
+
+// A runtime that stopped updating still gets a frame out every keepalive
+static void TestKeepalive() {
+	DuplicateFrameFilter filter;
+	filter.SetConfig(true, 0.1);
+	TrackingFrame *frame = new TrackingFrame;
+
+	int sent = 0;
+	for (int n = 0; n < 500; n++) {
+		MakeFrame(*frame, n * 2 * k_ulMillisecond);
+		if (!filter.Drop(*frame))
+			sent++;
+	}
+
+	// The first frame, then one every 100 ms
+	assertEqual(sent, 10);
+	assertEqual(filter.Duplicates(), 499ul);
+	assertEqual(filter.Dropped(), 490ul);
+	delete frame;
+}
+
+// Polled at 500 Hz, updated at 250 Hz: every other frame is a repeat
+static void TestPollingFasterThanSamples(bool dedup) {
+	SyntheticConfig config;
+	config.trackerCount = 4;
+	config.sampleRate = 250;
+	SyntheticPoseSource source(config);
+	LighthouseTracking tracking(&source, IpEndpointName("127.0.0.1", k_nTestPort));
+	tracking.SetFrameBundling(true);
+	tracking.SetFrameDedup(dedup, 0);
+
+	// Halfway between sample times, so every sample spans two polls
+	const int k_nFrames = 1000;
+	for (int n = 0; n < k_nFrames; n++) {
+		source.SetTime(0.001 + n * 0.002);
+		tracking.RunProcedure();
+	}
+
+	const DuplicateFrameFilter &duplicates = tracking.DuplicateFrames();
+	assertEqual(duplicates.Frames(), static_cast<unsigned long>(k_nFrames));
+	assertEqual(duplicates.Duplicates(), static_cast<unsigned long>(k_nFrames / 2));
+	if (dedup) {
+		assertEqual(duplicates.Dropped(), static_cast<unsigned long>(k_nFrames / 2));
+		assertEqual(tracking.PacketsSent(), static_cast<unsigned long>(k_nFrames / 2));
+	} else {
+		assertEqual(duplicates.Dropped(), 0ul);
+		assertEqual(tracking.PacketsSent(), static_cast<unsigned long>(k_nFrames));
+	}
+	assertTrue(duplicates.PollRate() > 0);
+	assertTrue(duplicates.UpdateRate() > 0 && duplicates.UpdateRate() < duplicates.PollRate());
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestDetection();
+	TestKeepalive();
+	TestPollingFasterThanSamples(false);
+	TestPollingFasterThanSamples(true);
+	return PrintTestSummary();
+}
@@ -0,0 +1,157 @@
+//
+// Tests for FramePacker: per device datagrams vs. per frame bundles
+//
+
+#include "SenderTestSupport.h"
+
+#include <string.h>
+#include <vector>
+
+#include "FramePacker.h"
+#include "osc/OscOutboundPacketStream.h"
+#include "osc/OscReceivedElements.h"
+
+static const int k_nTestPort = 17301;
+
+// Loopback pair: packets sent by the packer land in receiveSocket
+struct Loopback {
+	UdpReceiveSocket receiveSocket;
+	UdpFanout fanout;
+
+	Loopback()
+		: receiveSocket(IpEndpointName("127.0.0.1", k_nTestPort)) {
+		fanout.AddDestination(IpEndpointName("127.0.0.1", k_nTestPort));
+	}
+
+	std::size_t Receive(char *buffer, std::size_t size) {
+		IpEndpointName from;
+		return receiveSocket.ReceiveFrom(from, buffer, size);
+	}
+};
+
+// A tracker style message, 7 floats
+static std::size_t MakeMessage(char *buffer, std::size_t size, int device) {
+	char address[32];
+	snprintf(address, sizeof(address), "/tracker/%d", device);
+	osc::OutboundPacketStream p(buffer, size);
+	p << osc::BeginMessage(address);
+	for (int i = 0; i < 7; i++)
+		p << static_cast<float>(device * 10 + i);
+	p << osc::EndMessage;
+	return p.Size();
+}
+
+static void TestUnbundled() {
+	Loopback loopback;
+	FramePacker packer(loopback.fanout);
+
+	char message[256];
+	packer.BeginFrame(1);
+	for (int device = 0; device < 3; device++)
+		packer.AddMessage(message, MakeMessage(message, sizeof(message), device));
+	packer.EndFrame();
+	loopback.fanout.Flush();
+
+	assertEqual(packer.PacketsSent(), 3UL);
+	assertEqual(packer.MessagesSent(), 3UL);
+
+	char buffer[2048];
+	for (int device = 0; device < 3; device++) {
+		std::size_t size = loopback.Receive(buffer, sizeof(buffer));
+		osc::ReceivedPacket packet(buffer, static_cast<osc::osc_bundle_element_size_t>(size));
+		assertTrue(packet.IsMessage());
+		assertEqual(osc::ReceivedMessage(packet).ArgumentCount(), 7U);
+	}
+}
+
+static void TestBundledFrameIsSplitAtMaxPacketSize() {
+	Loopback loopback;
+	FramePacker packer(loopback.fanout);
+
+	char message[256];
+	std::size_t messageSize = MakeMessage(message, sizeof(message), 0);
+
+	// Header plus three size-prefixed messages fit, a fourth doesn't
+	std::size_t maxPacketSize = 16 + 3 * (4 + messageSize) + 2;
+	packer.SetFrameBundling(true, maxPacketSize);
+
+	const osc::uint64 timeTag = 0x0123456789abcdefULL;
+	const int deviceCount = 10;
+	packer.BeginFrame(timeTag);
+	for (int device = 0; device < deviceCount; device++)
+		packer.AddMessage(message, MakeMessage(message, sizeof(message), device));
+	packer.EndFrame();
+	loopback.fanout.Flush();
+
+	assertEqual(packer.PacketsSent(), 4UL);
+	assertEqual(packer.MessagesSent(), static_cast<unsigned long>(deviceCount));
+
+	// Messages arrive in order, every part stamped with the frame time
+	char buffer[2048];
+	int nextDevice = 0;
+	for (int part = 0; part < 4; part++) {
+		std::size_t size = loopback.Receive(buffer, sizeof(buffer));
+		assertTrue(size <= maxPacketSize);
+
+		osc::ReceivedPacket packet(buffer, static_cast<osc::osc_bundle_element_size_t>(size));
+		assertTrue(packet.IsBundle());
+		osc::ReceivedBundle bundle(packet);
+		assertEqual(bundle.TimeTag(), timeTag);
+
+		for (osc::ReceivedBundle::const_iterator i = bundle.ElementsBegin(); i != bundle.ElementsEnd(); ++i) {
+			osc::ReceivedMessage m(*i);
+			char expected[32];
+			snprintf(expected, sizeof(expected), "/tracker/%d", nextDevice++);
+			assertEqual(strcmp(m.AddressPattern(), expected), 0);
+		}
+	}
+	assertEqual(nextDevice, deviceCount);
+}
+
+// A message too large for any datagram is dropped, and counted as such
+static void TestOversizedMessageIsDropped() {
+	Loopback loopback;
+	FramePacker packer(loopback.fanout);
+	packer.SetFrameBundling(true);
+
+	std::vector<char> huge(k_unMaxUdpPacketSize, 0);
+	char message[256];
+	packer.BeginFrame(1);
+	packer.AddMessage(&huge[0], huge.size());
+	packer.AddMessage(message, MakeMessage(message, sizeof(message), 0));
+	packer.EndFrame();
+	loopback.fanout.Flush();
+
+	assertEqual(packer.MessagesSent(), 1UL);
+	assertEqual(packer.MessagesDropped(), 1UL);
+	assertEqual(packer.PacketsSent(), 1UL);
+
+	char buffer[2048];
+	std::size_t size = loopback.Receive(buffer, sizeof(buffer));
+	osc::ReceivedBundle bundle(osc::ReceivedPacket(buffer, static_cast<osc::osc_bundle_element_size_t>(size)));
+	assertEqual(bundle.ElementCount(), 1U);
+}
+
+static void TestEmptyFrameSendsNothing() {
+	Loopback loopback;
+	FramePacker packer(loopback.fanout);
+	packer.SetFrameBundling(true);
+
+	packer.BeginFrame(1);
+	packer.EndFrame();
+	loopback.fanout.Flush();
+	assertEqual(packer.PacketsSent(), 0UL);
+	assertEqual(loopback.fanout.SendCalls(), 0UL);
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestUnbundled();
+	TestBundledFrameIsSplitAtMaxPacketSize();
+	TestOversizedMessageIsDropped();
+	TestEmptyFrameSendsNothing();
+	return PrintTestSummary();
+}
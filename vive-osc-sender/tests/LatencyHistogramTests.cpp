@@ -0,0 +1,95 @@
+//
+// Tests for LatencyHistogram: bucket layout, percentiles and concurrent
+// reading while recording
+//
+
+#include "SenderTestSupport.h"
+
+#include <atomic>
+#include <thread>
+
+#include "LatencyHistogram.h"
+
+static void TestBuckets() {
+	// Small values are exact, buckets tile the range without gaps
+	for (int64_t v = 0; v < 64; v++)
+		assertEqual(LatencyHistogram::BucketIndex(v), static_cast<int>(v));
+	bool contiguous = true, precise = true, inside = true;
+	for (int n = 0; n + 1 < k_nLatencyBucketCount; n++) {
+		int64_t lowest = LatencyHistogram::BucketLowest(n);
+		int64_t highest = LatencyHistogram::BucketHighest(n);
+		if (LatencyHistogram::BucketLowest(n + 1) != highest + 1)
+			contiguous = false;
+		if ((highest - lowest + 1) * k_nLatencySubBuckets > lowest && lowest >= k_nLatencySubBuckets)
+			precise = false;
+		if (LatencyHistogram::BucketIndex(lowest) != n || LatencyHistogram::BucketIndex(highest) != n)
+			inside = false;
+	}
+	assertTrue(contiguous);
+	assertTrue(precise);
+	assertTrue(inside);
+
+	// Beyond the range everything lands in the last bucket
+	assertEqual(LatencyHistogram::BucketIndex(static_cast<int64_t>(1) << 40), k_nLatencyBucketCount - 1);
+}
+
+static void TestPercentiles() {
+	LatencyHistogram *histogram = new LatencyHistogram();
+	assertEqual(histogram->PercentileNanoseconds(0.5), static_cast<int64_t>(0));
+
+	// 1 us .. 100 ms, uniformly
+	for (int64_t v = 1; v <= 100000; v++)
+		histogram->Record(v * 1000);
+	assertEqual(histogram->Count(), static_cast<uint64_t>(100000));
+	assertEqual(histogram->MaxNanoseconds(), static_cast<int64_t>(100000000));
+	assertNear(histogram->MeanNanoseconds(), 50000500.0, 1.0);
+	assertNear(static_cast<double>(histogram->PercentileNanoseconds(0.5)), 50e6, 50e6 / 32);
+	assertNear(static_cast<double>(histogram->PercentileNanoseconds(0.99)), 99e6, 99e6 / 32);
+	assertNear(static_cast<double>(histogram->PercentileNanoseconds(0.999)), 99.9e6, 99.9e6 / 32);
+	assertEqual(histogram->PercentileNanoseconds(1.0), static_cast<int64_t>(100000000));
+
+	// Negative durations (a clock read out of order) count as 0
+	histogram->Record(-5);
+	assertEqual(histogram->PercentileNanoseconds(0), static_cast<int64_t>(0));
+	delete histogram;
+}
+
+static void TestConcurrentReading() {
+	PipelineLatency *latency = new PipelineLatency();
+	std::atomic<bool> done(false);
+	const uint64_t k_unSamples = 1000000;
+
+	std::thread writer([&] {
+		for (uint64_t n = 0; n < k_unSamples; n++)
+			latency->Record(PipelineStage_Frame, static_cast<int64_t>(n % 5000));
+		done = true;
+	});
+
+	// Counts only grow while the writer runs
+	uint64_t last = 0;
+	bool monotonic = true;
+	while (!done) {
+		uint64_t count = latency->Stage(PipelineStage_Frame).Count();
+		if (count < last)
+			monotonic = false;
+		last = count;
+		std::this_thread::yield();
+	}
+	writer.join();
+	assertTrue(monotonic);
+	assertEqual(latency->Stage(PipelineStage_Frame).Count(), k_unSamples);
+	assertEqual(latency->Stage(PipelineStage_Send).Count(), static_cast<uint64_t>(0));
+	assertEqual(latency->Stage(PipelineStage_Frame).MaxNanoseconds(), static_cast<int64_t>(4999));
+	delete latency;
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestBuckets();
+	TestPercentiles();
+	TestConcurrentReading();
+	return PrintTestSummary();
+}
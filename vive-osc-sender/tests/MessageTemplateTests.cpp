@@ -0,0 +1,89 @@
+//
+// Tests for MessageTemplate: patched templates must encode exactly like
+// a message built with OutboundPacketStream
+//
+
+#include "SenderTestSupport.h"
+
+#include <string.h>
+
+#include "MessageTemplate.h"
+#include "osc/OscOutboundPacketStream.h"
+
+static bool SameAsOutboundPacketStream(const MessageTemplate &message, const char *address, const float *values, int count) {
+	char buffer[256];
+	osc::OutboundPacketStream p(buffer, sizeof(buffer));
+	p << osc::BeginMessage(address);
+	for (int i = 0; i < count; i++)
+		p << values[i];
+	p << osc::EndMessage;
+
+	return p.Size() == message.Size() && memcmp(p.Data(), message.Data(), p.Size()) == 0;
+}
+
+static void TestPatchedFloatsMatchStream() {
+	// Address lengths around the 4 byte padding boundary
+	const char *addresses[] = { "/t", "/tr/", "/tracker/1", "/controller/12", "/abc" };
+	const float values[] = { 1.5f, -0.25f, 3.0e-8f, -123456.75f, 0.0f, -0.0f, 0.70710678f, 1.0f };
+
+	for (const char *address : addresses) {
+		for (int count = 7; count <= 8; count++) {
+			MessageTemplate message;
+			assertTrue(message.Build(address, count));
+			assertEqual(message.FloatCount(), count);
+
+			for (int i = 0; i < count; i++)
+				message.SetFloat(i, values[i]);
+			assertTrue(SameAsOutboundPacketStream(message, address, values, count));
+
+			// Patching again only touches the arguments
+			float shifted[8];
+			for (int i = 0; i < count; i++) {
+				shifted[i] = values[i] * 2 + 1;
+				message.SetFloat(i, shifted[i]);
+			}
+			assertTrue(SameAsOutboundPacketStream(message, address, shifted, count));
+		}
+	}
+}
+
+static void TestTimeTagMatchesStream() {
+	const float values[] = { 1.5f, -0.25f, 3.0e-8f };
+	const osc::uint64 timeTag = 0xe1234567890abcdeULL;
+
+	MessageTemplate message;
+	assertTrue(message.Build("/tracker/1", 3, true));
+	assertTrue(message.HasTimeTag());
+	for (int i = 0; i < 3; i++)
+		message.SetFloat(i, values[i]);
+	message.SetTimeTag(timeTag);
+
+	char buffer[256];
+	osc::OutboundPacketStream p(buffer, sizeof(buffer));
+	p << osc::BeginMessage("/tracker/1") << values[0] << values[1] << values[2] << osc::TimeTag(timeTag) << osc::EndMessage;
+	assertEqual(p.Size(), message.Size());
+	assertEqual(memcmp(p.Data(), message.Data(), p.Size()), 0);
+}
+
+static void TestOversizedAddressIsRejected() {
+	char address[k_unMaxTemplateSize + 1];
+	memset(address, 'a', sizeof(address) - 1);
+	address[0] = '/';
+	address[sizeof(address) - 1] = '\0';
+
+	MessageTemplate message;
+	assertTrue(!message.Build(address, 7));
+	assertTrue(!message.IsBuilt());
+	assertTrue(!message.Build("/tracker/1", k_unMaxTemplateFloats + 1));
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestPatchedFloatsMatchStream();
+	TestTimeTagMatchesStream();
+	TestOversizedAddressIsRejected();
+	return PrintTestSummary();
+}
@@ -0,0 +1,59 @@
+//
+// Tests for the OSC time tag conversions and NtpClock
+//
+
+#include "SenderTestSupport.h"
+
+#include <chrono>
+
+#include "NtpClock.h"
+#include "MonotonicClock.h"
+
+static void TestTimeTagConversions() {
+	// The unix epoch, and half a second past it
+	assertEqual(osc::TimeTagFromUnixNanoseconds(0), osc::NTP_UNIX_EPOCH_OFFSET_SECONDS << 32);
+	assertEqual(osc::TimeTagFromUnixNanoseconds(500000000), (osc::NTP_UNIX_EPOCH_OFFSET_SECONDS << 32) | 0x80000000UL);
+	assertEqual(osc::TimeTagToUnixNanoseconds(osc::NTP_UNIX_EPOCH_OFFSET_SECONDS << 32), static_cast<osc::int64>(0));
+
+	// Nanoseconds survive the round trip, fractions are finer than that
+	const osc::int64 times[] = { 1, 999999999, 1000000000, 1700000000123456789LL, 2000000000999999999LL };
+	for (osc::int64 t : times)
+		assertEqual(osc::TimeTagToUnixNanoseconds(osc::TimeTagFromUnixNanoseconds(t)), t);
+
+	const osc::uint64 tags[] = { 0x83aa7e8000000000ULL, 0xe5f1c2a3ffffffffULL, 0xe5f1c2a300000001ULL };
+	for (osc::uint64 tag : tags) {
+		osc::uint64 back = osc::TimeTagFromNtpNanoseconds(osc::TimeTagToNtpNanoseconds(tag));
+		assertTrue(back - tag + 3 <= 6);	// within a nanosecond, 2^-32 s units
+	}
+}
+
+static void TestClockFollowsWallClock() {
+	NtpClock clock;
+	int64_t monotonic = MonotonicNanoseconds();
+	int64_t wall = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	int64_t mapped = osc::TimeTagToUnixNanoseconds(clock.TimeTag(monotonic));
+	assertTrue(mapped - wall < 5000000 && wall - mapped < 5000000);
+	assertEqual(clock.Estimates(), 1UL);
+
+	// Between estimates tags keep the monotonic spacing exactly
+	osc::uint64 a = clock.TimeTag(monotonic + 1000000);
+	osc::uint64 b = clock.TimeTag(monotonic + 3000000);
+	assertEqual(osc::TimeTagToUnixNanoseconds(b) - osc::TimeTagToUnixNanoseconds(a), static_cast<osc::int64>(2000000));
+	assertEqual(clock.Estimates(), 1UL);
+
+	// And the offset is measured again once the interval is up
+	clock.TimeTag(monotonic + 1000000000);
+	assertEqual(clock.Estimates(), 2UL);
+	assertEqual(clock.Steps(), 0UL);
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestTimeTagConversions();
+	TestClockFollowsWallClock();
+	return PrintTestSummary();
+}
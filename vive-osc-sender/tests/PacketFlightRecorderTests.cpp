@@ -0,0 +1,269 @@
+//
+// Tests for the packet flight recorder: every socket send is recorded,
+// the ring keeps the latest packets, concurrent senders never leave torn
+// records in a dump, and a crash writes one
+//
+
+#include "SenderTestSupport.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "ip/PacketFlightRecorder.h"
+#include "ip/UdpSocket.h"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+static const char *const k_pchTestFile = "PacketFlightRecorderTests.flight";
+static const int k_nTestPort = 17351;
+
+// Reads a dump back into packets of the form "<thread> <sequence> ..."
+struct DumpContents {
+	FlightDumpReader reader;
+	std::vector<FlightPacket> packets;
+
+	bool Read(const char *path) {
+		if (!reader.Open(path))
+			return false;
+		FlightPacket packet;
+		while (reader.Next(packet))
+			packets.push_back(packet);
+		return true;
+	}
+};
+
+// A packet whose whole payload follows from thread and sequence, so a torn
+// one shows
+static std::size_t MakePacket(char *buffer, int thread, unsigned long sequence) {
+	std::size_t size = static_cast<std::size_t>(snprintf(buffer, 64, "%d %lu ", thread, sequence));
+	std::size_t total = 16 + (sequence * 7 + thread) % 200;
+	for (std::size_t n = size; n < total; n++)
+		buffer[n] = static_cast<char>('a' + (n + sequence) % 26);
+	return total;
+}
+
+static bool CheckPacket(const FlightPacket &packet, int &thread, unsigned long &sequence) {
+	if (sscanf(packet.data, "%d %lu ", &thread, &sequence) != 2)
+		return false;
+	char expected[256];
+	std::size_t size = MakePacket(expected, thread, sequence);
+	return size == packet.size && memcmp(expected, packet.data, size) == 0;
+}
+
+static void TestRecordsSends() {
+	PacketFlightRecorder recorder;
+	assertTrue(recorder.Start(1 << 20, 0));
+	assertTrue(PacketFlightRecorder::Active() == &recorder);
+
+	// A second recorder can't take over
+	PacketFlightRecorder other;
+	assertTrue(!other.Start(1 << 20, 0));
+
+	IpEndpointName destination("127.0.0.1", k_nTestPort);
+	UdpTransmitSocket connected(destination);
+	connected.Send("send", 4);
+	UdpSocket unconnected;
+	unconnected.SendTo(IpEndpointName("127.0.0.1", k_nTestPort + 1), "sendto", 6);
+	UdpPacket batch[2];
+	batch[0].remoteEndpoint = destination;
+	batch[0].data = "first";
+	batch[0].size = 5;
+	batch[1].remoteEndpoint = IpEndpointName("127.0.0.1", k_nTestPort + 2);
+	batch[1].data = "second";
+	batch[1].size = 6;
+	unconnected.SendToMultiple(batch, 2);
+
+	int64_t before = PacketFlightRecorder::Now();
+	assertTrue(recorder.Dump(k_pchTestFile));
+	recorder.Stop();
+	assertTrue(PacketFlightRecorder::Active() == NULL);
+
+	// Not recorded anymore
+	connected.Send("late", 4);
+
+	DumpContents dump;
+	assertTrue(dump.Read(k_pchTestFile));
+	assertEqual(dump.packets.size(), static_cast<std::size_t>(4));
+	const char *expected[] = { "send", "sendto", "first", "second" };
+	const int ports[] = { k_nTestPort, k_nTestPort + 1, k_nTestPort, k_nTestPort + 2 };
+	for (std::size_t n = 0; n < dump.packets.size() && n < 4; n++) {
+		const FlightPacket &packet = dump.packets[n];
+		assertEqual(packet.size, strlen(expected[n]));
+		assertEqual(memcmp(packet.data, expected[n], packet.size), 0);
+		assertTrue(packet.remoteEndpoint == IpEndpointName("127.0.0.1", ports[n]));
+		assertTrue(packet.timeNs <= before && packet.timeNs > before - 1000000000LL);
+	}
+	assertTrue(dump.packets[2].timeNs == dump.packets[3].timeNs);
+}
+
+// The ring keeps the newest packets
+static void TestWraparound() {
+	PacketFlightRecorder recorder;
+	assertTrue(recorder.Start(65536, 0));
+	assertEqual(recorder.Capacity(), static_cast<std::size_t>(65536));
+
+	IpEndpointName destination("127.0.0.1", k_nTestPort);
+	char buffer[256];
+	const unsigned long k_nPackets = 10000;
+	for (unsigned long n = 0; n < k_nPackets; n++)
+		recorder.Record(destination, buffer, MakePacket(buffer, 0, n), PacketFlightRecorder::Now());
+	assertTrue(recorder.BytesRecorded() > 10 * recorder.Capacity());
+
+	// Too large for the ring
+	std::vector<char> huge(40000);
+	recorder.Record(destination, &huge[0], huge.size(), PacketFlightRecorder::Now());
+	assertEqual(recorder.Skipped(), 1UL);
+
+	assertTrue(recorder.Dump(k_pchTestFile));
+	DumpContents dump;
+	assertTrue(dump.Read(k_pchTestFile));
+
+	// Consecutive up to the last packet, and as many as fit
+	bool intact = true;
+	unsigned long last = 0;
+	for (std::size_t n = 0; n < dump.packets.size(); n++) {
+		int thread;
+		unsigned long sequence;
+		if (!CheckPacket(dump.packets[n], thread, sequence) || (n > 0 && sequence != last + 1))
+			intact = false;
+		last = sequence;
+	}
+	assertTrue(intact);
+	assertEqual(last, k_nPackets - 1);
+	std::cout << "    " << dump.packets.size() << " packets of " << k_nPackets << " in a 64 KiB ring\n";
+	assertTrue(dump.packets.size() > 300 && dump.packets.size() < 1000);
+}
+
+// Dumps only have the packets of the last seconds
+static void TestWindow() {
+	PacketFlightRecorder recorder;
+	assertTrue(recorder.Start(65536, 5));
+
+	IpEndpointName destination("127.0.0.1", k_nTestPort);
+	char buffer[256];
+	int64_t now = PacketFlightRecorder::Now();
+	for (unsigned long n = 0; n < 200; n++) {
+		int64_t timeNs = (n < 100) ? now - 60000000000LL : now;
+		recorder.Record(destination, buffer, MakePacket(buffer, 0, n), timeNs);
+	}
+	assertTrue(recorder.BytesRecorded() < recorder.Capacity());
+
+	assertTrue(recorder.Dump(k_pchTestFile));
+	DumpContents dump;
+	assertTrue(dump.Read(k_pchTestFile));
+	assertEqual(dump.packets.size(), static_cast<std::size_t>(100));
+	int thread;
+	unsigned long sequence;
+	assertTrue(CheckPacket(dump.packets.front(), thread, sequence));
+	assertEqual(sequence, 100UL);
+}
+
+// Senders on several threads, dumped while they write
+static void TestConcurrentSenders() {
+	PacketFlightRecorder recorder;
+	assertTrue(recorder.Start(65536, 0));
+
+	const int k_nThreads = 4;
+	const unsigned long k_nPackets = 50000;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < k_nThreads; t++) {
+		threads.push_back(std::thread([&recorder, t, k_nPackets] {
+			IpEndpointName destination("127.0.0.1", k_nTestPort + t);
+			char buffer[256];
+			for (unsigned long n = 0; n < k_nPackets; n++)
+				recorder.Record(destination, buffer, MakePacket(buffer, t, n), PacketFlightRecorder::Now());
+		}));
+	}
+
+	int dumps = 0;
+	bool intact = true;
+	std::size_t packets = 0;
+	for (int d = 0; d < 20; d++) {
+		if (!recorder.Dump(k_pchTestFile))
+			continue;
+		dumps++;
+		DumpContents dump;
+		if (!dump.Read(k_pchTestFile)) {
+			intact = false;
+			continue;
+		}
+		// Each thread's packets in order, never torn
+		unsigned long next[k_nThreads] = { 0 };
+		bool seen[k_nThreads] = { false };
+		for (std::size_t n = 0; n < dump.packets.size(); n++) {
+			int thread;
+			unsigned long sequence;
+			if (!CheckPacket(dump.packets[n], thread, sequence) || thread < 0 || thread >= k_nThreads
+				|| dump.packets[n].remoteEndpoint.port != k_nTestPort + thread
+				|| (seen[thread] && sequence < next[thread]))
+				intact = false;
+			else {
+				seen[thread] = true;
+				next[thread] = sequence + 1;
+			}
+		}
+		packets += dump.packets.size();
+	}
+	for (std::thread &thread : threads)
+		thread.join();
+	std::cout << "    " << recorder.Torn() << " packets torn by a stalled sender\n";
+	assertEqual(dumps, 20);
+	assertTrue(intact);
+	assertTrue(packets > 0);
+}
+
+#ifndef _WIN32
+// A child that crashes leaves a dump with what it sent
+static void TestCrashDump() {
+	remove(k_pchTestFile);
+	pid_t child = fork();
+	if (child == 0) {
+		PacketFlightRecorder recorder;
+		recorder.Start(1 << 20, 10);
+		recorder.DumpOnCrash(k_pchTestFile);
+		UdpTransmitSocket socket(IpEndpointName("127.0.0.1", k_nTestPort));
+		socket.Send("last words", 10);
+		abort();
+	}
+	int status = 0;
+	waitpid(child, &status, 0);
+	assertTrue(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+
+	DumpContents dump;
+	assertTrue(dump.Read(k_pchTestFile));
+	assertEqual(dump.packets.size(), static_cast<std::size_t>(1));
+	assertEqual(memcmp(dump.packets[0].data, "last words", 10), 0);
+}
+#endif
+
+static void TestMalformedDump() {
+	FlightDumpReader reader;
+	FILE *file = fopen(k_pchTestFile, "wb");
+	fputs("not a flight recorder dump, but long enough to have a header....", file);
+	fclose(file);
+	assertTrue(!reader.Open(k_pchTestFile));
+	remove(k_pchTestFile);
+	assertTrue(!reader.Open(k_pchTestFile));
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestRecordsSends();
+	TestWraparound();
+	TestWindow();
+	TestConcurrentSenders();
+#ifndef _WIN32
+	TestCrashDump();
+#endif
+	TestMalformedDump();
+	return PrintTestSummary();
+}
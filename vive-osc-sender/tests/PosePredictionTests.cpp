@@ -0,0 +1,189 @@
+//
+// Tests for PredictPoses: constant motion is extrapolated exactly, the
+// synthetic orbit predicted a few ms ahead lands where it will be, and
+// destinations with different horizons get poses predicted that far
+//
+
+#include "SenderTestSupport.h"
+
+#include <math.h>
+
+#include <string.h>
+
+#include "PosePrediction.h"
+#include "SyntheticPoseSource.h"
+#include "LighthouseTracking.h"
+#include "osc/OscReceivedElements.h"
+
+static const int k_nTestPort = 17391;
+
+// Rotations q and -q are the same, compare with |dot|
+static double QuaternionDistance(double w1, double x1, double y1, double z1, double w2, double x2, double y2, double z2) {
+	return 1 - fabs(w1 * w2 + x1 * x2 + y1 * y2 + z1 * z2);
+}
+
+static void TestConstantRotationAboutY() {
+	// Yawed by 0.3 rad, turning at 2 rad/s about +y, moving along +x
+	const double yaw = 0.3, rate = 2.0, horizon = 0.05;
+	DevicePose pose = {};
+	pose.mDeviceToAbsoluteTracking.m[0][0] = static_cast<float>(cos(yaw));
+	pose.mDeviceToAbsoluteTracking.m[0][2] = static_cast<float>(sin(yaw));
+	pose.mDeviceToAbsoluteTracking.m[1][1] = 1;
+	pose.mDeviceToAbsoluteTracking.m[2][0] = static_cast<float>(-sin(yaw));
+	pose.mDeviceToAbsoluteTracking.m[2][2] = static_cast<float>(cos(yaw));
+	pose.mDeviceToAbsoluteTracking.m[0][3] = 1.0f;
+	pose.vVelocity.v[0] = 0.5f;
+	pose.vAngularVelocity.v[1] = static_cast<float>(rate);
+
+	PoseBatch batch(1);
+	batch.Add(pose);
+	ConvertPoses(batch);
+	PredictPoses(batch, static_cast<float>(horizon));
+
+	double expected = (yaw + rate * horizon) / 2;
+	assertNear(batch.PredictedPositionX()[0], 1.0 + 0.5 * horizon, 1e-6);
+	assertNear(batch.PredictedPositionY()[0], 0.0, 1e-6);
+	assertTrue(QuaternionDistance(batch.PredictedQuaternionW()[0], batch.PredictedQuaternionX()[0], batch.PredictedQuaternionY()[0], batch.PredictedQuaternionZ()[0],
+		cos(expected), 0, sin(expected), 0) < 1e-6);
+
+	// The converted pose is left alone
+	assertNear(batch.QuaternionY()[0], sin(yaw / 2), 1e-6);
+}
+
+static void TestZeroHorizonAndStill() {
+	DevicePose pose = {};
+	pose.mDeviceToAbsoluteTracking.m[0][0] = 1;
+	pose.mDeviceToAbsoluteTracking.m[1][1] = 1;
+	pose.mDeviceToAbsoluteTracking.m[2][2] = 1;
+	pose.mDeviceToAbsoluteTracking.m[1][3] = 1.5f;
+	pose.vAngularVelocity.v[2] = 3.0f;
+
+	PoseBatch batch(2);
+	batch.Add(pose);
+	pose.vAngularVelocity.v[2] = 0;		// below the small angle cut off
+	batch.Add(pose);
+	ConvertPoses(batch);
+
+	PredictPoses(batch, 0);
+	assertNear(batch.PredictedQuaternionW()[0], 1.0, 1e-7);
+	assertNear(batch.PredictedPositionY()[0], 1.5, 1e-7);
+
+	PredictPoses(batch, 0.1f);
+	assertNear(batch.PredictedQuaternionW()[1], 1.0, 1e-7);
+	assertNear(batch.PredictedQuaternionZ()[0], sin(0.15), 1e-6);
+}
+
+static void TestSyntheticOrbit() {
+	SyntheticConfig config;
+	config.controllerCount = 2;
+	config.trackerCount = 6;
+	config.angularSpeed = 1.5;
+	config.sampleRate = 1000;
+	SyntheticPoseSource source(config);
+
+	const double t = 1.25, horizon = 0.008;
+	PoseBatch now(k_unMaxDeviceCount), later(k_unMaxDeviceCount);
+
+	source.SetTime(t);
+	for (DeviceIndex i = 0; i < k_unMaxDeviceCount; i++) {
+		DevicePose pose;
+		if (source.GetDevicePose(i, &pose, NULL))
+			now.Add(pose);
+	}
+	source.SetTime(t + horizon);
+	for (DeviceIndex i = 0; i < k_unMaxDeviceCount; i++) {
+		DevicePose pose;
+		if (source.GetDevicePose(i, &pose, NULL))
+			later.Add(pose);
+	}
+	ConvertPoses(now);
+	ConvertPoses(later);
+	PredictPoses(now, static_cast<float>(horizon));
+
+	double maxPositionError = 0, maxRotationError = 0, maxUnpredictedError = 0;
+	for (std::size_t n = 0; n < now.Count(); n++) {
+		maxPositionError = fmax(maxPositionError, fabs(now.PredictedPositionX()[n] - later.PositionX()[n]));
+		maxPositionError = fmax(maxPositionError, fabs(now.PredictedPositionY()[n] - later.PositionY()[n]));
+		maxPositionError = fmax(maxPositionError, fabs(now.PredictedPositionZ()[n] - later.PositionZ()[n]));
+		maxRotationError = fmax(maxRotationError, QuaternionDistance(
+			now.PredictedQuaternionW()[n], now.PredictedQuaternionX()[n], now.PredictedQuaternionY()[n], now.PredictedQuaternionZ()[n],
+			later.QuaternionW()[n], later.QuaternionX()[n], later.QuaternionY()[n], later.QuaternionZ()[n]));
+		maxUnpredictedError = fmax(maxUnpredictedError, fabs(now.PositionX()[n] - later.PositionX()[n]));
+	}
+
+	// Only the curvature of the path over 8 ms is left
+	assertTrue(maxPositionError < 1e-3);
+	assertTrue(maxRotationError < 1e-5);
+	assertTrue(maxPositionError < maxUnpredictedError / 5);
+}
+
+// Position and velocity of /tracker/1 from the next messages on a socket,
+// skipping the launch notice and the other devices
+static bool ReceiveTracker(UdpReceiveSocket &socket, float position[3], float velocity[3]) {
+	char buffer[1024];
+	for (int n = 0; n < 20; n++) {
+		IpEndpointName from;
+		std::size_t size = socket.ReceiveFrom(from, buffer, sizeof(buffer));
+		osc::ReceivedPacket packet(buffer, static_cast<osc::osc_bundle_element_size_t>(size));
+		if (packet.IsBundle())
+			continue;
+		osc::ReceivedMessage message(packet);
+		if (strcmp(message.AddressPattern(), "/tracker/1") != 0)
+			continue;
+		osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+		for (int k = 0; k < 3; k++)
+			position[k] = (arg++)->AsFloat();
+		for (int k = 0; k < 3; k++)
+			velocity[k] = (arg++)->AsFloat();
+		return true;
+	}
+	return false;
+}
+
+// Two destinations 100 ms apart in horizon get positions 100 ms of
+// velocity apart, from the same frame
+static void TestHorizonPerDestination() {
+	UdpReceiveSocket nearSocket(IpEndpointName("127.0.0.1", k_nTestPort + 1));
+	UdpReceiveSocket farSocket(IpEndpointName("127.0.0.1", k_nTestPort + 2));
+
+	SyntheticConfig config;
+	config.controllerCount = 0;
+	config.trackerCount = 2;
+	SyntheticPoseSource source(config);
+	source.SetTime(1.0);
+
+	OutputProfile unpredicted;
+	assertTrue(ParseProfileFields("pos,vel", unpredicted.fields));
+	OutputProfile nearProfile = unpredicted;
+	nearProfile.predict = true;
+	nearProfile.predictionSeconds = 0.02;
+	OutputProfile farProfile = nearProfile;
+	farProfile.predictionSeconds = 0.12;
+
+	LighthouseTracking tracking(&source, IpEndpointName("127.0.0.1", k_nTestPort), unpredicted);
+	tracking.AddDestination(IpEndpointName("127.0.0.1", k_nTestPort + 1), nearProfile);
+	tracking.AddDestination(IpEndpointName("127.0.0.1", k_nTestPort + 2), farProfile);
+	tracking.RunProcedure();
+
+	float nearPosition[3], farPosition[3], velocity[3], farVelocity[3];
+	assertTrue(ReceiveTracker(nearSocket, nearPosition, velocity));
+	assertTrue(ReceiveTracker(farSocket, farPosition, farVelocity));
+	double speed = sqrt(velocity[0] * velocity[0] + velocity[1] * velocity[1] + velocity[2] * velocity[2]);
+	assertTrue(speed > 0.1);
+	for (int k = 0; k < 3; k++) {
+		assertEqual(farVelocity[k], velocity[k]);
+		assertNear(farPosition[k] - nearPosition[k], velocity[k] * 0.1, 1e-3);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestConstantRotationAboutY();
+	TestZeroHorizonAndStill();
+	TestSyntheticOrbit();
+	TestHorizonPerDestination();
+	return PrintTestSummary();
+}
@@ -0,0 +1,284 @@
+//
+// Tests for the keyframe and delta pose stream: accuracy across frames,
+// delta sizes, recovery from lost frames and allocation-free coding
+//
+
+#include "SenderTestSupport.h"
+
+#include <math.h>
+
+#include "PoseStream.h"
+#include "AllocationTracker.h"
+#include "osc/OscOutboundPacketStream.h"
+
+static const int k_nDevices = 16;
+
+// Devices drifting along slowly, the way tracked objects held by people do
+static void MovePoses(int frame, float positions[][3], float quaternions[][4]) {
+	for (int n = 0; n < k_nDevices; n++) {
+		double t = frame * 0.004 + n;
+		positions[n][0] = static_cast<float>(sin(t) * 2);
+		positions[n][1] = static_cast<float>(1 + 0.1 * n);
+		positions[n][2] = static_cast<float>(cos(t) * 2);
+		double a = t / 2;
+		quaternions[n][0] = static_cast<float>(cos(a));
+		quaternions[n][1] = 0;
+		quaternions[n][2] = static_cast<float>(sin(a));
+		quaternions[n][3] = 0;
+	}
+}
+
+static void EncodeFrame(PoseStreamEncoder &encoder, int frame) {
+	float positions[k_nDevices][3];
+	float quaternions[k_nDevices][4];
+	MovePoses(frame, positions, quaternions);
+	encoder.Begin();
+	for (int n = 0; n < k_nDevices; n++)
+		encoder.Add(n % 2 == 0, n / 2 + 1, positions[n], quaternions[n]);
+	encoder.End();
+}
+
+// Decoded poses match what one frame of the compact blob gives
+static void TestMatchesCompactPoses() {
+	CompactPoseFormat format;
+	PoseStreamEncoder encoder(format, 10);
+	PoseStreamDecoder decoder;
+	int keyframes = 0, deltas = 0;
+	for (int frame = 0; frame < 35; frame++) {
+		EncodeFrame(encoder, frame);
+
+		float positions[k_nDevices][3];
+		float quaternions[k_nDevices][4];
+		MovePoses(frame, positions, quaternions);
+		CompactPoseWriter writer;
+		writer.Begin(format);
+		for (int n = 0; n < k_nDevices; n++)
+			writer.Add(n % 2 == 0, n / 2 + 1, positions[n], quaternions[n]);
+		CompactPose expected[k_nDevices];
+		CompactPoseFormat expectedFormat;
+		int expectedCount = 0;
+		DecodeCompactPoses(writer.Data(), writer.Size(), expectedFormat, expected, k_nDevices, expectedCount);
+
+		CompactPose decoded[k_nDevices];
+		CompactPoseFormat decodedFormat;
+		int count = 0;
+		PoseStreamResult result = decoder.Decode(encoder.Data(), encoder.Size(), decodedFormat, decoded, k_nDevices, count);
+		assertTrue(result == (encoder.IsKeyframe() ? PoseStreamResult_Keyframe : PoseStreamResult_Delta));
+		(encoder.IsKeyframe() ? keyframes : deltas)++;
+		assertTrue(decodedFormat == format);
+		assertEqual(count, k_nDevices);
+		for (int n = 0; n < count; n++) {
+			if (decoded[n].isController != expected[n].isController || decoded[n].ordinal != expected[n].ordinal)
+				fail_("device id", __FILE__, __LINE__);
+			if (memcmp(decoded[n].position, expected[n].position, sizeof(decoded[n].position)) != 0
+				|| memcmp(decoded[n].quaternion, expected[n].quaternion, sizeof(decoded[n].quaternion)) != 0)
+				fail_("pose differs from the compact blob", __FILE__, __LINE__);
+		}
+	}
+
+	// The first frame, then every tenth
+	assertEqual(keyframes, 4);
+	assertEqual(deltas, 31);
+	assertEqual(encoder.Keyframes(), 4UL);
+	assertEqual(decoder.FramesLost(), 0UL);
+}
+
+static void TestDeltaSizes() {
+	CompactPoseFormat format;
+	PoseStreamEncoder encoder(format, 100);
+	const float position[3] = { 0.5f, 1.2f, -0.3f };
+	const float rotation[4] = { 0.5f, 0.5f, -0.5f, 0.5f };
+
+	encoder.Begin();
+	for (int n = 1; n <= 8; n++)
+		encoder.Add(false, n, position, rotation);
+	encoder.End();
+	assertTrue(encoder.IsKeyframe());
+	std::size_t keyframeSize = encoder.Size();
+
+	// Devices that didn't move cost their id, two widths and the flag
+	encoder.Begin();
+	for (int n = 1; n <= 8; n++)
+		encoder.Add(false, n, position, rotation);
+	encoder.End();
+	assertTrue(!encoder.IsKeyframe());
+	assertEqual(encoder.Size(), k_unPoseStreamHeaderSize + (8 * (8 + 5 + 1 + 5) + 7) / 8);
+	assertTrue(encoder.Size() < keyframeSize / 2);
+	std::cout << "    8 still devices: keyframe " << keyframeSize << " bytes, delta " << encoder.Size() << "\n";
+
+	// Moving ones grow with the distance from the keyframe
+	encoder.Begin();
+	const float moved[3] = { 0.51f, 1.2f, -0.3f };
+	for (int n = 1; n <= 8; n++)
+		encoder.Add(false, n, moved, rotation);
+	encoder.End();
+	std::size_t movedSize = encoder.Size();
+	assertTrue(movedSize > k_unPoseStreamHeaderSize + 19);
+	assertTrue(movedSize < keyframeSize);
+
+	// An empty frame doesn't use up a sequence number
+	encoder.Begin();
+	encoder.End();
+	assertEqual(encoder.Count(), 0);
+	assertEqual(encoder.Deltas(), 2UL);
+}
+
+static void TestLostFrames() {
+	CompactPoseFormat format;
+	PoseStreamEncoder encoder(format, 5);
+	PoseStreamDecoder decoder;
+	CompactPose poses[k_nDevices];
+	CompactPoseFormat decodedFormat;
+	int count = 0;
+
+	// Frame 0 is a keyframe, deltas 1 .. 4 can be decoded whichever of them arrive
+	for (int frame = 0; frame < 5; frame++) {
+		EncodeFrame(encoder, frame);
+		if (frame == 1 || frame == 2)
+			continue;
+		PoseStreamResult result = decoder.Decode(encoder.Data(), encoder.Size(), decodedFormat, poses, k_nDevices, count);
+		assertTrue(result == (frame == 0 ? PoseStreamResult_Keyframe : PoseStreamResult_Delta));
+		assertEqual(count, k_nDevices);
+	}
+	assertEqual(decoder.FramesLost(), 2UL);
+
+	// Losing keyframe 5 leaves the deltas after it undecodable until frame 10
+	for (int frame = 5; frame < 11; frame++) {
+		EncodeFrame(encoder, frame);
+		if (frame == 5)
+			continue;
+		PoseStreamResult result = decoder.Decode(encoder.Data(), encoder.Size(), decodedFormat, poses, k_nDevices, count);
+		if (frame < 10) {
+			assertTrue(result == PoseStreamResult_WaitingForKeyframe);
+			assertEqual(count, 0);
+		} else {
+			assertTrue(result == PoseStreamResult_Keyframe);
+			assertEqual(count, k_nDevices);
+		}
+	}
+	assertEqual(decoder.FramesLost(), 3UL);
+	assertEqual(decoder.FramesWaiting(), 4UL);
+
+	// A receiver can ask for a keyframe instead of waiting for one
+	EncodeFrame(encoder, 11);
+	assertTrue(!encoder.IsKeyframe());
+	encoder.RequestKeyframe();
+	EncodeFrame(encoder, 12);
+	assertTrue(encoder.IsKeyframe());
+	EncodeFrame(encoder, 13);
+	assertTrue(!encoder.IsKeyframe());
+}
+
+// A device that wasn't in the keyframe is sent against the origin
+static void TestNewDevice() {
+	CompactPoseFormat format;
+	PoseStreamEncoder encoder(format, 100);
+	PoseStreamDecoder decoder;
+	const float position[3] = { 1.0f, 1.5f, -2.0f };
+	const float rotation[4] = { 0.5f, 0.5f, -0.5f, 0.5f };
+	CompactPose poses[2];
+	CompactPoseFormat decodedFormat;
+	int count = 0;
+
+	encoder.Begin();
+	encoder.Add(false, 1, position, rotation);
+	encoder.End();
+	assertTrue(decoder.Decode(encoder.Data(), encoder.Size(), decodedFormat, poses, 2, count) == PoseStreamResult_Keyframe);
+
+	encoder.Begin();
+	encoder.Add(false, 1, position, rotation);
+	encoder.Add(true, 3, position, rotation);
+	encoder.End();
+	assertTrue(decoder.Decode(encoder.Data(), encoder.Size(), decodedFormat, poses, 2, count) == PoseStreamResult_Delta);
+	assertEqual(count, 2);
+	assertTrue(poses[1].isController);
+	assertEqual(poses[1].ordinal, 3);
+	assertNear(poses[1].position[2], -2.0, 0.0001);
+	assertNear(poses[1].quaternion[2], -0.5, 0.0001);
+}
+
+static void TestMalformedBlobs() {
+	CompactPoseFormat format;
+	PoseStreamEncoder encoder(format, 100);
+	const float position[3] = { 1.0f, 1.5f, -2.0f };
+	const float rotation[4] = { 1, 0, 0, 0 };
+	encoder.Begin();
+	encoder.Add(false, 1, position, rotation);
+	encoder.End();
+
+	CompactPose pose;
+	CompactPoseFormat decodedFormat;
+	int count = 0;
+	char copy[64];
+	memcpy(copy, encoder.Data(), encoder.Size());
+	PoseStreamDecoder decoder;
+	assertTrue(decoder.Decode(copy, encoder.Size() - 1, decodedFormat, &pose, 1, count) == PoseStreamResult_Malformed);
+	assertTrue(decoder.Decode(copy, 10, decodedFormat, &pose, 1, count) == PoseStreamResult_Malformed);
+	copy[encoder.Size()] = 0;
+	assertTrue(decoder.Decode(copy, encoder.Size() + 1, decodedFormat, &pose, 1, count) == PoseStreamResult_Malformed);
+	copy[1] = 7;	// unknown kind
+	assertTrue(decoder.Decode(copy, encoder.Size(), decodedFormat, &pose, 1, count) == PoseStreamResult_Malformed);
+	copy[1] = PoseStreamKind_Keyframe;
+	copy[0] = static_cast<char>(k_nCompactPoseVersion);	// a plain compact blob
+	assertTrue(decoder.Decode(copy, encoder.Size(), decodedFormat, &pose, 1, count) == PoseStreamResult_Malformed);
+	copy[0] = static_cast<char>(k_nPoseStreamVersion);
+	assertTrue(decoder.Decode(copy, encoder.Size(), decodedFormat, &pose, 1, count) == PoseStreamResult_Keyframe);
+	assertEqual(count, 1);
+}
+
+static void TestNoAllocations() {
+	CompactPoseFormat format;
+	PoseStreamEncoder *encoder = new PoseStreamEncoder(format, 10);
+	PoseStreamDecoder *decoder = new PoseStreamDecoder();
+	CompactPose poses[k_nDevices];
+	CompactPoseFormat decodedFormat;
+	int count = 0;
+
+	// Every form of new, and on glibc malloc, is counted by the
+	// AllocationHooks.cpp linked into this test
+	assertTrue(AllocationTrackingEnabled());
+	uint64_t before = ThreadAllocationCount();
+	for (int frame = 0; frame < 100; frame++) {
+		EncodeFrame(*encoder, frame);
+		decoder->Decode(encoder->Data(), encoder->Size(), decodedFormat, poses, k_nDevices, count);
+	}
+	assertEqual(ThreadAllocationCount() - before, static_cast<uint64_t>(0));
+	assertEqual(count, k_nDevices);
+
+	delete encoder;
+	delete decoder;
+}
+
+static void TestReceivedMessage() {
+	CompactPoseFormat format;
+	PoseStreamEncoder encoder(format, 10);
+	EncodeFrame(encoder, 0);
+
+	char buffer[512];
+	osc::OutboundPacketStream p(buffer, sizeof(buffer));
+	p << osc::BeginMessage(k_pchCompactPoseAddress)
+		<< osc::Blob(encoder.Data(), static_cast<osc::osc_bundle_element_size_t>(encoder.Size())) << osc::EndMessage;
+
+	osc::ReceivedMessage m(osc::ReceivedPacket(p.Data(), static_cast<osc::osc_bundle_element_size_t>(p.Size())));
+	PoseStreamDecoder decoder;
+	CompactPose poses[k_nDevices];
+	CompactPoseFormat decodedFormat;
+	int count = 0;
+	assertTrue(decoder.Decode(*m.ArgumentsBegin(), decodedFormat, poses, k_nDevices, count) == PoseStreamResult_Keyframe);
+	assertEqual(count, k_nDevices);
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestMatchesCompactPoses();
+	TestDeltaSizes();
+	TestLostFrames();
+	TestNewDevice();
+	TestMalformedBlobs();
+	TestNoAllocations();
+	TestReceivedMessage();
+	return PrintTestSummary();
+}
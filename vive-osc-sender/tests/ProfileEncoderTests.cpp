@@ -0,0 +1,245 @@
+//
+// Tests for output profiles and ProfileEncoder: device filters, field
+// selection and rate limiting
+//
+
+#include "SenderTestSupport.h"
+
+#include <string.h>
+
+#include "ProfileEncoder.h"
+#include "osc/OscReceivedElements.h"
+
+static const int k_nTestPort = 17321;
+
+// Loopback destination and the columns a frame is encoded from, device n's
+// values are n * 100 + the value's index in FrameColumns order
+struct EncoderFixture {
+	UdpReceiveSocket receiveSocket;
+	UdpFanout fanout;
+	float values[28][k_unMaxDeviceCount];
+	FrameColumns columns;
+	TrackingFrame frame;
+
+	EncoderFixture()
+		: receiveSocket(IpEndpointName("127.0.0.1", k_nTestPort)) {
+		fanout.AddDestination(IpEndpointName("127.0.0.1", k_nTestPort));
+
+		for (int value = 0; value < 28; value++)
+			for (DeviceIndex n = 0; n < k_unMaxDeviceCount; n++)
+				values[value][n] = static_cast<float>(n * 100 + value);
+		int value = 0;
+		for (int k = 0; k < 3; k++) columns.position[k] = values[value++];
+		for (int k = 0; k < 4; k++) columns.quaternion[k] = values[value++];
+		for (int k = 0; k < 12; k++) columns.matrix[k] = values[value++];
+		for (int k = 0; k < 3; k++) columns.velocity[k] = values[value++];
+		for (int k = 0; k < 3; k++) columns.angularVelocity[k] = values[value++];
+		columns.trigger = values[value++];
+		for (int k = 0; k < 2; k++) columns.axes[k] = values[value++];
+
+		memset(&frame, 0, sizeof(frame));
+		AddDevice(DeviceClass_Controller, "/controller/1");
+		AddDevice(DeviceClass_GenericTracker, "/tracker/1");
+	}
+
+	void AddDevice(DeviceClass deviceClass, const char *address) {
+		TrackedDeviceSample &sample = frame.devices[frame.deviceCount];
+		sample.unDevice = static_cast<DeviceIndex>(frame.deviceCount + 3);
+		sample.deviceClass = deviceClass;
+		sample.ordinal = 1;
+		sample.profiles = 1;
+		snprintf(sample.oscAddress, sizeof(sample.oscAddress), "%s", address);
+		frame.deviceCount++;
+	}
+
+	std::size_t Receive(char *buffer, std::size_t size) {
+		IpEndpointName from;
+		return receiveSocket.ReceiveFrom(from, buffer, size);
+	}
+};
+
+static void TestFieldSelection() {
+	EncoderFixture fixture;
+	OutputProfile profile;
+	assertTrue(ParseProfileFields("pos,matrix,trigger", profile.fields));
+	ProfileEncoder encoder(profile, 0, fixture.fanout);
+	encoder.Bind(fixture.columns);
+
+	encoder.Encode(fixture.frame);
+	fixture.fanout.Flush();
+	assertEqual(encoder.MessagesSent(), 2UL);
+
+	// Controller: position, matrix, trigger. Tracker: no trigger.
+	char buffer[1024];
+	const unsigned int expectedCounts[] = { 3 + 12 + 1, 3 + 12 };
+	const float expectedLast[] = { 0 * 100 + 25, 1 * 100 + 18 };
+	for (int n = 0; n < 2; n++) {
+		std::size_t size = fixture.Receive(buffer, sizeof(buffer));
+		osc::ReceivedMessage m(osc::ReceivedPacket(buffer, static_cast<osc::osc_bundle_element_size_t>(size)));
+		assertEqual(m.ArgumentCount(), expectedCounts[n]);
+
+		osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
+		assertEqual(arg->AsFloat(), static_cast<float>(n * 100 + 0));
+		for (unsigned int k = 1; k < expectedCounts[n]; k++)
+			++arg;
+		assertEqual(arg->AsFloat(), expectedLast[n]);
+	}
+}
+
+static void TestTimeTagField() {
+	EncoderFixture fixture;
+	fixture.frame.timeTag = 0xe1234567800000ffULL;
+	OutputProfile profile;
+	assertTrue(ParseProfileFields("pos,time", profile.fields));
+	ProfileEncoder encoder(profile, 0, fixture.fanout);
+	encoder.Bind(fixture.columns);
+	encoder.Encode(fixture.frame);
+	fixture.fanout.Flush();
+
+	// The capture time follows the values as the last argument
+	char buffer[1024];
+	std::size_t size = fixture.Receive(buffer, sizeof(buffer));
+	osc::ReceivedMessage m(osc::ReceivedPacket(buffer, static_cast<osc::osc_bundle_element_size_t>(size)));
+	assertEqual(m.ArgumentCount(), 4U);
+	osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
+	++arg; ++arg; ++arg;
+	assertTrue(arg->IsTimeTag());
+	assertEqual(arg->AsTimeTag(), fixture.frame.timeTag);
+}
+
+static void TestCompactField() {
+	EncoderFixture fixture;
+	OutputProfile profile;
+	assertTrue(ParseCompactPoseFormat("1,24", profile.compact));
+	profile.fields |= ProfileField_Compact;
+	ProfileEncoder encoder(profile, 0, fixture.fanout);
+	encoder.Bind(fixture.columns);
+	encoder.Encode(fixture.frame);
+	fixture.fanout.Flush();
+
+	// Only the controller's trigger is left for a message of its own
+	char buffer[1024];
+	std::size_t size = fixture.Receive(buffer, sizeof(buffer));
+	osc::ReceivedMessage trigger(osc::ReceivedPacket(buffer, static_cast<osc::osc_bundle_element_size_t>(size)));
+	assertEqual(strcmp(trigger.AddressPattern(), "/controller/1"), 0);
+	assertEqual(trigger.ArgumentCount(), 1U);
+
+	size = fixture.Receive(buffer, sizeof(buffer));
+	osc::ReceivedMessage poses(osc::ReceivedPacket(buffer, static_cast<osc::osc_bundle_element_size_t>(size)));
+	assertEqual(strcmp(poses.AddressPattern(), k_pchCompactPoseAddress), 0);
+	CompactPoseFormat format;
+	CompactPose decoded[4];
+	int count = 0;
+	assertTrue(DecodeCompactPoses(*poses.ArgumentsBegin(), format, decoded, 4, count));
+	assertEqual(count, 2);
+	assertTrue(decoded[0].isController);
+	assertTrue(!decoded[1].isController);
+	assertEqual(decoded[1].ordinal, 1);
+	assertNear(decoded[1].position[2], 102.0, 0.0005);
+	assertEqual(encoder.MessagesSent(), 2UL);
+}
+
+static void TestKeyframeInterval() {
+	EncoderFixture fixture;
+	OutputProfile profile;
+	assertTrue(ParseCompactPoseFormat("1,24", profile.compact));
+	assertTrue(ParseProfileFields("quat", profile.fields));
+	profile.fields |= ProfileField_Compact;
+	profile.keyframeInterval = 2;
+	ProfileEncoder encoder(profile, 0, fixture.fanout);
+	encoder.Bind(fixture.columns);
+
+	// A keyframe, a delta, then a keyframe again
+	PoseStreamDecoder decoder;
+	const PoseStreamResult expected[] = { PoseStreamResult_Keyframe, PoseStreamResult_Delta, PoseStreamResult_Keyframe };
+	for (int frame = 0; frame < 3; frame++) {
+		encoder.Encode(fixture.frame);
+		fixture.fanout.Flush();
+
+		char buffer[1024];
+		std::size_t size = fixture.Receive(buffer, sizeof(buffer));
+		osc::ReceivedMessage m(osc::ReceivedPacket(buffer, static_cast<osc::osc_bundle_element_size_t>(size)));
+		assertEqual(strcmp(m.AddressPattern(), k_pchCompactPoseAddress), 0);
+		CompactPoseFormat format;
+		CompactPose decoded[4];
+		int count = 0;
+		assertTrue(decoder.Decode(*m.ArgumentsBegin(), format, decoded, 4, count) == expected[frame]);
+		assertEqual(count, 2);
+		assertNear(decoded[1].position[2], 102.0, 0.0005);
+	}
+	assertEqual(encoder.MessagesSent(), 3UL);
+}
+
+static void TestDeviceFilter() {
+	OutputProfile profile;
+	assertTrue(ParseProfileDevices("trackers,serial=LHR-1", profile));
+	assertEqual(profile.devices, static_cast<unsigned int>(ProfileDevices_Trackers));
+
+	RegisteredDevice device;
+	memset(&device, 0, sizeof(device));
+	device.deviceClass = DeviceClass_GenericTracker;
+	snprintf(device.serial, sizeof(device.serial), "LHR-1234");
+	assertTrue(profile.Accepts(device));
+	snprintf(device.serial, sizeof(device.serial), "LHR-2234");
+	assertTrue(!profile.Accepts(device));
+	device.deviceClass = DeviceClass_Controller;
+	snprintf(device.serial, sizeof(device.serial), "LHR-1234");
+	assertTrue(!profile.Accepts(device));
+
+	assertTrue(!ParseProfileDevices("trackers,hands", profile));
+	assertTrue(!ParseProfileFields("pos,colour", profile.fields));
+
+	// Devices without the profile's bit are left out
+	EncoderFixture fixture;
+	fixture.frame.devices[0].profiles = 2;
+	ProfileEncoder encoder(OutputProfile(), 0, fixture.fanout);
+	encoder.Bind(fixture.columns);
+	encoder.Encode(fixture.frame);
+	fixture.fanout.Flush();
+	assertEqual(encoder.MessagesSent(), 1UL);
+
+	char buffer[1024];
+	std::size_t size = fixture.Receive(buffer, sizeof(buffer));
+	osc::ReceivedMessage m(osc::ReceivedPacket(buffer, static_cast<osc::osc_bundle_element_size_t>(size)));
+	assertEqual(strcmp(m.AddressPattern(), "/tracker/1"), 0);
+	assertEqual(m.ArgumentCount(), 7U);
+}
+
+static void TestRateLimit() {
+	EncoderFixture fixture;
+	OutputProfile profile;
+	profile.rate = 100;
+	profile.devices = ProfileDevices_Trackers;
+	ProfileEncoder encoder(profile, 0, fixture.fanout);
+	encoder.Bind(fixture.columns);
+
+	// 500 Hz frames for 40 ms, every fifth one is sent
+	for (int frame = 0; frame < 20; frame++) {
+		fixture.frame.captureTimeNs = 1000000000LL + frame * 2000000LL;
+		encoder.Encode(fixture.frame);
+		fixture.fanout.Flush();
+	}
+	assertEqual(encoder.FramesSent(), 4UL);
+
+	// A gap longer than the period restarts the schedule, no burst after it
+	for (int frame = 0; frame < 5; frame++) {
+		fixture.frame.captureTimeNs = 2000000000LL + frame * 2000000LL;
+		encoder.Encode(fixture.frame);
+	}
+	fixture.fanout.Flush();
+	assertEqual(encoder.FramesSent(), 5UL);
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestFieldSelection();
+	TestTimeTagField();
+	TestCompactField();
+	TestKeyframeInterval();
+	TestDeviceFilter();
+	TestRateLimit();
+	return PrintTestSummary();
+}
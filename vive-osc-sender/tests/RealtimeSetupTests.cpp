@@ -0,0 +1,181 @@
+//
+// Tests for the real-time setup: what is reported granted is what the
+// thread really got, refusals are reported as such, and prefaulting leaves
+// memory resident and unchanged. Whether SCHED_FIFO and mlockall are
+// allowed depends on where the tests run, so those only check consistency.
+//
+
+#include "SenderTestSupport.h"
+
+#include <string.h>
+#include <atomic>
+#include <thread>
+
+#include "RealtimeSetup.h"
+#include "SyntheticPoseSource.h"
+#include "LighthouseTracking.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+static const int k_nTestPort = 17371;
+
+#ifdef __linux__
+// The first core this thread may run on
+static int AllowedCpu() {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+		return 0;
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		if (CPU_ISSET(cpu, &set))
+			return cpu;
+	return 0;
+}
+
+static void TestAffinity() {
+	int cpu = AllowedCpu();
+
+	// On this thread
+	ThreadRealtimeStatus status = ConfigureThread(CurrentRealtimeThread(), cpu, 0);
+	assertEqual(status.affinity, RealtimeOutcome_Granted);
+	assertEqual(status.priority, RealtimeOutcome_NotRequested);
+	assertEqual(CurrentCpu(), cpu);
+
+	// A core that doesn't exist is refused, with the reason
+	status = ConfigureThread(CurrentRealtimeThread(), 100000, 0);
+	assertEqual(status.affinity, RealtimeOutcome_Denied);
+	assertTrue(status.affinityError != 0);
+
+	// On another thread, through its handle
+	std::atomic<bool> configured(false);
+	int threadCpu = -1;
+	std::thread thread([&configured, &threadCpu] {
+		while (!configured)
+			std::this_thread::yield();
+		threadCpu = CurrentCpu();
+	});
+	status = ConfigureThread(thread.native_handle(), cpu, 0);
+	configured = true;
+	thread.join();
+	assertEqual(status.affinity, RealtimeOutcome_Granted);
+	assertEqual(threadCpu, cpu);
+}
+#endif
+
+#ifndef _WIN32
+// Granted exactly when the thread reads back as SCHED_FIFO at that priority
+static void TestPriority() {
+	std::atomic<bool> configured(false);
+	int policy = -1;
+	int priority = -1;
+	std::thread thread([&] {
+		while (!configured)
+			std::this_thread::yield();
+		sched_param param;
+		pthread_getschedparam(pthread_self(), &policy, &param);
+		priority = param.sched_priority;
+	});
+	ThreadRealtimeStatus status = ConfigureThread(thread.native_handle(), -1, 10);
+	configured = true;
+	thread.join();
+
+	assertEqual(status.affinity, RealtimeOutcome_NotRequested);
+	assertTrue(status.priority == RealtimeOutcome_Granted || status.priority == RealtimeOutcome_Denied);
+	if (status.priority == RealtimeOutcome_Granted) {
+		assertEqual(policy, SCHED_FIFO);
+		assertEqual(priority, 10);
+	} else {
+		assertTrue(status.priorityError != 0);
+		assertTrue(policy != SCHED_FIFO);
+	}
+	std::cout << "    SCHED_FIFO " << RealtimeOutcomeName(status.priority) << "\n";
+
+	// Back to normal scheduling is always allowed
+	status = ConfigureThread(CurrentRealtimeThread(), -1, -1);
+	assertEqual(status.priority, RealtimeOutcome_Granted);
+}
+
+static void TestLockMemory() {
+	int error = 0;
+	RealtimeOutcome outcome = LockMemory(error);
+	assertTrue(outcome == RealtimeOutcome_Granted || outcome == RealtimeOutcome_Denied);
+	assertEqual(error != 0, outcome == RealtimeOutcome_Denied);
+	std::cout << "    mlockall " << RealtimeOutcomeName(outcome) << "\n";
+	UnlockMemory();
+}
+
+// Every page resident afterwards, and the contents untouched
+static void TestPrefaultMemory() {
+	const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+	const std::size_t k_unPages = 64;
+	void *mapping = mmap(NULL, k_unPages * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	assertTrue(mapping != MAP_FAILED);
+	if (mapping == MAP_FAILED)
+		return;
+	char *memory = static_cast<char *>(mapping);
+	memory[5 * page + 10] = 42;
+
+	unsigned char resident[k_unPages];
+	mincore(mapping, k_unPages * page, resident);
+	int residentBefore = 0;
+	for (std::size_t n = 0; n < k_unPages; n++)
+		residentBefore += resident[n] & 1;
+	assertTrue(residentBefore < static_cast<int>(k_unPages));
+
+	// Not page aligned, the pages it overlaps count
+	assertEqual(PrefaultMemory(memory + 100, k_unPages * page - 200), k_unPages * page - 200);
+	mincore(mapping, k_unPages * page, resident);
+	int residentAfter = 0;
+	for (std::size_t n = 0; n < k_unPages; n++)
+		residentAfter += resident[n] & 1;
+	assertEqual(residentAfter, static_cast<int>(k_unPages));
+	assertEqual(memory[5 * page + 10], static_cast<char>(42));
+	assertEqual(memory[7 * page], static_cast<char>(0));
+	munmap(mapping, k_unPages * page);
+
+	PrefaultStack();
+}
+#endif
+
+// Prefaulting doesn't change what the sender does
+static void TestPrefaultedSender() {
+	SyntheticConfig config;
+	config.trackerCount = 8;
+	SyntheticPoseSource source(config);
+	LighthouseTracking tracking(&source, IpEndpointName("127.0.0.1", k_nTestPort));
+	tracking.SetFrameBundling(true);
+	assertTrue(tracking.PrefaultBuffers() > sizeof(TrackingFrame) * 2);
+	tracking.StartTransmitThread(RingOverflow_Block);
+	ThreadRealtimeStatus status = ConfigureThread(tracking.TransmitThreadHandle(), -1, 0);
+	assertEqual(status.affinity, RealtimeOutcome_NotRequested);
+
+	double time = 0;
+	for (int n = 0; n < 100; n++) {
+		source.SetTime(time += 0.002);
+		tracking.RunProcedure();
+	}
+	tracking.StopTransmitThread();
+	assertEqual(tracking.PacketsSent(), 100UL);
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+#ifdef __linux__
+	TestAffinity();
+#endif
+#ifndef _WIN32
+	TestPriority();
+	TestLockMemory();
+	TestPrefaultMemory();
+#endif
+	TestPrefaultedSender();
+	return PrintTestSummary();
+}
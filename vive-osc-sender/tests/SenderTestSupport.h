@@ -0,0 +1,57 @@
+// SENDERTESTSUPPORT.h
+#ifndef _SENDERTESTSUPPORT_H_
+#define _SENDERTESTSUPPORT_H_
+
+//
+// Pass/fail bookkeeping shared by the sender tests, same output format as
+// oscpack's OscUnitTests. Each test program is a single translation unit.
+//
+
+#include <iostream>
+#include <math.h>
+
+static int passCount_=0, failCount_=0;
+
+inline void pass_( const char *expr, const char *file, int line )
+{
+    ++passCount_;
+    std::cout << file << "(" << line << "): PASSED : " << expr << "\n";
+}
+
+inline void fail_( const char *expr, const char *file, int line )
+{
+    ++failCount_;
+    std::cout << file << "(" << line << "): FAILED : " << expr << "\n";
+}
+
+template <typename T>
+inline void assertEqual_( const T& lhs, const T& rhs, const char *expr, const char *file, int line )
+{
+    if( lhs == rhs )
+        pass_( expr, file, line );
+    else
+        fail_( expr, file, line );
+}
+
+inline void assertNear_( double lhs, double rhs, double tolerance, const char *expr, const char *file, int line )
+{
+    if( fabs( lhs - rhs ) <= tolerance )
+        pass_( expr, file, line );
+    else{
+        fail_( expr, file, line );
+        std::cout << "    " << lhs << " vs " << rhs << " (tolerance " << tolerance << ")\n";
+    }
+}
+
+#define assertEqual( a, b ) assertEqual_( (a), (b), #a " == " #b, __FILE__, __LINE__ )
+#define assertTrue( a ) ((a) ? pass_( #a, __FILE__, __LINE__ ) : fail_( #a, __FILE__, __LINE__ ))
+#define assertNear( a, b, tolerance ) assertNear_( (a), (b), (tolerance), #a " ~= " #b, __FILE__, __LINE__ )
+
+// Prints the summary line, returns the process exit code
+inline int PrintTestSummary()
+{
+    std::cout << (passCount_+failCount_) << " tests run, " << passCount_ << " passed, " << failCount_ << " failed.\n";
+    return failCount_ == 0 ? 0 : 1;
+}
+
+#endif // _SENDERTESTSUPPORT_H_
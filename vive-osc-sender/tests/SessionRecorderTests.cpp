@@ -0,0 +1,172 @@
+//
+// Tests for session files: frames of 64 devices over several chunks read
+// back as written, and files that were never closed. The sustained rate is
+// measured by SessionRecorderBench.
+//
+
+#include "SenderTestSupport.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "SessionRecorder.h"
+#include "SyntheticPoseSource.h"
+#include "MonotonicClock.h"
+
+static const char *const k_pchTestFile = "SessionRecorderTests.session";
+
+// 2 controllers and 62 trackers, nothing else
+static SyntheticConfig FullConfig() {
+	SyntheticConfig config;
+	config.controllerCount = 2;
+	config.trackerCount = 62;
+	config.baseStationCount = 0;
+	config.includeHmd = false;
+	return config;
+}
+
+// A frame of every registered device at the given time, like
+// LighthouseTracking::AcquireFrame reads it
+static void AcquireFrame(SyntheticPoseSource &source, const DeviceRegistry &registry, unsigned long frameNumber, TrackingFrame &frame) {
+	source.SetTime(frameNumber * 0.001);
+	frame.captureTimeNs = MonotonicNanoseconds();
+	frame.timeTag = 0xe100000000000000ULL + frameNumber;
+	frame.frameNumber = frameNumber;
+	frame.templateGeneration = registry.Generation();
+	frame.deviceCount = 0;
+	for (int n = 0; n < registry.DeviceCount(); n++) {
+		const RegisteredDevice &device = registry.Device(n);
+		TrackedDeviceSample &sample = frame.devices[frame.deviceCount++];
+		ControllerState state;
+		source.GetDevicePose(device.unDevice, &sample.pose, &state);
+		sample.unDevice = device.unDevice;
+		sample.deviceClass = device.deviceClass;
+		sample.ordinal = device.ordinal;
+		sample.profiles = 1;
+		bool isController = (device.deviceClass == DeviceClass_Controller);
+		sample.trigger = isController ? state.rAxis[1].x : 0;
+		sample.axes[0] = isController ? state.rAxis[0].x : 0;
+		sample.axes[1] = isController ? state.rAxis[0].y : 0;
+		memcpy(sample.oscAddress, device.oscAddress, sizeof(sample.oscAddress));
+	}
+}
+
+static void TestChunks() {
+	SyntheticPoseSource source(FullConfig());
+	DeviceRegistry registry;
+	registry.Refresh(source);
+	assertEqual(registry.DeviceCount(), 64);
+
+	// 1 MiB chunks are 8192 records, a new chunk every 128 frames
+	SessionRecorder recorder;
+	assertTrue(recorder.Open(k_pchTestFile, 1 << 20));
+
+	// A frame that finds the next chunk not mapped yet is dropped; it is
+	// recorded again once the background thread caught up, so every frame
+	// ends up in the file however busy the machine is
+	const int k_nFrames = 1000;
+	TrackingFrame *frame = new TrackingFrame;
+	for (int n = 0; n < k_nFrames; n++) {
+		AcquireFrame(source, registry, static_cast<unsigned long>(n), *frame);
+		unsigned long overruns = recorder.Overruns();
+		recorder.Record(*frame, registry);
+		while (recorder.Overruns() != overruns) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			overruns = recorder.Overruns();
+			recorder.Record(*frame, registry);
+		}
+	}
+	assertEqual(recorder.Frames(), static_cast<unsigned long>(k_nFrames));
+	assertEqual(recorder.RecordCount(), static_cast<uint64_t>(k_nFrames * 64));
+	recorder.Close();
+
+	SessionReader reader;
+	assertTrue(reader.Open(k_pchTestFile));
+	assertEqual(reader.RecordCount(), static_cast<std::size_t>(k_nFrames * 64));
+
+	// Spot check a frame against what the source gives for it
+	AcquireFrame(source, registry, 777, *frame);
+	const SessionRecord *records = reader.Records() + 777 * 64;
+	for (int n = 0; n < 64; n++) {
+		const SessionRecord &record = records[n];
+		const TrackedDeviceSample &sample = frame->devices[n];
+		if (record.frameNumber != 777 || record.timeTag != frame->timeTag
+			|| record.frameDevice != n || record.frameDeviceCount != 64)
+			fail_("frame of a record", __FILE__, __LINE__);
+		if (record.deviceIndex != sample.unDevice || record.ordinal != sample.ordinal
+			|| ((record.flags & SessionRecord_Controller) != 0) != (sample.deviceClass == DeviceClass_Controller)
+			|| strncmp(record.serial, registry.Device(n).serial, k_unSessionSerialSize) != 0)
+			fail_("device of a record", __FILE__, __LINE__);
+		if (record.flags != (SessionRecord_Present | SessionRecord_PoseValid | SessionRecord_TrackingOK
+				| (sample.deviceClass == DeviceClass_Controller ? SessionRecord_Controller : 0))
+			|| memcmp(record.matrix, sample.pose.mDeviceToAbsoluteTracking.m, sizeof(record.matrix)) != 0
+			|| memcmp(record.velocity, sample.pose.vVelocity.v, sizeof(record.velocity)) != 0
+			|| memcmp(record.angularVelocity, sample.pose.vAngularVelocity.v, sizeof(record.angularVelocity)) != 0
+			|| record.trigger != sample.trigger || record.axes[0] != sample.axes[0] || record.axes[1] != sample.axes[1])
+			fail_("pose of a record", __FILE__, __LINE__);
+	}
+	assertEqual(strncmp(records[0].serial, "SYN-C-", 6), 0);
+
+	// Capture times only go forward
+	bool ordered = true;
+	for (std::size_t n = 1; n < reader.RecordCount(); n++)
+		if (reader.Record(n).captureTimeNs < reader.Record(n - 1).captureTimeNs)
+			ordered = false;
+	assertTrue(ordered);
+	delete frame;
+}
+
+// What a crashed sender leaves: no count in the header and zeroed chunks
+// past the last record
+static void TestUnclosedFile() {
+	SyntheticPoseSource source(FullConfig());
+	DeviceRegistry registry;
+	registry.Refresh(source);
+
+	SessionRecorder recorder;
+	assertTrue(recorder.Open(k_pchTestFile, 100000));	// rounded up to 128 KiB
+	TrackingFrame *frame = new TrackingFrame;
+	for (int n = 0; n < 50; n++) {
+		AcquireFrame(source, registry, static_cast<unsigned long>(n), *frame);
+		frame->deviceCount = 10;
+		recorder.Record(*frame, registry);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	assertEqual(recorder.RecordCount(), static_cast<uint64_t>(500));
+
+	// Read while the recorder still has it open
+	SessionReader reader;
+	assertTrue(reader.Open(k_pchTestFile));
+	assertEqual(reader.RecordCount(), static_cast<std::size_t>(500));
+	assertEqual(reader.Record(499).frameNumber, 49U);
+	reader.Close();
+
+	// An empty frame writes nothing
+	frame->deviceCount = 0;
+	recorder.Record(*frame, registry);
+	recorder.Close();
+	assertTrue(reader.Open(k_pchTestFile));
+	assertEqual(reader.RecordCount(), static_cast<std::size_t>(500));
+	reader.Close();
+	delete frame;
+
+	// Not a session file
+	FILE *file = fopen(k_pchTestFile, "wb");
+	fputs("not a session file, but long enough to have a header.............................................................................", file);
+	fclose(file);
+	assertTrue(!reader.Open(k_pchTestFile));
+	remove(k_pchTestFile);
+	assertTrue(!reader.Open(k_pchTestFile));
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestChunks();
+	TestUnclosedFile();
+	return PrintTestSummary();
+}
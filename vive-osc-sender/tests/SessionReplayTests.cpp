@@ -0,0 +1,267 @@
+//
+// Tests for session replay: frames read back as recorded, seeking, the
+// three timing modes and sending through LighthouseTracking
+//
+
+#include "SenderTestSupport.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "SessionReplay.h"
+#include "SyntheticPoseSource.h"
+#include "LighthouseTracking.h"
+#include "MonotonicClock.h"
+#include "osc/OscReceivedElements.h"
+
+static const char *const k_pchTestFile = "SessionReplayTests.session";
+static const int k_nTestPort = 17341;
+
+// 200 frames 1 ms apart, 1 s ago
+static const int k_nFrames = 200;
+static const int64_t k_nFrameSpacingNs = 1000000;
+
+// 2 controllers and 4 trackers, nothing else
+static SyntheticConfig SmallConfig() {
+	SyntheticConfig config;
+	config.controllerCount = 2;
+	config.trackerCount = 4;
+	config.baseStationCount = 0;
+	config.includeHmd = false;
+	return config;
+}
+
+// A frame of every registered device, like LighthouseTracking::AcquireFrame
+// reads it, with made up capture times
+static void AcquireFrame(SyntheticPoseSource &source, const DeviceRegistry &registry, int64_t startNs, unsigned long frameNumber, TrackingFrame &frame) {
+	source.SetTime(frameNumber * 0.001);
+	frame.captureTimeNs = startNs + static_cast<int64_t>(frameNumber) * k_nFrameSpacingNs;
+	frame.timeTag = 0xe100000000000000ULL + frameNumber;
+	frame.frameNumber = frameNumber;
+	frame.templateGeneration = registry.Generation();
+	frame.deviceCount = 0;
+	for (int n = 0; n < registry.DeviceCount(); n++) {
+		const RegisteredDevice &device = registry.Device(n);
+		TrackedDeviceSample &sample = frame.devices[frame.deviceCount++];
+		ControllerState state;
+		source.GetDevicePose(device.unDevice, &sample.pose, &state);
+		sample.unDevice = device.unDevice;
+		sample.deviceClass = device.deviceClass;
+		sample.ordinal = device.ordinal;
+		sample.profiles = 1;
+		bool isController = (device.deviceClass == DeviceClass_Controller);
+		sample.trigger = isController ? state.rAxis[1].x : 0;
+		sample.axes[0] = isController ? state.rAxis[0].x : 0;
+		sample.axes[1] = isController ? state.rAxis[0].y : 0;
+		memcpy(sample.oscAddress, device.oscAddress, sizeof(sample.oscAddress));
+	}
+}
+
+// Every odd frame loses its last tracker, as if it went out of sight
+static void WriteSession() {
+	SyntheticPoseSource source(SmallConfig());
+	DeviceRegistry registry;
+	registry.Refresh(source);
+
+	SessionRecorder recorder;
+	assertTrue(recorder.Open(k_pchTestFile, 1 << 20));
+	TrackingFrame *frame = new TrackingFrame;
+	int64_t startNs = MonotonicNanoseconds() - 1000000000LL;
+	for (int n = 0; n < k_nFrames; n++) {
+		AcquireFrame(source, registry, startNs, static_cast<unsigned long>(n), *frame);
+		if (n % 2 == 1)
+			frame->deviceCount--;
+		recorder.Record(*frame, registry);
+	}
+	recorder.Close();
+	delete frame;
+}
+
+static void TestFrames() {
+	SessionReader reader;
+	assertTrue(reader.Open(k_pchTestFile));
+	ReplayConfig config;
+	config.timing = ReplayTiming_MaxSpeed;
+	SessionReplay replay(reader, config);
+	assertNear(replay.DurationSeconds(), 0.199, 1e-9);
+
+	SyntheticPoseSource source(SmallConfig());
+	DeviceRegistry registry;
+	registry.Refresh(source);
+	TrackingFrame *expected = new TrackingFrame;
+	TrackingFrame *frame = new TrackingFrame;
+
+	int frames = 0;
+	unsigned int generation = 0;
+	while (replay.NextFrame(*frame)) {
+		AcquireFrame(source, registry, 0, static_cast<unsigned long>(frames), *expected);
+		if (frames == 0)
+			generation = frame->templateGeneration;
+		if (frame->frameNumber != static_cast<unsigned long>(frames) || frame->timeTag != expected->timeTag
+			|| frame->deviceCount != (frames % 2 == 1 ? 5 : 6))
+			fail_("frame", __FILE__, __LINE__);
+		// Devices dropping out don't renumber the others
+		if (frame->templateGeneration != generation)
+			fail_("template generation", __FILE__, __LINE__);
+		for (int n = 0; n < frame->deviceCount; n++) {
+			const TrackedDeviceSample &sample = frame->devices[n];
+			const TrackedDeviceSample &original = expected->devices[n];
+			if (sample.unDevice != original.unDevice || sample.deviceClass != original.deviceClass
+				|| sample.ordinal != original.ordinal || strcmp(sample.oscAddress, original.oscAddress) != 0)
+				fail_("device", __FILE__, __LINE__);
+			if (memcmp(&sample.pose.mDeviceToAbsoluteTracking, &original.pose.mDeviceToAbsoluteTracking, sizeof(PoseMatrix34)) != 0
+				|| memcmp(&sample.pose.vVelocity, &original.pose.vVelocity, sizeof(PoseVector3)) != 0
+				|| !sample.pose.bPoseIsValid || !sample.pose.bTrackingOK
+				|| sample.trigger != original.trigger || sample.axes[0] != original.axes[0])
+				fail_("pose", __FILE__, __LINE__);
+		}
+		frames++;
+	}
+	assertEqual(frames, k_nFrames);
+	assertEqual(replay.Frames(), static_cast<unsigned long>(k_nFrames));
+
+	// Profiles see the recorded serials
+	const RegisteredDevice &device = replay.Devices()[frame->devices[0].unDevice];
+	assertEqual(strncmp(device.serial, registry.Device(0).serial, k_unSessionSerialSize), 0);
+	assertEqual(replay.Devices()[63].deviceClass, DeviceClass_Invalid);
+	delete expected;
+	delete frame;
+}
+
+static void TestSeek() {
+	SessionReader reader;
+	assertTrue(reader.Open(k_pchTestFile));
+	SessionReplay replay(reader);
+	TrackingFrame *frame = new TrackingFrame;
+
+	assertTrue(replay.Seek(0.1));
+	assertTrue(replay.NextFrame(*frame));
+	assertEqual(frame->frameNumber, 100UL);
+
+	// Between frames goes to the next one
+	assertTrue(replay.Seek(0.0505));
+	assertTrue(replay.NextFrame(*frame));
+	assertEqual(frame->frameNumber, 51UL);
+	assertEqual(frame->deviceCount, 5);
+
+	assertTrue(replay.Seek(0));
+	assertTrue(replay.NextFrame(*frame));
+	assertEqual(frame->frameNumber, 0UL);
+
+	assertTrue(replay.Seek(0.199));
+	assertTrue(replay.NextFrame(*frame));
+	assertEqual(frame->frameNumber, 199UL);
+	assertTrue(!replay.NextFrame(*frame));
+
+	assertTrue(!replay.Seek(0.2));
+	assertTrue(!replay.NextFrame(*frame));
+	delete frame;
+}
+
+// Seconds it takes to play the session from seconds into it, and the
+// frames played
+static double PlayFrom(const SessionReader &reader, const ReplayConfig &config, double seconds, int &frames) {
+	SessionReplay replay(reader, config);
+	TrackingFrame *frame = new TrackingFrame;
+	replay.Seek(seconds);
+	int64_t start = MonotonicNanoseconds();
+	for (frames = 0; replay.NextFrame(*frame); frames++) {}
+	delete frame;
+	return (MonotonicNanoseconds() - start) / 1e9;
+}
+
+static void TestTiming() {
+	SessionReader reader;
+	assertTrue(reader.Open(k_pchTestFile));
+
+	// The last 50 frames span 49 ms. Pacing may only ever be late, how
+	// fast max speed is is measured by SessionReplayBench.
+	int frames = 0;
+	ReplayConfig original;
+	double elapsed = PlayFrom(reader, original, 0.15, frames);
+	assertTrue(elapsed >= 0.049);
+	assertEqual(frames, 50);
+
+	// 199 ms at 4x
+	ReplayConfig scaled;
+	assertTrue(ParseReplaySpeed("4", scaled));
+	assertEqual(scaled.timing, ReplayTiming_Scaled);
+	elapsed = PlayFrom(reader, scaled, 0, frames);
+	assertTrue(elapsed >= 0.199 / 4);
+	assertEqual(frames, k_nFrames);
+
+	ReplayConfig fastest;
+	assertTrue(ParseReplaySpeed("max", fastest));
+	assertEqual(fastest.timing, ReplayTiming_MaxSpeed);
+	PlayFrom(reader, fastest, 0, frames);
+	assertEqual(frames, k_nFrames);
+
+	ReplayConfig config;
+	assertTrue(ParseReplaySpeed("1", config));
+	assertEqual(config.timing, ReplayTiming_Original);
+	assertTrue(!ParseReplaySpeed("0", config));
+	assertTrue(!ParseReplaySpeed("fast", config));
+}
+
+// Replayed frames come out of the sender under their recorded addresses,
+// filtered by the destination's profile
+static void TestSendsThroughPipeline() {
+	UdpReceiveSocket receiveSocket(IpEndpointName("127.0.0.1", k_nTestPort));
+	SyntheticConfig empty;
+	empty.controllerCount = 0;
+	empty.trackerCount = 0;
+	empty.baseStationCount = 0;
+	empty.includeHmd = false;
+	SyntheticPoseSource source(empty);
+	OutputProfile profile;
+	profile.devices = ProfileDevices_Trackers;
+	LighthouseTracking *tracking = new LighthouseTracking(&source, IpEndpointName("127.0.0.1", k_nTestPort), profile);
+
+	SessionReader reader;
+	assertTrue(reader.Open(k_pchTestFile));
+	ReplayConfig config;
+	config.timing = ReplayTiming_MaxSpeed;
+	SessionReplay replay(reader, config);
+	TrackingFrame *frame = new TrackingFrame;
+	for (int n = 0; n < 10 && replay.NextFrame(*frame); n++)
+		tracking->InjectFrame(*frame, replay.Devices());
+
+	// 4 trackers in even frames, 3 in odd ones
+	assertEqual(tracking->PacketsSent(), 35UL);
+	char buffer[1024];
+	int trackers[5] = { 0 };
+	for (int n = 0; n < 35; n++) {
+		IpEndpointName from;
+		std::size_t size = receiveSocket.ReceiveFrom(from, buffer, sizeof(buffer));
+		osc::ReceivedPacket packet(buffer, static_cast<osc::osc_bundle_element_size_t>(size));
+		// The launch notice
+		if (packet.IsBundle()) {
+			n--;
+			continue;
+		}
+		osc::ReceivedMessage m(packet);
+		int ordinal = 0;
+		if (sscanf(m.AddressPattern(), "/tracker/%d", &ordinal) == 1 && ordinal >= 1 && ordinal <= 4)
+			trackers[ordinal]++;
+	}
+	assertEqual(trackers[1], 10);
+	assertEqual(trackers[2], 10);
+	assertEqual(trackers[3], 10);
+	assertEqual(trackers[4], 5);
+	delete frame;
+	delete tracking;
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	WriteSession();
+	TestFrames();
+	TestSeek();
+	TestTiming();
+	TestSendsThroughPipeline();
+	remove(k_pchTestFile);
+	return PrintTestSummary();
+}
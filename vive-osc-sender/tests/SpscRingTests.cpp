@@ -0,0 +1,178 @@
+//
+// Tests for SpscRing: ordering, both overflow policies, and that a
+// consumer racing a dropping producer never sees a torn record
+//
+
+#include "SenderTestSupport.h"
+
+#include <thread>
+
+#include "SpscRing.h"
+
+// Every word carries the sequence number, so a half overwritten record shows
+struct TestRecord {
+	unsigned long sequence;
+	unsigned long check[31];
+};
+
+static void Fill(TestRecord &record, unsigned long sequence) {
+	record.sequence = sequence;
+	for (int i = 0; i < 31; i++)
+		record.check[i] = sequence * 31 + i;
+}
+
+static bool Intact(const TestRecord &record) {
+	for (int i = 0; i < 31; i++)
+		if (record.check[i] != record.sequence * 31 + i)
+			return false;
+	return true;
+}
+
+static void TestFifoOrder() {
+	SpscRing<TestRecord, 8> ring;
+	TestRecord record;
+
+	assertTrue(!ring.Pop(record));
+	for (unsigned long i = 0; i < 5; i++) {
+		Fill(record, i);
+		assertTrue(ring.Push(record));
+	}
+	assertEqual(ring.Size(), static_cast<std::size_t>(5));
+
+	bool inOrder = true;
+	for (unsigned long i = 0; i < 5; i++)
+		inOrder = inOrder && ring.Pop(record) && record.sequence == i && Intact(record);
+	assertTrue(inOrder);
+	assertTrue(!ring.Pop(record));
+	assertEqual(ring.Dropped(), 0ul);
+	assertEqual(ring.MaxOccupancy(), 5ul);
+}
+
+static void TestDropOldestKeepsNewest() {
+	SpscRing<TestRecord, 8> ring(RingOverflow_DropOldest);
+	TestRecord record;
+
+	for (unsigned long i = 0; i < 11; i++) {
+		Fill(record, i);
+		ring.Push(record);
+	}
+	assertEqual(ring.Size(), static_cast<std::size_t>(8));
+	assertEqual(ring.Dropped(), 3ul);
+	assertEqual(ring.Pushed(), 11ul);
+	assertEqual(ring.MaxOccupancy(), 8ul);
+
+	// 0, 1 and 2 were dropped
+	bool inOrder = true;
+	for (unsigned long i = 3; i < 11; i++)
+		inOrder = inOrder && ring.Pop(record) && record.sequence == i;
+	assertTrue(inOrder);
+	assertTrue(!ring.Pop(record));
+}
+
+static void TestBlockLosesNothing() {
+	SpscRing<TestRecord, 4> ring(RingOverflow_Block);
+	const unsigned long count = 100000;
+
+	std::thread producer([&ring, count] {
+		TestRecord record;
+		for (unsigned long i = 0; i < count; i++) {
+			Fill(record, i);
+			ring.Push(record);
+		}
+	});
+
+	unsigned long expected = 0;
+	bool ok = true;
+	TestRecord record;
+	while (expected < count) {
+		if (!ring.Pop(record)) {
+			std::this_thread::yield();
+			continue;
+		}
+		ok = ok && record.sequence == expected && Intact(record);
+		expected++;
+	}
+	producer.join();
+
+	assertTrue(ok);
+	assertEqual(ring.Dropped(), 0ul);
+	assertTrue(ring.MaxOccupancy() <= 4ul);
+}
+
+static void TestBlockedProducerCanBeAborted() {
+	SpscRing<TestRecord, 2> ring(RingOverflow_Block);
+	std::atomic<bool> abort(true);
+	TestRecord record;
+	Fill(record, 0);
+
+	assertTrue(ring.Push(record, &abort));
+	assertTrue(ring.Push(record, &abort));
+	assertTrue(!ring.Push(record, &abort));
+	assertEqual(ring.Blocked(), 1ul);
+}
+
+static void TestConcurrentDropOldest() {
+	SpscRing<TestRecord, 4> ring(RingOverflow_DropOldest);
+	const unsigned long count = 200000;
+	std::atomic<bool> done(false);
+
+	std::thread producer([&ring, &done, count] {
+		TestRecord record;
+		for (unsigned long i = 1; i <= count; i++) {
+			Fill(record, i);
+			ring.Push(record);
+		}
+		done = true;
+	});
+
+	unsigned long last = 0, received = 0;
+	bool ok = true;
+	TestRecord record;
+	for (;;) {
+		bool finished = done;
+		while (ring.Pop(record)) {
+			ok = ok && record.sequence > last && Intact(record);
+			last = record.sequence;
+			received++;
+		}
+		if (finished)
+			break;
+		std::this_thread::yield();
+	}
+	producer.join();
+
+	assertTrue(ok);
+	assertEqual(last, count);	// the newest record always survives
+	assertEqual(received + ring.Dropped(), count);
+}
+
+static void TestWaitForData() {
+	SpscRing<TestRecord, 4> ring;
+	assertTrue(!ring.WaitForData(std::chrono::microseconds(1000)));
+
+	std::thread producer([&ring] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		TestRecord record;
+		Fill(record, 7);
+		ring.Push(record);
+	});
+	assertTrue(ring.WaitForData(std::chrono::microseconds(2000000)));
+	producer.join();
+
+	TestRecord record;
+	assertTrue(ring.Pop(record) && record.sequence == 7);
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestFifoOrder();
+	TestDropOldestKeepsNewest();
+	TestBlockLosesNothing();
+	TestBlockedProducerCanBeAborted();
+	TestConcurrentDropOldest();
+	TestWaitForData();
+	return PrintTestSummary();
+}
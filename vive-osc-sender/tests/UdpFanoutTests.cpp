@@ -0,0 +1,85 @@
+//
+// Tests for UdpFanout: every destination gets every packet from one
+// batched send, and a failing destination doesn't hold up the others
+//
+
+#include "SenderTestSupport.h"
+
+#include <string.h>
+#include <vector>
+
+#include "UdpFanout.h"
+
+static const int k_nFirstTestPort = 17311;
+static const int k_nSecondTestPort = 17312;
+
+static std::size_t Receive(UdpReceiveSocket &socket, char *buffer, std::size_t size) {
+	IpEndpointName from;
+	return socket.ReceiveFrom(from, buffer, size);
+}
+
+static void TestEveryDestinationGetsEveryPacket() {
+	UdpReceiveSocket first(IpEndpointName("127.0.0.1", k_nFirstTestPort));
+	UdpReceiveSocket second(IpEndpointName("127.0.0.1", k_nSecondTestPort));
+	UdpFanout fanout;
+	assertEqual(fanout.AddDestination(IpEndpointName("127.0.0.1", k_nFirstTestPort)), 0);
+	assertEqual(fanout.AddDestination(IpEndpointName("127.0.0.1", k_nSecondTestPort)), 1);
+
+	const char *packets[] = { "first packet", "second", "third and last" };
+	for (const char *packet : packets)
+		fanout.QueueToAll(packet, strlen(packet));
+	fanout.Flush();
+
+	assertEqual(fanout.SendCalls(), 1UL);
+	assertEqual(fanout.PacketsSent(0), 3UL);
+	assertEqual(fanout.PacketsSent(1), 3UL);
+
+	char buffer[256];
+	UdpReceiveSocket *receivers[] = { &first, &second };
+	for (UdpReceiveSocket *receiver : receivers) {
+		for (const char *packet : packets) {
+			std::size_t size = Receive(*receiver, buffer, sizeof(buffer));
+			assertEqual(size, strlen(packet));
+			assertEqual(memcmp(buffer, packet, size), 0);
+		}
+	}
+
+	// Nothing queued, nothing sent
+	fanout.Flush();
+	assertEqual(fanout.SendCalls(), 1UL);
+}
+
+static void TestErrorsAreCountedPerDestination() {
+	UdpReceiveSocket first(IpEndpointName("127.0.0.1", k_nFirstTestPort));
+	UdpReceiveSocket second(IpEndpointName("127.0.0.1", k_nSecondTestPort));
+	UdpFanout fanout;
+	fanout.AddDestination(IpEndpointName("127.0.0.1", k_nFirstTestPort));
+	fanout.AddDestination(IpEndpointName("127.0.0.1", k_nSecondTestPort));
+
+	// Larger than a UDP datagram can be, so only this one fails
+	std::vector<char> oversized(k_unMaxUdpPacketSize + 100, 'x');
+	fanout.Queue(0, &oversized[0], oversized.size());
+	fanout.QueueToAll("after", 5);
+	fanout.Flush();
+
+	assertEqual(fanout.Errors(0), 1UL);
+	assertEqual(fanout.Errors(1), 0UL);
+	assertEqual(fanout.PacketsSent(0), 1UL);
+	assertEqual(fanout.PacketsSent(1), 1UL);
+
+	// The packets after the failed one still went out
+	char buffer[256];
+	assertEqual(Receive(first, buffer, sizeof(buffer)), static_cast<std::size_t>(5));
+	assertEqual(Receive(second, buffer, sizeof(buffer)), static_cast<std::size_t>(5));
+	assertEqual(memcmp(buffer, "after", 5), 0);
+}
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	TestEveryDestinationGetsEveryPacket();
+	TestErrorsAreCountedPerDestination();
+	return PrintTestSummary();
+}